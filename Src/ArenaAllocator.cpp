@@ -0,0 +1,68 @@
+#include "ArenaAllocator.h"
+
+// Std
+#include <iterator>
+
+void ArenaAllocator::Reset(uint64_t InCapacity)
+{
+    FreeRanges.clear();
+    Capacity = InCapacity;
+    Used = 0;
+    if (Capacity > 0) { FreeRanges.emplace(0, Capacity); }
+}
+
+bool ArenaAllocator::Allocate(uint64_t Size, uint64_t& OutOffset)
+{
+    if (Size == 0)
+    {
+        OutOffset = 0;
+        return true;
+    }
+
+    // Lowest range that fits, so the arena fills from the front and the tail stays one large range.
+    for (auto It = FreeRanges.begin(); It != FreeRanges.end(); ++It)
+    {
+        if (It->second < Size) { continue; }
+
+        OutOffset = It->first;
+        const uint64_t Left = It->second - Size;
+        FreeRanges.erase(It);
+        if (Left > 0) { FreeRanges.emplace(OutOffset + Size, Left); }
+        Used += Size;
+        return true;
+    }
+    return false;
+}
+
+void ArenaAllocator::Free(uint64_t Offset, uint64_t Size)
+{
+    if (Size == 0) { return; }
+
+    Used -= Size;
+    auto Next = FreeRanges.lower_bound(Offset);
+    if (Next != FreeRanges.begin())
+    {
+        auto Prev = std::prev(Next);
+        if (Prev->first + Prev->second == Offset)
+        {
+            Offset = Prev->first;
+            Size += Prev->second;
+            FreeRanges.erase(Prev);
+        }
+    }
+    if (Next != FreeRanges.end() && Offset + Size == Next->first)
+    {
+        Size += Next->second;
+        FreeRanges.erase(Next);
+    }
+    FreeRanges.emplace(Offset, Size);
+}
+
+uint64_t ArenaAllocator::GetFragmented() const
+{
+    if (FreeRanges.empty()) { return 0; }
+
+    const auto& Last = *FreeRanges.rbegin();
+    const uint64_t Tail = Last.first + Last.second == Capacity ? Last.second : 0;
+    return GetFree() - Tail;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+// First fit sub-allocation of one large buffer, counted in elements of the buffer's stride so an offset is directly a base vertex
+// or first index. Free ranges are kept by offset and merged with their neighbours when freed.
+class ArenaAllocator
+{
+public:
+    void Reset(uint64_t InCapacity); // Everything free.
+
+    // False when no free range is large enough, the caller repacks the arena into a larger buffer then.
+    bool Allocate(uint64_t Size, uint64_t& OutOffset);
+    void Free(uint64_t Offset, uint64_t Size);
+
+    uint64_t GetCapacity() const { return Capacity; }
+    uint64_t GetUsed() const { return Used; }
+    uint64_t GetFree() const { return Capacity - Used; }
+    uint64_t GetFragmented() const; // Free elements in holes before the last allocated range, only repacking gets them back whole.
+    size_t GetNumFreeRanges() const { return FreeRanges.size(); }
+
+private:
+    std::map<uint64_t, uint64_t> FreeRanges; // Offset to size.
+    uint64_t Capacity = 0;
+    uint64_t Used = 0;
+};
@@ -9,12 +9,35 @@ using namespace DirectX;
 void Camera::UpdateWVP(CB_WVP& WVP) const
 {
     // Using Left handed coordinate systems, but matrices need to be transposed for hlsl.
-    WVP.ViewMatrix = XMMatrixLookAtRH(Position, FocusPosition, UpAxis); 
-    WVP.ViewMatrix = XMMatrixTranspose(WVP.ViewMatrix);
+    WVP.ViewMatrix = XMMatrixTranspose(GetViewMatrix());
 
     float AR = G_MainWindow->RendererDX->AspectRatio;
-    WVP.ProjectionMatrix = XMMatrixPerspectiveFovRH(XMConvertToRadians(FieldOfView), AR, NearPlane, FarPlane);
-    WVP.ProjectionMatrix = XMMatrixTranspose(WVP.ProjectionMatrix);
+    WVP.ProjectionMatrix = XMMatrixTranspose(GetProjectionMatrix(AR));
+}
+
+XMMATRIX Camera::GetViewMatrix() const
+{
+    return XMMatrixLookAtRH(Position, FocusPosition, UpAxis);
+}
+
+XMMATRIX Camera::GetProjectionMatrix(float AspectRatio) const
+{
+    return XMMatrixPerspectiveFovRH(XMConvertToRadians(FieldOfView), AspectRatio, NearPlane, FarPlane);
+}
+
+Frustum Camera::GetFrustum(float AspectRatio) const
+{
+    return Frustum::FromViewProjection(XMMatrixMultiply(GetViewMatrix(), GetProjectionMatrix(AspectRatio)));
+}
+
+void Camera::GetPickRay(float X, float Y, float Width, float Height, XMFLOAT3& OutOrigin, XMFLOAT3& OutDirection) const
+{
+    // Unproject the pixel at the far plane, viewport Y points down while clip space Y points up.
+    const XMMATRIX InvViewProjection = XMMatrixInverse(nullptr, XMMatrixMultiply(GetViewMatrix(), GetProjectionMatrix(Width / Height)));
+    const XMVECTOR FarPoint = XMVector3TransformCoord(XMVectorSet(2.0f * X / Width - 1.0f, 1.0f - 2.0f * Y / Height, 1.0f, 1.0f), InvViewProjection);
+
+    XMStoreFloat3(&OutOrigin, Position);
+    XMStoreFloat3(&OutDirection, XMVector3Normalize(XMVectorSubtract(FarPoint, Position)));
 }
 
 void Camera::Rotate(float X, float Y)
@@ -1,18 +1,32 @@
 #pragma once
 #include <DirectXMath.h>
 
+#include "Frustum.h"
+
 
 class Camera
 {
 public:
 
     void UpdateWVP(struct CB_WVP& WVP) const;
+
+    // Untransposed row vector matrices, as used on the CPU.
+    DirectX::XMMATRIX GetViewMatrix() const;
+    DirectX::XMMATRIX GetProjectionMatrix(float AspectRatio) const;
+    Frustum GetFrustum(float AspectRatio) const;
+
+    // World space ray through a viewport pixel, from the camera position with a normalised direction.
+    void GetPickRay(float X, float Y, float Width, float Height, DirectX::XMFLOAT3& OutOrigin, DirectX::XMFLOAT3& OutDirection) const;
     void Rotate(float X, float Y);
     void Translate(float X, float Y, float Z);
     void Pan(float X, float Y);
     void Zoom(float Zoom);
 
     DirectX::XMVECTOR GetViewDirection() const;
+    DirectX::XMVECTOR GetPosition() const { return Position; }
+    float GetFieldOfView() const { return FieldOfView; } // Vertical, in degrees.
+    float GetNearPlane() const { return NearPlane; }
+    float GetFarPlane() const { return FarPlane; }
     
 private:
     
@@ -1,6 +1,7 @@
 
 // Windows
 #include <Windows.h>
+#include <cstring>
 
 // Renderer
 #include "pch.h"
@@ -14,6 +15,13 @@ extern "C" { __declspec(dllexport) unsigned long NvOptimusEnablement = 0x0000000
 int WINAPI WinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPSTR lpCmdLine, _In_ int nCmdShow)
 {
     MainWindow App = MainWindow(hInstance);
+
+    // -hydra loads scenes through the Hydra front-end instead of the USD traversal.
+    if (lpCmdLine && std::strstr(lpCmdLine, "-hydra"))
+    {
+        App.Scene->SetFrontEnd(SceneFrontEnd::Hydra);
+    }
+
     const int ExitCode = App.Run();
 
     return ExitCode;
@@ -0,0 +1,91 @@
+#include "DrawSorting.h"
+
+// Std
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+    constexpr size_t RadixBits = 8;
+    constexpr size_t RadixSize = size_t(1) << RadixBits;
+    constexpr size_t NumDigits = 64 / RadixBits;
+
+    constexpr uint64_t FieldMask(uint32_t Bits) { return (uint64_t(1) << Bits) - 1; }
+
+    // Float bits flipped so they order as unsigned integers, negative floats below positive ones.
+    uint32_t OrderedFloatBits(float Value)
+    {
+        uint32_t Bits;
+        std::memcpy(&Bits, &Value, sizeof(Bits));
+        return (Bits & 0x80000000u) ? ~Bits : (Bits | 0x80000000u);
+    }
+}
+
+uint64_t DrawSorting::MakeKey(DrawPass Pass, uint32_t Pipeline, uint32_t Material, float Depth)
+{
+    if (std::isnan(Depth)) { Depth = INFINITY; }
+    const uint64_t QuantisedDepth = OrderedFloatBits(Depth) >> (32 - DepthBits);
+
+    uint64_t Key = static_cast<uint64_t>(Pass) & FieldMask(PassBits);
+    Key = (Key << PipelineBits) | (Pipeline & FieldMask(PipelineBits));
+    Key = (Key << MaterialBits) | (Material & FieldMask(MaterialBits));
+    return (Key << DepthBits) | QuantisedDepth;
+}
+
+uint32_t DrawSorting::GetPipeline(uint64_t Key)
+{
+    return static_cast<uint32_t>((Key >> (MaterialBits + DepthBits)) & FieldMask(PipelineBits));
+}
+
+uint64_t DrawSorting::GetState(uint64_t Key)
+{
+    return Key >> DepthBits;
+}
+
+void DrawPacketSorter::Sort(std::vector<DrawPacket>& Packets)
+{
+    NumPasses = 0;
+    const size_t NumPackets = Packets.size();
+    if (NumPackets < 2) { return; }
+
+    // Every digit's histogram in one read.
+    uint32_t Counts[NumDigits][RadixSize] = {};
+    for (const DrawPacket& Packet : Packets)
+    {
+        const uint64_t Key = Packet.Key;
+        for (size_t Digit = 0; Digit < NumDigits; Digit++)
+        {
+            Counts[Digit][(Key >> (Digit * RadixBits)) & (RadixSize - 1)]++;
+        }
+    }
+
+    Scratch.resize(NumPackets);
+    DrawPacket* Source = Packets.data();
+    DrawPacket* Destination = Scratch.data();
+    for (size_t Digit = 0; Digit < NumDigits; Digit++)
+    {
+        // A digit every key shares leaves the order as it is.
+        uint32_t* DigitCounts = Counts[Digit];
+        const size_t Shift = Digit * RadixBits;
+        if (DigitCounts[(Source[0].Key >> Shift) & (RadixSize - 1)] == NumPackets) { continue; }
+
+        uint32_t Offset = 0;
+        for (size_t Bucket = 0; Bucket < RadixSize; Bucket++)
+        {
+            const uint32_t Count = DigitCounts[Bucket];
+            DigitCounts[Bucket] = Offset;
+            Offset += Count;
+        }
+        for (size_t Idx = 0; Idx < NumPackets; Idx++)
+        {
+            const DrawPacket& Packet = Source[Idx];
+            Destination[DigitCounts[(Packet.Key >> Shift) & (RadixSize - 1)]++] = Packet;
+        }
+        std::swap(Source, Destination);
+        NumPasses++;
+    }
+
+    // An odd number of passes leaves the sorted packets in the scratch memory, swapping keeps both allocations for the next sort.
+    if (Source != Packets.data()) { Packets.swap(Scratch); }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One draw waiting to be recorded, sorted by its key so draws sharing a pipeline and bindings are recorded together and front to back.
+struct DrawPacket
+{
+    uint64_t Key = 0;
+    uint32_t Mesh = 0; // Index into the pipeline's meshes.
+    uint32_t Padding = 0;
+};
+
+// Where draws are recorded, highest order bits of the key.
+enum class DrawPass : uint32_t
+{
+    Opaque,
+    Count
+};
+
+namespace DrawSorting
+{
+    // Key fields from the highest bits down: pass, pipeline state and material, then the depth quantised to 24 bits.
+    constexpr uint32_t PassBits = 4;
+    constexpr uint32_t PipelineBits = 8;
+    constexpr uint32_t MaterialBits = 28;
+    constexpr uint32_t DepthBits = 24;
+
+    // Larger fields are masked. Depth is a distance from the eye and keeps its order to the precision of a float with 15 mantissa
+    // bits, about one part in 32768 at any distance.
+    uint64_t MakeKey(DrawPass Pass, uint32_t Pipeline, uint32_t Material, float Depth);
+    uint32_t GetPipeline(uint64_t Key);
+    uint64_t GetState(uint64_t Key); // Pass, pipeline and material, everything but the depth.
+}
+
+// LSD radix sort of draw packets by key, one byte per pass. The histograms of every byte come from one read of the keys and bytes
+// every key shares are skipped, so a scene with one pass and pipeline only sorts the bytes that differ. Stable, packets with equal
+// keys stay in the order they were added. Keep one sorter around, its scratch memory is reused by every sort.
+class DrawPacketSorter
+{
+public:
+    void Sort(std::vector<DrawPacket>& Packets);
+
+    size_t GetNumPasses() const { return NumPasses; } // Bytes the last sort scattered.
+
+private:
+    std::vector<DrawPacket> Scratch;
+    size_t NumPasses = 0;
+};
@@ -0,0 +1,35 @@
+#include "Frustum.h"
+
+using namespace DirectX;
+
+Frustum Frustum::FromViewProjection(FXMMATRIX ViewProjection)
+{
+    // Gribb and Hartmann, with row vectors the clip space planes are combinations of the matrix columns.
+    const XMMATRIX Columns = XMMatrixTranspose(ViewProjection);
+    const XMVECTOR PlaneVectors[6] =
+    {
+        XMVectorAdd(Columns.r[3], Columns.r[0]),
+        XMVectorSubtract(Columns.r[3], Columns.r[0]),
+        XMVectorAdd(Columns.r[3], Columns.r[1]),
+        XMVectorSubtract(Columns.r[3], Columns.r[1]),
+        Columns.r[2],
+        XMVectorSubtract(Columns.r[3], Columns.r[2]),
+    };
+
+    Frustum Result;
+    for (size_t Idx = 0; Idx < 6; Idx++)
+    {
+        XMStoreFloat4(&Result.Planes[Idx], XMPlaneNormalize(PlaneVectors[Idx]));
+    }
+    return Result;
+}
+
+bool Frustum::IntersectsSphere(const XMFLOAT3& Center, float Radius) const
+{
+    const XMVECTOR Point = XMLoadFloat3(&Center);
+    for (const XMFLOAT4& Plane : Planes)
+    {
+        if (XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&Plane), Point)) < -Radius) { return false; }
+    }
+    return true;
+}
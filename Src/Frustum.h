@@ -0,0 +1,14 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// View frustum as six inward facing planes, for CPU culling against the camera.
+struct Frustum
+{
+    DirectX::XMFLOAT4 Planes[6]; // Left, right, bottom, top, near, far. Normalised, inside where Dot(Plane.xyz, P) + Plane.w >= 0.
+
+    // From an untransposed row vector View * Projection matrix with D3D's [0, 1] depth range.
+    static Frustum FromViewProjection(DirectX::FXMMATRIX ViewProjection);
+
+    bool IntersectsSphere(const DirectX::XMFLOAT3& Center, float Radius) const;
+};
@@ -0,0 +1,163 @@
+#include "FrustumCulling.h"
+
+#include "Frustum.h"
+
+// Std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr size_t ChunkGroups = 1024; // Groups of four objects per parallel task.
+
+    // Frustum planes with every component replicated across a register, one plane is tested against four objects at a time.
+    struct SplatPlanes
+    {
+        XMVECTOR X[6], Y[6], Z[6], W[6];
+        XMVECTOR AbsX[6], AbsY[6], AbsZ[6];
+
+        explicit SplatPlanes(const Frustum& ViewFrustum)
+        {
+            for (size_t Idx = 0; Idx < 6; Idx++)
+            {
+                const XMFLOAT4& Plane = ViewFrustum.Planes[Idx];
+                X[Idx] = XMVectorReplicate(Plane.x);
+                Y[Idx] = XMVectorReplicate(Plane.y);
+                Z[Idx] = XMVectorReplicate(Plane.z);
+                W[Idx] = XMVectorReplicate(Plane.w);
+                AbsX[Idx] = XMVectorReplicate(std::abs(Plane.x));
+                AbsY[Idx] = XMVectorReplicate(std::abs(Plane.y));
+                AbsZ[Idx] = XMVectorReplicate(std::abs(Plane.z));
+            }
+        }
+    };
+
+    void CullGroups(const CullBoundsSoA& Bounds, const SplatPlanes& Planes, size_t FirstGroup, size_t EndGroup, std::vector<uint32_t>& OutVisible, CullKernelStats& Stats)
+    {
+        const XMVECTOR Zero = XMVectorZero();
+        for (size_t Group = FirstGroup; Group < EndGroup; Group++)
+        {
+            const size_t First = Group * 4;
+            const XMVECTOR Cx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&Bounds.CenterX[First]));
+            const XMVECTOR Cy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&Bounds.CenterY[First]));
+            const XMVECTOR Cz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&Bounds.CenterZ[First]));
+            const XMVECTOR Radius = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&Bounds.Radius[First]));
+            const XMVECTOR Ex = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&Bounds.ExtentX[First]));
+            const XMVECTOR Ey = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&Bounds.ExtentY[First]));
+            const XMVECTOR Ez = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&Bounds.ExtentZ[First]));
+
+            // An object is outside when its centre is further behind any plane than its radius, or its box's extent along the normal.
+            XMVECTOR SphereInside = XMVectorTrueInt();
+            XMVECTOR BoxInside = XMVectorTrueInt();
+            for (size_t Plane = 0; Plane < 6; Plane++)
+            {
+                const XMVECTOR Distance = XMVectorMultiplyAdd(Cz, Planes.Z[Plane], XMVectorMultiplyAdd(Cy, Planes.Y[Plane], XMVectorMultiplyAdd(Cx, Planes.X[Plane], Planes.W[Plane])));
+                const XMVECTOR BoxRadius = XMVectorMultiplyAdd(Ez, Planes.AbsZ[Plane], XMVectorMultiplyAdd(Ey, Planes.AbsY[Plane], XMVectorMultiply(Ex, Planes.AbsX[Plane])));
+                SphereInside = XMVectorAndInt(SphereInside, XMVectorGreaterOrEqual(XMVectorAdd(Distance, Radius), Zero));
+                BoxInside = XMVectorAndInt(BoxInside, XMVectorGreaterOrEqual(XMVectorAdd(Distance, BoxRadius), Zero));
+            }
+
+            // Only groups with a surviving sphere need their lanes looked at one by one.
+            const size_t NumLanes = std::min<size_t>(4, Bounds.NumObjects - First);
+            if (XMVector4EqualInt(SphereInside, Zero))
+            {
+                Stats.NumSphereCulled += NumLanes;
+                continue;
+            }
+
+            XMUINT4 SphereMask, BoxMask;
+            XMStoreUInt4(&SphereMask, SphereInside);
+            XMStoreUInt4(&BoxMask, BoxInside);
+            const uint32_t* SphereLanes = &SphereMask.x;
+            const uint32_t* BoxLanes = &BoxMask.x;
+            for (size_t Lane = 0; Lane < NumLanes; Lane++)
+            {
+                if (SphereLanes[Lane] == 0) { Stats.NumSphereCulled++; }
+                else if (BoxLanes[Lane] == 0) { Stats.NumBoxCulled++; }
+                else { OutVisible.push_back(static_cast<uint32_t>(First + Lane)); }
+            }
+        }
+    }
+}
+
+void CullBoundsSoA::Resize(size_t InNumObjects)
+{
+    NumObjects = InNumObjects;
+    const size_t NumPadded = GetNumGroups() * 4;
+    for (std::vector<float>* Component : { &CenterX, &CenterY, &CenterZ, &Radius, &ExtentX, &ExtentY, &ExtentZ })
+    {
+        Component->assign(NumPadded, 0.0f);
+    }
+    for (size_t Idx = NumObjects; Idx < NumPadded; Idx++) { SetNeverVisible(Idx); }
+}
+
+void CullBoundsSoA::Set(size_t Idx, const XMFLOAT3& Center, float InRadius, const XMFLOAT3& Extents)
+{
+    CenterX[Idx] = Center.x;
+    CenterY[Idx] = Center.y;
+    CenterZ[Idx] = Center.z;
+    Radius[Idx] = InRadius;
+    ExtentX[Idx] = Extents.x;
+    ExtentY[Idx] = Extents.y;
+    ExtentZ[Idx] = Extents.z;
+}
+
+void CullBoundsSoA::SetNeverVisible(size_t Idx)
+{
+    // A NaN centre fails every comparison, so the object is outside every plane.
+    const float NaN = std::numeric_limits<float>::quiet_NaN();
+    Set(Idx, XMFLOAT3(NaN, NaN, NaN), 0.0f, XMFLOAT3(0.0f, 0.0f, 0.0f));
+}
+
+void CullKernelStats::Merge(const CullKernelStats& Other)
+{
+    NumObjects += Other.NumObjects;
+    NumVisible += Other.NumVisible;
+    NumSphereCulled += Other.NumSphereCulled;
+    NumBoxCulled += Other.NumBoxCulled;
+}
+
+void FrustumCulling::Cull(const CullBoundsSoA& Bounds, const Frustum& ViewFrustum, std::vector<uint32_t>& OutVisible, CullKernelStats& OutStats)
+{
+    const SplatPlanes Planes(ViewFrustum);
+    const size_t NumGroups = Bounds.GetNumGroups();
+    const size_t FirstVisible = OutVisible.size();
+
+    CullKernelStats Stats;
+    Stats.NumObjects = Bounds.NumObjects;
+    if (Bounds.NumObjects < ParallelCullObjects)
+    {
+        CullGroups(Bounds, Planes, 0, NumGroups, OutVisible, Stats);
+    }
+    else
+    {
+        // Each chunk collects its own visible objects, joined in chunk order so the output stays sorted.
+        const size_t NumChunks = (NumGroups + ChunkGroups - 1) / ChunkGroups;
+        std::vector<std::vector<uint32_t>> ChunkVisible(NumChunks);
+        std::vector<CullKernelStats> ChunkStats(NumChunks);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, NumChunks, 1),
+            [&](const tbb::blocked_range<size_t>& Range)
+            {
+                for (size_t Chunk = Range.begin(); Chunk != Range.end(); ++Chunk)
+                {
+                    CullGroups(Bounds, Planes, Chunk * ChunkGroups, std::min(NumGroups, (Chunk + 1) * ChunkGroups), ChunkVisible[Chunk], ChunkStats[Chunk]);
+                }
+            });
+
+        for (size_t Chunk = 0; Chunk < NumChunks; Chunk++)
+        {
+            OutVisible.insert(OutVisible.end(), ChunkVisible[Chunk].begin(), ChunkVisible[Chunk].end());
+            Stats.Merge(ChunkStats[Chunk]);
+        }
+    }
+
+    Stats.NumVisible = OutVisible.size() - FirstVisible;
+    OutStats.Merge(Stats);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+
+struct Frustum;
+
+// Bounds of every object as separate component arrays, so the culling kernel loads four objects per register.
+// Each object is a sphere and a box around the same centre, padded to whole groups of four with objects that never pass.
+struct CullBoundsSoA
+{
+    std::vector<float> CenterX, CenterY, CenterZ;
+    std::vector<float> Radius;
+    std::vector<float> ExtentX, ExtentY, ExtentZ; // Half size of the box.
+    size_t NumObjects = 0;
+
+    void Resize(size_t InNumObjects);
+    void Set(size_t Idx, const DirectX::XMFLOAT3& Center, float InRadius, const DirectX::XMFLOAT3& Extents);
+    void SetNeverVisible(size_t Idx);
+    size_t GetNumGroups() const { return (NumObjects + 3) / 4; }
+};
+
+struct CullKernelStats
+{
+    size_t NumObjects = 0;
+    size_t NumVisible = 0;
+    size_t NumSphereCulled = 0;
+    size_t NumBoxCulled = 0;   // Passed the sphere test but not the box test.
+
+    void Merge(const CullKernelStats& Other);
+};
+
+namespace FrustumCulling
+{
+    // Objects at or above this count are culled in chunks on several threads.
+    constexpr size_t ParallelCullObjects = 16 * 1024;
+
+    // Appends the objects whose sphere and box both touch the frustum, in object order.
+    void Cull(const CullBoundsSoA& Bounds, const Frustum& ViewFrustum, std::vector<uint32_t>& OutVisible, CullKernelStats& OutStats);
+}
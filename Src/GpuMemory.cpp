@@ -0,0 +1,88 @@
+#include "GpuMemory.h"
+
+// Std
+#include <utility>
+
+bool D3D12HeapSource::CreateBlock(uint32_t Block, uint64_t Size)
+{
+    D3D12_HEAP_DESC HeapDesc = {};
+    HeapDesc.SizeInBytes = Size;
+    HeapDesc.Properties.Type = HeapType;
+    HeapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    HeapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+    HeapDesc.Properties.CreationNodeMask = 1;
+    HeapDesc.Properties.VisibleNodeMask = 1;
+    HeapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    HeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+    if (Block >= Heaps.size()) { Heaps.resize(Block + 1); }
+    if (FAILED(Device->CreateHeap(&HeapDesc, IID_PPV_ARGS(&Heaps[Block])))) { return false; }
+    Heaps[Block]->SetName(HeapType == D3D12_HEAP_TYPE_UPLOAD ? L"Upload Buffer Heap" : L"Default Buffer Heap");
+    return true;
+}
+
+void D3D12HeapSource::DestroyBlock(uint32_t Block)
+{
+    Heaps[Block].Reset();
+}
+
+void PlacedBufferAllocator::Init(ID3D12Device* Device, D3D12_HEAP_TYPE HeapType, uint64_t BlockSize)
+{
+    Source.Device = Device;
+    Source.HeapType = HeapType;
+    Allocator = std::make_unique<TlsfAllocator>(Source, BlockSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+}
+
+bool PlacedBufferAllocator::CreateBuffer(uint64_t Size, D3D12_RESOURCE_STATES InitialState, PlacedBuffer& OutBuffer)
+{
+    OutBuffer.Reset();
+
+    TlsfAllocation Allocation;
+    if (!Allocator->Allocate(Size, Allocation)) { return false; }
+
+    D3D12_RESOURCE_DESC BufferResourceDesc;
+    BufferResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    BufferResourceDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    BufferResourceDesc.Width = Size;
+    BufferResourceDesc.Height = 1;
+    BufferResourceDesc.DepthOrArraySize = 1;
+    BufferResourceDesc.MipLevels = 1;
+    BufferResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+    BufferResourceDesc.SampleDesc.Count = 1;
+    BufferResourceDesc.SampleDesc.Quality = 0;
+    BufferResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    BufferResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+    const HRESULT HR = Source.Device->CreatePlacedResource(Source.Heaps[Allocation.Block].Get(), Allocation.Offset, &BufferResourceDesc,
+        InitialState, nullptr, IID_PPV_ARGS(&OutBuffer.Resource));
+    if (FAILED(HR))
+    {
+        Allocator->Free(Allocation);
+        return false;
+    }
+    OutBuffer.Allocation = Allocation;
+    OutBuffer.Owner = this;
+    return true;
+}
+
+PlacedBuffer& PlacedBuffer::operator=(PlacedBuffer&& Other) noexcept
+{
+    if (this != &Other)
+    {
+        Reset();
+        Resource = std::move(Other.Resource);
+        Allocation = Other.Allocation;
+        Owner = Other.Owner;
+        Other.Allocation = TlsfAllocation();
+        Other.Owner = nullptr;
+    }
+    return *this;
+}
+
+void PlacedBuffer::Reset()
+{
+    // The resource goes first, its heap range may be handed out again straight away.
+    Resource.Reset();
+    if (Owner) { Owner->Free(Allocation); }
+    Owner = nullptr;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <wrl/client.h>
+
+#include "TlsfAllocator.h"
+
+#include <d3d12.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using Microsoft::WRL::ComPtr; // Import only the ComPtr
+
+class PlacedBuffer;
+
+// ID3D12Heaps of one heap type holding only buffers, one per block of the TLSF allocator.
+class D3D12HeapSource final : public MemoryBlockSource
+{
+public:
+    ID3D12Device* Device = nullptr;
+    D3D12_HEAP_TYPE HeapType = D3D12_HEAP_TYPE_DEFAULT;
+    std::vector<ComPtr<ID3D12Heap>> Heaps; // By block index, null once destroyed.
+
+    bool CreateBlock(uint32_t Block, uint64_t Size) override;
+    void DestroyBlock(uint32_t Block) override;
+};
+
+// Buffers placed in large heaps of one type instead of each being a committed resource with its own heap. Ranges are 64 KB aligned,
+// the placement alignment of buffers, so placing one costs a few bit scans and a CreatePlacedResource once its heap exists.
+class PlacedBufferAllocator
+{
+public:
+    void Init(ID3D12Device* Device, D3D12_HEAP_TYPE HeapType, uint64_t BlockSize);
+
+    // The buffer starts in InitialState, GENERIC_READ for upload heaps. False when no heap could be created.
+    bool CreateBuffer(uint64_t Size, D3D12_RESOURCE_STATES InitialState, PlacedBuffer& OutBuffer);
+    TlsfStats GetStats() const { return Allocator ? Allocator->GetStats() : TlsfStats(); }
+
+private:
+    friend class PlacedBuffer;
+    void Free(TlsfAllocation& Allocation) { Allocator->Free(Allocation); }
+
+    D3D12HeapSource Source;
+    std::unique_ptr<TlsfAllocator> Allocator;
+};
+
+// A placed buffer and its heap range, freed together. Must be released before its allocator.
+class PlacedBuffer
+{
+public:
+    PlacedBuffer() = default;
+    ~PlacedBuffer() { Reset(); }
+    PlacedBuffer(PlacedBuffer&& Other) noexcept { *this = std::move(Other); }
+    PlacedBuffer& operator=(PlacedBuffer&& Other) noexcept;
+    PlacedBuffer(const PlacedBuffer&) = delete;
+    PlacedBuffer& operator=(const PlacedBuffer&) = delete;
+
+    void Reset();
+    ID3D12Resource* Get() const { return Resource.Get(); }
+    ID3D12Resource* operator->() const { return Resource.Get(); }
+    explicit operator bool() const { return Resource != nullptr; }
+
+private:
+    friend class PlacedBufferAllocator;
+    ComPtr<ID3D12Resource> Resource;
+    TlsfAllocation Allocation;
+    PlacedBufferAllocator* Owner = nullptr;
+};
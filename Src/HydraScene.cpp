@@ -0,0 +1,386 @@
+#include "HydraScene.h"
+
+#include "RenderMesh.h"
+
+// Std
+#include <algorithm>
+#include <chrono>
+
+// USD
+#include "pxr/base/gf/quatd.h"
+#include "pxr/base/gf/quatf.h"
+#include "pxr/base/gf/quath.h"
+#include "pxr/base/gf/rotation.h"
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/imaging/hd/resourceRegistry.h"
+#include "pxr/imaging/hd/rprimCollection.h"
+#include "pxr/imaging/hd/tokens.h"
+#include "pxr/usd/usdGeom/tokens.h"
+
+using namespace pxr;
+
+namespace
+{
+    const TfToken TokenUVs("st");
+
+    // The rprims are synced before the pass runs, drawing is left to the StaticMeshPipeline.
+    class HydraRenderPass final : public HdRenderPass
+    {
+    public:
+        HydraRenderPass(HdRenderIndex* Index, const HdRprimCollection& Collection) : HdRenderPass(Index, Collection) {}
+
+    protected:
+        void _Execute(const HdRenderPassStateSharedPtr& RenderPassState, const TfTokenVector& RenderTags) override {}
+    };
+
+    // The only task, its render pass' collection and render tags decide which rprims HdRenderIndex::SyncAll syncs.
+    class HydraSyncTask final : public HdTask
+    {
+    public:
+        explicit HydraSyncTask(HdRenderPassSharedPtr InRenderPass)
+            : HdTask(SdfPath::EmptyPath()), RenderPass(std::move(InRenderPass)), RenderTags{ HdRenderTagTokens->geometry } {}
+
+        void Sync(HdSceneDelegate* SceneDelegate, HdTaskContext* Context, HdDirtyBits* DirtyBits) override
+        {
+            RenderPass->Sync();
+            *DirtyBits = HdChangeTracker::Clean;
+        }
+        void Prepare(HdTaskContext* Context, HdRenderIndex* RenderIndex) override {}
+        void Execute(HdTaskContext* Context) override {}
+        const TfTokenVector& GetRenderTags() const override { return RenderTags; }
+
+    private:
+        HdRenderPassSharedPtr RenderPass;
+        TfTokenVector RenderTags;
+    };
+
+    // Copies a primvar when the scene delegate has it in the type the mesh build reads, leaves it empty otherwise.
+    template <typename ArrayT>
+    void ReadArray(const VtValue& Value, ArrayT& Out)
+    {
+        Out = Value.IsHolding<ArrayT>() ? Value.UncheckedGet<ArrayT>() : ArrayT();
+    }
+
+    // Interpolation of a primvar as UsdGeomTokens names it, like RenderMesh reads it from USD. Empty when the rprim has no such primvar.
+    TfToken GetPrimvarInterpolation(HdSceneDelegate* SceneDelegate, const SdfPath& Id, const TfToken& Name)
+    {
+        static const TfToken Names[] = { UsdGeomTokens->constant, UsdGeomTokens->uniform, UsdGeomTokens->varying, UsdGeomTokens->vertex,
+            UsdGeomTokens->faceVarying };
+        for (int Interpolation = HdInterpolationConstant; Interpolation <= HdInterpolationFaceVarying; Interpolation++)
+        {
+            for (const HdPrimvarDescriptor& Primvar : SceneDelegate->GetPrimvarDescriptors(Id, static_cast<HdInterpolation>(Interpolation)))
+            {
+                if (Primvar.name == Name) { return Names[Interpolation]; }
+            }
+        }
+        return TfToken();
+    }
+
+    GfMatrix4d RotationMatrix(const VtValue& Rotations, size_t Idx)
+    {
+        GfQuatd Rotation(1.0);
+        if (Rotations.IsHolding<VtQuathArray>()) { Rotation = GfQuatd(Rotations.UncheckedGet<VtQuathArray>()[Idx]); }
+        else if (Rotations.IsHolding<VtQuatfArray>()) { Rotation = GfQuatd(Rotations.UncheckedGet<VtQuatfArray>()[Idx]); }
+        GfMatrix4d Matrix(1.0);
+        Matrix.SetRotate(Rotation);
+        return Matrix;
+    }
+}
+
+HydraMesh::HydraMesh(const SdfPath& Id)
+    : HdMesh(Id)
+{
+}
+
+HdDirtyBits HydraMesh::GetInitialDirtyBitsMask() const
+{
+    return HdChangeTracker::Clean | HdChangeTracker::InitRepr | HdChangeTracker::DirtyTopology | HdChangeTracker::DirtyPoints
+        | HdChangeTracker::DirtyNormals | HdChangeTracker::DirtyPrimvar | HdChangeTracker::DirtyTransform | HdChangeTracker::DirtyVisibility
+        | HdChangeTracker::DirtyInstancer | HdChangeTracker::DirtyInstanceIndex;
+}
+
+void HydraMesh::Sync(HdSceneDelegate* SceneDelegate, HdRenderParam* RenderParam, HdDirtyBits* DirtyBits, const TfToken& ReprToken)
+{
+    const SdfPath& Id = GetId();
+    const HydraRenderParam* Param = static_cast<const HydraRenderParam*>(RenderParam);
+
+    // Instancers are synced first, the instance transforms below read their primvars.
+    _UpdateInstancer(SceneDelegate, DirtyBits);
+    HdInstancer::_SyncInstancerAndParents(SceneDelegate->GetRenderIndex(), GetInstancerId());
+
+    // The same source arrays a USD load reads, so both front-ends build and cache identical meshes.
+    const bool bTopologyDirty = HdChangeTracker::IsTopologyDirty(*DirtyBits, Id);
+    bool bRebuild = bTopologyDirty;
+    if (bTopologyDirty)
+    {
+        Topology = GetMeshTopology(SceneDelegate);
+        Source.FaceVertexCounts = Topology.GetFaceVertexCounts();
+        Source.FaceVertexIndices = Topology.GetFaceVertexIndices();
+        Source.HoleIndices = Topology.GetHoleIndices();
+        Source.Orientation = Topology.GetOrientation();
+    }
+    if (HdChangeTracker::IsPrimvarDirty(*DirtyBits, Id, HdTokens->points))
+    {
+        ReadArray(GetPrimvar(SceneDelegate, HdTokens->points), Source.Points);
+        bRebuild = true;
+    }
+    if (HdChangeTracker::IsPrimvarDirty(*DirtyBits, Id, HdTokens->normals))
+    {
+        ReadArray(GetPrimvar(SceneDelegate, HdTokens->normals), Source.Normals);
+        Source.NormalsInterpolation = Source.Normals.empty() ? TfToken() : GetPrimvarInterpolation(SceneDelegate, Id, HdTokens->normals);
+        bRebuild = true;
+    }
+    if (HdChangeTracker::IsPrimvarDirty(*DirtyBits, Id, TokenUVs))
+    {
+        ReadArray(GetPrimvar(SceneDelegate, TokenUVs), Source.UVs);
+        Source.UVsInterpolation = Source.UVs.empty() ? TfToken() : GetPrimvarInterpolation(SceneDelegate, Id, TokenUVs);
+        bRebuild = true;
+    }
+
+    if (bRebuild)
+    {
+        // Instanced prototypes resolve to their first instance, the prim is only used to name the mesh.
+        const UsdPrim Prim = Param->Stage->GetPrimAtPath(SceneDelegate->GetScenePrimPath(Id, 0));
+        std::shared_ptr<RenderMesh> Rebuilt = std::make_shared<RenderMesh>(Param->Settings, Param->CookedMeshes);
+        Rebuilt->LoadFromHydra(Prim, Id, Source);
+
+        const std::shared_ptr<MeshData> Previous = Mesh ? Mesh->GetMeshData() : nullptr;
+        const std::shared_ptr<MeshData> Data = Rebuilt->GetMeshData();
+        const bool bSameIndices = !bTopologyDirty && Previous && Data && Previous->HasSameIndices(*Data);
+        Changes |= ChangedGeometry | (bSameIndices ? ChangedNone : ChangedIndices);
+
+        // A mesh that failed to build has nothing to draw, it is laid out like one without instances.
+        if ((Previous != nullptr) != (Data != nullptr)) { Changes |= ChangedInstances; }
+        Mesh = Data ? Rebuilt : nullptr;
+    }
+
+    if (HdChangeTracker::IsTransformDirty(*DirtyBits, Id) || HdChangeTracker::IsVisibilityDirty(*DirtyBits, Id)
+        || HdChangeTracker::IsInstancerDirty(*DirtyBits, Id) || HdChangeTracker::IsInstanceIndexDirty(*DirtyBits, Id))
+    {
+        _UpdateVisibility(SceneDelegate, DirtyBits);
+        SyncTransforms(SceneDelegate);
+    }
+
+    *DirtyBits &= ~HdChangeTracker::AllSceneDirtyBits;
+}
+
+void HydraMesh::SyncTransforms(HdSceneDelegate* SceneDelegate)
+{
+    std::vector<GfMatrix4d> Transforms;
+    if (IsVisible())
+    {
+        const GfMatrix4d Transform = SceneDelegate->GetTransform(GetId());
+        if (GetInstancerId().IsEmpty())
+        {
+            Transforms.push_back(Transform);
+        }
+        else if (HydraInstancer* Instancer = static_cast<HydraInstancer*>(SceneDelegate->GetRenderIndex().GetInstancer(GetInstancerId())))
+        {
+            // Prototype transforms are relative to the instance, the same World = Offset * Instance as the USD traversal.
+            const std::vector<GfMatrix4d> Instances = Instancer->ComputeInstanceTransforms(GetId());
+            Transforms.reserve(Instances.size());
+            for (const GfMatrix4d& Instance : Instances) { Transforms.push_back(Transform * Instance); }
+        }
+    }
+
+    if (Transforms.size() != WorldTransforms.size()) { Changes |= ChangedInstances; }
+    else if (Transforms != WorldTransforms) { Changes |= ChangedTransforms; }
+    WorldTransforms.swap(Transforms);
+}
+
+HydraInstancer::HydraInstancer(HdSceneDelegate* SceneDelegate, const SdfPath& Id)
+    : HdInstancer(SceneDelegate, Id)
+{
+}
+
+void HydraInstancer::Sync(HdSceneDelegate* SceneDelegate, HdRenderParam* RenderParam, HdDirtyBits* DirtyBits)
+{
+    _UpdateInstancer(SceneDelegate, DirtyBits);
+
+    const SdfPath& Id = GetId();
+    if (!HdChangeTracker::IsAnyPrimvarDirty(*DirtyBits, Id)) { return; }
+
+    std::lock_guard<std::mutex> Lock(PrimvarMutex);
+    for (const HdPrimvarDescriptor& Primvar : SceneDelegate->GetPrimvarDescriptors(Id, HdInterpolationInstance))
+    {
+        if (!HdChangeTracker::IsPrimvarDirty(*DirtyBits, Id, Primvar.name)) { continue; }
+
+        const VtValue Value = SceneDelegate->Get(Id, Primvar.name);
+        if (Value.IsEmpty()) { Primvars.erase(Primvar.name); }
+        else { Primvars[Primvar.name] = Value; }
+    }
+}
+
+std::vector<GfMatrix4d> HydraInstancer::ComputeInstanceTransforms(const SdfPath& Prototype)
+{
+    HdSceneDelegate* SceneDelegate = GetDelegate();
+    const VtIntArray InstanceIndices = SceneDelegate->GetInstanceIndices(GetId(), Prototype);
+    const GfMatrix4d InstancerTransform = SceneDelegate->GetInstancerTransform(GetId());
+
+    VtValue Translations;
+    VtValue Rotations;
+    VtValue Scales;
+    VtValue InstanceTransforms;
+    {
+        std::lock_guard<std::mutex> Lock(PrimvarMutex);
+        const auto Find = [this](const TfToken& Name) { const auto Found = Primvars.find(Name); return Found != Primvars.end() ? Found->second : VtValue(); };
+        Translations = Find(HdInstancerTokens->instanceTranslations);
+        Rotations = Find(HdInstancerTokens->instanceRotations);
+        Scales = Find(HdInstancerTokens->instanceScales);
+        InstanceTransforms = Find(HdInstancerTokens->instanceTransforms);
+    }
+    const size_t NumTranslations = Translations.IsHolding<VtVec3fArray>() ? Translations.UncheckedGet<VtVec3fArray>().size() : 0;
+    const size_t NumRotations = Rotations.IsArrayValued() ? Rotations.GetArraySize() : 0;
+    const size_t NumScales = Scales.IsHolding<VtVec3fArray>() ? Scales.UncheckedGet<VtVec3fArray>().size() : 0;
+    const size_t NumInstanceTransforms = InstanceTransforms.IsHolding<VtMatrix4dArray>() ? InstanceTransforms.UncheckedGet<VtMatrix4dArray>().size() : 0;
+
+    // Row vectors: instance transform, then scale, rotation and translation, then the instancer.
+    std::vector<GfMatrix4d> Transforms(InstanceIndices.size(), InstancerTransform);
+    for (size_t Idx = 0; Idx < InstanceIndices.size(); Idx++)
+    {
+        const size_t Instance = static_cast<size_t>(InstanceIndices[Idx]);
+        GfMatrix4d Local(1.0);
+        if (Instance < NumInstanceTransforms) { Local = InstanceTransforms.UncheckedGet<VtMatrix4dArray>()[Instance]; }
+        if (Instance < NumScales)
+        {
+            GfMatrix4d Scale(1.0);
+            Scale.SetScale(GfVec3d(Scales.UncheckedGet<VtVec3fArray>()[Instance]));
+            Local *= Scale;
+        }
+        if (Instance < NumRotations) { Local *= RotationMatrix(Rotations, Instance); }
+        if (Instance < NumTranslations)
+        {
+            GfMatrix4d Translation(1.0);
+            Translation.SetTranslate(GfVec3d(Translations.UncheckedGet<VtVec3fArray>()[Instance]));
+            Local *= Translation;
+        }
+        Transforms[Idx] = Local * InstancerTransform;
+    }
+
+    // A nested instancer is itself instanced, every instance of it repeats all of these.
+    if (GetParentId().IsEmpty()) { return Transforms; }
+
+    HydraInstancer* Parent = static_cast<HydraInstancer*>(SceneDelegate->GetRenderIndex().GetInstancer(GetParentId()));
+    if (!Parent) { return Transforms; }
+
+    const std::vector<GfMatrix4d> ParentTransforms = Parent->ComputeInstanceTransforms(GetId());
+    std::vector<GfMatrix4d> Nested;
+    Nested.reserve(ParentTransforms.size() * Transforms.size());
+    for (const GfMatrix4d& ParentTransform : ParentTransforms)
+    {
+        for (const GfMatrix4d& Transform : Transforms) { Nested.push_back(Transform * ParentTransform); }
+    }
+    return Nested;
+}
+
+HydraRenderDelegate::HydraRenderDelegate(std::unique_ptr<HydraRenderParam> InRenderParam)
+    : RenderParam(std::move(InRenderParam))
+    , ResourceRegistry(std::make_shared<HdResourceRegistry>())
+{
+}
+
+HydraRenderDelegate::~HydraRenderDelegate() = default;
+
+const TfTokenVector& HydraRenderDelegate::GetSupportedRprimTypes() const
+{
+    static const TfTokenVector Types = { HdPrimTypeTokens->mesh };
+    return Types;
+}
+
+const TfTokenVector& HydraRenderDelegate::GetSupportedSprimTypes() const
+{
+    static const TfTokenVector Types;
+    return Types;
+}
+
+const TfTokenVector& HydraRenderDelegate::GetSupportedBprimTypes() const
+{
+    static const TfTokenVector Types;
+    return Types;
+}
+
+HdRenderPassSharedPtr HydraRenderDelegate::CreateRenderPass(HdRenderIndex* Index, const HdRprimCollection& Collection)
+{
+    return std::make_shared<HydraRenderPass>(Index, Collection);
+}
+
+HdInstancer* HydraRenderDelegate::CreateInstancer(HdSceneDelegate* SceneDelegate, const SdfPath& Id)
+{
+    return new HydraInstancer(SceneDelegate, Id);
+}
+
+void HydraRenderDelegate::DestroyInstancer(HdInstancer* Instancer)
+{
+    delete Instancer;
+}
+
+HdRprim* HydraRenderDelegate::CreateRprim(const TfToken& TypeId, const SdfPath& RprimId)
+{
+    if (TypeId != HdPrimTypeTokens->mesh) { return nullptr; }
+
+    HydraMesh* Mesh = new HydraMesh(RprimId);
+    std::lock_guard<std::mutex> Lock(MeshesMutex);
+    Meshes.push_back(Mesh);
+    bMeshesChanged = true;
+    return Mesh;
+}
+
+void HydraRenderDelegate::DestroyRprim(HdRprim* Rprim)
+{
+    {
+        std::lock_guard<std::mutex> Lock(MeshesMutex);
+        const auto Found = std::find(Meshes.begin(), Meshes.end(), Rprim);
+        if (Found != Meshes.end())
+        {
+            Meshes.erase(Found);
+            bMeshesChanged = true;
+        }
+    }
+    delete Rprim;
+}
+
+HydraScene::HydraScene(const UsdStageRefPtr& InStage, const MeshBuildSettings& Settings, std::shared_ptr<const MeshCacheFile> CookedMeshes)
+    : Stage(InStage)
+{
+    RenderDelegate = std::make_unique<HydraRenderDelegate>(std::make_unique<HydraRenderParam>(Settings, std::move(CookedMeshes), Stage));
+    RenderIndex.reset(HdRenderIndex::New(RenderDelegate.get(), HdDriverVector()));
+    SceneDelegate = std::make_unique<UsdImagingDelegate>(RenderIndex.get(), SdfPath::AbsoluteRootPath());
+
+    const HdRprimCollection Collection(HdTokens->geometry, HdReprSelector(HdReprTokens->hull));
+    Tasks.push_back(std::make_shared<HydraSyncTask>(RenderDelegate->CreateRenderPass(RenderIndex.get(), Collection)));
+}
+
+HydraScene::~HydraScene()
+{
+    // The scene delegate removes its prims from the index, which needs the render delegate to destroy them.
+    Tasks.clear();
+    SceneDelegate.reset();
+    RenderIndex.reset();
+    RenderDelegate.reset();
+}
+
+void HydraScene::Populate()
+{
+    SceneDelegate->Populate(Stage->GetPseudoRoot());
+}
+
+HydraSyncResult HydraScene::Sync(UsdTimeCode Time)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point StartTime = Clock::now();
+
+    // Stage edits since the last sync and the time varying data at Time only mark rprims dirty, SyncAll then syncs them in parallel.
+    SceneDelegate->ApplyPendingUpdates();
+    SceneDelegate->SetTime(Time);
+    Engine.Execute(RenderIndex.get(), &Tasks);
+
+    HydraSyncResult Result;
+    Result.bMeshesChanged = RenderDelegate->TakeMeshesChanged();
+    for (HydraMesh* Mesh : RenderDelegate->GetMeshes())
+    {
+        const uint32_t Changes = Mesh->TakeChanges();
+        if (Changes != HydraMesh::ChangedNone) { Result.Changed.push_back(HydraMeshChange{ Mesh, Changes }); }
+    }
+    Result.SyncMs = std::chrono::duration<double, std::milli>(Clock::now() - StartTime).count();
+    return Result;
+}
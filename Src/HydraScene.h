@@ -0,0 +1,167 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Usd
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/imaging/hd/engine.h"
+#include "pxr/imaging/hd/instancer.h"
+#include "pxr/imaging/hd/mesh.h"
+#include "pxr/imaging/hd/renderDelegate.h"
+#include "pxr/imaging/hd/renderIndex.h"
+#include "pxr/imaging/hd/renderPass.h"
+#include "pxr/imaging/hd/task.h"
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usdImaging/usdImaging/delegate.h"
+
+#include "MeshCache.h"
+
+// Hydra front-end: a UsdImagingDelegate populates an HdRenderIndex whose render delegate only has mesh rprims. Each rprim builds its
+// RenderMesh in Sync from the data the scene delegate hands it, so Hydra's change tracking decides what is built again and syncs
+// the dirty rprims in parallel. Drawing stays with the StaticMeshPipeline, USDScene lays the rprims out as scene meshes.
+
+// Shared by every rprim during Sync, read only.
+class HydraRenderParam final : public pxr::HdRenderParam
+{
+public:
+    HydraRenderParam(const MeshBuildSettings& InSettings, std::shared_ptr<const MeshCacheFile> InCookedMeshes, pxr::UsdStageRefPtr InStage)
+        : Settings(InSettings), CookedMeshes(std::move(InCookedMeshes)), Stage(std::move(InStage)) {}
+
+    MeshBuildSettings Settings;
+    std::shared_ptr<const MeshCacheFile> CookedMeshes;
+    pxr::UsdStageRefPtr Stage;
+};
+
+// A mesh rprim, its world transforms are one per instance with the instancer's transforms applied.
+class HydraMesh final : public pxr::HdMesh
+{
+public:
+    // What the last Sync changed, taken by HydraScene once the sync is done.
+    enum ChangeBits : uint32_t
+    {
+        ChangedNone = 0,
+        ChangedGeometry = 1 << 0,   // A new RenderMesh.
+        ChangedIndices = 1 << 1,    // Its triangles changed too, only the vertices changed otherwise.
+        ChangedTransforms = 1 << 2, // Same number of world transforms, different values.
+        ChangedInstances = 1 << 3,  // The number of world transforms changed, e.g. visibility or instancing.
+    };
+
+    explicit HydraMesh(const pxr::SdfPath& Id);
+
+    pxr::HdDirtyBits GetInitialDirtyBitsMask() const override;
+    void Sync(pxr::HdSceneDelegate* SceneDelegate, pxr::HdRenderParam* RenderParam, pxr::HdDirtyBits* DirtyBits, const pxr::TfToken& ReprToken) override;
+
+    const std::shared_ptr<class RenderMesh>& GetRenderMesh() const { return Mesh; }
+    const std::vector<pxr::GfMatrix4d>& GetWorldTransforms() const { return WorldTransforms; }
+    uint32_t TakeChanges() { const uint32_t Taken = Changes; Changes = ChangedNone; return Taken; }
+
+protected:
+    pxr::HdDirtyBits _PropagateDirtyBits(pxr::HdDirtyBits Bits) const override { return Bits; }
+    void _InitRepr(const pxr::TfToken& ReprToken, pxr::HdDirtyBits* DirtyBits) override {}
+
+private:
+    void SyncTransforms(pxr::HdSceneDelegate* SceneDelegate);
+
+private:
+    pxr::HdMeshTopology Topology;
+    MeshSourceArrays Source;
+    std::shared_ptr<class RenderMesh> Mesh;
+    std::vector<pxr::GfMatrix4d> WorldTransforms;
+    uint32_t Changes = ChangedNone;
+};
+
+// Point instancers and native USD instancing, the instance primvars are kept until the rprims have read them.
+class HydraInstancer final : public pxr::HdInstancer
+{
+public:
+    HydraInstancer(pxr::HdSceneDelegate* SceneDelegate, const pxr::SdfPath& Id);
+
+    void Sync(pxr::HdSceneDelegate* SceneDelegate, pxr::HdRenderParam* RenderParam, pxr::HdDirtyBits* DirtyBits) override;
+
+    // Transforms of every instance of Prototype, parent instancers included, as row vector matrices applied after the prototype's own.
+    std::vector<pxr::GfMatrix4d> ComputeInstanceTransforms(const pxr::SdfPath& Prototype);
+
+private:
+    std::mutex PrimvarMutex;
+    std::unordered_map<pxr::TfToken, pxr::VtValue, pxr::TfToken::HashFunctor> Primvars;
+};
+
+// Only mesh rprims and instancers, cameras, lights and materials are left out by UsdImaging when they are not supported.
+class HydraRenderDelegate final : public pxr::HdRenderDelegate
+{
+public:
+    explicit HydraRenderDelegate(std::unique_ptr<HydraRenderParam> InRenderParam);
+    ~HydraRenderDelegate() override;
+
+    const pxr::TfTokenVector& GetSupportedRprimTypes() const override;
+    const pxr::TfTokenVector& GetSupportedSprimTypes() const override;
+    const pxr::TfTokenVector& GetSupportedBprimTypes() const override;
+    pxr::HdRenderParam* GetRenderParam() const override { return RenderParam.get(); }
+    pxr::HdResourceRegistrySharedPtr GetResourceRegistry() const override { return ResourceRegistry; }
+
+    pxr::HdRenderPassSharedPtr CreateRenderPass(pxr::HdRenderIndex* Index, const pxr::HdRprimCollection& Collection) override;
+    pxr::HdInstancer* CreateInstancer(pxr::HdSceneDelegate* SceneDelegate, const pxr::SdfPath& Id) override;
+    void DestroyInstancer(pxr::HdInstancer* Instancer) override;
+    pxr::HdRprim* CreateRprim(const pxr::TfToken& TypeId, const pxr::SdfPath& RprimId) override;
+    void DestroyRprim(pxr::HdRprim* Rprim) override;
+    pxr::HdSprim* CreateSprim(const pxr::TfToken& TypeId, const pxr::SdfPath& SprimId) override { return nullptr; }
+    pxr::HdSprim* CreateFallbackSprim(const pxr::TfToken& TypeId) override { return nullptr; }
+    void DestroySprim(pxr::HdSprim* Sprim) override {}
+    pxr::HdBprim* CreateBprim(const pxr::TfToken& TypeId, const pxr::SdfPath& BprimId) override { return nullptr; }
+    pxr::HdBprim* CreateFallbackBprim(const pxr::TfToken& TypeId) override { return nullptr; }
+    void DestroyBprim(pxr::HdBprim* Bprim) override {}
+    void CommitResources(pxr::HdChangeTracker* Tracker) override {}
+
+    // Every mesh rprim in the index, in creation order. True when rprims were added or removed since the last call.
+    const std::vector<HydraMesh*>& GetMeshes() const { return Meshes; }
+    bool TakeMeshesChanged() { const bool bTaken = bMeshesChanged; bMeshesChanged = false; return bTaken; }
+
+private:
+    std::unique_ptr<HydraRenderParam> RenderParam;
+    pxr::HdResourceRegistrySharedPtr ResourceRegistry;
+    std::mutex MeshesMutex;
+    std::vector<HydraMesh*> Meshes;
+    bool bMeshesChanged = false;
+};
+
+// One rprim the last HydraScene::Sync changed, Changes are its HydraMesh::ChangeBits.
+struct HydraMeshChange
+{
+    HydraMesh* Mesh = nullptr;
+    uint32_t Changes = HydraMesh::ChangedNone;
+};
+
+struct HydraSyncResult
+{
+    bool bMeshesChanged = false; // Rprims were added or removed since the last sync.
+    std::vector<HydraMeshChange> Changed;
+    double SyncMs = 0.0;
+};
+
+// Owns the Hydra objects for one stage. Main thread only, the stage must not be edited during Populate or Sync.
+class HydraScene
+{
+public:
+    HydraScene(const pxr::UsdStageRefPtr& Stage, const MeshBuildSettings& Settings, std::shared_ptr<const MeshCacheFile> CookedMeshes);
+    ~HydraScene();
+
+    // Inserts an rprim for every mesh of the stage, nothing is built until the first Sync.
+    void Populate();
+
+    // Applies the stage's pending changes and the time, then syncs every dirty rprim through the engine.
+    HydraSyncResult Sync(pxr::UsdTimeCode Time);
+
+    const std::vector<HydraMesh*>& GetMeshes() const { return RenderDelegate->GetMeshes(); }
+    size_t GetNumRprims() const { return RenderIndex ? RenderIndex->GetRprimIds().size() : 0; }
+
+private:
+    pxr::UsdStageRefPtr Stage;
+    std::unique_ptr<HydraRenderDelegate> RenderDelegate;
+    std::unique_ptr<pxr::HdRenderIndex> RenderIndex;
+    std::unique_ptr<pxr::UsdImagingDelegate> SceneDelegate;
+    pxr::HdEngine Engine;
+    pxr::HdTaskSharedPtrVector Tasks;
+};
@@ -0,0 +1,32 @@
+#include "IndirectDraws.h"
+
+void IndirectDrawList::Clear()
+{
+    Commands.clear();
+    Batches.clear();
+    NumCompacted = 0;
+}
+
+void IndirectDraws::Build(const std::vector<IndirectDrawCommand>& MeshCommands, const std::vector<DrawPacket>& Packets, IndirectDrawList& Out)
+{
+    Out.Clear();
+    Out.Commands.reserve(Packets.size());
+
+    for (const DrawPacket& Packet : Packets)
+    {
+        const IndirectDrawCommand& Command = MeshCommands[Packet.Mesh];
+        if (Command.IndexCountPerInstance == 0 || Command.InstanceCount == 0)
+        {
+            Out.NumCompacted++;
+            continue;
+        }
+
+        const uint64_t State = DrawSorting::GetState(Packet.Key);
+        if (Out.Batches.empty() || Out.Batches.back().State != State)
+        {
+            Out.Batches.push_back(IndirectDrawBatch{ State, Packet.Mesh, static_cast<uint32_t>(Out.Commands.size()), 0 });
+        }
+        Out.Batches.back().NumCommands++;
+        Out.Commands.push_back(Command);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pch.h"
+#include "DrawSorting.h"
+
+// One command of the indirect argument buffer, laid out the way the mesh command signature reads it: the mesh's dequantisation
+// root constants, then the arguments of DrawIndexedInstanced in the order of D3D12_DRAW_INDEXED_ARGUMENTS.
+struct IndirectDrawCommand
+{
+    PositionDequantisation Dequantisation;
+    uint32_t IndexCountPerInstance = 0;
+    uint32_t InstanceCount = 0;
+    uint32_t StartIndexLocation = 0;
+    int32_t BaseVertexLocation = 0;
+    uint32_t StartInstanceLocation = 0;
+};
+static_assert(sizeof(IndirectDrawCommand) == sizeof(PositionDequantisation) + 5 * sizeof(uint32_t), "Command signature stride must match.");
+
+// Consecutive commands one ExecuteIndirect records. The pipeline and buffer bindings come from Mesh, every other mesh in the batch
+// shares them.
+struct IndirectDrawBatch
+{
+    uint64_t State = 0; // Pass, pipeline and material bits of the batch's keys.
+    uint32_t Mesh = 0;  // First mesh drawn.
+    uint32_t FirstCommand = 0;
+    uint32_t NumCommands = 0;
+};
+
+struct IndirectDrawList
+{
+    std::vector<IndirectDrawCommand> Commands;
+    std::vector<IndirectDrawBatch> Batches;
+    size_t NumCompacted = 0; // Packets left out for drawing nothing.
+
+    void Clear();
+};
+
+// Builds the indirect argument buffer from the per mesh command table, in the layout a GPU culling pass could write directly.
+namespace IndirectDraws
+{
+    // Copies the command of each packet's mesh in packet order, compacting away those without indices or instances, and starts a
+    // new batch wherever the pass, pipeline or material of the keys changes. Reuses Out's memory.
+    void Build(const std::vector<IndirectDrawCommand>& MeshCommands, const std::vector<DrawPacket>& Packets, IndirectDrawList& Out);
+}
@@ -1,6 +1,7 @@
 #include "MainWindow.h"
 
 // Windows
+#include <algorithm>
 #include <cstdio>
 #include <tchar.h>
 #include <wrl.h> // ComPtr
@@ -157,7 +158,11 @@ void MainWindow::Tick()
 {
     nvtx3::scoped_range loop{ "Tick" };
     
-    Time += TimeStep;
+    // Wall clock step, the first tick has none.
+    const std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+    DeltaTime = LastTickTime.time_since_epoch().count() == 0 ? 0.0 : std::min(std::chrono::duration<double>(Now - LastTickTime).count(), MaxDeltaTime);
+    LastTickTime = Now;
+    Time += DeltaTime;
 
     // Update the UI
     UI->RenderUI();
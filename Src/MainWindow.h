@@ -3,6 +3,7 @@
 // Common
 #include <windows.h>
 #include <wrl/client.h>
+#include <chrono>
 #include <memory>
 
 // DX
@@ -26,6 +27,7 @@ public:
     HWND& GetHWND() { return hWnd; }
 
     const double& GetTime() const { return Time; } 
+    double GetDeltaTime() const { return DeltaTime; } // Seconds since the previous tick.
     bool SetupWindow();
 
 public:
@@ -41,7 +43,9 @@ private:
 
     // Timing
     double Time = 0.0;
-    float TimeStep = 0.01f;
+    double DeltaTime = 0.0;
+    std::chrono::steady_clock::time_point LastTickTime;
+    static constexpr double MaxDeltaTime = 0.1; // Long stalls, e.g. loading a scene, don't skip the animation ahead.
     
 
 };
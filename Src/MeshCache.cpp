@@ -0,0 +1,298 @@
+#include "MeshCache.h"
+
+#include "pch.h"
+#include "RenderMesh.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace MeshCacheFormat;
+
+namespace
+{
+    constexpr size_t BlobAlignment = 16;
+
+    size_t AlignUp(size_t Value, size_t Alignment) { return (Value + Alignment - 1) & ~(Alignment - 1); }
+
+    // Word at a time mix of raw bytes into a running 64 bit hash, arrays are hashed with their length.
+    uint64_t HashBytes(uint64_t Hash, const void* Bytes, size_t NumBytes)
+    {
+        const auto Mix = [](uint64_t H, uint64_t Word)
+        {
+            H ^= Word;
+            H *= 0x9E3779B97F4A7C15ull;
+            return H ^ (H >> 29);
+        };
+
+        const uint8_t* Src = static_cast<const uint8_t*>(Bytes);
+        Hash = Mix(Hash, NumBytes);
+
+        size_t Offset = 0;
+        for (; Offset + sizeof(uint64_t) <= NumBytes; Offset += sizeof(uint64_t))
+        {
+            uint64_t Word;
+            memcpy(&Word, Src + Offset, sizeof(Word));
+            Hash = Mix(Hash, Word);
+        }
+        if (Offset < NumBytes)
+        {
+            uint64_t Word = 0;
+            memcpy(&Word, Src + Offset, NumBytes - Offset);
+            Hash = Mix(Hash, Word);
+        }
+        return Hash;
+    }
+
+    template <typename T>
+    uint64_t HashArray(uint64_t Hash, const pxr::VtArray<T>& Array)
+    {
+        return HashBytes(Hash, Array.cdata(), Array.size() * sizeof(T));
+    }
+}
+
+uint64_t MeshSourceArrays::Hash(const MeshBuildSettings& Settings) const
+{
+    // The format version, vertex layout and build settings are part of the key, so changing any never returns stale geometry.
+    const uint32_t Salt[7] = { Version, GetVertexLayouts(), Settings.bIsYUp ? 1u : 0u, Settings.bOptimiseIndexOrder ? 1u : 0u, static_cast<uint32_t>(Settings.Format),
+        Settings.bBuildMeshlets ? 1u : 0u, Settings.bGenerateLods ? 1u : 0u };
+
+    uint64_t Result = HashBytes(0xCBF29CE484222325ull, Salt, sizeof(Salt));
+    Result = HashArray(Result, FaceVertexCounts);
+    Result = HashArray(Result, FaceVertexIndices);
+    Result = HashArray(Result, HoleIndices);
+    Result = HashBytes(Result, Orientation.GetText(), Orientation.size());
+    Result = HashArray(Result, Points);
+    Result = HashArray(Result, Normals);
+    Result = HashArray(Result, UVs);
+    Result = HashBytes(Result, NormalsInterpolation.GetText(), NormalsInterpolation.size());
+    Result = HashBytes(Result, UVsInterpolation.GetText(), UVsInterpolation.size());
+    return Result;
+}
+
+std::shared_ptr<const MeshCacheFile> MeshCacheFile::Open(const std::string& Path)
+{
+    std::shared_ptr<MeshCacheFile> File(new MeshCacheFile());
+    if (!File->Map(Path)) { return nullptr; }
+
+    if (!File->Validate())
+    {
+        std::cout << "MeshCacheFile: Ignoring '" << Path << "', it is corrupt or from an older version.\n";
+        return nullptr;
+    }
+    return File;
+}
+
+MeshCacheFile::~MeshCacheFile()
+{
+#if defined(_WIN32)
+    if (Data) { UnmapViewOfFile(Data); }
+    if (MappingHandle) { CloseHandle(MappingHandle); }
+    if (FileHandle && FileHandle != INVALID_HANDLE_VALUE) { CloseHandle(FileHandle); }
+#else
+    if (Data) { munmap(const_cast<uint8_t*>(Data), Size); }
+#endif
+}
+
+bool MeshCacheFile::Map(const std::string& Path)
+{
+#if defined(_WIN32)
+    FileHandle = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (FileHandle == INVALID_HANDLE_VALUE) { return false; }
+
+    LARGE_INTEGER FileSize;
+    if (!GetFileSizeEx(FileHandle, &FileSize) || FileSize.QuadPart < static_cast<LONGLONG>(sizeof(FileHeader))) { return false; }
+    Size = static_cast<size_t>(FileSize.QuadPart);
+
+    MappingHandle = CreateFileMappingA(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!MappingHandle) { return false; }
+
+    Data = static_cast<const uint8_t*>(MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0));
+    return Data != nullptr;
+#else
+    const int Descriptor = open(Path.c_str(), O_RDONLY);
+    if (Descriptor < 0) { return false; }
+
+    struct stat FileStat;
+    if (fstat(Descriptor, &FileStat) != 0 || FileStat.st_size < static_cast<off_t>(sizeof(FileHeader)))
+    {
+        close(Descriptor);
+        return false;
+    }
+    Size = static_cast<size_t>(FileStat.st_size);
+
+    // The mapping stays valid after the descriptor is closed.
+    void* Mapped = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, Descriptor, 0);
+    close(Descriptor);
+    if (Mapped == MAP_FAILED) { return false; }
+
+    Data = static_cast<const uint8_t*>(Mapped);
+    return true;
+#endif
+}
+
+bool MeshCacheFile::Validate()
+{
+    FileHeader Header;
+    memcpy(&Header, Data, sizeof(Header));
+    if (Header.Magic != Magic || Header.Version != Version || Header.VertexLayouts != GetVertexLayouts()) { return false; }
+    if (Header.EntriesOffset % alignof(FileEntry) != 0) { return false; }
+    if (Header.EntriesOffset > Size || (Size - Header.EntriesOffset) / sizeof(FileEntry) < Header.NumEntries) { return false; }
+
+    Entries = reinterpret_cast<const FileEntry*>(Data + Header.EntriesOffset);
+    NumEntries = Header.NumEntries;
+
+    // Every blob has to lie within the file, checked once here so lookups can trust the table.
+    for (size_t Idx = 0; Idx < NumEntries; Idx++)
+    {
+        const FileEntry& Entry = Entries[Idx];
+        if (Entry.Format >= static_cast<uint32_t>(VertexFormat::Count)) { return false; }
+
+        const size_t VertexStride = GetVertexStride(static_cast<VertexFormat>(Entry.Format));
+        const size_t IndexStride = Entry.NumVertices < 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+        if (Entry.VertexOffset > Size || (Size - Entry.VertexOffset) / VertexStride < Entry.NumVertices) { return false; }
+        if (Entry.IndexOffset > Size || (Size - Entry.IndexOffset) / IndexStride < Entry.NumIndices) { return false; }
+        if (Entry.MeshletOffset % alignof(MeshletBounds) != 0 || Entry.MeshletOffset > Size || Size - Entry.MeshletOffset < GetMeshletBlobSize(Entry)) { return false; }
+        if (Idx > 0 && Entries[Idx - 1].Hash >= Entry.Hash) { return false; }
+
+        if (Entry.NumLods == 0 || Entry.NumLods > MaxMeshLods) { return false; }
+        for (uint32_t Lod = 0; Lod < Entry.NumLods; Lod++)
+        {
+            if (static_cast<uint64_t>(Entry.Lods[Lod].FirstIndex) + Entry.Lods[Lod].NumIndices > Entry.NumIndices) { return false; }
+        }
+
+        if (Entry.OccluderOffset % alignof(uint32_t) != 0 || Entry.OccluderOffset > Size || Size - Entry.OccluderOffset < GetOccluderBlobSize(Entry)) { return false; }
+        if (Entry.NumOccluderIndices % 3 != 0) { return false; }
+        const uint8_t* OccluderIndices = Data + Entry.OccluderOffset + static_cast<size_t>(Entry.NumOccluderVertices) * sizeof(DirectX::XMFLOAT3);
+        for (uint32_t Idx = 0; Idx < Entry.NumOccluderIndices; Idx++)
+        {
+            uint32_t Vertex;
+            memcpy(&Vertex, OccluderIndices + Idx * sizeof(uint32_t), sizeof(Vertex));
+            if (Vertex >= Entry.NumOccluderVertices) { return false; }
+        }
+    }
+    return true;
+}
+
+const FileEntry* MeshCacheFile::Find(uint64_t Hash) const
+{
+    const FileEntry* End = Entries + NumEntries;
+    const FileEntry* Found = std::lower_bound(Entries, End, Hash, [](const FileEntry& Entry, uint64_t Key) { return Entry.Hash < Key; });
+    return (Found != End && Found->Hash == Hash) ? Found : nullptr;
+}
+
+void MeshCacheWriter::Add(uint64_t Hash, const MeshData& Mesh)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (!Hashes.insert(Hash).second) { return; }
+
+    FileEntry Entry;
+    Entry.Hash = Hash;
+    Entry.NumVertices = static_cast<uint32_t>(Mesh.GetNumVertices());
+    Entry.NumIndices = static_cast<uint32_t>(Mesh.GetNumIndices());
+    Entry.NumSourceVertices = static_cast<uint32_t>(Mesh.NumSourceVertices);
+    Entry.NumDegenerateTriangles = static_cast<uint32_t>(Mesh.NumDegenerateTriangles);
+    Entry.Format = static_cast<uint32_t>(Mesh.Format);
+    memcpy(Entry.PositionScale, &Mesh.Dequantisation.Scale, sizeof(Entry.PositionScale));
+    memcpy(Entry.PositionOffset, &Mesh.Dequantisation.Offset, sizeof(Entry.PositionOffset));
+    memcpy(Entry.BoundsCenter, &Mesh.BoundsCenter, sizeof(Entry.BoundsCenter));
+    Entry.BoundsRadius = Mesh.BoundsRadius;
+    memcpy(Entry.BoundsExtents, &Mesh.BoundsExtents, sizeof(Entry.BoundsExtents));
+    Entry.NumLods = static_cast<uint32_t>(std::min<size_t>(Mesh.Lods.size(), MaxMeshLods));
+    std::copy(Mesh.Lods.begin(), Mesh.Lods.begin() + Entry.NumLods, Entry.Lods);
+
+    // Blobs are written in their GPU layout, the same bytes the pipeline would copy to the upload heap.
+    Entry.VertexOffset = AlignUp(Blobs.size(), BlobAlignment);
+    Entry.IndexOffset = AlignUp(Entry.VertexOffset + Mesh.GetVertexBufferSize(), BlobAlignment);
+    Blobs.resize(Entry.IndexOffset + Mesh.GetIndexBufferSize());
+    memcpy(Blobs.data() + Entry.VertexOffset, Mesh.GetVertexData(), Mesh.GetVertexBufferSize());
+    Mesh.CopyIndices(Blobs.data() + Entry.IndexOffset);
+
+    const MeshletData& Clusters = Mesh.Clusters;
+    Entry.NumMeshlets = static_cast<uint32_t>(Clusters.Meshlets.size());
+    Entry.NumMeshletVertices = static_cast<uint32_t>(Clusters.VertexIndices.size());
+    Entry.NumMeshletTriangles = static_cast<uint32_t>(Clusters.Triangles.size() / 3);
+    Entry.MeshletOffset = AlignUp(Blobs.size(), BlobAlignment);
+    Blobs.resize(Entry.MeshletOffset + GetMeshletBlobSize(Entry));
+
+    uint8_t* MeshletBlob = Blobs.data() + Entry.MeshletOffset;
+    const auto AppendBlob = [&MeshletBlob](const auto& Src)
+    {
+        memcpy(MeshletBlob, Src.data(), Src.size() * sizeof(Src[0]));
+        MeshletBlob += Src.size() * sizeof(Src[0]);
+    };
+    AppendBlob(Clusters.Meshlets);
+    AppendBlob(Clusters.Bounds);
+    AppendBlob(Clusters.VertexIndices);
+    AppendBlob(Clusters.Triangles);
+
+    const OccluderMesh& Occluder = Mesh.Occluder;
+    Entry.NumOccluderVertices = static_cast<uint32_t>(Occluder.Positions.size());
+    Entry.NumOccluderIndices = static_cast<uint32_t>(Occluder.Indices.size());
+    Entry.OccluderOffset = AlignUp(Blobs.size(), BlobAlignment);
+    Blobs.resize(Entry.OccluderOffset + GetOccluderBlobSize(Entry));
+
+    uint8_t* OccluderBlob = Blobs.data() + Entry.OccluderOffset;
+    memcpy(OccluderBlob, Occluder.Positions.data(), Occluder.Positions.size() * sizeof(DirectX::XMFLOAT3));
+    memcpy(OccluderBlob + Occluder.Positions.size() * sizeof(DirectX::XMFLOAT3), Occluder.Indices.data(), Occluder.Indices.size() * sizeof(uint32_t));
+
+    Entries.push_back(Entry);
+}
+
+bool MeshCacheWriter::Write(const std::string& Path) const
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+
+    const size_t BlobStart = AlignUp(sizeof(FileHeader), BlobAlignment);
+
+    FileHeader Header;
+    Header.Magic = Magic;
+    Header.Version = Version;
+    Header.VertexLayouts = GetVertexLayouts();
+    Header.NumEntries = static_cast<uint32_t>(Entries.size());
+    Header.EntriesOffset = AlignUp(BlobStart + Blobs.size(), BlobAlignment);
+
+    std::vector<FileEntry> SortedEntries = Entries;
+    for (FileEntry& Entry : SortedEntries)
+    {
+        Entry.VertexOffset += BlobStart;
+        Entry.IndexOffset += BlobStart;
+        Entry.MeshletOffset += BlobStart;
+        Entry.OccluderOffset += BlobStart;
+    }
+    std::sort(SortedEntries.begin(), SortedEntries.end(), [](const FileEntry& A, const FileEntry& B) { return A.Hash < B.Hash; });
+
+    // Written to a temporary first, a half written cache is never picked up by a running load.
+    const std::string TempPath = Path + ".tmp";
+    {
+        std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+        if (!Out) { return false; }
+
+        const std::vector<char> Padding(BlobAlignment, 0);
+        Out.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+        Out.write(Padding.data(), BlobStart - sizeof(Header));
+        Out.write(reinterpret_cast<const char*>(Blobs.data()), Blobs.size());
+        Out.write(Padding.data(), Header.EntriesOffset - BlobStart - Blobs.size());
+        Out.write(reinterpret_cast<const char*>(SortedEntries.data()), SortedEntries.size() * sizeof(FileEntry));
+        if (!Out) { return false; }
+    }
+
+    std::remove(Path.c_str());
+    return std::rename(TempPath.c_str(), Path.c_str()) == 0;
+}
+
+std::string MeshCache::GetCachePath(const std::string& ScenePath)
+{
+    return ScenePath + ".meshcache";
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "pch.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "OcclusionCulling.h"
+
+// Usd
+#include "pxr/base/gf/vec2f.h"
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/base/tf/token.h"
+#include "pxr/base/vt/array.h"
+
+// Cooked geometry, one file per USD scene next to it as '<scene>.meshcache'.
+// Entries are keyed by a content hash of the mesh's USD topology and primvars, and hold the vertex and index
+// buffers exactly as StaticMeshPipeline uploads them, so a load maps the file and copies the blobs straight to the GPU.
+//
+// Layout: FileHeader | 16 byte aligned vertex, index, meshlet and occluder blobs | FileEntry table sorted by hash.
+// A meshlet blob is the Meshlet, MeshletBounds, vertex index and triangle arrays of a MeshletData back to back,
+// an occluder blob the positions and 32 bit indices of an OccluderMesh.
+namespace MeshCacheFormat
+{
+    constexpr uint32_t Magic = 0x434D5844; // 'DXMC'
+
+    // Bump whenever the processing between USD and the uploaded buffers changes, old entries then miss.
+    constexpr uint32_t Version = 8;
+
+    struct FileHeader
+    {
+        uint32_t Magic = 0;
+        uint32_t Version = 0;
+        uint32_t VertexLayouts = 0; // Sizes of both vertex layouts, old files miss when either changes.
+        uint32_t NumEntries = 0;
+        uint64_t EntriesOffset = 0;
+    };
+
+    struct FileEntry
+    {
+        uint64_t Hash = 0;
+        uint64_t VertexOffset = 0;
+        uint64_t IndexOffset = 0;    // 16 bit indices when NumVertices < 65536, 32 bit otherwise.
+        uint32_t NumVertices = 0;
+        uint32_t NumIndices = 0;
+        uint32_t NumSourceVertices = 0;
+        uint32_t NumDegenerateTriangles = 0;
+        uint32_t Format = 0;        // VertexFormat of the vertex blob, the scale and offset are its PositionDequantisation.
+        float PositionScale[3] = {};
+        float PositionOffset[3] = {};
+        uint32_t NumMeshlets = 0;
+        uint64_t MeshletOffset = 0;
+        uint32_t NumMeshletVertices = 0;
+        uint32_t NumMeshletTriangles = 0;
+        float BoundsCenter[3] = {}; // Render space bounding sphere, centred on the bounding box.
+        float BoundsRadius = 0.0f;
+        float BoundsExtents[3] = {}; // Half size of the render space bounding box.
+        uint32_t NumLods = 0;       // Index ranges of the LODs, LOD0 first.
+        MeshLod Lods[MaxMeshLods] = {};
+        uint32_t NumOccluderVertices = 0; // Both 0 for meshes that are never occluders.
+        uint32_t NumOccluderIndices = 0;
+        uint64_t OccluderOffset = 0;
+    };
+
+    inline size_t GetMeshletBlobSize(const FileEntry& Entry)
+    {
+        return static_cast<size_t>(Entry.NumMeshlets) * (sizeof(Meshlet) + sizeof(MeshletBounds)) + static_cast<size_t>(Entry.NumMeshletVertices) * sizeof(uint32_t)
+            + static_cast<size_t>(Entry.NumMeshletTriangles) * 3;
+    }
+
+    inline size_t GetOccluderBlobSize(const FileEntry& Entry)
+    {
+        return static_cast<size_t>(Entry.NumOccluderVertices) * sizeof(DirectX::XMFLOAT3) + static_cast<size_t>(Entry.NumOccluderIndices) * sizeof(uint32_t);
+    }
+
+    inline uint32_t GetVertexLayouts() { return static_cast<uint32_t>(sizeof(Vertex) | (sizeof(QuantisedVertex) << 16)); }
+}
+
+// Options a mesh is built with, part of the cache key alongside its USD data.
+struct MeshBuildSettings
+{
+    bool bIsYUp = true;
+    bool bOptimiseIndexOrder = true; // Vertex cache, overdraw and vertex fetch ordering after welding.
+    VertexFormat Format = VertexFormat::QuantisedBounds;
+    bool bBuildMeshlets = true;      // Meshlet side table with culling bounds, for meshes over one meshlet.
+    bool bGenerateLods = true;       // Quadric simplified LODs appended to the index buffer.
+};
+
+// The USD data a mesh is built from, read once and hashed before deciding whether to triangulate.
+struct MeshSourceArrays
+{
+    pxr::VtArray<int> FaceVertexCounts;
+    pxr::VtArray<int> FaceVertexIndices;
+    pxr::VtArray<int> HoleIndices;
+    pxr::TfToken Orientation;
+    pxr::VtArray<pxr::GfVec3f> Points;
+    pxr::VtArray<pxr::GfVec3f> Normals;
+    pxr::VtArray<pxr::GfVec2f> UVs;
+    pxr::TfToken NormalsInterpolation; // As authored, in UsdGeomTokens names, empty without the primvar. Per vertex when unknown.
+    pxr::TfToken UVsInterpolation;
+
+    uint64_t Hash(const MeshBuildSettings& Settings) const;
+};
+
+// Read only view of a cooked mesh cache, memory mapped for as long as any mesh references it.
+class MeshCacheFile
+{
+public:
+    static std::shared_ptr<const MeshCacheFile> Open(const std::string& Path);
+    ~MeshCacheFile();
+
+    const MeshCacheFormat::FileEntry* Find(uint64_t Hash) const;
+    const uint8_t* GetData(uint64_t Offset) const { return Data + Offset; }
+    size_t GetNumEntries() const { return NumEntries; }
+
+private:
+    MeshCacheFile() = default;
+    bool Map(const std::string& Path);
+    bool Validate();
+
+private:
+    const uint8_t* Data = nullptr;
+    size_t Size = 0;
+    const MeshCacheFormat::FileEntry* Entries = nullptr;
+    size_t NumEntries = 0;
+
+#if defined(_WIN32)
+    void* FileHandle = nullptr;
+    void* MappingHandle = nullptr;
+#endif
+};
+
+// Collects cooked meshes, safe to add to from parallel mesh builds. Identical meshes are only stored once.
+class MeshCacheWriter
+{
+public:
+    void Add(uint64_t Hash, const struct MeshData& Mesh);
+    bool Write(const std::string& Path) const;
+
+    size_t GetNumEntries() const { return Entries.size(); }
+    size_t GetBlobBytes() const { return Blobs.size(); }
+
+private:
+    mutable std::mutex Mutex;
+    std::unordered_set<uint64_t> Hashes;
+    std::vector<MeshCacheFormat::FileEntry> Entries; // Offsets relative to the start of Blobs.
+    std::vector<uint8_t> Blobs;
+};
+
+namespace MeshCache
+{
+    std::string GetCachePath(const std::string& ScenePath);
+}
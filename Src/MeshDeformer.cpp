@@ -0,0 +1,323 @@
+#include "MeshDeformer.h"
+
+// Std
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+// USD
+#include "pxr/usd/usdGeom/mesh.h"
+#include "pxr/usd/usdGeom/tokens.h"
+#include "pxr/usd/usdGeom/xformable.h"
+#include "pxr/usd/usdSkel/animQuery.h"
+#include "pxr/usd/usdSkel/bindingAPI.h"
+
+using namespace pxr;
+
+namespace
+{
+    // Joint influences are only read through the skinning query, their presence marks a mesh a skeleton may bind.
+    bool HasAuthoredJointInfluences(const UsdPrim& Prim)
+    {
+        if (!Prim.HasAPI<UsdSkelBindingAPI>()) { return false; }
+        const UsdGeomPrimvar JointIndices = UsdSkelBindingAPI(Prim).GetJointIndicesPrimvar();
+        return JointIndices && JointIndices.HasAuthoredValue();
+    }
+}
+
+bool MeshDeformer::IsDeforming(const UsdPrim& Prim)
+{
+    const UsdAttribute Points = Prim.GetAttribute(UsdGeomTokens->points);
+    const UsdAttribute Normals = Prim.GetAttribute(UsdGeomTokens->normals);
+    return (Points && Points.ValueMightBeTimeVarying()) || (Normals && Normals.ValueMightBeTimeVarying()) || HasAuthoredJointInfluences(Prim);
+}
+
+MeshDeformer::MeshDeformer(const UsdPrim& Prim, bool bInIsYUp)
+    : PointsAttr(Prim.GetAttribute(UsdGeomTokens->points))
+    , NormalsAttr(Prim.GetAttribute(UsdGeomTokens->normals))
+    , bIsYUp(bInIsYUp)
+    , bHasJointInfluences(HasAuthoredJointInfluences(Prim))
+    , MeshPrim(Prim)
+{
+    bPointsVarying = PointsAttr && PointsAttr.ValueMightBeTimeVarying();
+    bNormalsVarying = NormalsAttr && NormalsAttr.ValueMightBeTimeVarying();
+
+    // Nothing has been sampled yet, the first Sample reads every time varying primvar.
+    const double NaN = std::numeric_limits<double>::quiet_NaN();
+    PointsBracket = GfVec2d(NaN, NaN);
+    NormalsBracket = GfVec2d(NaN, NaN);
+}
+
+void MeshDeformer::SetVertexSources(std::vector<uint32_t> InVertexPoints, std::vector<uint32_t> InVertexNormals, const std::vector<Vertex>& BuiltVertices,
+    const VtArray<GfVec3f>& InPoints, const VtArray<GfVec3f>& InNormals)
+{
+    VertexPoints = std::move(InVertexPoints);
+    VertexNormals = bNormalsVarying ? std::move(InVertexNormals) : std::vector<uint32_t>();
+    Points = InPoints;
+    Normals = InNormals;
+
+    Colours.resize(BuiltVertices.size());
+    RestNormals.resize(BuiltVertices.size());
+    for (size_t Idx = 0; Idx < BuiltVertices.size(); Idx++)
+    {
+        Colours[Idx] = BuiltVertices[Idx].Colour;
+        RestNormals[Idx] = BuiltVertices[Idx].Normals;
+    }
+
+    // Samples shorter than this would index past their end, they are skipped and the last good one is kept.
+    NumRequiredPoints = VertexPoints.empty() ? 0 : *std::max_element(VertexPoints.begin(), VertexPoints.end()) + size_t(1);
+    NumRequiredNormals = VertexNormals.empty() ? 0 : *std::max_element(VertexNormals.begin(), VertexNormals.end()) + size_t(1);
+    Version++;
+}
+
+bool MeshDeformer::BindSkeleton(const UsdSkelSkeletonQuery& InSkelQuery, const UsdSkelSkinningQuery& InSkinQuery)
+{
+    if (!bHasJointInfluences || !InSkelQuery || !InSkinQuery || VertexPoints.empty()) { return false; }
+
+    // Influences are authored per point, or once for a mesh rigidly bound to its joints, which is expanded to every point.
+    VtIntArray JointIndices;
+    VtFloatArray JointWeights;
+    const uint32_t NumInfluences = static_cast<uint32_t>(InSkinQuery.GetNumInfluencesPerComponent());
+    if (NumInfluences == 0 || !InSkinQuery.ComputeVaryingJointInfluences(Points.size(), &JointIndices, &JointWeights) ||
+        JointIndices.size() < Points.size() * NumInfluences || JointWeights.size() < Points.size() * NumInfluences)
+    {
+        return false;
+    }
+
+    // Influences index the mesh's own joint order when it has one, the skeleton's otherwise.
+    VtTokenArray MeshJointOrder;
+    const size_t NumJoints = InSkinQuery.GetJointOrder(&MeshJointOrder) ? MeshJointOrder.size() : InSkelQuery.GetJointOrder().size();
+    if (NumJoints == 0 || NumJoints > std::numeric_limits<uint16_t>::max()) { return false; }
+
+    SkelQuery = InSkelQuery;
+    SkinQuery = InSkinQuery;
+    GeomBindTransform = SkinQuery.GetGeomBindTransform();
+
+    // The rest pose is the points the mesh was built from, one entry per welded vertex.
+    const size_t NumVertices = VertexPoints.size();
+    const GfVec3f* PointData = Points.cdata();
+    SkinnedMesh.Resize(NumVertices, NumInfluences, static_cast<uint32_t>(NumJoints));
+    for (size_t Idx = 0; Idx < NumVertices; Idx++)
+    {
+        const size_t Point = VertexPoints[Idx];
+        SkinnedMesh.SetVertex(Idx, ToRenderSpace(PointData[Point]), RestNormals[Idx], Colours[Idx]);
+        for (uint32_t Influence = 0; Influence < NumInfluences; Influence++)
+        {
+            const int Joint = JointIndices[Point * NumInfluences + Influence];
+            const bool bValid = Joint >= 0 && static_cast<size_t>(Joint) < NumJoints;
+            SkinnedMesh.SetInfluence(Idx, Influence, bValid ? static_cast<uint16_t>(Joint) : uint16_t(0), bValid ? JointWeights[Point * NumInfluences + Influence] : 0.0f);
+        }
+    }
+    SkinnedMesh.PadGroups();
+
+    // Every inbetween of a blend shape is its own sparse shape, offsets of a point go to each vertex welded from it.
+    BlendShapeQuery = UsdSkelBlendShapeQuery(UsdSkelBindingAPI(MeshPrim));
+    if (SkinQuery.HasBlendShapes() && BlendShapeQuery.IsValid())
+    {
+        std::vector<uint32_t> PointFirstVertex(Points.size() + 1, 0);
+        std::vector<uint32_t> PointVertices(NumVertices);
+        for (const uint32_t Point : VertexPoints) { PointFirstVertex[Point + 1]++; }
+        for (size_t Point = 0; Point < Points.size(); Point++) { PointFirstVertex[Point + 1] += PointFirstVertex[Point]; }
+        std::vector<uint32_t> PointFill(PointFirstVertex.begin(), PointFirstVertex.end() - 1);
+        for (size_t Idx = 0; Idx < NumVertices; Idx++) { PointVertices[PointFill[VertexPoints[Idx]]++] = static_cast<uint32_t>(Idx); }
+
+        const std::vector<VtIntArray> ShapePointIndices = BlendShapeQuery.ComputeBlendShapePointIndices();
+        const std::vector<VtVec3fArray> SubShapeOffsets = BlendShapeQuery.ComputeSubShapePointOffsets();
+        const std::vector<VtVec3fArray> SubShapeNormalOffsets = BlendShapeQuery.ComputeSubShapeNormalOffsets();
+        for (size_t SubShape = 0; SubShape < BlendShapeQuery.GetNumSubShapes(); SubShape++)
+        {
+            // Shapes without point indices offset every point in order.
+            const VtIntArray& Indices = ShapePointIndices[BlendShapeQuery.GetBlendShapeIndex(SubShape)];
+            const VtVec3fArray& Offsets = SubShapeOffsets[SubShape];
+            const VtVec3fArray& NormalOffsets = SubShapeNormalOffsets[SubShape];
+            const bool bHasNormalOffsets = NormalOffsets.size() == Offsets.size();
+
+            SkinBlendShape Shape;
+            for (size_t Idx = 0; Idx < Offsets.size(); Idx++)
+            {
+                const size_t Point = Indices.empty() ? Idx : static_cast<size_t>(Indices[Idx]);
+                if (Point >= Points.size()) { continue; }
+
+                for (uint32_t Slot = PointFirstVertex[Point]; Slot < PointFirstVertex[Point + 1]; Slot++)
+                {
+                    Shape.Vertices.push_back(PointVertices[Slot]);
+                    Shape.PositionOffsets.push_back(ToRenderSpace(Offsets[Idx]));
+                    if (bHasNormalOffsets) { Shape.NormalOffsets.push_back(ToRenderSpace(NormalOffsets[Idx])); }
+                }
+            }
+            SkinnedMesh.BlendShapes.emplace_back(std::move(Shape));
+        }
+    }
+    SubShapeWeights.assign(SkinnedMesh.BlendShapes.size(), 0.0f);
+    JointMatrices.assign(NumJoints, DirectX::XMFLOAT4X4());
+
+    // The first pose validates the skeleton, a mesh it cannot pose keeps playing its own primvars.
+    bSkinned = true;
+    PosedTimeCode = std::numeric_limits<double>::quiet_NaN();
+    if (!SampleSkeleton(UsdTimeCode::EarliestTime()))
+    {
+        bSkinned = false;
+        SkinnedMesh = SkinnedMeshSoA();
+        JointMatrices.clear();
+        SubShapeWeights.clear();
+        return false;
+    }
+    Version++;
+    return true;
+}
+
+bool MeshDeformer::SampleSkeleton(UsdTimeCode Time)
+{
+    // Joints are evaluated at any time, interpolating their animation, so only an unchanged time skips the pose.
+    if (Time.GetValue() == PosedTimeCode) { return false; }
+
+    if (!SkelQuery.ComputeSkinningTransforms(&SkelTransforms, Time))
+    {
+        NumRejectedSamples++;
+        return false;
+    }
+    const VtMatrix4dArray* Transforms = &SkelTransforms;
+    if (const UsdSkelAnimMapperRefPtr& Mapper = SkinQuery.GetJointMapper())
+    {
+        if (!Mapper->RemapTransforms(SkelTransforms, &MeshTransforms))
+        {
+            NumRejectedSamples++;
+            return false;
+        }
+        Transforms = &MeshTransforms;
+    }
+    if (Transforms->size() < JointMatrices.size())
+    {
+        NumRejectedSamples++;
+        return false;
+    }
+
+    // Skinning leaves the points in skeleton space, the mesh is drawn with its own world transform, so that is taken out again.
+    const GfMatrix4d SkelToWorld = UsdGeomXformable(SkelQuery.GetPrim()).ComputeLocalToWorldTransform(Time);
+    const GfMatrix4d WorldToMesh = UsdGeomXformable(MeshPrim).ComputeLocalToWorldTransform(Time).GetInverse();
+    const GfMatrix4d SkelToMesh = SkelToWorld * WorldToMesh;
+    for (size_t Joint = 0; Joint < JointMatrices.size(); Joint++)
+    {
+        JointMatrices[Joint] = ToRenderSpace(GeomBindTransform * (*Transforms)[Joint] * SkelToMesh);
+    }
+
+    // Blend shape weights come from the skeleton's animation, in its order, and are spread over each shape's inbetweens.
+    if (!SubShapeWeights.empty())
+    {
+        std::fill(SubShapeWeights.begin(), SubShapeWeights.end(), 0.0f);
+        const UsdSkelAnimQuery& AnimQuery = SkelQuery.GetAnimQuery();
+        if (AnimQuery && AnimQuery.ComputeBlendShapeWeights(&AnimWeights, Time))
+        {
+            const VtFloatArray* Weights = &AnimWeights;
+            if (const UsdSkelAnimMapperRefPtr& Mapper = SkinQuery.GetBlendShapeMapper())
+            {
+                Mapper->Remap(AnimWeights, &MeshWeights);
+                Weights = &MeshWeights;
+            }
+            if (BlendShapeQuery.ComputeSubShapeWeights(*Weights, &ActiveSubShapeWeights, &ActiveBlendShapes, &ActiveSubShapes))
+            {
+                for (size_t Idx = 0; Idx < ActiveSubShapes.size(); Idx++)
+                {
+                    if (ActiveSubShapes[Idx] < SubShapeWeights.size()) { SubShapeWeights[ActiveSubShapes[Idx]] = ActiveSubShapeWeights[Idx]; }
+                }
+            }
+        }
+    }
+
+    PosedTimeCode = Time.GetValue();
+    return true;
+}
+
+bool MeshDeformer::SamplePrimvar(const UsdAttribute& Attr, UsdTimeCode Time, size_t NumRequired, VtArray<GfVec3f>& InOutValues, GfVec2d& InOutBracket)
+{
+    // Between two time samples the value is interpolated, before the first or after the last it is held and only read once.
+    double Lower = 0.0;
+    double Upper = 0.0;
+    bool bHasTimeSamples = false;
+    if (!Attr.GetBracketingTimeSamples(Time.GetValue(), &Lower, &Upper, &bHasTimeSamples) || !bHasTimeSamples) { return false; }
+
+    const GfVec2d Bracket(Lower, Upper);
+    if (Lower == Upper && Bracket == InOutBracket) { return false; }
+
+    if (!Attr.Get(&Scratch, Time) || Scratch.size() < NumRequired)
+    {
+        NumRejectedSamples++;
+        return false;
+    }
+    InOutValues.swap(Scratch);
+    InOutBracket = Bracket;
+    return true;
+}
+
+bool MeshDeformer::Sample(UsdTimeCode Time)
+{
+    if (bSkinned)
+    {
+        const bool bPosed = SampleSkeleton(Time);
+        if (bPosed) { Version++; }
+        return bPosed;
+    }
+
+    bool bChanged = false;
+    if (bPointsVarying) { bChanged |= SamplePrimvar(PointsAttr, Time, NumRequiredPoints, Points, PointsBracket); }
+    if (bNormalsVarying) { bChanged |= SamplePrimvar(NormalsAttr, Time, NumRequiredNormals, Normals, NormalsBracket); }
+    if (bChanged) { Version++; }
+    return bChanged;
+}
+
+DirectX::XMFLOAT3 MeshDeformer::ToRenderSpace(const GfVec3f& Value) const
+{
+    // The same Y and Z swap the mesh build applies to Z up stages.
+    return bIsYUp ? DirectX::XMFLOAT3(Value[0], Value[1], Value[2]) : DirectX::XMFLOAT3(Value[0], Value[2], Value[1]);
+}
+
+DirectX::XMFLOAT4X4 MeshDeformer::ToRenderSpace(const GfMatrix4d& Matrix) const
+{
+    // Same basis change as the vertices, S * M * S.
+    const int Axis[4] = { 0, bIsYUp ? 1 : 2, bIsYUp ? 2 : 1, 3 };
+
+    DirectX::XMFLOAT4X4 Out;
+    for (int Row = 0; Row < 4; Row++)
+    {
+        for (int Col = 0; Col < 4; Col++)
+        {
+            Out.m[Row][Col] = static_cast<float>(Matrix[Axis[Row]][Axis[Col]]);
+        }
+    }
+    return Out;
+}
+
+void MeshDeformer::WriteVertices(Vertex* Dest, DeformedBounds& OutBounds)
+{
+    DirectX::XMFLOAT3 Min(FLT_MAX, FLT_MAX, FLT_MAX);
+    DirectX::XMFLOAT3 Max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    if (bSkinned)
+    {
+        Skinning::Skin(SkinnedMesh, JointMatrices.data(), SubShapeWeights.empty() ? nullptr : SubShapeWeights.data(), SkinScratch, Dest, Min, Max);
+    }
+    else
+    {
+        const GfVec3f* PointData = Points.cdata();
+        const GfVec3f* NormalData = Normals.cdata();
+        const bool bStaticNormals = VertexNormals.empty();
+        for (size_t Idx = 0; Idx < VertexPoints.size(); Idx++)
+        {
+            Vertex Vtx;
+            Vtx.Position = ToRenderSpace(PointData[VertexPoints[Idx]]);
+            Vtx.Normals = bStaticNormals ? RestNormals[Idx] : ToRenderSpace(NormalData[VertexNormals[Idx]]);
+            Vtx.Colour = Colours[Idx];
+            Dest[Idx] = Vtx;
+
+            Min = DirectX::XMFLOAT3(std::min(Min.x, Vtx.Position.x), std::min(Min.y, Vtx.Position.y), std::min(Min.z, Vtx.Position.z));
+            Max = DirectX::XMFLOAT3(std::max(Max.x, Vtx.Position.x), std::max(Max.y, Vtx.Position.y), std::max(Max.z, Vtx.Position.z));
+        }
+    }
+
+    OutBounds = DeformedBounds();
+    if (VertexPoints.empty()) { return; }
+    OutBounds.Center = DirectX::XMFLOAT3((Min.x + Max.x) * 0.5f, (Min.y + Max.y) * 0.5f, (Min.z + Max.z) * 0.5f);
+    OutBounds.Extents = DirectX::XMFLOAT3((Max.x - Min.x) * 0.5f, (Max.y - Min.y) * 0.5f, (Max.z - Min.z) * 0.5f);
+    OutBounds.Radius = std::sqrt(OutBounds.Extents.x * OutBounds.Extents.x + OutBounds.Extents.y * OutBounds.Extents.y + OutBounds.Extents.z * OutBounds.Extents.z);
+}
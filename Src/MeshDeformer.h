@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "pch.h"
+#include "Skinning.h"
+
+#include "pxr/usd/usd/prim.h"
+#include "pxr/usd/usd/attribute.h"
+#include "pxr/usd/usdSkel/blendShapeQuery.h"
+#include "pxr/usd/usdSkel/skeletonQuery.h"
+#include "pxr/usd/usdSkel/skinningQuery.h"
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/gf/vec2d.h"
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/base/vt/array.h"
+#include "pxr/base/vt/types.h"
+
+// Render space box around a mesh's deformed vertices, with the sphere around its corners.
+struct DeformedBounds
+{
+    DirectX::XMFLOAT3 Center = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    DirectX::XMFLOAT3 Extents = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    float Radius = 0.0f;
+};
+
+// Vertex source of a mesh whose points or normals are time sampled. Triangulation and welding run once when the mesh is built
+// and leave the source point, and face varying normal when those vary too, of every vertex. A frame then only re-reads the
+// time varying primvars and gathers them into the vertex layout.
+// Meshes bound to a UsdSkel skeleton are skinned instead, their rest pose is posed by the skeleton's joints and blend shapes.
+class MeshDeformer
+{
+public:
+    // True when the points or normals of the mesh are time varying, or it has joint influences for a skeleton to skin it with.
+    static bool IsDeforming(const pxr::UsdPrim& Prim);
+
+    MeshDeformer(const pxr::UsdPrim& Prim, bool bInIsYUp);
+
+    // The welded vertices' sources, with the primvar values the mesh was built from. Colours and rest normals are kept
+    // from the built vertices.
+    void SetVertexSources(std::vector<uint32_t> InVertexPoints, std::vector<uint32_t> InVertexNormals, const std::vector<Vertex>& BuiltVertices,
+        const pxr::VtArray<pxr::GfVec3f>& InPoints, const pxr::VtArray<pxr::GfVec3f>& InNormals);
+
+    // Reads the stage, after SetVertexSources. Expands the joint influences and blend shapes of the rest pose to the welded
+    // vertices and poses it at the earliest time. False when the binding cannot be skinned, the mesh then keeps its time samples.
+    bool BindSkeleton(const pxr::UsdSkelSkeletonQuery& InSkelQuery, const pxr::UsdSkelSkinningQuery& InSkinQuery);
+
+    // Reads the stage, re-samples only the time varying primvars, or the skeleton's pose, at Time. True when the vertices changed.
+    bool Sample(pxr::UsdTimeCode Time);
+
+    // Writes every vertex in the Float format, front to back so Dest may be write combined upload memory. Meshes are
+    // independent, different meshes may be written on different threads.
+    void WriteVertices(Vertex* Dest, DeformedBounds& OutBounds);
+
+    bool HasVaryingNormals() const { return bNormalsVarying; }
+    bool HasJointInfluences() const { return bHasJointInfluences; }
+    bool IsSkinned() const { return bSkinned; }
+    const std::vector<uint32_t>& GetVertexPoints() const { return VertexPoints; }
+    size_t GetNumVertices() const { return VertexPoints.size(); }
+    size_t GetVertexBufferSize() const { return GetNumVertices() * sizeof(Vertex); }
+    uint64_t GetVersion() const { return Version; } // Bumped by every Sample that changed the vertices.
+    size_t GetNumRejectedSamples() const { return NumRejectedSamples; } // Samples too short for the topology, e.g. a changing point count, or poses that failed.
+
+private:
+    bool SamplePrimvar(const pxr::UsdAttribute& Attr, pxr::UsdTimeCode Time, size_t NumRequired, pxr::VtArray<pxr::GfVec3f>& InOutValues, pxr::GfVec2d& InOutBracket);
+    bool SampleSkeleton(pxr::UsdTimeCode Time);
+    DirectX::XMFLOAT3 ToRenderSpace(const pxr::GfVec3f& Value) const;
+    DirectX::XMFLOAT4X4 ToRenderSpace(const pxr::GfMatrix4d& Matrix) const;
+
+    pxr::UsdAttribute PointsAttr;
+    pxr::UsdAttribute NormalsAttr;
+    bool bPointsVarying = false;
+    bool bNormalsVarying = false;
+    bool bIsYUp = true;
+
+    std::vector<uint32_t> VertexPoints;  // Index into Points per vertex.
+    std::vector<uint32_t> VertexNormals; // Index into Normals per vertex, empty when the normals are static.
+    std::vector<DirectX::XMFLOAT3> RestNormals; // Render space, written as they are when the normals are static.
+    std::vector<DirectX::XMFLOAT4> Colours;
+    size_t NumRequiredPoints = 0;
+    size_t NumRequiredNormals = 0;
+
+    // Last sample, and the time samples it was read between. Swapped with Scratch so a frame allocates nothing itself.
+    pxr::VtArray<pxr::GfVec3f> Points;
+    pxr::VtArray<pxr::GfVec3f> Normals;
+    pxr::VtArray<pxr::GfVec3f> Scratch;
+    pxr::GfVec2d PointsBracket;
+    pxr::GfVec2d NormalsBracket;
+
+    // Skinning, from BindSkeleton. Joint matrices take the rest pose to the mesh's render space at the posed time.
+    bool bHasJointInfluences = false;
+    bool bSkinned = false;
+    pxr::UsdPrim MeshPrim;
+    pxr::UsdSkelSkeletonQuery SkelQuery;
+    pxr::UsdSkelSkinningQuery SkinQuery;
+    pxr::UsdSkelBlendShapeQuery BlendShapeQuery;
+    pxr::GfMatrix4d GeomBindTransform{1.0};
+    SkinnedMeshSoA SkinnedMesh;
+    SkinningScratch SkinScratch;
+    std::vector<DirectX::XMFLOAT4X4> JointMatrices;
+    std::vector<float> SubShapeWeights; // One per SkinnedMesh blend shape.
+    double PosedTimeCode = 0.0;
+
+    // Per frame skeleton reads, kept so their storage is reused.
+    pxr::VtMatrix4dArray SkelTransforms;
+    pxr::VtMatrix4dArray MeshTransforms;
+    pxr::VtFloatArray AnimWeights;
+    pxr::VtFloatArray MeshWeights;
+    pxr::VtFloatArray ActiveSubShapeWeights;
+    pxr::VtUIntArray ActiveBlendShapes;
+    pxr::VtUIntArray ActiveSubShapes;
+
+    uint64_t Version = 0;
+    size_t NumRejectedSamples = 0;
+};
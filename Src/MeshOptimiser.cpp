@@ -0,0 +1,326 @@
+#include "MeshOptimiser.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+    // Forsyth's published tuning, "Linear-Speed Vertex Cache Optimisation".
+    constexpr float CacheDecayPower = 1.5f;
+    constexpr float LastTriScore = 0.75f;
+    constexpr float ValenceBoostScale = 2.0f;
+    constexpr float ValenceBoostPower = 0.5f;
+    constexpr uint32_t MaxScoredValence = 64;
+
+    // Score tables, indexed by cache position and by the number of triangles still to emit that use the vertex.
+    struct ForsythScoreTables
+    {
+        float Cache[MeshOptimiser::ForsythCacheSize];
+        float Valence[MaxScoredValence];
+
+        ForsythScoreTables()
+        {
+            for (uint32_t Pos = 0; Pos < MeshOptimiser::ForsythCacheSize; Pos++)
+            {
+                // The last triangle's vertices get a fixed score so the next one does not just reuse the same edge.
+                const float Scaler = 1.0f / (MeshOptimiser::ForsythCacheSize - 3);
+                Cache[Pos] = Pos < 3 ? LastTriScore : std::pow(1.0f - (Pos - 3) * Scaler, CacheDecayPower);
+            }
+            Valence[0] = 0.0f;
+            for (uint32_t Count = 1; Count < MaxScoredValence; Count++)
+            {
+                Valence[Count] = ValenceBoostScale * std::pow(static_cast<float>(Count), -ValenceBoostPower);
+            }
+        }
+
+        float Score(int32_t CachePosition, uint32_t Remaining) const
+        {
+            if (Remaining == 0) { return -1.0f; }
+
+            const float CacheScore = CachePosition >= 0 ? Cache[CachePosition] : 0.0f;
+            const float ValenceScore = Remaining < MaxScoredValence ? Valence[Remaining] : ValenceBoostScale * std::pow(static_cast<float>(Remaining), -ValenceBoostPower);
+            return CacheScore + ValenceScore;
+        }
+    };
+
+    // FIFO cache simulation shared by the analysis and the overdraw clustering, timestamps avoid clearing per reset.
+    struct FifoCache
+    {
+        std::vector<uint32_t> Timestamps;
+        uint32_t Time;
+        uint32_t Size;
+
+        FifoCache(size_t NumVertices, uint32_t InSize) : Timestamps(NumVertices, 0), Time(InSize + 1), Size(InSize) {}
+
+        void Reset() { Time += Size + 1; }
+
+        uint32_t Misses(const uint32_t* Tri)
+        {
+            uint32_t Count = 0;
+            for (size_t Corner = 0; Corner < 3; Corner++)
+            {
+                if (Time - Timestamps[Tri[Corner]] > Size)
+                {
+                    Timestamps[Tri[Corner]] = Time++;
+                    Count++;
+                }
+            }
+            return Count;
+        }
+    };
+}
+
+MeshOptimiser::VertexCacheStats MeshOptimiser::AnalyseVertexCache(const std::vector<uint32_t>& Indices, size_t NumVertices, uint32_t CacheSize)
+{
+    VertexCacheStats Stats;
+    const size_t NumTriangles = Indices.size() / 3;
+    if (NumTriangles == 0) { return Stats; }
+
+    FifoCache Cache(NumVertices, CacheSize);
+    std::vector<bool> Referenced(NumVertices, false);
+    size_t NumMisses = 0;
+    size_t NumReferenced = 0;
+    for (size_t Tri = 0; Tri < NumTriangles; Tri++)
+    {
+        NumMisses += Cache.Misses(&Indices[Tri * 3]);
+        for (size_t Corner = 0; Corner < 3; Corner++)
+        {
+            const uint32_t Index = Indices[Tri * 3 + Corner];
+            if (!Referenced[Index]) { Referenced[Index] = true; NumReferenced++; }
+        }
+    }
+
+    Stats.ACMR = static_cast<float>(NumMisses) / static_cast<float>(NumTriangles);
+    Stats.ATVR = static_cast<float>(NumMisses) / static_cast<float>(NumReferenced);
+    return Stats;
+}
+
+void MeshOptimiser::OptimiseVertexCache(std::vector<uint32_t>& Indices, size_t NumVertices)
+{
+    static const ForsythScoreTables Scores;
+
+    const size_t NumTriangles = Indices.size() / 3;
+    if (NumTriangles == 0) { return; }
+
+    // Triangles around each vertex, emitted triangles are swapped out of the end of each vertex's range.
+    std::vector<uint32_t> Remaining(NumVertices, 0);
+    for (const uint32_t Index : Indices) { Remaining[Index]++; }
+
+    std::vector<uint32_t> Offsets(NumVertices + 1, 0);
+    for (size_t Vtx = 0; Vtx < NumVertices; Vtx++) { Offsets[Vtx + 1] = Offsets[Vtx] + Remaining[Vtx]; }
+
+    std::vector<uint32_t> Adjacency(Indices.size());
+    {
+        std::vector<uint32_t> Fill(Offsets.begin(), Offsets.end() - 1);
+        for (size_t Tri = 0; Tri < NumTriangles; Tri++)
+        {
+            for (size_t Corner = 0; Corner < 3; Corner++) { Adjacency[Fill[Indices[Tri * 3 + Corner]]++] = static_cast<uint32_t>(Tri); }
+        }
+    }
+
+    std::vector<int32_t> CachePosition(NumVertices, -1);
+    std::vector<float> VertexScores(NumVertices);
+    for (size_t Vtx = 0; Vtx < NumVertices; Vtx++) { VertexScores[Vtx] = Scores.Score(-1, Remaining[Vtx]); }
+
+    std::vector<float> TriangleScores(NumTriangles);
+    std::vector<bool> Emitted(NumTriangles, false);
+    int64_t BestTri = 0;
+    for (size_t Tri = 0; Tri < NumTriangles; Tri++)
+    {
+        TriangleScores[Tri] = VertexScores[Indices[Tri * 3]] + VertexScores[Indices[Tri * 3 + 1]] + VertexScores[Indices[Tri * 3 + 2]];
+        if (TriangleScores[Tri] > TriangleScores[BestTri]) { BestTri = static_cast<int64_t>(Tri); }
+    }
+
+    std::vector<uint32_t> Result;
+    Result.reserve(Indices.size());
+
+    uint32_t Cache[ForsythCacheSize + 3];
+    uint32_t NewCache[ForsythCacheSize + 3];
+    size_t CacheCount = 0;
+    size_t Cursor = 0; // Where to look for an unemitted triangle once nothing in the cache has any left.
+
+    while (BestTri >= 0)
+    {
+        const uint32_t* Tri = &Indices[BestTri * 3];
+        Emitted[BestTri] = true;
+        Result.insert(Result.end(), Tri, Tri + 3);
+
+        for (size_t Corner = 0; Corner < 3; Corner++)
+        {
+            const uint32_t Vtx = Tri[Corner];
+            uint32_t* Begin = &Adjacency[Offsets[Vtx]];
+            uint32_t* End = Begin + Remaining[Vtx];
+            uint32_t* Found = std::find(Begin, End, static_cast<uint32_t>(BestTri));
+            if (Found == End) { continue; }
+
+            std::swap(*Found, End[-1]);
+            Remaining[Vtx]--;
+        }
+
+        // The emitted triangle moves to the front of the LRU cache.
+        size_t NewCount = 0;
+        for (size_t Corner = 0; Corner < 3; Corner++) { NewCache[NewCount++] = Tri[Corner]; }
+        for (size_t Idx = 0; Idx < CacheCount; Idx++)
+        {
+            const uint32_t Vtx = Cache[Idx];
+            if (Vtx != Tri[0] && Vtx != Tri[1] && Vtx != Tri[2]) { NewCache[NewCount++] = Vtx; }
+        }
+
+        // Rescore every vertex that is in the cache or just fell out of it, and the triangles they still have left.
+        for (size_t Idx = 0; Idx < NewCount; Idx++)
+        {
+            const uint32_t Vtx = NewCache[Idx];
+            const int32_t Position = Idx < ForsythCacheSize ? static_cast<int32_t>(Idx) : -1;
+            CachePosition[Vtx] = Position;
+
+            const float NewScore = Scores.Score(Position, Remaining[Vtx]);
+            const float Delta = NewScore - VertexScores[Vtx];
+            VertexScores[Vtx] = NewScore;
+            for (uint32_t Adj = Offsets[Vtx]; Adj < Offsets[Vtx] + Remaining[Vtx]; Adj++) { TriangleScores[Adjacency[Adj]] += Delta; }
+        }
+        CacheCount = std::min<size_t>(NewCount, ForsythCacheSize);
+        std::copy(NewCache, NewCache + CacheCount, Cache);
+
+        // The next triangle is the best one touching the cache.
+        BestTri = -1;
+        float BestScore = -1.0f;
+        for (size_t Idx = 0; Idx < CacheCount; Idx++)
+        {
+            const uint32_t Vtx = Cache[Idx];
+            for (uint32_t Adj = Offsets[Vtx]; Adj < Offsets[Vtx] + Remaining[Vtx]; Adj++)
+            {
+                if (TriangleScores[Adjacency[Adj]] > BestScore)
+                {
+                    BestScore = TriangleScores[Adjacency[Adj]];
+                    BestTri = Adjacency[Adj];
+                }
+            }
+        }
+
+        if (BestTri < 0)
+        {
+            while (Cursor < NumTriangles && Emitted[Cursor]) { Cursor++; }
+            if (Cursor < NumTriangles) { BestTri = static_cast<int64_t>(Cursor); }
+        }
+    }
+
+    Indices.swap(Result);
+}
+
+void MeshOptimiser::OptimiseOverdraw(std::vector<uint32_t>& Indices, const std::vector<XMFLOAT3>& Positions, float Threshold)
+{
+    const size_t NumTriangles = Indices.size() / 3;
+    if (NumTriangles == 0) { return; }
+
+    // Hard boundaries where the cache restarts, every vertex of the triangle misses.
+    std::vector<size_t> HardClusters;
+    {
+        FifoCache Cache(Positions.size(), AnalysisCacheSize);
+        for (size_t Tri = 0; Tri < NumTriangles; Tri++)
+        {
+            if (Cache.Misses(&Indices[Tri * 3]) == 3) { HardClusters.push_back(Tri); }
+        }
+    }
+    HardClusters.push_back(NumTriangles);
+
+    // Soft boundaries split a hard cluster wherever the order so far is already within Threshold of the cluster's ACMR.
+    std::vector<size_t> Clusters;
+    FifoCache Cache(Positions.size(), AnalysisCacheSize);
+    for (size_t Hard = 0; Hard + 1 < HardClusters.size(); Hard++)
+    {
+        const size_t Start = HardClusters[Hard];
+        const size_t End = HardClusters[Hard + 1];
+
+        Cache.Reset();
+        size_t ClusterMisses = 0;
+        for (size_t Tri = Start; Tri < End; Tri++) { ClusterMisses += Cache.Misses(&Indices[Tri * 3]); }
+        const float ClusterACMR = static_cast<float>(ClusterMisses) / static_cast<float>(End - Start);
+
+        Cache.Reset();
+        Clusters.push_back(Start);
+        size_t SoftStart = Start;
+        size_t Misses = 0;
+        for (size_t Tri = Start; Tri < End; Tri++)
+        {
+            Misses += Cache.Misses(&Indices[Tri * 3]);
+            if (Tri + 1 < End && static_cast<float>(Misses) <= ClusterACMR * Threshold * static_cast<float>(Tri + 1 - SoftStart))
+            {
+                Clusters.push_back(Tri + 1);
+                SoftStart = Tri + 1;
+                Misses = 0;
+                Cache.Reset();
+            }
+        }
+    }
+    Clusters.push_back(NumTriangles);
+
+    const auto TriangleArea = [&](size_t Tri, XMVECTOR& OutCentroid, XMVECTOR& OutAreaNormal)
+    {
+        const XMVECTOR A = XMLoadFloat3(&Positions[Indices[Tri * 3]]);
+        const XMVECTOR B = XMLoadFloat3(&Positions[Indices[Tri * 3 + 1]]);
+        const XMVECTOR C = XMLoadFloat3(&Positions[Indices[Tri * 3 + 2]]);
+        OutCentroid = XMVectorScale(XMVectorAdd(XMVectorAdd(A, B), C), 1.0f / 3.0f);
+        OutAreaNormal = XMVector3Cross(XMVectorSubtract(B, A), XMVectorSubtract(C, A));
+        return XMVectorGetX(XMVector3Length(OutAreaNormal));
+    };
+
+    // Area weighted centroid of the whole mesh, the view directions are taken from it.
+    XMVECTOR MeshCentroid = XMVectorZero();
+    float MeshArea = 0.0f;
+    for (size_t Tri = 0; Tri < NumTriangles; Tri++)
+    {
+        XMVECTOR Centroid, AreaNormal;
+        const float Area = TriangleArea(Tri, Centroid, AreaNormal);
+        MeshCentroid = XMVectorAdd(MeshCentroid, XMVectorScale(Centroid, Area));
+        MeshArea += Area;
+    }
+    MeshCentroid = MeshArea > 0.0f ? XMVectorScale(MeshCentroid, 1.0f / MeshArea) : MeshCentroid;
+
+    // Clusters facing further out from the centroid are more likely to occlude the rest, so they draw first.
+    const size_t NumClusters = Clusters.size() - 1;
+    std::vector<float> SortKeys(NumClusters);
+    for (size_t Cluster = 0; Cluster < NumClusters; Cluster++)
+    {
+        XMVECTOR ClusterCentroid = XMVectorZero();
+        XMVECTOR ClusterNormal = XMVectorZero();
+        float ClusterArea = 0.0f;
+        for (size_t Tri = Clusters[Cluster]; Tri < Clusters[Cluster + 1]; Tri++)
+        {
+            XMVECTOR Centroid, AreaNormal;
+            const float Area = TriangleArea(Tri, Centroid, AreaNormal);
+            ClusterCentroid = XMVectorAdd(ClusterCentroid, XMVectorScale(Centroid, Area));
+            ClusterNormal = XMVectorAdd(ClusterNormal, AreaNormal);
+            ClusterArea += Area;
+        }
+        if (ClusterArea > 0.0f) { ClusterCentroid = XMVectorScale(ClusterCentroid, 1.0f / ClusterArea); }
+
+        SortKeys[Cluster] = XMVectorGetX(XMVector3Dot(XMVectorSubtract(ClusterCentroid, MeshCentroid), XMVector3Normalize(ClusterNormal)));
+    }
+
+    std::vector<size_t> Order(NumClusters);
+    for (size_t Cluster = 0; Cluster < NumClusters; Cluster++) { Order[Cluster] = Cluster; }
+    std::stable_sort(Order.begin(), Order.end(), [&](size_t A, size_t B) { return SortKeys[A] > SortKeys[B]; });
+
+    std::vector<uint32_t> Result;
+    Result.reserve(Indices.size());
+    for (const size_t Cluster : Order)
+    {
+        Result.insert(Result.end(), Indices.begin() + Clusters[Cluster] * 3, Indices.begin() + Clusters[Cluster + 1] * 3);
+    }
+    Indices.swap(Result);
+}
+
+std::vector<uint32_t> MeshOptimiser::OptimiseVertexFetch(std::vector<uint32_t>& Indices, size_t NumVertices, size_t& OutNumVertices)
+{
+    std::vector<uint32_t> Remap(NumVertices, UINT32_MAX);
+    uint32_t NextVertex = 0;
+    for (uint32_t& Index : Indices)
+    {
+        if (Remap[Index] == UINT32_MAX) { Remap[Index] = NextVertex++; }
+        Index = Remap[Index];
+    }
+    OutNumVertices = NextVertex;
+    return Remap;
+}
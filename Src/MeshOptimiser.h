@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "pch.h"
+
+// Index and vertex reordering for the GPU, run on welded triangle lists before they are uploaded.
+namespace MeshOptimiser
+{
+    // Cache size the Forsyth scores are tuned for, larger than any real post-transform cache so the order degrades gracefully.
+    constexpr uint32_t ForsythCacheSize = 32;
+
+    // FIFO size used to measure an index order, close to what current GPUs batch vertices in.
+    constexpr uint32_t AnalysisCacheSize = 16;
+
+    // How much worse than the vertex cache order each overdraw cluster's ACMR may get.
+    constexpr float DefaultOverdrawThreshold = 1.05f;
+
+    struct VertexCacheStats
+    {
+        float ACMR = 0.0f; // Average cache miss ratio, transformed vertices per triangle. 0.5 is ideal for a large grid, 3 is the worst.
+        float ATVR = 0.0f; // Average transformed vertex ratio, transformed vertices per referenced vertex. 1 is ideal.
+    };
+
+    // Simulates a FIFO post-transform cache over the index order.
+    VertexCacheStats AnalyseVertexCache(const std::vector<uint32_t>& Indices, size_t NumVertices, uint32_t CacheSize = AnalysisCacheSize);
+
+    // Tom Forsyth's linear speed vertex cache optimisation, greedily emits the triangle whose vertices score highest in a simulated LRU cache.
+    void OptimiseVertexCache(std::vector<uint32_t>& Indices, size_t NumVertices);
+
+    // Sander et al's overdraw ordering, splits the cache optimised order into clusters where the cache restarts and draws outward
+    // facing clusters first, so the mesh tends to occlude itself front to back from any view. Keeps the ACMR within Threshold.
+    void OptimiseOverdraw(std::vector<uint32_t>& Indices, const std::vector<DirectX::XMFLOAT3>& Positions, float Threshold = DefaultOverdrawThreshold);
+
+    // Renumbers vertices in first use order so vertex fetches walk memory linearly, unreferenced vertices are dropped.
+    // Returns the old to new vertex map, UINT32_MAX for dropped vertices, and the new vertex count through OutNumVertices.
+    std::vector<uint32_t> OptimiseVertexFetch(std::vector<uint32_t>& Indices, size_t NumVertices, size_t& OutNumVertices);
+
+    // Applies a map from OptimiseVertexFetch to one attribute stream.
+    template <typename T>
+    void RemapVertices(std::vector<T>& Data, const std::vector<uint32_t>& Remap, size_t NumVertices)
+    {
+        if (Data.size() != Remap.size()) { return; }
+
+        std::vector<T> Remapped(NumVertices);
+        for (size_t Idx = 0; Idx < Remap.size(); Idx++)
+        {
+            if (Remap[Idx] != UINT32_MAX) { Remapped[Remap[Idx]] = Data[Idx]; }
+        }
+        Data.swap(Remapped);
+    }
+}
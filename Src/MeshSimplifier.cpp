@@ -0,0 +1,386 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+    // Open edges add a plane through the edge perpendicular to its triangle, so borders and seams keep their outline.
+    constexpr double EdgeWeight = 10.0;
+
+    // Collapses may turn a triangle by at most this much, as the cosine between its old and new normal.
+    constexpr double MinFlipCosine = 0.25;
+
+    constexpr uint32_t NoVertex = UINT32_MAX;
+
+    enum class VertexKind : uint8_t
+    {
+        Manifold, // Closed fan with a single set of attributes, may collapse anywhere.
+        Border,   // One open edge in and out, collapses along the border only.
+        Seam,     // Two vertices at one position split by attributes, collapses along the seam only.
+        Locked,   // Anything else, never moves.
+    };
+
+    // Symmetric 4x4 plane quadric, with the summed weight to normalise the error by.
+    struct Quadric
+    {
+        double A00 = 0.0, A11 = 0.0, A22 = 0.0, A01 = 0.0, A02 = 0.0, A12 = 0.0;
+        double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+        double C = 0.0;
+        double Weight = 0.0;
+
+        void AddPlane(double Nx, double Ny, double Nz, double D, double InWeight)
+        {
+            A00 += InWeight * Nx * Nx;
+            A11 += InWeight * Ny * Ny;
+            A22 += InWeight * Nz * Nz;
+            A01 += InWeight * Nx * Ny;
+            A02 += InWeight * Nx * Nz;
+            A12 += InWeight * Ny * Nz;
+            B0 += InWeight * Nx * D;
+            B1 += InWeight * Ny * D;
+            B2 += InWeight * Nz * D;
+            C += InWeight * D * D;
+            Weight += InWeight;
+        }
+
+        void Add(const Quadric& Other)
+        {
+            A00 += Other.A00; A11 += Other.A11; A22 += Other.A22;
+            A01 += Other.A01; A02 += Other.A02; A12 += Other.A12;
+            B0 += Other.B0; B1 += Other.B1; B2 += Other.B2;
+            C += Other.C;
+            Weight += Other.Weight;
+        }
+
+        // Weighted mean squared distance of P to the accumulated planes.
+        double Error(const XMFLOAT3& P) const
+        {
+            const double X = P.x, Y = P.y, Z = P.z;
+            const double Result = A00 * X * X + A11 * Y * Y + A22 * Z * Z + 2.0 * (A01 * X * Y + A02 * X * Z + A12 * Y * Z)
+                + 2.0 * (B0 * X + B1 * Y + B2 * Z) + C;
+            return Weight > 0.0 ? std::max(Result, 0.0) / Weight : 0.0;
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t V0 = 0; // Moves onto V1.
+        uint32_t V1 = 0;
+        double Error = 0.0;
+    };
+
+    void Cross(const XMFLOAT3& A, const XMFLOAT3& B, const XMFLOAT3& C, double Out[3])
+    {
+        const double E0[3] = { double(B.x) - A.x, double(B.y) - A.y, double(B.z) - A.z };
+        const double E1[3] = { double(C.x) - A.x, double(C.y) - A.y, double(C.z) - A.z };
+        Out[0] = E0[1] * E1[2] - E0[2] * E1[1];
+        Out[1] = E0[2] * E1[0] - E0[0] * E1[2];
+        Out[2] = E0[0] * E1[1] - E0[1] * E1[0];
+    }
+
+    // Maps every vertex to the first vertex at its position and links vertices sharing a position into a ring.
+    void BuildPositionRemap(const std::vector<XMFLOAT3>& Positions, std::vector<uint32_t>& OutRemap, std::vector<uint32_t>& OutWedge)
+    {
+        struct PositionKey
+        {
+            uint32_t Bits[3];
+            bool operator==(const PositionKey& Other) const { return memcmp(Bits, Other.Bits, sizeof(Bits)) == 0; }
+        };
+        struct PositionHash
+        {
+            size_t operator()(const PositionKey& Key) const
+            {
+                uint64_t Hash = 0xCBF29CE484222325ull;
+                for (const uint32_t Bits : Key.Bits) { Hash = (Hash ^ Bits) * 0x100000001B3ull; }
+                return static_cast<size_t>(Hash);
+            }
+        };
+
+        const size_t NumVertices = Positions.size();
+        OutRemap.resize(NumVertices);
+        OutWedge.resize(NumVertices);
+        std::unordered_map<PositionKey, uint32_t, PositionHash> FirstAtPosition;
+        FirstAtPosition.reserve(NumVertices);
+        for (uint32_t Vtx = 0; Vtx < NumVertices; Vtx++)
+        {
+            PositionKey Key;
+            memcpy(Key.Bits, &Positions[Vtx], sizeof(Key.Bits));
+            const auto Found = FirstAtPosition.emplace(Key, Vtx);
+            const uint32_t First = Found.first->second;
+            OutRemap[Vtx] = First;
+
+            // Insert after the first vertex of the ring.
+            OutWedge[Vtx] = Vtx;
+            if (First != Vtx)
+            {
+                OutWedge[Vtx] = OutWedge[First];
+                OutWedge[First] = Vtx;
+            }
+        }
+    }
+
+    uint64_t EdgeKey(uint32_t From, uint32_t To) { return (static_cast<uint64_t>(From) << 32) | To; }
+
+    bool HasEdge(const std::vector<uint64_t>& SortedEdges, uint32_t From, uint32_t To)
+    {
+        return std::binary_search(SortedEdges.begin(), SortedEdges.end(), EdgeKey(From, To));
+    }
+
+    // Kinds from the open half edges, those without a twin between the same two vertices. Attribute seams are open on both sides.
+    void ClassifyVertices(const std::vector<uint32_t>& Indices, const std::vector<uint32_t>& Remap, const std::vector<uint32_t>& Wedge,
+        std::vector<VertexKind>& OutKinds, std::vector<uint32_t>& OutOpenIn, std::vector<uint32_t>& OutOpenOut)
+    {
+        const size_t NumVertices = Remap.size();
+        std::vector<uint64_t> Edges;
+        Edges.reserve(Indices.size());
+        for (size_t Tri = 0; Tri + 2 < Indices.size(); Tri += 3)
+        {
+            for (size_t Corner = 0; Corner < 3; Corner++) { Edges.push_back(EdgeKey(Indices[Tri + Corner], Indices[Tri + (Corner + 1) % 3])); }
+        }
+        std::sort(Edges.begin(), Edges.end());
+
+        // The one open edge into and out of each vertex. A second one points the entry at the vertex itself, which no check accepts.
+        OutOpenIn.assign(NumVertices, NoVertex);
+        OutOpenOut.assign(NumVertices, NoVertex);
+        for (size_t Tri = 0; Tri + 2 < Indices.size(); Tri += 3)
+        {
+            for (size_t Corner = 0; Corner < 3; Corner++)
+            {
+                const uint32_t From = Indices[Tri + Corner];
+                const uint32_t To = Indices[Tri + (Corner + 1) % 3];
+                if (HasEdge(Edges, To, From)) { continue; }
+
+                OutOpenOut[From] = OutOpenOut[From] == NoVertex ? To : From;
+                OutOpenIn[To] = OutOpenIn[To] == NoVertex ? From : To;
+            }
+        }
+
+        OutKinds.assign(NumVertices, VertexKind::Locked);
+        const auto IsOpenEdge = [&](uint32_t Vtx, uint32_t Other) { return Other != NoVertex && Remap[Other] != Remap[Vtx]; };
+        for (uint32_t Vtx = 0; Vtx < NumVertices; Vtx++)
+        {
+            if (Remap[Vtx] != Vtx) { continue; }
+
+            if (Wedge[Vtx] == Vtx)
+            {
+                if (OutOpenIn[Vtx] == NoVertex && OutOpenOut[Vtx] == NoVertex) { OutKinds[Vtx] = VertexKind::Manifold; }
+                else if (IsOpenEdge(Vtx, OutOpenIn[Vtx]) && IsOpenEdge(Vtx, OutOpenOut[Vtx])) { OutKinds[Vtx] = VertexKind::Border; }
+            }
+            else if (Wedge[Wedge[Vtx]] == Vtx)
+            {
+                // Both sides have one open edge in and out, running between the same two positions in opposite directions.
+                const uint32_t Other = Wedge[Vtx];
+                const uint32_t A = OutOpenIn[Vtx], B = OutOpenOut[Vtx], C = OutOpenIn[Other], D = OutOpenOut[Other];
+                if (IsOpenEdge(Vtx, A) && IsOpenEdge(Vtx, B) && IsOpenEdge(Other, C) && IsOpenEdge(Other, D) && Remap[A] == Remap[D] && Remap[B] == Remap[C])
+                {
+                    OutKinds[Vtx] = VertexKind::Seam;
+                }
+            }
+        }
+        for (uint32_t Vtx = 0; Vtx < NumVertices; Vtx++) { OutKinds[Vtx] = OutKinds[Remap[Vtx]]; }
+    }
+
+    void BuildQuadrics(const std::vector<uint32_t>& Indices, const std::vector<XMFLOAT3>& Positions, const std::vector<uint32_t>& Remap,
+        const std::vector<uint32_t>& OpenOut, std::vector<Quadric>& OutQuadrics)
+    {
+        OutQuadrics.assign(Positions.size(), Quadric());
+        for (size_t Tri = 0; Tri + 2 < Indices.size(); Tri += 3)
+        {
+            const XMFLOAT3& P0 = Positions[Indices[Tri]];
+            double Normal[3];
+            Cross(P0, Positions[Indices[Tri + 1]], Positions[Indices[Tri + 2]], Normal);
+            const double DoubleArea = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+            if (DoubleArea <= 0.0) { continue; }
+
+            const double Nx = Normal[0] / DoubleArea, Ny = Normal[1] / DoubleArea, Nz = Normal[2] / DoubleArea;
+            const double D = -(Nx * P0.x + Ny * P0.y + Nz * P0.z);
+            for (size_t Corner = 0; Corner < 3; Corner++)
+            {
+                OutQuadrics[Remap[Indices[Tri + Corner]]].AddPlane(Nx, Ny, Nz, D, DoubleArea * 0.5);
+            }
+
+            // Open edges of this triangle, weighted by their length squared like the triangle by its area.
+            for (size_t Corner = 0; Corner < 3; Corner++)
+            {
+                const uint32_t From = Indices[Tri + Corner];
+                const uint32_t To = Indices[Tri + (Corner + 1) % 3];
+                if (OpenOut[From] != To) { continue; }
+
+                const XMFLOAT3& A = Positions[From];
+                const XMFLOAT3& B = Positions[To];
+                double Edge[3] = { double(B.x) - A.x, double(B.y) - A.y, double(B.z) - A.z };
+                const double LengthSq = Edge[0] * Edge[0] + Edge[1] * Edge[1] + Edge[2] * Edge[2];
+                if (LengthSq <= 0.0) { continue; }
+
+                double Px = Edge[1] * Nz - Edge[2] * Ny;
+                double Py = Edge[2] * Nx - Edge[0] * Nz;
+                double Pz = Edge[0] * Ny - Edge[1] * Nx;
+                const double PLength = std::sqrt(Px * Px + Py * Py + Pz * Pz);
+                Px /= PLength; Py /= PLength; Pz /= PLength;
+                const double PD = -(Px * A.x + Py * A.y + Pz * A.z);
+                OutQuadrics[Remap[From]].AddPlane(Px, Py, Pz, PD, LengthSq * EdgeWeight);
+                OutQuadrics[Remap[To]].AddPlane(Px, Py, Pz, PD, LengthSq * EdgeWeight);
+            }
+        }
+    }
+
+    // Whether moving position From onto Positions[To] turns any triangle around it over, triangles collapsing to nothing are fine.
+    bool HasTriangleFlip(const std::vector<uint32_t>& Indices, const std::vector<XMFLOAT3>& Positions, const std::vector<uint32_t>& Remap,
+        const std::vector<uint32_t>& TriangleOffsets, const std::vector<uint32_t>& TriangleList, uint32_t From, uint32_t To)
+    {
+        const uint32_t RemapFrom = Remap[From];
+        const uint32_t RemapTo = Remap[To];
+        for (uint32_t Entry = TriangleOffsets[RemapFrom]; Entry < TriangleOffsets[RemapFrom + 1]; Entry++)
+        {
+            const uint32_t* Tri = &Indices[TriangleList[Entry] * 3];
+            if (Remap[Tri[0]] == RemapTo || Remap[Tri[1]] == RemapTo || Remap[Tri[2]] == RemapTo) { continue; }
+
+            XMFLOAT3 Moved[3] = { Positions[Tri[0]], Positions[Tri[1]], Positions[Tri[2]] };
+            for (size_t Corner = 0; Corner < 3; Corner++)
+            {
+                if (Remap[Tri[Corner]] == RemapFrom) { Moved[Corner] = Positions[To]; }
+            }
+
+            double Before[3], After[3];
+            Cross(Positions[Tri[0]], Positions[Tri[1]], Positions[Tri[2]], Before);
+            Cross(Moved[0], Moved[1], Moved[2], After);
+            const double Dot = Before[0] * After[0] + Before[1] * After[1] + Before[2] * After[2];
+            const double Lengths = std::sqrt((Before[0] * Before[0] + Before[1] * Before[1] + Before[2] * Before[2])
+                * (After[0] * After[0] + After[1] * After[1] + After[2] * After[2]));
+            if (Dot <= MinFlipCosine * Lengths) { return true; }
+        }
+        return false;
+    }
+}
+
+float MeshSimplifier::Simplify(const std::vector<uint32_t>& Indices, const std::vector<XMFLOAT3>& Positions, size_t TargetIndexCount,
+    std::vector<uint32_t>& OutIndices)
+{
+    OutIndices = Indices;
+    const size_t NumVertices = Positions.size();
+    if (Indices.size() <= TargetIndexCount || NumVertices == 0) { return 0.0f; }
+
+    std::vector<uint32_t> Remap, Wedge;
+    BuildPositionRemap(Positions, Remap, Wedge);
+
+    std::vector<VertexKind> Kinds;
+    std::vector<uint32_t> OpenIn, OpenOut;
+    ClassifyVertices(Indices, Remap, Wedge, Kinds, OpenIn, OpenOut);
+
+    std::vector<Quadric> Quadrics;
+    BuildQuadrics(Indices, Positions, Remap, OpenOut, Quadrics);
+
+    const auto IsOpenNeighbour = [&](uint32_t Vtx, uint32_t Other) { return OpenIn[Vtx] == Other || OpenOut[Vtx] == Other; };
+
+    std::vector<uint32_t> TriangleOffsets(NumVertices + 1);
+    std::vector<uint32_t> TriangleList;
+    std::vector<Collapse> Collapses;
+    std::vector<uint32_t> CollapseRemap(NumVertices);
+    std::vector<uint8_t> Touched(NumVertices);
+    double MaxError = 0.0;
+
+    // Each pass collapses the cheapest edges whose positions no other collapse in the pass has touched, then rebuilds the triangles.
+    while (OutIndices.size() > TargetIndexCount)
+    {
+        const size_t NumTriangles = OutIndices.size() / 3;
+
+        // Triangles around each position, for the flip test.
+        std::fill(TriangleOffsets.begin(), TriangleOffsets.end(), 0);
+        for (const uint32_t Vtx : OutIndices) { TriangleOffsets[Remap[Vtx] + 1]++; }
+        for (size_t Vtx = 0; Vtx < NumVertices; Vtx++) { TriangleOffsets[Vtx + 1] += TriangleOffsets[Vtx]; }
+        TriangleList.resize(OutIndices.size());
+        {
+            std::vector<uint32_t> Cursor(TriangleOffsets.begin(), TriangleOffsets.end() - 1);
+            for (size_t Idx = 0; Idx < OutIndices.size(); Idx++) { TriangleList[Cursor[Remap[OutIndices[Idx]]]++] = static_cast<uint32_t>(Idx / 3); }
+        }
+
+        Collapses.clear();
+        for (size_t Tri = 0; Tri < NumTriangles; Tri++)
+        {
+            for (size_t Corner = 0; Corner < 3; Corner++)
+            {
+                const uint32_t V0 = OutIndices[Tri * 3 + Corner];
+                const uint32_t V1 = OutIndices[Tri * 3 + (Corner + 1) % 3];
+                for (const auto& [From, To] : { std::pair<uint32_t, uint32_t>(V0, V1), std::pair<uint32_t, uint32_t>(V1, V0) })
+                {
+                    const VertexKind Kind = Kinds[From];
+                    if (Remap[From] == Remap[To] || Kind == VertexKind::Locked) { continue; }
+
+                    // Border and seam vertices stay on their edge loop, seams also need a matching edge on the other side.
+                    if (Kind == VertexKind::Border && (Kinds[To] != VertexKind::Border || !IsOpenNeighbour(From, To))) { continue; }
+                    if (Kind == VertexKind::Seam
+                        && (Kinds[To] != VertexKind::Seam || !IsOpenNeighbour(From, To) || !IsOpenNeighbour(Wedge[From], Wedge[To]))) { continue; }
+
+                    Collapses.push_back({ From, To, Quadrics[Remap[From]].Error(Positions[To]) });
+                }
+            }
+        }
+        if (Collapses.empty()) { break; }
+        std::sort(Collapses.begin(), Collapses.end(), [](const Collapse& A, const Collapse& B) { return A.Error < B.Error; });
+
+        for (uint32_t Vtx = 0; Vtx < NumVertices; Vtx++) { CollapseRemap[Vtx] = Vtx; }
+        std::fill(Touched.begin(), Touched.end(), 0);
+
+        // An interior or seam collapse removes two triangles, a border one.
+        const size_t TrianglesToRemove = (OutIndices.size() - TargetIndexCount) / 3;
+        size_t TrianglesRemoved = 0;
+        for (const Collapse& Candidate : Collapses)
+        {
+            const uint32_t RemapFrom = Remap[Candidate.V0];
+            const uint32_t RemapTo = Remap[Candidate.V1];
+            if (Touched[RemapFrom] || Touched[RemapTo]) { continue; }
+            if (HasTriangleFlip(OutIndices, Positions, Remap, TriangleOffsets, TriangleList, Candidate.V0, Candidate.V1)) { continue; }
+
+            const VertexKind Kind = Kinds[Candidate.V0];
+            CollapseRemap[Candidate.V0] = Candidate.V1;
+            if (Kind == VertexKind::Seam) { CollapseRemap[Wedge[Candidate.V0]] = Wedge[Candidate.V1]; }
+            Quadrics[RemapTo].Add(Quadrics[RemapFrom]);
+            Touched[RemapFrom] = 1;
+            Touched[RemapTo] = 1;
+
+            MaxError = std::max(MaxError, Candidate.Error);
+            TrianglesRemoved += Kind == VertexKind::Border ? 1 : 2;
+            if (TrianglesRemoved >= TrianglesToRemove) { break; }
+        }
+        if (TrianglesRemoved == 0) { break; }
+
+        // Border and seam loops follow their collapsed vertices. A loop whose next vertex collapsed back onto it skips ahead.
+        const auto RemapLoop = [&CollapseRemap, NumVertices](std::vector<uint32_t>& Loop)
+        {
+            std::vector<uint32_t> Remapped(Loop);
+            for (uint32_t Vtx = 0; Vtx < NumVertices; Vtx++)
+            {
+                const uint32_t Next = Loop[Vtx];
+                if (Next == NoVertex) { continue; }
+
+                const uint32_t RemapNext = CollapseRemap[Next];
+                Remapped[Vtx] = RemapNext != Vtx ? RemapNext : (Loop[Next] != NoVertex ? CollapseRemap[Loop[Next]] : NoVertex);
+            }
+            Loop.swap(Remapped);
+        };
+        RemapLoop(OpenIn);
+        RemapLoop(OpenOut);
+
+        // Drop the triangles that lost an edge.
+        size_t Write = 0;
+        for (size_t Tri = 0; Tri < NumTriangles; Tri++)
+        {
+            const uint32_t A = CollapseRemap[OutIndices[Tri * 3]];
+            const uint32_t B = CollapseRemap[OutIndices[Tri * 3 + 1]];
+            const uint32_t C = CollapseRemap[OutIndices[Tri * 3 + 2]];
+            if (Remap[A] == Remap[B] || Remap[B] == Remap[C] || Remap[A] == Remap[C]) { continue; }
+
+            OutIndices[Write++] = A;
+            OutIndices[Write++] = B;
+            OutIndices[Write++] = C;
+        }
+        OutIndices.resize(Write);
+    }
+
+    return static_cast<float>(std::sqrt(MaxError));
+}
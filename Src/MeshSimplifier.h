@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+
+// Levels of detail of one mesh, LOD0 is the full mesh. Every level indexes the same vertex buffer.
+constexpr uint32_t MaxMeshLods = 5;
+
+struct MeshLod
+{
+    uint32_t FirstIndex = 0;
+    uint32_t NumIndices = 0;
+    float Error = 0.0f; // Geometric deviation from LOD0 in mesh units.
+};
+
+// Quadric error metric edge collapse simplification, run on welded, optimised triangle lists.
+namespace MeshSimplifier
+{
+    // Meshes below this many triangles keep LOD0 only, and no LOD goes below it.
+    constexpr size_t MinLodTriangles = 128;
+
+    // Each LOD targets this fraction of the previous one's triangles.
+    constexpr float LodReduction = 0.5f;
+
+    // Collapses vertices onto their neighbours until at most TargetIndexCount indices remain or nothing more can collapse.
+    // Vertices only ever move onto existing vertices, so no attribute is interpolated. Vertices sharing a position with
+    // different attributes form UV and normal seams, which only collapse along the seam with both sides together,
+    // open borders only collapse along the border, and anything more complex stays put.
+    // Returns the error of the worst collapse, the square root of its area weighted quadric error in mesh units.
+    float Simplify(const std::vector<uint32_t>& Indices, const std::vector<DirectX::XMFLOAT3>& Positions, size_t TargetIndexCount,
+        std::vector<uint32_t>& OutIndices);
+}
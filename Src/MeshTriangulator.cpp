@@ -0,0 +1,268 @@
+#include "MeshTriangulator.h"
+
+// Std
+#include <cmath>
+
+// Usd
+#include "pxr/usd/usdGeom/tokens.h"
+
+using namespace pxr;
+
+namespace
+{
+    // Corners of one block of four triangles or two quads as offsets from the block's first face vertex, the next block starts
+    // Stride face vertices on. Every face of a block has the same offsets shifted by its size, so a lone face uses the first ones.
+    struct RunPattern
+    {
+        uint32_t Offsets[12];
+        uint32_t Stride;
+        uint32_t FacesPerBlock;
+    };
+
+    constexpr RunPattern TrianglePattern = { { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 }, 12, 4 };
+    constexpr RunPattern FlippedTrianglePattern = { { 0, 2, 1, 3, 5, 4, 6, 8, 7, 9, 11, 10 }, 12, 4 };
+    constexpr RunPattern QuadPattern = { { 0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7 }, 8, 2 };
+    constexpr RunPattern FlippedQuadPattern = { { 0, 2, 1, 0, 3, 2, 4, 6, 5, 4, 7, 6 }, 8, 2 };
+
+    // Writes the triangles of NumFaces faces of the pattern's size starting at face vertex Base, returns the end of the output.
+    // A block is three four wide adds of the base to the offsets, no branches or loads besides the loop.
+    uint32_t* EmitRun(const RunPattern& Pattern, uint32_t Base, size_t NumFaces, uint32_t* Out)
+    {
+        const size_t NumBlocks = NumFaces / Pattern.FacesPerBlock;
+#if defined(_XM_SSE_INTRINSICS_)
+        const __m128i Offsets0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Pattern.Offsets));
+        const __m128i Offsets1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Pattern.Offsets + 4));
+        const __m128i Offsets2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Pattern.Offsets + 8));
+        const __m128i Stride = _mm_set1_epi32(static_cast<int>(Pattern.Stride));
+        __m128i BlockBase = _mm_set1_epi32(static_cast<int>(Base));
+        for (size_t Block = 0; Block < NumBlocks; Block++)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(Out), _mm_add_epi32(BlockBase, Offsets0));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(Out + 4), _mm_add_epi32(BlockBase, Offsets1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(Out + 8), _mm_add_epi32(BlockBase, Offsets2));
+            BlockBase = _mm_add_epi32(BlockBase, Stride);
+            Out += 12;
+        }
+#else
+        for (size_t Block = 0; Block < NumBlocks; Block++)
+        {
+            const uint32_t BlockBase = Base + static_cast<uint32_t>(Block) * Pattern.Stride;
+            for (uint32_t Idx = 0; Idx < 12; Idx++) { Out[Idx] = BlockBase + Pattern.Offsets[Idx]; }
+            Out += 12;
+        }
+#endif
+        Base += static_cast<uint32_t>(NumBlocks) * Pattern.Stride;
+
+        const uint32_t FaceSize = Pattern.Stride / Pattern.FacesPerBlock;
+        const uint32_t FaceIndices = 12 / Pattern.FacesPerBlock;
+        for (size_t Face = NumBlocks * Pattern.FacesPerBlock; Face < NumFaces; Face++)
+        {
+            for (uint32_t Idx = 0; Idx < FaceIndices; Idx++) { Out[Idx] = Base + Pattern.Offsets[Idx]; }
+            Base += FaceSize;
+            Out += FaceIndices;
+        }
+        return Out;
+    }
+
+    // Reused between the polygons of one mesh.
+    struct PolygonScratch
+    {
+        std::vector<double> X, Y; // Corners projected onto the plane of the polygon.
+        std::vector<uint32_t> Prev, Next; // Ring of the corners not clipped yet.
+    };
+
+    double Cross(const PolygonScratch& Scratch, uint32_t A, uint32_t B, uint32_t C)
+    {
+        return (Scratch.X[B] - Scratch.X[A]) * (Scratch.Y[C] - Scratch.Y[A]) - (Scratch.Y[B] - Scratch.Y[A]) * (Scratch.X[C] - Scratch.X[A]);
+    }
+
+    // A triangle of polygon corners, wound like the polygon unless flipped.
+    uint32_t* EmitTriangle(uint32_t Base, uint32_t A, uint32_t B, uint32_t C, bool bFlip, uint32_t* Out)
+    {
+        Out[0] = Base + A;
+        Out[1] = Base + (bFlip ? C : B);
+        Out[2] = Base + (bFlip ? B : C);
+        return Out + 3;
+    }
+
+    // Corner Cur is an ear when it is convex and no other corner left in the ring lies in or on its triangle. Corners at the same
+    // position as one of the triangle's, as where a polygon is bridged to a hole, do not block it.
+    bool IsEar(const PolygonScratch& Scratch, uint32_t Cur, double Winding)
+    {
+        const uint32_t A = Scratch.Prev[Cur];
+        const uint32_t C = Scratch.Next[Cur];
+        if (Cross(Scratch, A, Cur, C) * Winding <= 0.0) { return false; }
+
+        const auto IsCorner = [&Scratch](uint32_t P, uint32_t Q) { return Scratch.X[P] == Scratch.X[Q] && Scratch.Y[P] == Scratch.Y[Q]; };
+        for (uint32_t P = Scratch.Next[C]; P != A; P = Scratch.Next[P])
+        {
+            if (IsCorner(P, A) || IsCorner(P, Cur) || IsCorner(P, C)) { continue; }
+            if (Cross(Scratch, A, Cur, P) * Winding >= 0.0 && Cross(Scratch, Cur, C, P) * Winding >= 0.0 && Cross(Scratch, C, A, P) * Winding >= 0.0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Always NumCorners - 2 triangles, so the output can be sized from the counts alone.
+    uint32_t* TriangulatePolygon(const MeshSourceArrays& Source, uint32_t Base, uint32_t NumCorners, bool bFlip, PolygonScratch& Scratch,
+        MeshTriangulator::TriangulationStats& Stats, uint32_t* Out)
+    {
+        // Newell's normal picks the plane to project onto, its largest axis is dropped.
+        double Normal[3] = { 0.0, 0.0, 0.0 };
+        for (uint32_t Corner = 0; Corner < NumCorners; Corner++)
+        {
+            const GfVec3f& P = Source.Points[Source.FaceVertexIndices[Base + Corner]];
+            const GfVec3f& Q = Source.Points[Source.FaceVertexIndices[Base + (Corner + 1) % NumCorners]];
+            Normal[0] += (static_cast<double>(P[1]) - Q[1]) * (static_cast<double>(P[2]) + Q[2]);
+            Normal[1] += (static_cast<double>(P[2]) - Q[2]) * (static_cast<double>(P[0]) + Q[0]);
+            Normal[2] += (static_cast<double>(P[0]) - Q[0]) * (static_cast<double>(P[1]) + Q[1]);
+        }
+        const int Drop = std::abs(Normal[0]) > std::abs(Normal[1]) ? (std::abs(Normal[0]) > std::abs(Normal[2]) ? 0 : 2) : (std::abs(Normal[1]) > std::abs(Normal[2]) ? 1 : 2);
+        const int AxisX = (Drop + 1) % 3;
+        const int AxisY = (Drop + 2) % 3;
+
+        // The projection keeps the polygon's winding when the dropped axis of the normal is positive.
+        const double Winding = Normal[Drop] < 0.0 ? -1.0 : 1.0;
+        Scratch.X.resize(NumCorners);
+        Scratch.Y.resize(NumCorners);
+        Scratch.Prev.resize(NumCorners);
+        Scratch.Next.resize(NumCorners);
+        for (uint32_t Corner = 0; Corner < NumCorners; Corner++)
+        {
+            const GfVec3f& P = Source.Points[Source.FaceVertexIndices[Base + Corner]];
+            Scratch.X[Corner] = P[AxisX];
+            Scratch.Y[Corner] = P[AxisY];
+            Scratch.Prev[Corner] = (Corner + NumCorners - 1) % NumCorners;
+            Scratch.Next[Corner] = (Corner + 1) % NumCorners;
+        }
+
+        // Convex faces, collinear corners included, get HdMeshUtil's fan.
+        bool bConvex = true;
+        for (uint32_t Corner = 0; Corner < NumCorners && bConvex; Corner++)
+        {
+            bConvex = Cross(Scratch, Scratch.Prev[Corner], Corner, Scratch.Next[Corner]) * Winding >= 0.0;
+        }
+        if (bConvex)
+        {
+            Stats.NumConvexPolygons++;
+            for (uint32_t Corner = 1; Corner + 1 < NumCorners; Corner++) { Out = EmitTriangle(Base, 0, Corner, Corner + 1, bFlip, Out); }
+            return Out;
+        }
+
+        Stats.NumConcavePolygons++;
+        uint32_t Remaining = NumCorners;
+        uint32_t Cur = 0;
+        uint32_t Misses = 0;
+        while (Remaining > 3)
+        {
+            if (IsEar(Scratch, Cur, Winding))
+            {
+                const uint32_t A = Scratch.Prev[Cur];
+                const uint32_t C = Scratch.Next[Cur];
+                Out = EmitTriangle(Base, A, Cur, C, bFlip, Out);
+                Scratch.Next[A] = C;
+                Scratch.Prev[C] = A;
+                Remaining--;
+                Cur = C;
+                Misses = 0;
+                continue;
+            }
+
+            // A full lap without an ear means the polygon is degenerate or self intersecting, the rest is fanned so no area is lost.
+            Cur = Scratch.Next[Cur];
+            if (++Misses < Remaining) { continue; }
+
+            Stats.NumEarClipFailures++;
+            for (uint32_t Corner = Scratch.Next[Cur]; Scratch.Next[Corner] != Cur; Corner = Scratch.Next[Corner])
+            {
+                Out = EmitTriangle(Base, Cur, Corner, Scratch.Next[Corner], bFlip, Out);
+            }
+            return Out;
+        }
+        return EmitTriangle(Base, Scratch.Prev[Cur], Cur, Scratch.Next[Cur], bFlip, Out);
+    }
+}
+
+bool MeshTriangulator::Triangulate(const MeshSourceArrays& Source, std::vector<uint32_t>& OutCorners, TriangulationStats* OutStats)
+{
+    OutCorners.clear();
+    TriangulationStats Stats;
+
+    const VtArray<int>& Counts = Source.FaceVertexCounts;
+    const size_t NumFaces = Counts.size();
+    const size_t NumFaceVertices = Source.FaceVertexIndices.size();
+    if (NumFaceVertices >= UINT32_MAX) { return false; }
+
+    std::vector<uint8_t> Holes;
+    if (!Source.HoleIndices.empty())
+    {
+        Holes.assign(NumFaces, 0);
+        for (const int Hole : Source.HoleIndices)
+        {
+            if (Hole >= 0 && static_cast<size_t>(Hole) < NumFaces) { Holes[Hole] = 1; }
+        }
+    }
+    const auto IsSkipped = [&](size_t Face) { return Counts[Face] < 3 || (!Holes.empty() && Holes[Face] != 0); };
+
+    // The distribution of face sizes sizes the output, and says how much goes down the run kernel.
+    size_t TotalCorners = 0;
+    size_t NumTriangles = 0;
+    for (size_t Face = 0; Face < NumFaces; Face++)
+    {
+        const int Count = Counts[Face];
+        if (Count < 0) { return false; }
+        TotalCorners += static_cast<size_t>(Count);
+        if (IsSkipped(Face)) { Stats.NumSkippedFaces++; continue; }
+
+        NumTriangles += static_cast<size_t>(Count) - 2;
+        if (Count == 3) { Stats.NumTriangleFaces++; }
+        else if (Count == 4) { Stats.NumQuadFaces++; }
+    }
+    if (TotalCorners != NumFaceVertices) { return false; }
+
+    bool bInRange = true;
+    const uint32_t NumPoints = static_cast<uint32_t>(Source.Points.size());
+    for (const int Index : Source.FaceVertexIndices) { bInRange &= static_cast<uint32_t>(Index) < NumPoints; }
+    if (!bInRange) { return false; }
+
+    const bool bFlip = Source.Orientation == UsdGeomTokens->leftHanded;
+    const RunPattern& Triangles = bFlip ? FlippedTrianglePattern : TrianglePattern;
+    const RunPattern& Quads = bFlip ? FlippedQuadPattern : QuadPattern;
+
+    OutCorners.resize(NumTriangles * 3);
+    uint32_t* Out = OutCorners.data();
+    uint32_t Base = 0;
+    PolygonScratch Scratch;
+    size_t Face = 0;
+    while (Face < NumFaces)
+    {
+        const int Count = Counts[Face];
+        if (IsSkipped(Face))
+        {
+            Base += static_cast<uint32_t>(Count);
+            Face++;
+            continue;
+        }
+
+        if (Count == 3 || Count == 4)
+        {
+            // A run lasts until a face of another size or a hole.
+            size_t End = Face + 1;
+            while (End < NumFaces && Counts[End] == Count && !IsSkipped(End)) { End++; }
+            Out = EmitRun(Count == 3 ? Triangles : Quads, Base, End - Face, Out);
+            Base += static_cast<uint32_t>((End - Face) * Count);
+            Stats.NumRuns++;
+            Face = End;
+            continue;
+        }
+
+        Out = TriangulatePolygon(Source, Base, static_cast<uint32_t>(Count), bFlip, Scratch, Stats, Out);
+        Base += static_cast<uint32_t>(Count);
+        Face++;
+    }
+
+    if (OutStats) { *OutStats = Stats; }
+    return true;
+}
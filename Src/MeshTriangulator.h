@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pch.h"
+#include "MeshCache.h"
+
+// Triangulates USD polygon topology straight from the source arrays, without HdMeshUtil and the VtValue round trips of its primvars.
+// Runs of triangles and quads are split with fixed corner patterns, four indices per register. Larger faces are fanned like HdMeshUtil
+// when convex and ear clipped when concave.
+namespace MeshTriangulator
+{
+    struct TriangulationStats
+    {
+        size_t NumTriangleFaces = 0;
+        size_t NumQuadFaces = 0;
+        size_t NumConvexPolygons = 0;   // Five or more corners.
+        size_t NumConcavePolygons = 0;
+        size_t NumEarClipFailures = 0;  // Concave polygons ear clipping gave up on part way, e.g. self intersecting, the rest is fanned.
+        size_t NumSkippedFaces = 0;     // Holes and faces with fewer than three corners.
+        size_t NumRuns = 0;             // Consecutive triangles or quads split by one pattern.
+    };
+
+    // Face vertex of every triangle corner, three per triangle in face order, so a corner indexes face varying primvars and
+    // FaceVertexIndices gives its point. Triangles, quads and convex faces come out exactly as HdMeshUtil::ComputeTriangleIndices
+    // makes them, flipped for left handed orientation. False with OutCorners empty when the counts do not add up to the indices
+    // or an index is outside the points, HdMeshUtil stays the fallback for such topology.
+    bool Triangulate(const MeshSourceArrays& Source, std::vector<uint32_t>& OutCorners, TriangulationStats* OutStats = nullptr);
+}
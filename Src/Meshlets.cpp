@@ -0,0 +1,176 @@
+#include "Meshlets.h"
+#include "Frustum.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr uint8_t UnusedLocalIndex = 0xFF;
+
+    // Normals spread past this dot from the average leave too narrow a cone to ever cull, the same cut off as meshoptimizer.
+    constexpr float MinConeDot = 0.1f;
+
+    MeshletBounds ComputeBounds(const MeshletData& Data, const Meshlet& Cluster, const std::vector<XMFLOAT3>& Positions)
+    {
+        MeshletBounds Bounds;
+
+        const auto GetPosition = [&](uint32_t Local) { return XMLoadFloat3(&Positions[Data.VertexIndices[Cluster.VertexOffset + Local]]); };
+
+        // Sphere around the centre of the vertex bounds.
+        XMVECTOR Min = XMVectorReplicate(FLT_MAX);
+        XMVECTOR Max = XMVectorReplicate(-FLT_MAX);
+        for (uint32_t Local = 0; Local < Cluster.VertexCount; Local++)
+        {
+            Min = XMVectorMin(Min, GetPosition(Local));
+            Max = XMVectorMax(Max, GetPosition(Local));
+        }
+        const XMVECTOR Center = XMVectorScale(XMVectorAdd(Min, Max), 0.5f);
+        float RadiusSq = 0.0f;
+        for (uint32_t Local = 0; Local < Cluster.VertexCount; Local++)
+        {
+            RadiusSq = std::max(RadiusSq, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(GetPosition(Local), Center))));
+        }
+        XMStoreFloat3(&Bounds.Center, Center);
+        Bounds.Radius = std::sqrt(RadiusSq);
+
+        // Normal cone around the average face normal, using the winding the rasterizer culls by.
+        XMVECTOR Normals[MaxMeshletTriangles];
+        uint32_t NumNormals = 0;
+        XMVECTOR NormalSum = XMVectorZero();
+        for (uint32_t Tri = 0; Tri < Cluster.TriangleCount; Tri++)
+        {
+            const uint8_t* Corners = &Data.Triangles[Cluster.TriangleOffset + Tri * 3];
+            const XMVECTOR P0 = GetPosition(Corners[0]);
+            const XMVECTOR Normal = XMVector3Cross(XMVectorSubtract(GetPosition(Corners[1]), P0), XMVectorSubtract(GetPosition(Corners[2]), P0));
+            if (XMVectorGetX(XMVector3LengthSq(Normal)) <= 0.0f) { continue; }
+
+            Normals[NumNormals] = XMVector3Normalize(Normal);
+            NormalSum = XMVectorAdd(NormalSum, Normals[NumNormals]);
+            NumNormals++;
+        }
+
+        Bounds.ConeAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        Bounds.ConeCutoff = 1.0f;
+        if (NumNormals == 0 || XMVectorGetX(XMVector3LengthSq(NormalSum)) <= 0.0f) { return Bounds; }
+
+        const XMVECTOR Axis = XMVector3Normalize(NormalSum);
+        float MinDot = 1.0f;
+        for (uint32_t Idx = 0; Idx < NumNormals; Idx++)
+        {
+            MinDot = std::min(MinDot, XMVectorGetX(XMVector3Dot(Axis, Normals[Idx])));
+        }
+        XMStoreFloat3(&Bounds.ConeAxis, Axis);
+        if (MinDot > MinConeDot) { Bounds.ConeCutoff = std::sqrt(1.0f - MinDot * MinDot); }
+        return Bounds;
+    }
+}
+
+size_t MeshletData::GetSizeBytes() const
+{
+    return Meshlets.size() * sizeof(Meshlet) + Bounds.size() * sizeof(MeshletBounds) + VertexIndices.size() * sizeof(uint32_t) + Triangles.size();
+}
+
+void MeshletCullStats::Merge(const MeshletCullStats& Other)
+{
+    NumMeshlets += Other.NumMeshlets;
+    NumFrustumCulled += Other.NumFrustumCulled;
+    NumConeCulled += Other.NumConeCulled;
+    NumTriangles += Other.NumTriangles;
+    NumConeCulledTriangles += Other.NumConeCulledTriangles;
+    NumVisibleTriangles += Other.NumVisibleTriangles;
+}
+
+void Meshlets::Build(const std::vector<uint32_t>& Indices, const std::vector<XMFLOAT3>& Positions, MeshletData& Out)
+{
+    Out = MeshletData();
+
+    std::vector<uint8_t> LocalIndex(Positions.size(), UnusedLocalIndex);
+    Meshlet Current;
+
+    const auto Flush = [&]()
+    {
+        if (Current.TriangleCount == 0) { return; }
+
+        for (uint32_t Local = 0; Local < Current.VertexCount; Local++) { LocalIndex[Out.VertexIndices[Current.VertexOffset + Local]] = UnusedLocalIndex; }
+        Out.Bounds.push_back(ComputeBounds(Out, Current, Positions));
+        Out.Meshlets.push_back(Current);
+
+        Current = Meshlet();
+        Current.VertexOffset = static_cast<uint32_t>(Out.VertexIndices.size());
+        Current.TriangleOffset = static_cast<uint32_t>(Out.Triangles.size());
+    };
+
+    for (size_t Tri = 0; Tri + 2 < Indices.size(); Tri += 3)
+    {
+        const uint32_t A = Indices[Tri];
+        const uint32_t B = Indices[Tri + 1];
+        const uint32_t C = Indices[Tri + 2];
+        const uint32_t NumNew = (LocalIndex[A] == UnusedLocalIndex ? 1 : 0)
+            + (LocalIndex[B] == UnusedLocalIndex && B != A ? 1 : 0)
+            + (LocalIndex[C] == UnusedLocalIndex && C != A && C != B ? 1 : 0);
+        if (Current.VertexCount + NumNew > MaxMeshletVertices || Current.TriangleCount + 1 > MaxMeshletTriangles) { Flush(); }
+
+        for (const uint32_t Vtx : { A, B, C })
+        {
+            if (LocalIndex[Vtx] == UnusedLocalIndex)
+            {
+                LocalIndex[Vtx] = static_cast<uint8_t>(Current.VertexCount++);
+                Out.VertexIndices.push_back(Vtx);
+            }
+            Out.Triangles.push_back(LocalIndex[Vtx]);
+        }
+        Current.TriangleCount++;
+    }
+    Flush();
+}
+
+void Meshlets::Cull(const MeshletData& Data, const XMFLOAT4X4& World, const Frustum& ViewFrustum, const XMFLOAT3& EyePosition,
+    MeshletCullStats& Stats, std::vector<uint32_t>* OutVisible)
+{
+    const XMMATRIX Matrix = XMLoadFloat4x4(&World);
+    const XMVECTOR Eye = XMLoadFloat3(&EyePosition);
+
+    // The largest axis scale bounds the spheres. Cones only survive uniform scale, and flip with a mirroring transform like the winding does.
+    const float ScaleX = XMVectorGetX(XMVector3Length(Matrix.r[0]));
+    const float ScaleY = XMVectorGetX(XMVector3Length(Matrix.r[1]));
+    const float ScaleZ = XMVectorGetX(XMVector3Length(Matrix.r[2]));
+    const float MaxScale = std::max({ ScaleX, ScaleY, ScaleZ });
+    const bool bUniformScale = MaxScale - std::min({ ScaleX, ScaleY, ScaleZ }) <= MaxScale * 1e-3f;
+    const float ConeSign = XMVectorGetX(XMMatrixDeterminant(Matrix)) < 0.0f ? -1.0f : 1.0f;
+
+    for (size_t Idx = 0; Idx < Data.Meshlets.size(); Idx++)
+    {
+        const Meshlet& Cluster = Data.Meshlets[Idx];
+        const MeshletBounds& Bounds = Data.Bounds[Idx];
+        Stats.NumMeshlets++;
+        Stats.NumTriangles += Cluster.TriangleCount;
+
+        XMFLOAT3 Center;
+        XMStoreFloat3(&Center, XMVector3Transform(XMLoadFloat3(&Bounds.Center), Matrix));
+        const float Radius = Bounds.Radius * MaxScale;
+        if (!ViewFrustum.IntersectsSphere(Center, Radius))
+        {
+            Stats.NumFrustumCulled++;
+            continue;
+        }
+
+        if (bUniformScale && Bounds.ConeCutoff < 1.0f)
+        {
+            const XMVECTOR Axis = XMVectorScale(XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&Bounds.ConeAxis), Matrix)), ConeSign);
+            const XMVECTOR ToCenter = XMVectorSubtract(XMLoadFloat3(&Center), Eye);
+            if (XMVectorGetX(XMVector3Dot(ToCenter, Axis)) >= Bounds.ConeCutoff * XMVectorGetX(XMVector3Length(ToCenter)) + Radius)
+            {
+                Stats.NumConeCulled++;
+                Stats.NumConeCulledTriangles += Cluster.TriangleCount;
+                continue;
+            }
+        }
+
+        Stats.NumVisibleTriangles += Cluster.TriangleCount;
+        if (OutVisible) { OutVisible->push_back(static_cast<uint32_t>(Idx)); }
+    }
+}
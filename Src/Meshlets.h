@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+
+struct Frustum;
+
+// Small clusters of a mesh's triangles that can be culled on their own, sized for mesh shader thread groups.
+constexpr uint32_t MaxMeshletVertices = 64;
+constexpr uint32_t MaxMeshletTriangles = 124;
+
+struct Meshlet
+{
+    uint32_t VertexOffset = 0;   // First entry in MeshletData::VertexIndices.
+    uint32_t TriangleOffset = 0; // First byte in MeshletData::Triangles, three per triangle.
+    uint32_t VertexCount = 0;
+    uint32_t TriangleCount = 0;
+};
+
+// Culling bounds in mesh space.
+struct MeshletBounds
+{
+    DirectX::XMFLOAT3 Center;
+    float Radius = 0.0f;
+
+    // Every triangle faces away from an eye where Dot(Center - Eye, ConeAxis) >= ConeCutoff * Length(Center - Eye) + Radius.
+    // A cutoff of 1 can never pass, used when the normals spread too far for a useful cone.
+    DirectX::XMFLOAT3 ConeAxis;
+    float ConeCutoff = 1.0f;
+};
+
+// Meshlet side table of one mesh, its indices refer to the mesh's vertex buffer.
+struct MeshletData
+{
+    std::vector<Meshlet> Meshlets;
+    std::vector<MeshletBounds> Bounds;    // One per meshlet.
+    std::vector<uint32_t> VertexIndices;  // Mesh vertex of each meshlet local vertex.
+    std::vector<uint8_t> Triangles;       // Meshlet local vertices, three per triangle.
+
+    bool IsEmpty() const { return Meshlets.empty(); }
+    size_t GetSizeBytes() const;
+};
+
+struct MeshletCullStats
+{
+    size_t NumMeshlets = 0;
+    size_t NumFrustumCulled = 0;
+    size_t NumConeCulled = 0;
+    size_t NumTriangles = 0;
+    size_t NumConeCulledTriangles = 0;
+    size_t NumVisibleTriangles = 0;
+
+    void Merge(const MeshletCullStats& Other);
+};
+
+namespace Meshlets
+{
+    // Greedily fills meshlets in index order, which after vertex cache optimisation keeps neighbouring triangles together.
+    void Build(const std::vector<uint32_t>& Indices, const std::vector<DirectX::XMFLOAT3>& Positions, MeshletData& Out);
+
+    // CPU reference culler for one instance. Appends the indices of the meshlets that survive the frustum and normal cone tests.
+    // World is the instance's row vector Model to World matrix, EyePosition is in world space.
+    void Cull(const MeshletData& Data, const DirectX::XMFLOAT4X4& World, const Frustum& ViewFrustum, const DirectX::XMFLOAT3& EyePosition,
+        MeshletCullStats& Stats, std::vector<uint32_t>* OutVisible = nullptr);
+}
@@ -0,0 +1,349 @@
+#include "OcclusionCulling.h"
+
+// Std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+using namespace DirectX;
+
+namespace
+{
+    // Clips an occluder's triangles to the near plane and projects them to pixels. Triangles wholly outside one side
+    // of the frustum are dropped, the rest are left for binning to trim to the screen.
+    template <typename TriangleT>
+    void ProjectTriangles(const OccluderInstance& Occluder, FXMMATRIX ViewProjection, float Width, float Height, std::vector<TriangleT>& OutTriangles)
+    {
+        const OccluderMesh& Mesh = *Occluder.Mesh;
+        const XMMATRIX WorldToClip = XMMatrixMultiply(XMLoadFloat4x4(&Occluder.World), ViewProjection);
+
+        std::vector<XMFLOAT4> Clip(Mesh.Positions.size());
+        for (size_t Idx = 0; Idx < Mesh.Positions.size(); Idx++)
+        {
+            XMStoreFloat4(&Clip[Idx], XMVector3Transform(XMLoadFloat3(&Mesh.Positions[Idx]), WorldToClip));
+        }
+
+        for (size_t Idx = 0; Idx + 2 < Mesh.Indices.size(); Idx += 3)
+        {
+            const XMFLOAT4* Corners[3] = { &Clip[Mesh.Indices[Idx]], &Clip[Mesh.Indices[Idx + 1]], &Clip[Mesh.Indices[Idx + 2]] };
+
+            uint32_t OutsideAll = 0x3F;
+            for (const XMFLOAT4* Corner : Corners)
+            {
+                const uint32_t Outside = (Corner->x < -Corner->w ? 1u : 0u) | (Corner->x > Corner->w ? 2u : 0u) | (Corner->y < -Corner->w ? 4u : 0u)
+                    | (Corner->y > Corner->w ? 8u : 0u) | (Corner->z < 0.0f ? 16u : 0u) | (Corner->z > Corner->w ? 32u : 0u);
+                OutsideAll &= Outside;
+            }
+            if (OutsideAll != 0) { continue; }
+
+            // Clipping against z >= 0 keeps w at least the near distance, so every clipped corner can be divided by it.
+            XMFLOAT4 Polygon[4];
+            size_t NumCorners = 0;
+            for (size_t Edge = 0; Edge < 3; Edge++)
+            {
+                const XMFLOAT4& A = *Corners[Edge];
+                const XMFLOAT4& B = *Corners[(Edge + 1) % 3];
+                const bool bAInside = A.z >= 0.0f;
+                if (bAInside) { Polygon[NumCorners++] = A; }
+                if (bAInside != (B.z >= 0.0f))
+                {
+                    const float T = A.z / (A.z - B.z);
+                    XMStoreFloat4(&Polygon[NumCorners++], XMVectorLerp(XMLoadFloat4(&A), XMLoadFloat4(&B), T));
+                }
+            }
+
+            float X[4], Y[4], Z[4];
+            for (size_t Corner = 0; Corner < NumCorners; Corner++)
+            {
+                const float InvW = 1.0f / Polygon[Corner].w;
+                X[Corner] = (Polygon[Corner].x * InvW * 0.5f + 0.5f) * Width;
+                Y[Corner] = (0.5f - Polygon[Corner].y * InvW * 0.5f) * Height;
+                Z[Corner] = Polygon[Corner].z * InvW;
+            }
+
+            // A clipped quad is split into a fan. Occluders are drawn from both sides, only degenerate triangles are skipped.
+            for (size_t Second = 1; Second + 1 < NumCorners; Second++)
+            {
+                const TriangleT Triangle = { { X[0], X[Second], X[Second + 1] }, { Y[0], Y[Second], Y[Second + 1] }, { Z[0], Z[Second], Z[Second + 1] } };
+                const float Area = (Triangle.X[1] - Triangle.X[0]) * (Triangle.Y[2] - Triangle.Y[0]) - (Triangle.X[2] - Triangle.X[0]) * (Triangle.Y[1] - Triangle.Y[0]);
+                if (Area != 0.0f && std::isfinite(Area)) { OutTriangles.push_back(Triangle); }
+            }
+        }
+    }
+}
+
+void OccluderMesh::Build(const uint32_t* InIndices, size_t NumIndices, const std::vector<XMFLOAT3>& InPositions)
+{
+    Positions.clear();
+    Indices.resize(NumIndices);
+
+    std::vector<uint32_t> Remap(InPositions.size(), UINT32_MAX);
+    for (size_t Idx = 0; Idx < NumIndices; Idx++)
+    {
+        uint32_t& Vertex = Remap[InIndices[Idx]];
+        if (Vertex == UINT32_MAX)
+        {
+            Vertex = static_cast<uint32_t>(Positions.size());
+            Positions.push_back(InPositions[InIndices[Idx]]);
+        }
+        Indices[Idx] = Vertex;
+    }
+}
+
+void OcclusionBuffer::Resize(uint32_t InWidth, uint32_t InHeight)
+{
+    NumTilesX = std::max((InWidth + TileWidth - 1) / TileWidth, 1u);
+    NumTilesY = std::max((InHeight + TileHeight - 1) / TileHeight, 1u);
+    if (Width == NumTilesX * TileWidth && Height == NumTilesY * TileHeight) { return; }
+
+    Width = NumTilesX * TileWidth;
+    Height = NumTilesY * TileHeight;
+    Depth.assign(static_cast<size_t>(Width) * Height, 1.0f);
+    BlockMaxDepth.assign(static_cast<size_t>(Width / BlockSize) * (Height / BlockSize), 1.0f);
+    TileTriangles.assign(static_cast<size_t>(NumTilesX) * NumTilesY, std::vector<uint32_t>());
+}
+
+void OcclusionBuffer::Render(const std::vector<OccluderInstance>& Occluders, FXMMATRIX InViewProjection, OcclusionStats& OutStats)
+{
+    const auto Start = std::chrono::steady_clock::now();
+    XMStoreFloat4x4(&ViewProjection, InViewProjection);
+
+    // Occluders are projected on separate threads and joined in submission order.
+    std::vector<std::vector<ScreenTriangle>> OccluderTriangles(Occluders.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, Occluders.size(), 1),
+        [&](const tbb::blocked_range<size_t>& Range)
+        {
+            for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+            {
+                ProjectTriangles(Occluders[Idx], InViewProjection, static_cast<float>(Width), static_cast<float>(Height), OccluderTriangles[Idx]);
+            }
+        });
+
+    Triangles.clear();
+    for (size_t Idx = 0; Idx < Occluders.size(); Idx++)
+    {
+        OutStats.NumOccluderTriangles += Occluders[Idx].Mesh->Indices.size() / 3;
+        Triangles.insert(Triangles.end(), OccluderTriangles[Idx].begin(), OccluderTriangles[Idx].end());
+    }
+    OutStats.NumOccluders += Occluders.size();
+
+    // Every triangle goes to each tile its pixel bounds overlap.
+    for (std::vector<uint32_t>& Tile : TileTriangles) { Tile.clear(); }
+    for (uint32_t Idx = 0; Idx < static_cast<uint32_t>(Triangles.size()); Idx++)
+    {
+        const ScreenTriangle& Triangle = Triangles[Idx];
+        const float MinX = std::min({ Triangle.X[0], Triangle.X[1], Triangle.X[2] });
+        const float MaxX = std::max({ Triangle.X[0], Triangle.X[1], Triangle.X[2] });
+        const float MinY = std::min({ Triangle.Y[0], Triangle.Y[1], Triangle.Y[2] });
+        const float MaxY = std::max({ Triangle.Y[0], Triangle.Y[1], Triangle.Y[2] });
+        if (MaxX < 0.0f || MaxY < 0.0f || MinX >= static_cast<float>(Width) || MinY >= static_cast<float>(Height)) { continue; }
+
+        const uint32_t FirstTileX = static_cast<uint32_t>(std::max(MinX, 0.0f)) / TileWidth;
+        const uint32_t LastTileX = static_cast<uint32_t>(std::min(MaxX, static_cast<float>(Width - 1))) / TileWidth;
+        const uint32_t FirstTileY = static_cast<uint32_t>(std::max(MinY, 0.0f)) / TileHeight;
+        const uint32_t LastTileY = static_cast<uint32_t>(std::min(MaxY, static_cast<float>(Height - 1))) / TileHeight;
+        for (uint32_t TileY = FirstTileY; TileY <= LastTileY; TileY++)
+        {
+            for (uint32_t TileX = FirstTileX; TileX <= LastTileX; TileX++)
+            {
+                TileTriangles[TileY * NumTilesX + TileX].push_back(Idx);
+            }
+        }
+        OutStats.NumRasterisedTriangles++;
+    }
+
+    // Tiles share no pixels, so each is cleared and rasterised on its own.
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, NumTilesX * NumTilesY, 1),
+        [this](const tbb::blocked_range<uint32_t>& Range)
+        {
+            for (uint32_t Tile = Range.begin(); Tile != Range.end(); ++Tile) { RasteriseTile(Tile); }
+        });
+
+    OutStats.RasterMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+void OcclusionBuffer::RasteriseTile(uint32_t Tile)
+{
+    const uint32_t TileX = (Tile % NumTilesX) * TileWidth;
+    const uint32_t TileY = (Tile / NumTilesX) * TileHeight;
+    for (uint32_t Y = TileY; Y < TileY + TileHeight; Y++)
+    {
+        std::fill_n(Depth.begin() + static_cast<size_t>(Y) * Width + TileX, TileWidth, 1.0f);
+    }
+
+    const XMVECTOR PixelOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+    const XMVECTOR Zero = XMVectorZero();
+    for (const uint32_t Idx : TileTriangles[Tile])
+    {
+        const ScreenTriangle& Triangle = Triangles[Idx];
+        const float Dx1 = Triangle.X[1] - Triangle.X[0], Dy1 = Triangle.Y[1] - Triangle.Y[0], Dz1 = Triangle.Z[1] - Triangle.Z[0];
+        const float Dx2 = Triangle.X[2] - Triangle.X[0], Dy2 = Triangle.Y[2] - Triangle.Y[0], Dz2 = Triangle.Z[2] - Triangle.Z[0];
+        const float Area = Dx1 * Dy2 - Dx2 * Dy1;
+        const float Sign = Area > 0.0f ? 1.0f : -1.0f;
+
+        // Edge functions A * X + B * Y + C, positive inside whichever way the triangle winds.
+        float EdgeA[3], EdgeB[3], EdgeC[3];
+        for (size_t Edge = 0; Edge < 3; Edge++)
+        {
+            const size_t Next = (Edge + 1) % 3;
+            const float Ex = Triangle.X[Next] - Triangle.X[Edge];
+            const float Ey = Triangle.Y[Next] - Triangle.Y[Edge];
+            EdgeA[Edge] = -Ey * Sign;
+            EdgeB[Edge] = Ex * Sign;
+            EdgeC[Edge] = (Triangle.X[Edge] * Ey - Triangle.Y[Edge] * Ex) * Sign;
+        }
+
+        // Depth is linear in screen space after the divide.
+        const float DepthA = (Dz1 * Dy2 - Dz2 * Dy1) / Area;
+        const float DepthB = (Dx1 * Dz2 - Dx2 * Dz1) / Area;
+        const float DepthC = Triangle.Z[0] - DepthA * Triangle.X[0] - DepthB * Triangle.Y[0];
+
+        // Pixels of the tile under the triangle's bounds, in whole groups of four.
+        const float MinX = std::min({ Triangle.X[0], Triangle.X[1], Triangle.X[2] });
+        const float MaxX = std::max({ Triangle.X[0], Triangle.X[1], Triangle.X[2] });
+        const float MinY = std::min({ Triangle.Y[0], Triangle.Y[1], Triangle.Y[2] });
+        const float MaxY = std::max({ Triangle.Y[0], Triangle.Y[1], Triangle.Y[2] });
+        const uint32_t FirstX = std::max(TileX, static_cast<uint32_t>(std::max(MinX, 0.0f))) & ~3u;
+        const uint32_t EndX = std::min(TileX + TileWidth, static_cast<uint32_t>(std::min(MaxX, static_cast<float>(Width - 1))) + 1);
+        const uint32_t FirstY = std::max(TileY, static_cast<uint32_t>(std::max(MinY, 0.0f)));
+        const uint32_t EndY = std::min(TileY + TileHeight, static_cast<uint32_t>(std::min(MaxY, static_cast<float>(Height - 1))) + 1);
+
+        const XMVECTOR A0 = XMVectorReplicate(EdgeA[0]), A1 = XMVectorReplicate(EdgeA[1]), A2 = XMVectorReplicate(EdgeA[2]);
+        const XMVECTOR ZA = XMVectorReplicate(DepthA);
+        for (uint32_t Y = FirstY; Y < EndY; Y++)
+        {
+            const float CenterY = static_cast<float>(Y) + 0.5f;
+            const XMVECTOR Row0 = XMVectorReplicate(EdgeB[0] * CenterY + EdgeC[0]);
+            const XMVECTOR Row1 = XMVectorReplicate(EdgeB[1] * CenterY + EdgeC[1]);
+            const XMVECTOR Row2 = XMVectorReplicate(EdgeB[2] * CenterY + EdgeC[2]);
+            const XMVECTOR RowZ = XMVectorReplicate(DepthB * CenterY + DepthC);
+            float* DepthRow = Depth.data() + static_cast<size_t>(Y) * Width;
+            for (uint32_t X = FirstX; X < EndX; X += 4)
+            {
+                const XMVECTOR CenterX = XMVectorAdd(XMVectorReplicate(static_cast<float>(X)), PixelOffsets);
+                XMVECTOR Inside = XMVectorGreaterOrEqual(XMVectorMultiplyAdd(A0, CenterX, Row0), Zero);
+                Inside = XMVectorAndInt(Inside, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(A1, CenterX, Row1), Zero));
+                Inside = XMVectorAndInt(Inside, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(A2, CenterX, Row2), Zero));
+                if (XMVector4EqualInt(Inside, Zero)) { continue; }
+
+                const XMVECTOR Old = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(DepthRow + X));
+                const XMVECTOR New = XMVectorMin(Old, XMVectorMultiplyAdd(ZA, CenterX, RowZ));
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(DepthRow + X), XMVectorSelect(Old, New, Inside));
+            }
+        }
+    }
+
+    // Furthest depth of each block, a box in front of it is visible without reading the pixels.
+    const uint32_t BlocksPerRow = Width / BlockSize;
+    for (uint32_t BlockY = TileY; BlockY < TileY + TileHeight; BlockY += BlockSize)
+    {
+        for (uint32_t BlockX = TileX; BlockX < TileX + TileWidth; BlockX += BlockSize)
+        {
+            float MaxDepth = 0.0f;
+            for (uint32_t Y = BlockY; Y < BlockY + BlockSize; Y++)
+            {
+                const float* DepthRow = Depth.data() + static_cast<size_t>(Y) * Width + BlockX;
+                MaxDepth = std::max(MaxDepth, *std::max_element(DepthRow, DepthRow + BlockSize));
+            }
+            BlockMaxDepth[(BlockY / BlockSize) * BlocksPerRow + BlockX / BlockSize] = MaxDepth;
+        }
+    }
+}
+
+bool OcclusionBuffer::IsVisible(const BoundingBox& Box) const
+{
+    // Conservative screen rectangle and nearest depth of the box's corners.
+    const XMMATRIX VP = XMLoadFloat4x4(&ViewProjection);
+    float MinX = FLT_MAX, MaxX = -FLT_MAX, MinY = FLT_MAX, MaxY = -FLT_MAX, MinZ = FLT_MAX;
+    for (uint32_t Corner = 0; Corner < 8; Corner++)
+    {
+        const XMVECTOR Point = XMVectorSet((Corner & 1) ? Box.Max.x : Box.Min.x, (Corner & 2) ? Box.Max.y : Box.Min.y, (Corner & 4) ? Box.Max.z : Box.Min.z, 1.0f);
+        XMFLOAT4 Clip;
+        XMStoreFloat4(&Clip, XMVector4Transform(Point, VP));
+        if (Clip.z <= 0.0f) { return true; }
+
+        const float InvW = 1.0f / Clip.w;
+        const float X = (Clip.x * InvW * 0.5f + 0.5f) * static_cast<float>(Width);
+        const float Y = (0.5f - Clip.y * InvW * 0.5f) * static_cast<float>(Height);
+        MinX = std::min(MinX, X);
+        MaxX = std::max(MaxX, X);
+        MinY = std::min(MinY, Y);
+        MaxY = std::max(MaxY, Y);
+        MinZ = std::min(MinZ, Clip.z * InvW);
+    }
+
+    // Off screen boxes are left to frustum culling.
+    if (MaxX < 0.0f || MaxY < 0.0f || MinX >= static_cast<float>(Width) || MinY >= static_cast<float>(Height)) { return true; }
+
+    const uint32_t FirstX = static_cast<uint32_t>(std::max(MinX, 0.0f));
+    const uint32_t LastX = static_cast<uint32_t>(std::min(MaxX, static_cast<float>(Width - 1)));
+    const uint32_t FirstY = static_cast<uint32_t>(std::max(MinY, 0.0f));
+    const uint32_t LastY = static_cast<uint32_t>(std::min(MaxY, static_cast<float>(Height - 1)));
+    const uint32_t BlocksPerRow = Width / BlockSize;
+    for (uint32_t BlockY = FirstY / BlockSize; BlockY <= LastY / BlockSize; BlockY++)
+    {
+        for (uint32_t BlockX = FirstX / BlockSize; BlockX <= LastX / BlockSize; BlockX++)
+        {
+            if (BlockMaxDepth[BlockY * BlocksPerRow + BlockX] < MinZ) { continue; }
+
+            const uint32_t EndY = std::min(LastY + 1, (BlockY + 1) * BlockSize);
+            const uint32_t EndX = std::min(LastX + 1, (BlockX + 1) * BlockSize);
+            for (uint32_t Y = std::max(FirstY, BlockY * BlockSize); Y < EndY; Y++)
+            {
+                const float* DepthRow = Depth.data() + static_cast<size_t>(Y) * Width;
+                for (uint32_t X = std::max(FirstX, BlockX * BlockSize); X < EndX; X++)
+                {
+                    if (DepthRow[X] >= MinZ) { return true; }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void OcclusionCulling::SelectOccluders(std::vector<OccluderCandidate>& Candidates)
+{
+    Candidates.erase(std::remove_if(Candidates.begin(), Candidates.end(), [](const OccluderCandidate& Candidate) { return Candidate.ScreenSize < MinOccluderScreenSize; }),
+        Candidates.end());
+
+    const size_t NumKept = std::min(Candidates.size(), MaxOccluders);
+    std::partial_sort(Candidates.begin(), Candidates.begin() + NumKept, Candidates.end(),
+        [](const OccluderCandidate& A, const OccluderCandidate& B) { return A.ScreenSize > B.ScreenSize; });
+    Candidates.resize(NumKept);
+}
+
+void OcclusionCulling::RemoveOccluded(const OcclusionBuffer& Buffer, const std::vector<BoundingBox>& Boxes, std::vector<uint32_t>& InOutObjects, OcclusionStats& OutStats)
+{
+    const auto Start = std::chrono::steady_clock::now();
+
+    // Tests only read the buffer, so large sets are split across threads and compacted afterwards.
+    std::vector<uint8_t> Visible(InOutObjects.size());
+    const auto TestRange = [&](size_t Begin, size_t End)
+    {
+        for (size_t Idx = Begin; Idx < End; Idx++) { Visible[Idx] = Buffer.IsVisible(Boxes[InOutObjects[Idx]]) ? 1 : 0; }
+    };
+    if (InOutObjects.size() < ParallelTestObjects)
+    {
+        TestRange(0, InOutObjects.size());
+    }
+    else
+    {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, InOutObjects.size(), 1024),
+            [&](const tbb::blocked_range<size_t>& Range) { TestRange(Range.begin(), Range.end()); });
+    }
+
+    size_t NumKept = 0;
+    for (size_t Idx = 0; Idx < InOutObjects.size(); Idx++)
+    {
+        if (Visible[Idx]) { InOutObjects[NumKept++] = InOutObjects[Idx]; }
+    }
+
+    OutStats.NumTested += InOutObjects.size();
+    OutStats.NumOccluded += InOutObjects.size() - NumKept;
+    InOutObjects.resize(NumKept);
+    OutStats.TestMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
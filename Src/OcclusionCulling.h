@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "SceneBVH.h"
+
+// Few triangle stand-in of a mesh, rasterised into the occlusion buffer instead of the mesh itself. In render space.
+struct OccluderMesh
+{
+    std::vector<DirectX::XMFLOAT3> Positions;
+    std::vector<uint32_t> Indices;
+
+    // Copies a triangle list, keeping only the vertices it uses.
+    void Build(const uint32_t* InIndices, size_t NumIndices, const std::vector<DirectX::XMFLOAT3>& InPositions);
+    bool IsEmpty() const { return Indices.empty(); }
+};
+
+// One occluder mesh drawn with a row vector Model to World matrix.
+struct OccluderInstance
+{
+    const OccluderMesh* Mesh = nullptr;
+    DirectX::XMFLOAT4X4 World;
+};
+
+// An object that could be drawn as an occluder this frame, with how large it looks from the camera.
+struct OccluderCandidate
+{
+    uint32_t Object = 0;
+    float ScreenSize = 0.0f; // World radius over distance to the camera.
+};
+
+struct OcclusionStats
+{
+    size_t NumOccluders = 0;
+    size_t NumOccluderTriangles = 0;
+    size_t NumRasterisedTriangles = 0; // Left after clipping and rejecting triangles outside the screen.
+    size_t NumTested = 0;
+    size_t NumOccluded = 0;
+    double RasterMs = 0.0;
+    double TestMs = 0.0;
+};
+
+// Low resolution depth buffer of a few large occluders, for rejecting objects hidden behind them before anything is submitted.
+// Depth is the projection's [0, 1] z with the near plane at 0. Each tile of the screen is rasterised on its own thread,
+// four pixels at a time, and every 8x8 block keeps its furthest depth so most tests never look at single pixels.
+// Coverage is sampled at pixel centres, so gaps between occluders narrower than a buffer pixel may be missed.
+class OcclusionBuffer
+{
+public:
+    static constexpr uint32_t TileWidth = 64;
+    static constexpr uint32_t TileHeight = 16;
+    static constexpr uint32_t BlockSize = 8;
+
+    // Rounded up to whole tiles, the projection is stretched over the rounded size.
+    void Resize(uint32_t InWidth, uint32_t InHeight);
+
+    // Clears to the far plane and rasterises every occluder with a row vector World to Clip matrix.
+    void Render(const std::vector<OccluderInstance>& Occluders, DirectX::FXMMATRIX ViewProjection, OcclusionStats& OutStats);
+
+    // False when the box is behind occluders at every pixel it covers. Boxes crossing the near plane are always visible.
+    bool IsVisible(const BoundingBox& Box) const;
+
+    uint32_t GetWidth() const { return Width; }
+    uint32_t GetHeight() const { return Height; }
+    const std::vector<float>& GetDepth() const { return Depth; } // Row major, top row first.
+
+private:
+    // Triangle in pixel coordinates with [0, 1] depth.
+    struct ScreenTriangle
+    {
+        float X[3], Y[3], Z[3];
+    };
+
+    void RasteriseTile(uint32_t Tile);
+
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t NumTilesX = 0;
+    uint32_t NumTilesY = 0;
+    std::vector<float> Depth;
+    std::vector<float> BlockMaxDepth;
+    DirectX::XMFLOAT4X4 ViewProjection;
+
+    std::vector<ScreenTriangle> Triangles;
+    std::vector<std::vector<uint32_t>> TileTriangles; // Triangles overlapping each tile, in submission order.
+};
+
+namespace OcclusionCulling
+{
+    // Simplified LODs are only used as occluders while their error is this fraction of the mesh's radius,
+    // and meshes whose chosen level is still larger than this many triangles are never occluders.
+    constexpr float MaxOccluderRelativeError = 0.005f;
+    constexpr size_t MaxOccluderTriangles = 512;
+
+    // Per frame limits on what is drawn into the buffer, small objects hide little and cost the same to rasterise.
+    constexpr size_t MaxOccluders = 64;
+    constexpr float MinOccluderScreenSize = 0.05f;
+
+    // Buffer width, the height follows the aspect ratio.
+    constexpr uint32_t BufferWidth = 256;
+
+    // Candidates at or above this count are tested on several threads.
+    constexpr size_t ParallelTestObjects = 4096;
+
+    // Keeps the largest MaxOccluders candidates over MinOccluderScreenSize, largest first.
+    void SelectOccluders(std::vector<OccluderCandidate>& Candidates);
+
+    // Removes the objects whose box is hidden in the buffer, keeping the order of the rest.
+    void RemoveOccluded(const OcclusionBuffer& Buffer, const std::vector<BoundingBox>& Boxes, std::vector<uint32_t>& InOutObjects, OcclusionStats& OutStats);
+}
@@ -0,0 +1,264 @@
+#include "PayloadStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include <nvtx3/nvtx3.hpp>
+
+using namespace DirectX;
+
+namespace
+{
+    // How long the worker sleeps when there is nothing to load, the camera moving wakes it sooner.
+    constexpr std::chrono::milliseconds IdleWait{100};
+
+    // A resident payload is only evicted for one at least this many times larger on screen, stops thrashing at the budget.
+    constexpr float EvictionHysteresis = 2.0f;
+
+    // Stand in radius for payloads without authored bounds.
+    constexpr float UnknownRadius = 1.0f;
+}
+
+PayloadStreamer::PayloadStreamer(size_t InBudgetBytes, LoadFunction InLoad, UnloadFunction InUnload)
+    : Load(std::move(InLoad))
+    , Unload(std::move(InUnload))
+{
+    Stats.BudgetBytes = InBudgetBytes;
+}
+
+PayloadStreamer::~PayloadStreamer()
+{
+    Stop();
+}
+
+void PayloadStreamer::AddPayloads(const std::vector<PayloadBounds>& Payloads)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    AddPayloadsLocked(Payloads);
+    WakeUp.notify_one();
+}
+
+void PayloadStreamer::AddPayloadsLocked(const std::vector<PayloadBounds>& Payloads)
+{
+    for (const PayloadBounds& Bounds : Payloads)
+    {
+        PayloadEntry Entry;
+        Entry.Id = NextId++;
+        Entry.Bounds = Bounds;
+        Entries.emplace_back(std::move(Entry));
+    }
+    Stats.NumPayloads = Entries.size();
+}
+
+void PayloadStreamer::Start()
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (bRunning) { return; }
+
+    bRunning = true;
+    Worker = std::thread(&PayloadStreamer::WorkerLoop, this);
+}
+
+void PayloadStreamer::Stop()
+{
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        bRunning = false;
+    }
+    WakeUp.notify_one();
+
+    // Waits for a payload that is mid load, its result is dropped with the scene.
+    if (Worker.joinable()) { Worker.join(); }
+}
+
+void PayloadStreamer::SetView(const XMFLOAT3& Position, const XMFLOAT3& Forward, float TanHalfFov)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    ViewPosition = Position;
+    ViewForward = Forward;
+    ViewTanHalfFov = TanHalfFov;
+    WakeUp.notify_one();
+}
+
+std::vector<uint32_t> PayloadStreamer::TakeEvictions()
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    std::vector<uint32_t> Ids;
+    Ids.swap(PendingEvictions);
+    return Ids;
+}
+
+void PayloadStreamer::ConfirmEvictions(const std::vector<uint32_t>& Ids)
+{
+    if (Ids.empty()) { return; }
+
+    std::lock_guard<std::mutex> Lock(Mutex);
+    ConfirmedEvictions.insert(ConfirmedEvictions.end(), Ids.begin(), Ids.end());
+    WakeUp.notify_one();
+}
+
+PayloadStreamingStats PayloadStreamer::GetStats() const
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return Stats;
+}
+
+void PayloadStreamer::WorkerLoop()
+{
+    std::unique_lock<std::mutex> Lock(Mutex);
+    while (bRunning)
+    {
+        UnloadConfirmed(Lock);
+
+        // The unloaded payload covering the most of the screen.
+        size_t BestIdx = Entries.size();
+        float BestScore = 0.0f;
+        for (size_t Idx = 0; Idx < Entries.size(); Idx++)
+        {
+            if (Entries[Idx].State != PayloadState::Unloaded) { continue; }
+
+            const float Score = ScorePayload(Entries[Idx]);
+            if (BestIdx == Entries.size() || Score > BestScore)
+            {
+                BestIdx = Idx;
+                BestScore = Score;
+            }
+        }
+
+        if (BestIdx == Entries.size())
+        {
+            WakeUp.wait_for(Lock, IdleWait);
+            continue;
+        }
+
+        // Over budget, make room by evicting one payload at a time and re-evaluating.
+        if (Stats.ResidentBytes >= Stats.BudgetBytes)
+        {
+            if (!EvictFor(BestScore)) { WakeUp.wait_for(Lock, IdleWait); }
+            continue;
+        }
+
+        PayloadEntry& Best = Entries[BestIdx];
+        Best.State = PayloadState::Loading;
+        const uint32_t Id = Best.Id;
+        const pxr::SdfPath Path = Best.Bounds.Path;
+
+        Lock.unlock();
+        std::vector<PayloadBounds> Nested;
+        size_t Bytes = 0;
+        {
+            nvtx3::scoped_range r{ "Stream Payload" };
+            Bytes = Load(Id, Path, Nested);
+        }
+        Lock.lock();
+
+        // Only the worker adds or removes entries, so the loading one is still there.
+        const auto Loaded = std::find_if(Entries.begin(), Entries.end(), [Id](const PayloadEntry& Entry) { return Entry.Id == Id; });
+        Loaded->State = PayloadState::Resident;
+        Loaded->Bytes = Bytes;
+        Stats.ResidentBytes += Bytes;
+        Stats.NumResident++;
+        Stats.NumLoads++;
+
+        AddPayloadsLocked(Nested);
+    }
+}
+
+float PayloadStreamer::ScorePayload(const PayloadEntry& Entry) const
+{
+    const XMVECTOR Center = XMLoadFloat3(&Entry.Bounds.Center);
+    const XMVECTOR ToCenter = XMVectorSubtract(Center, XMLoadFloat3(&ViewPosition));
+    const float Distance = XMVectorGetX(XMVector3Length(ToCenter));
+    const float Radius = Entry.Bounds.Radius > 0.0f ? Entry.Bounds.Radius : UnknownRadius;
+
+    // Approximate projected size, the bounding sphere's radius as a fraction of half the screen height.
+    const float SurfaceDistance = std::max(Distance - Radius, 0.01f);
+    float Score = Radius / (SurfaceDistance * ViewTanHalfFov);
+
+    // Behind the camera is less urgent than in view, but still close enough to matter when turning around.
+    if (Distance > Radius && XMVectorGetX(XMVector3Dot(ToCenter, XMLoadFloat3(&ViewForward))) < 0.0f)
+    {
+        Score *= 0.25f;
+    }
+    return Score;
+}
+
+bool PayloadStreamer::EvictFor(float Score)
+{
+    size_t WorstIdx = Entries.size();
+    float WorstScore = std::numeric_limits<float>::max();
+    for (size_t Idx = 0; Idx < Entries.size(); Idx++)
+    {
+        if (Entries[Idx].State != PayloadState::Resident) { continue; }
+
+        const float EntryScore = ScorePayload(Entries[Idx]);
+        if (EntryScore < WorstScore)
+        {
+            WorstIdx = Idx;
+            WorstScore = EntryScore;
+        }
+    }
+    if (WorstIdx == Entries.size() || WorstScore * EvictionHysteresis >= Score) { return false; }
+
+    // Unloading a payload also unloads everything nested below it.
+    const pxr::SdfPath Root = Entries[WorstIdx].Bounds.Path;
+    for (PayloadEntry& Entry : Entries)
+    {
+        if (!Entry.Bounds.Path.HasPrefix(Root)) { continue; }
+
+        Entry.bDiscard = Entry.Bounds.Path != Root;
+        if (Entry.State == PayloadState::Resident)
+        {
+            Entry.State = PayloadState::Evicting;
+            Stats.ResidentBytes -= Entry.Bytes;
+            Stats.NumResident--;
+            PendingEvictions.push_back(Entry.Id);
+        }
+    }
+
+    // Nested payloads that never loaded are simply forgotten.
+    Entries.erase(std::remove_if(Entries.begin(), Entries.end(), [](const PayloadEntry& Entry)
+        {
+            return Entry.bDiscard && Entry.State == PayloadState::Unloaded;
+        }), Entries.end());
+
+    Stats.NumPayloads = Entries.size();
+    Stats.NumEvictions++;
+    return true;
+}
+
+void PayloadStreamer::UnloadConfirmed(std::unique_lock<std::mutex>& Lock)
+{
+    if (ConfirmedEvictions.empty()) { return; }
+
+    std::vector<uint32_t> Ids;
+    Ids.swap(ConfirmedEvictions);
+
+    std::vector<pxr::SdfPath> Paths;
+    for (const uint32_t Id : Ids)
+    {
+        const auto Found = std::find_if(Entries.begin(), Entries.end(), [Id](const PayloadEntry& Entry) { return Entry.Id == Id; });
+        if (Found != Entries.end() && !Found->bDiscard) { Paths.push_back(Found->Bounds.Path); }
+    }
+
+    // The main thread no longer references anything below these prims.
+    Lock.unlock();
+    {
+        nvtx3::scoped_range r{ "Unload Payloads" };
+        Unload(Paths);
+    }
+    Lock.lock();
+
+    for (PayloadEntry& Entry : Entries)
+    {
+        if (Entry.State != PayloadState::Evicting || std::find(Ids.begin(), Ids.end(), Entry.Id) == Ids.end()) { continue; }
+        Entry.State = PayloadState::Unloaded;
+        Entry.Bytes = 0;
+    }
+    Entries.erase(std::remove_if(Entries.begin(), Entries.end(), [](const PayloadEntry& Entry)
+        {
+            return Entry.bDiscard && Entry.State == PayloadState::Unloaded;
+        }), Entries.end());
+    Stats.NumPayloads = Entries.size();
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <DirectXMath.h>
+
+// Usd
+#include "pxr/usd/sdf/path.h"
+
+// An unloaded payload prim and its world bounds in render space.
+// Radius is zero when nothing like an extentsHint is authored above the payload, it is then ranked by distance only.
+struct PayloadBounds
+{
+    pxr::SdfPath Path;
+    DirectX::XMFLOAT3 Center{0.0f, 0.0f, 0.0f};
+    float Radius = 0.0f;
+};
+
+struct PayloadStreamingStats
+{
+    size_t NumPayloads = 0;   // Known payloads, grows as nested payloads are discovered.
+    size_t NumResident = 0;
+    size_t ResidentBytes = 0;
+    size_t BudgetBytes = 0;
+    size_t NumLoads = 0;      // Total loads and evictions since the scene was opened.
+    size_t NumEvictions = 0;
+};
+
+// Brings payloads in on a background thread, largest on screen first, and evicts the smallest on screen once the
+// resident geometry goes over the memory budget. The worker only decides and loads, eviction is a handshake:
+// TakeEvictions() hands the ids to the main thread, which drops their render data and then calls ConfirmEvictions()
+// so the worker can unload them from the stage.
+class PayloadStreamer
+{
+public:
+    // Run on the worker. Loads one payload, returns its resident bytes and any payloads nested below it.
+    using LoadFunction = std::function<size_t(uint32_t Id, const pxr::SdfPath& Path, std::vector<PayloadBounds>& OutNested)>;
+    using UnloadFunction = std::function<void(const std::vector<pxr::SdfPath>& Paths)>;
+
+    PayloadStreamer(size_t InBudgetBytes, LoadFunction InLoad, UnloadFunction InUnload);
+    ~PayloadStreamer();
+
+    void AddPayloads(const std::vector<PayloadBounds>& Payloads);
+    void Start();
+    void Stop();
+
+    // Main thread.
+    void SetView(const DirectX::XMFLOAT3& Position, const DirectX::XMFLOAT3& Forward, float TanHalfFov);
+    std::vector<uint32_t> TakeEvictions();
+    void ConfirmEvictions(const std::vector<uint32_t>& Ids);
+    PayloadStreamingStats GetStats() const;
+
+private:
+    enum class PayloadState : uint8_t
+    {
+        Unloaded,
+        Loading,
+        Resident,
+        Evicting,
+    };
+
+    struct PayloadEntry
+    {
+        uint32_t Id = 0;
+        PayloadBounds Bounds;
+        PayloadState State = PayloadState::Unloaded;
+        size_t Bytes = 0;
+        bool bDiscard = false; // Nested below an evicted payload, rediscovered when its parent loads again.
+    };
+
+    void WorkerLoop();
+    void AddPayloadsLocked(const std::vector<PayloadBounds>& Payloads);
+    float ScorePayload(const PayloadEntry& Entry) const;
+    bool EvictFor(float Score);
+    void UnloadConfirmed(std::unique_lock<std::mutex>& Lock);
+
+private:
+    LoadFunction Load;
+    UnloadFunction Unload;
+
+    std::thread Worker;
+    mutable std::mutex Mutex;
+    std::condition_variable WakeUp;
+    bool bRunning = false;
+
+    std::vector<PayloadEntry> Entries;
+    uint32_t NextId = 1; // Zero is the part of the scene outside any payload.
+    std::vector<uint32_t> PendingEvictions;
+    std::vector<uint32_t> ConfirmedEvictions;
+
+    // Camera snapshot from the main thread.
+    DirectX::XMFLOAT3 ViewPosition{0.0f, 0.0f, 0.0f};
+    DirectX::XMFLOAT3 ViewForward{0.0f, 0.0f, 1.0f};
+    float ViewTanHalfFov = 1.0f;
+
+    PayloadStreamingStats Stats;
+};
@@ -0,0 +1,134 @@
+#include "PointInstancer.h"
+
+#include <algorithm>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+using namespace pxr;
+using namespace DirectX;
+
+namespace
+{
+    // Instances per parallel task, also the granularity of the per chunk prototype histograms.
+    constexpr size_t ChunkSize = 16 * 1024;
+
+    size_t GetNumChunks(size_t NumInstances) { return (NumInstances + ChunkSize - 1) / ChunkSize; }
+}
+
+bool PointInstanceArrays::Read(const UsdGeomPointInstancer& Instancer, UsdTimeCode Time)
+{
+    Instancer.GetProtoIndicesAttr().Get(&ProtoIndices, Time);
+    Instancer.GetPositionsAttr().Get(&Positions, Time);
+    Instancer.GetOrientationsAttr().Get(&Orientations, Time);
+    Instancer.GetScalesAttr().Get(&Scales, Time);
+    Mask = Instancer.ComputeMaskAtTime(Time);
+
+    // Optional arrays have to match the instance count to be used.
+    const size_t NumInstances = ProtoIndices.size();
+    if (Orientations.size() != NumInstances) { Orientations.clear(); }
+    if (Scales.size() != NumInstances) { Scales.clear(); }
+    if (Mask.size() != NumInstances) { Mask.clear(); }
+    
+    return Positions.size() == NumInstances;
+}
+
+bool PointInstanceArrays::MightBeTimeVarying(const UsdGeomPointInstancer& Instancer)
+{
+    return Instancer.GetProtoIndicesAttr().ValueMightBeTimeVarying()
+        || Instancer.GetPositionsAttr().ValueMightBeTimeVarying()
+        || Instancer.GetOrientationsAttr().ValueMightBeTimeVarying()
+        || Instancer.GetScalesAttr().ValueMightBeTimeVarying();
+}
+
+void PointInstancing::CountInstances(const PointInstanceArrays& Arrays, size_t NumPrototypes, std::vector<uint32_t>& OutCounts)
+{
+    OutCounts.assign(NumPrototypes, 0);
+    for (size_t Idx = 0; Idx < Arrays.GetNumInstances(); Idx++)
+    {
+        if (Arrays.IsDrawn(Idx, NumPrototypes)) { OutCounts[Arrays.ProtoIndices[Idx]]++; }
+    }
+}
+
+void PointInstancing::BuildSortedTransforms(const PointInstanceArrays& Arrays, size_t NumPrototypes, bool bIsYUp,
+    const XMFLOAT4X4& InstancerWorld, SortedInstanceTransforms& Out)
+{
+    const size_t NumInstances = Arrays.GetNumInstances();
+    const size_t NumChunks = GetNumChunks(NumInstances);
+
+    // Pass 1: prototype histogram of every chunk.
+    std::vector<uint32_t> ChunkOffsets(NumChunks * NumPrototypes, 0);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, NumChunks, 1),
+        [&](const tbb::blocked_range<size_t>& Range)
+        {
+            for (size_t Chunk = Range.begin(); Chunk != Range.end(); ++Chunk)
+            {
+                uint32_t* Counts = &ChunkOffsets[Chunk * NumPrototypes];
+                const size_t End = std::min(NumInstances, (Chunk + 1) * ChunkSize);
+                for (size_t Idx = Chunk * ChunkSize; Idx < End; Idx++)
+                {
+                    if (Arrays.IsDrawn(Idx, NumPrototypes)) { Counts[Arrays.ProtoIndices[Idx]]++; }
+                }
+            }
+        });
+
+    // Prototype major exclusive prefix sum, each chunk gets its own contiguous rows inside every prototype.
+    Out.PrototypeOffsets.assign(NumPrototypes + 1, 0);
+    uint32_t Running = 0;
+    for (size_t Proto = 0; Proto < NumPrototypes; Proto++)
+    {
+        Out.PrototypeOffsets[Proto] = Running;
+        for (size_t Chunk = 0; Chunk < NumChunks; Chunk++)
+        {
+            const uint32_t Count = ChunkOffsets[Chunk * NumPrototypes + Proto];
+            ChunkOffsets[Chunk * NumPrototypes + Proto] = Running;
+            Running += Count;
+        }
+    }
+    Out.PrototypeOffsets[NumPrototypes] = Running;
+    Out.Transforms.resize(Running);
+
+    // Pass 2: build the matrices straight into their sorted rows.
+    const XMMATRIX World = XMLoadFloat4x4(&InstancerWorld);
+    const bool bHasOrientations = !Arrays.Orientations.empty();
+    const bool bHasScales = !Arrays.Scales.empty();
+    
+    // Z up stages swap Y and Z, for a rotation that mirror also flips the angle: (x, y, z, w) -> (-x, -z, -y, w).
+    const XMVECTOR QuatMirror = XMVectorSet(-1.0f, -1.0f, -1.0f, 1.0f);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, NumChunks, 1),
+        [&](const tbb::blocked_range<size_t>& Range)
+        {
+            for (size_t Chunk = Range.begin(); Chunk != Range.end(); ++Chunk)
+            {
+                uint32_t* Cursors = &ChunkOffsets[Chunk * NumPrototypes];
+                const size_t End = std::min(NumInstances, (Chunk + 1) * ChunkSize);
+                for (size_t Idx = Chunk * ChunkSize; Idx < End; Idx++)
+                {
+                    if (!Arrays.IsDrawn(Idx, NumPrototypes)) { continue; }
+
+                    XMVECTOR Translation = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(Arrays.Positions[Idx].data()));
+                    XMVECTOR Scale = bHasScales ? XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(Arrays.Scales[Idx].data())) : XMVectorSplatOne();
+                    XMVECTOR Rotation = XMQuaternionIdentity();
+                    if (bHasOrientations)
+                    {
+                        const GfQuath& Quat = Arrays.Orientations[Idx];
+                        const GfVec3h& Im = Quat.GetImaginary();
+                        Rotation = XMQuaternionNormalize(XMVectorSet(Im[0], Im[1], Im[2], Quat.GetReal()));
+                    }
+
+                    if (!bIsYUp)
+                    {
+                        Translation = XMVectorSwizzle<0, 2, 1, 3>(Translation);
+                        Scale = XMVectorSwizzle<0, 2, 1, 3>(Scale);
+                        Rotation = XMVectorMultiply(XMVectorSwizzle<0, 2, 1, 3>(Rotation), QuatMirror);
+                    }
+
+                    const XMMATRIX Local = XMMatrixAffineTransformation(Scale, XMVectorZero(), Rotation, Translation);
+                    const uint32_t Row = Cursors[Arrays.ProtoIndices[Idx]]++;
+                    XMStoreFloat4x4(&Out.Transforms[Row], XMMatrixMultiply(Local, World));
+                }
+            }
+        });
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+
+// Usd
+#include "pxr/base/gf/quath.h"
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/base/vt/array.h"
+#include "pxr/usd/usdGeom/pointInstancer.h"
+
+// Per instance arrays of a UsdGeomPointInstancer at one time code, read in bulk.
+struct PointInstanceArrays
+{
+    pxr::VtArray<int> ProtoIndices;
+    pxr::VtArray<pxr::GfVec3f> Positions;
+    pxr::VtArray<pxr::GfQuath> Orientations; // Optional, identity when empty.
+    pxr::VtArray<pxr::GfVec3f> Scales;       // Optional, unit scale when empty.
+    std::vector<bool> Mask;                  // Optional, false for invisible or inactive ids.
+
+    bool Read(const pxr::UsdGeomPointInstancer& Instancer, pxr::UsdTimeCode Time);
+    static bool MightBeTimeVarying(const pxr::UsdGeomPointInstancer& Instancer);
+
+    size_t GetNumInstances() const { return ProtoIndices.size(); }
+    bool IsDrawn(size_t Idx, size_t NumPrototypes) const
+    {
+        const int ProtoIdx = ProtoIndices[Idx];
+        return ProtoIdx >= 0 && static_cast<size_t>(ProtoIdx) < NumPrototypes && (Mask.empty() || Mask[Idx]);
+    }
+};
+
+// Instance matrices sorted by prototype, prototype P owns rows [PrototypeOffsets[P], PrototypeOffsets[P + 1]).
+struct SortedInstanceTransforms
+{
+    std::vector<DirectX::XMFLOAT4X4> Transforms;
+    std::vector<uint32_t> PrototypeOffsets;
+};
+
+namespace PointInstancing
+{
+    // Number of drawn instances of each prototype.
+    void CountInstances(const PointInstanceArrays& Arrays, size_t NumPrototypes, std::vector<uint32_t>& OutCounts);
+
+    // Converts every drawn instance to a render space Scale * Rotation * Translation * InstancerWorld matrix.
+    // Runs in parallel chunks with a stable counting sort, so the output order only depends on the input.
+    void BuildSortedTransforms(const PointInstanceArrays& Arrays, size_t NumPrototypes, bool bIsYUp,
+        const DirectX::XMFLOAT4X4& InstancerWorld, SortedInstanceTransforms& Out);
+}
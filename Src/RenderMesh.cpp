@@ -1,5 +1,12 @@
 #include "RenderMesh.h"
+#include "MeshTriangulator.h"
+#include "VertexQuantisation.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <cstring>
 #include <iostream>
 
 #include "pxr/usd/usd/stage.h"
@@ -9,7 +16,7 @@
 #include "pxr/usd/usd/primRange.h"
 #include "pxr/usd/usd/tokens.h"
 #include "pxr/usd/usdGeom/primvarsAPI.h"
-#include "pxr/usdImaging/usdImaging/meshAdapter.h"
+#include "pxr/imaging/pxOsd/tokens.h"
 #include "pxr/imaging/hd/meshUtil.h"
 #include "pxr/imaging/hd/bufferSource.h"
 #include "pxr/imaging/hd/bufferArray.h"
@@ -23,6 +30,80 @@ using namespace pxr;
 namespace 
 {
     char const* TokenAttrUVs = "primvars:st";
+
+    // How a primvar maps onto the face vertices, from its authored interpolation. Varying reads like vertex on a mesh.
+    enum class PrimvarLayout { None, FaceVarying, Vertex, Uniform, Constant };
+
+    // None when the primvar is missing or has fewer elements than its interpolation needs, it is then left out of the mesh.
+    PrimvarLayout GetPrimvarLayout(size_t NumElements, const TfToken& Interpolation, const MeshSourceArrays& Source)
+    {
+        if (NumElements == 0) { return PrimvarLayout::None; }
+        if (Interpolation == UsdGeomTokens->faceVarying)
+        {
+            return NumElements >= Source.FaceVertexIndices.size() ? PrimvarLayout::FaceVarying : PrimvarLayout::None;
+        }
+        if (Interpolation == UsdGeomTokens->uniform)
+        {
+            return NumElements >= Source.FaceVertexCounts.size() ? PrimvarLayout::Uniform : PrimvarLayout::None;
+        }
+        if (Interpolation == UsdGeomTokens->constant) { return PrimvarLayout::Constant; }
+        return NumElements >= Source.Points.size() ? PrimvarLayout::Vertex : PrimvarLayout::None;
+    }
+
+    // One value per corner of the triangles HdMeshUtil made. Face varying primvars are triangulated by HdMeshUtil, the others are
+    // read through the corner's point or the coarse face the triangle came from.
+    template <typename T>
+    VtArray<T> TriangulatePrimvar(HdMeshUtil& MeshUtil, const VtVec3iArray& Triangles, const VtIntArray& FaceParams, const VtArray<T>& Values,
+        PrimvarLayout Layout)
+    {
+        VtArray<T> Out;
+        if (Layout == PrimvarLayout::None) { return Out; }
+        if (Layout == PrimvarLayout::FaceVarying)
+        {
+            HdVtBufferSource Buffer(TfToken("TempPrimvar"), VtValue(Values));
+            VtValue OutValue;
+            if (MeshUtil.ComputeTriangulatedFaceVaryingPrimvar(Buffer.GetData(), static_cast<int>(Buffer.GetNumElements()), Buffer.GetTupleType().type, &OutValue)
+                && OutValue.IsHolding<VtArray<T>>())
+            {
+                Out = OutValue.UncheckedGet<VtArray<T>>();
+            }
+            return Out;
+        }
+
+        Out.reserve(Triangles.size() * 3);
+        for (size_t Tri = 0; Tri < Triangles.size(); Tri++)
+        {
+            const int Face = HdMeshUtil::DecodeFaceIndexFromCoarseFaceParam(FaceParams[Tri]);
+            for (int Idx = 0; Idx < 3; Idx++)
+            {
+                const size_t Element = Layout == PrimvarLayout::Vertex ? static_cast<size_t>(Triangles[Tri][Idx])
+                    : Layout == PrimvarLayout::Uniform ? static_cast<size_t>(Face) : 0;
+                Out.push_back(Values[Element]);
+            }
+        }
+        return Out;
+    }
+
+    // Mix 32 bits into a running 64 bit hash.
+    uint64_t HashBits(uint64_t Hash, uint32_t Bits)
+    {
+        Hash ^= Bits;
+        Hash *= 0x9E3779B97F4A7C15ull;
+        Hash ^= Hash >> 29;
+        return Hash;
+    }
+
+    // Hash the raw bits of a float tuple into a running 64 bit hash.
+    uint64_t HashFloats(uint64_t Hash, const float* Values, size_t Count)
+    {
+        for (size_t Idx = 0; Idx < Count; Idx++)
+        {
+            uint32_t Bits;
+            memcpy(&Bits, &Values[Idx], sizeof(Bits));
+            Hash = HashBits(Hash, Bits);
+        }
+        return Hash;
+    }
 }
 
 DirectX::XMFLOAT3 MeshData::VectorToRenderSpace(bool bIsYUp, size_t Idx, std::vector<DirectX::XMFLOAT3>& Data)
@@ -63,7 +144,255 @@ void MeshData::GenerateVertexColour()
     }
 }
 
-void MeshData::ProcessVertices(bool bIsYUp)
+void MeshData::WeldVertices()
+{
+    // Corners arrive unrolled, three per triangle. Collapse corners with identical attribute tuples into one vertex.
+    const size_t NumCorners = Positions.size();
+    const bool bHasNormals = Normals.size() == NumCorners;
+    const bool bHasUVs = UVs.size() == NumCorners;
+    const bool bHasColours = Colours.size() == NumCorners;
+    const bool bHasPointSources = CornerPoints.size() == NumCorners;
+    const bool bHasNormalSources = CornerNormals.size() == NumCorners;
+
+    NumSourceVertices = NumCorners;
+    NumDegenerateTriangles = 0;
+
+    const auto HashCorner = [&](size_t Corner) -> uint64_t
+    {
+        uint64_t Hash = 0;
+        Hash = HashFloats(Hash, &Positions[Corner].x, 3);
+        if (bHasNormals) { Hash = HashFloats(Hash, &Normals[Corner].x, 3); }
+        if (bHasUVs) { Hash = HashFloats(Hash, &UVs[Corner].x, 2); }
+        if (bHasColours) { Hash = HashFloats(Hash, &Colours[Corner].x, 4); }
+        if (bHasPointSources) { Hash = HashBits(Hash, CornerPoints[Corner]); }
+        if (bHasNormalSources) { Hash = HashBits(Hash, CornerNormals[Corner]); }
+        return Hash;
+    };
+    
+    // Bitwise compare, so we never merge vertices the GPU would see as different.
+    const auto CornersEqual = [&](size_t A, size_t B) -> bool
+    {
+        if (memcmp(&Positions[A], &Positions[B], sizeof(DirectX::XMFLOAT3)) != 0) { return false; }
+        if (bHasNormals && memcmp(&Normals[A], &Normals[B], sizeof(DirectX::XMFLOAT3)) != 0) { return false; }
+        if (bHasUVs && memcmp(&UVs[A], &UVs[B], sizeof(DirectX::XMFLOAT2)) != 0) { return false; }
+        if (bHasColours && memcmp(&Colours[A], &Colours[B], sizeof(DirectX::XMFLOAT4)) != 0) { return false; }
+        if (bHasPointSources && CornerPoints[A] != CornerPoints[B]) { return false; }
+        if (bHasNormalSources && CornerNormals[A] != CornerNormals[B]) { return false; }
+        return true;
+    };
+
+    // Open addressing table of unique vertex ids, kept at most half full.
+    size_t TableSize = 1;
+    while (TableSize < NumCorners * 2) { TableSize <<= 1; }
+    const size_t TableMask = TableSize - 1;
+    constexpr uint32_t EmptySlot = UINT32_MAX;
+    std::vector<uint32_t> Table(TableSize, EmptySlot);
+    
+    std::vector<uint32_t> UniqueCorners; // Source corner of each unique vertex.
+    std::vector<uint32_t> CornerToVertex(NumCorners);
+    UniqueCorners.reserve(NumCorners);
+    
+    for (size_t Corner = 0; Corner < NumCorners; Corner++)
+    {
+        size_t Slot = HashCorner(Corner) & TableMask;
+        while (Table[Slot] != EmptySlot && !CornersEqual(UniqueCorners[Table[Slot]], Corner))
+        {
+            Slot = (Slot + 1) & TableMask;
+        }
+
+        if (Table[Slot] == EmptySlot)
+        {
+            Table[Slot] = static_cast<uint32_t>(UniqueCorners.size());
+            UniqueCorners.push_back(static_cast<uint32_t>(Corner));
+        }
+        CornerToVertex[Corner] = Table[Slot];
+    }
+
+    // Compact in place, unique corners are found in increasing order so a source is never overwritten before it is read.
+    const size_t NumUnique = UniqueCorners.size();
+    for (size_t Idx = 0; Idx < NumUnique; Idx++)
+    {
+        const uint32_t Src = UniqueCorners[Idx];
+        Positions[Idx] = Positions[Src];
+        if (bHasNormals) { Normals[Idx] = Normals[Src]; }
+        if (bHasUVs) { UVs[Idx] = UVs[Src]; }
+        if (bHasColours) { Colours[Idx] = Colours[Src]; }
+        if (bHasPointSources) { CornerPoints[Idx] = CornerPoints[Src]; }
+        if (bHasNormalSources) { CornerNormals[Idx] = CornerNormals[Src]; }
+    }
+    Positions.resize(NumUnique);
+    if (bHasNormals) { Normals.resize(NumUnique); }
+    if (bHasUVs) { UVs.resize(NumUnique); }
+    if (bHasColours) { Colours.resize(NumUnique); }
+    if (bHasPointSources) { CornerPoints.resize(NumUnique); }
+    if (bHasNormalSources) { CornerNormals.resize(NumUnique); }
+
+    // Emit the index buffer, skipping zero area triangles.
+    Indices.clear();
+    Indices.reserve(NumCorners);
+    for (size_t Corner = 0; Corner + 2 < NumCorners; Corner += 3)
+    {
+        const uint32_t A = CornerToVertex[Corner];
+        const uint32_t B = CornerToVertex[Corner + 1];
+        const uint32_t C = CornerToVertex[Corner + 2];
+        
+        // Points that coincide now may move apart in a later frame, deforming meshes only drop triangles by index.
+        const bool bSharedIndex = A == B || B == C || A == C;
+        const bool bSharedPosition = !bHasPointSources && (
+            memcmp(&Positions[A], &Positions[B], sizeof(DirectX::XMFLOAT3)) == 0 ||
+            memcmp(&Positions[B], &Positions[C], sizeof(DirectX::XMFLOAT3)) == 0 ||
+            memcmp(&Positions[A], &Positions[C], sizeof(DirectX::XMFLOAT3)) == 0);
+        if (bSharedIndex || bSharedPosition)
+        {
+            NumDegenerateTriangles++;
+            continue;
+        }
+        
+        Indices.push_back(A);
+        Indices.push_back(B);
+        Indices.push_back(C);
+    }
+}
+
+void MeshData::OptimiseIndexOrder()
+{
+    // Triangle order first for the post-transform cache, then clusters of it for overdraw, then vertices to match the final order.
+    CacheStatsBefore = MeshOptimiser::AnalyseVertexCache(Indices, Positions.size());
+    MeshOptimiser::OptimiseVertexCache(Indices, Positions.size());
+    MeshOptimiser::OptimiseOverdraw(Indices, Positions);
+
+    size_t NumVertices = 0;
+    const std::vector<uint32_t> Remap = MeshOptimiser::OptimiseVertexFetch(Indices, Positions.size(), NumVertices);
+    MeshOptimiser::RemapVertices(Positions, Remap, NumVertices);
+    MeshOptimiser::RemapVertices(Normals, Remap, NumVertices);
+    MeshOptimiser::RemapVertices(UVs, Remap, NumVertices);
+    MeshOptimiser::RemapVertices(Colours, Remap, NumVertices);
+    MeshOptimiser::RemapVertices(CornerPoints, Remap, NumVertices);
+    MeshOptimiser::RemapVertices(CornerNormals, Remap, NumVertices);
+
+    CacheStatsAfter = MeshOptimiser::AnalyseVertexCache(Indices, NumVertices);
+    bIndexOrderOptimised = true;
+}
+
+void MeshData::BuildMeshlets(bool bIsYUp)
+{
+    // Bounds and cones are built from the render space positions, so the cones follow the winding the rasterizer sees.
+    std::vector<DirectX::XMFLOAT3> RenderPositions(Positions.size());
+    for (size_t Idx = 0; Idx < Positions.size(); Idx++)
+    {
+        RenderPositions[Idx] = VectorToRenderSpace(bIsYUp, Idx, Positions);
+    }
+    Meshlets::Build(Indices, RenderPositions, Clusters);
+}
+
+void MeshData::GenerateLods()
+{
+    const uint32_t NumLod0Indices = static_cast<uint32_t>(Indices.size());
+    Lods.assign(1, MeshLod{ 0, NumLod0Indices, 0.0f });
+
+    // Every level is simplified from LOD0, so its error is against the full mesh instead of accumulating.
+    const std::vector<uint32_t> Lod0(Indices);
+    std::vector<uint32_t> Simplified;
+    while (Lods.size() < MaxMeshLods)
+    {
+        const MeshLod Previous = Lods.back();
+        const size_t TargetIndices = static_cast<size_t>(Previous.NumIndices / 3 * MeshSimplifier::LodReduction) * 3;
+        if (TargetIndices / 3 < MeshSimplifier::MinLodTriangles) { break; }
+
+        const float Error = MeshSimplifier::Simplify(Lod0, Positions, TargetIndices, Simplified);
+
+        // Locked borders and seams can stop the mesh getting meaningfully smaller, more levels would only cost memory.
+        if (Simplified.size() * 4 > static_cast<size_t>(Previous.NumIndices) * 3) { break; }
+
+        MeshOptimiser::OptimiseVertexCache(Simplified, Positions.size());
+        Lods.push_back(MeshLod{ static_cast<uint32_t>(Indices.size()), static_cast<uint32_t>(Simplified.size()), std::max(Error, Previous.Error) });
+        Indices.insert(Indices.end(), Simplified.begin(), Simplified.end());
+    }
+}
+
+void MeshData::SetCooked(std::shared_ptr<const MeshCacheFile> File, const MeshCacheFormat::FileEntry& Entry)
+{
+    CookedFile = std::move(File);
+    CookedVertices = CookedFile->GetData(Entry.VertexOffset);
+    CookedIndices = CookedFile->GetData(Entry.IndexOffset);
+    NumCookedVertices = Entry.NumVertices;
+    NumCookedIndices = Entry.NumIndices;
+    NumSourceVertices = Entry.NumSourceVertices;
+    NumDegenerateTriangles = Entry.NumDegenerateTriangles;
+    Format = static_cast<VertexFormat>(Entry.Format);
+    Dequantisation.Scale = DirectX::XMFLOAT4(Entry.PositionScale[0], Entry.PositionScale[1], Entry.PositionScale[2], 0.0f);
+    Dequantisation.Offset = DirectX::XMFLOAT4(Entry.PositionOffset[0], Entry.PositionOffset[1], Entry.PositionOffset[2], 0.0f);
+
+    // The meshlet table is small next to the buffers, copied out so it can be used like a built one.
+    const uint8_t* MeshletBlob = CookedFile->GetData(Entry.MeshletOffset);
+    const auto CopyBlob = [&MeshletBlob](auto& Dest, size_t Count)
+    {
+        Dest.resize(Count);
+        memcpy(Dest.data(), MeshletBlob, Count * sizeof(Dest[0]));
+        MeshletBlob += Count * sizeof(Dest[0]);
+    };
+    CopyBlob(Clusters.Meshlets, Entry.NumMeshlets);
+    CopyBlob(Clusters.Bounds, Entry.NumMeshlets);
+    CopyBlob(Clusters.VertexIndices, Entry.NumMeshletVertices);
+    CopyBlob(Clusters.Triangles, Entry.NumMeshletTriangles * 3);
+
+    BoundsCenter = DirectX::XMFLOAT3(Entry.BoundsCenter[0], Entry.BoundsCenter[1], Entry.BoundsCenter[2]);
+    BoundsRadius = Entry.BoundsRadius;
+    BoundsExtents = DirectX::XMFLOAT3(Entry.BoundsExtents[0], Entry.BoundsExtents[1], Entry.BoundsExtents[2]);
+    Lods.assign(Entry.Lods, Entry.Lods + Entry.NumLods);
+
+    const uint8_t* OccluderBlob = CookedFile->GetData(Entry.OccluderOffset);
+    Occluder.Positions.resize(Entry.NumOccluderVertices);
+    Occluder.Indices.resize(Entry.NumOccluderIndices);
+    memcpy(Occluder.Positions.data(), OccluderBlob, Occluder.Positions.size() * sizeof(DirectX::XMFLOAT3));
+    memcpy(Occluder.Indices.data(), OccluderBlob + Occluder.Positions.size() * sizeof(DirectX::XMFLOAT3), Occluder.Indices.size() * sizeof(uint32_t));
+}
+
+size_t MeshData::GetNumVertices() const
+{
+    if (IsCooked()) { return NumCookedVertices; }
+    return Format == VertexFormat::Float ? Vertices.size() : QuantisedVertices.size();
+}
+
+const void* MeshData::GetVertexData() const
+{
+    if (IsCooked()) { return CookedVertices; }
+    return Format == VertexFormat::Float ? static_cast<const void*>(Vertices.data()) : static_cast<const void*>(QuantisedVertices.data());
+}
+
+void MeshData::CopyIndices(void* Dest) const
+{
+    if (IsCooked())
+    {
+        // Cooked indices are already in the upload format.
+        memcpy(Dest, CookedIndices, GetIndexBufferSize());
+    }
+    else if (Uses16BitIndices())
+    {
+        uint16_t* Dest16 = static_cast<uint16_t*>(Dest);
+        for (size_t Idx = 0; Idx < Indices.size(); Idx++)
+        {
+            Dest16[Idx] = static_cast<uint16_t>(Indices[Idx]);
+        }
+    }
+    else
+    {
+        memcpy(Dest, Indices.data(), Indices.size() * sizeof(uint32_t));
+    }
+}
+
+bool MeshData::HasSameIndices(const MeshData& Other) const
+{
+    if (GetNumIndices() == 0 || GetNumIndices() != Other.GetNumIndices() || Uses16BitIndices() != Other.Uses16BitIndices()) { return false; }
+
+    std::vector<uint8_t> Indices(GetIndexBufferSize());
+    std::vector<uint8_t> OtherIndices(Other.GetIndexBufferSize());
+    CopyIndices(Indices.data());
+    Other.CopyIndices(OtherIndices.data());
+    return Indices == OtherIndices;
+}
+
+void MeshData::ProcessVertices(bool bIsYUp, VertexFormat InFormat)
 {
     if (Colours.empty()){ GenerateVertexColour(); }
     
@@ -78,17 +407,66 @@ void MeshData::ProcessVertices(bool bIsYUp)
         Vtx.Colour = Colours[Idx];
         Vertices.emplace_back(Vtx);
     }
+
+    // A mesh without simplified levels draws all of its indices as LOD0.
+    if (Lods.empty()) { Lods.push_back(MeshLod{ 0, static_cast<uint32_t>(Indices.size()), 0.0f }); }
+
+    // Render space box, with a sphere around its centre.
+    DirectX::XMFLOAT3 Min(FLT_MAX, FLT_MAX, FLT_MAX);
+    DirectX::XMFLOAT3 Max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (const Vertex& Vtx : Vertices)
+    {
+        Min = DirectX::XMFLOAT3(std::min(Min.x, Vtx.Position.x), std::min(Min.y, Vtx.Position.y), std::min(Min.z, Vtx.Position.z));
+        Max = DirectX::XMFLOAT3(std::max(Max.x, Vtx.Position.x), std::max(Max.y, Vtx.Position.y), std::max(Max.z, Vtx.Position.z));
+    }
+    BoundsCenter = DirectX::XMFLOAT3((Min.x + Max.x) * 0.5f, (Min.y + Max.y) * 0.5f, (Min.z + Max.z) * 0.5f);
+    BoundsExtents = DirectX::XMFLOAT3((Max.x - Min.x) * 0.5f, (Max.y - Min.y) * 0.5f, (Max.z - Min.z) * 0.5f);
+    BoundsRadius = 0.0f;
+    for (const Vertex& Vtx : Vertices)
+    {
+        const float Dx = Vtx.Position.x - BoundsCenter.x, Dy = Vtx.Position.y - BoundsCenter.y, Dz = Vtx.Position.z - BoundsCenter.z;
+        BoundsRadius = std::max(BoundsRadius, std::sqrt(Dx * Dx + Dy * Dy + Dz * Dz));
+    }
+    if (Vertices.empty())
+    {
+        BoundsCenter = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+        BoundsExtents = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    }
+
+    // Compact formats replace the float vertices, only the encoded copy is kept for upload.
+    Format = VertexFormat::Float;
+    Dequantisation = PositionDequantisation();
+    if (InFormat != VertexFormat::Float)
+    {
+        Format = VertexQuantisation::Encode(Vertices, InFormat, QuantisedVertices, Dequantisation);
+        std::vector<Vertex>().swap(Vertices);
+    }
 }
 
-RenderMesh::RenderMesh(const USDScene* InReader)
+void MeshData::BuildOccluder(bool bIsYUp)
 {
-    if (InReader == nullptr)
+    // Coarsest level whose error is too small to hide anything the full mesh would not.
+    const MeshLod* OccluderLod = nullptr;
+    for (const MeshLod& Lod : Lods)
     {
-        std::cerr << "Error in USDReader::RenderMesh, In Reader is nullptr" << std::endl;
-        return;
+        if (Lod.Error <= OcclusionCulling::MaxOccluderRelativeError * BoundsRadius) { OccluderLod = &Lod; }
     }
 
-    Reader = InReader;
+    Occluder = OccluderMesh();
+    if (!OccluderLod || OccluderLod->NumIndices / 3 > OcclusionCulling::MaxOccluderTriangles) { return; }
+
+    std::vector<DirectX::XMFLOAT3> RenderPositions(Positions.size());
+    for (size_t Idx = 0; Idx < Positions.size(); Idx++)
+    {
+        RenderPositions[Idx] = VectorToRenderSpace(bIsYUp, Idx, Positions);
+    }
+    Occluder.Build(Indices.data() + OccluderLod->FirstIndex, OccluderLod->NumIndices, RenderPositions);
+}
+
+RenderMesh::RenderMesh(const MeshBuildSettings& InSettings, std::shared_ptr<const MeshCacheFile> InCookedMeshes)
+    : Settings(InSettings)
+    , CookedMeshes(std::move(InCookedMeshes))
+{
 }
 
 bool RenderMesh::ValidatePrim(UsdPrim& Mesh)
@@ -114,10 +492,111 @@ void RenderMesh::Load(UsdPrim& InMesh)
     Mesh = InMesh;
     SharedMeshData = std::make_shared<MeshData>();
 
-    TriangulateUsdGeometry();
+    // The hash of the source data is the cooked cache key, a hit skips triangulation and vertex processing entirely.
+    // Deforming meshes never use the cache, their vertices are rewritten every frame.
+    MeshSourceArrays Source;
+    ReadSourceArrays(Source);
+    SourceHash = Source.Hash(Settings);
+    std::shared_ptr<MeshDeformer> Deformer = MeshDeformer::IsDeforming(Mesh) ? std::make_shared<MeshDeformer>(Mesh, Settings.bIsYUp) : nullptr;
+    if (CookedMeshes && !Deformer)
+    {
+        if (const MeshCacheFormat::FileEntry* Entry = CookedMeshes->Find(SourceHash))
+        {
+            SharedMeshData->SetCooked(CookedMeshes, *Entry);
+            return;
+        }
+    }
+
+    BuildRenderData(Source, std::move(Deformer));
+}
+
+void RenderMesh::LoadFromHydra(const UsdPrim& InMesh, const SdfPath& Id, const MeshSourceArrays& Source)
+{
+    if (Source.Points.empty() || Source.FaceVertexIndices.empty() || Source.Normals.empty())
+    {
+        std::cout << "RenderMesh::LoadFromHydra: Rprim '" << Id << "' does not have valid data!" << "\n";
+        return;
+    }
+
+    Mesh = InMesh;
+    SharedMeshData = std::make_shared<MeshData>();
+
+    // Same source arrays as a USD load, so the cooked cache is shared between both front-ends.
+    SourceHash = Source.Hash(Settings);
+    if (CookedMeshes)
+    {
+        if (const MeshCacheFormat::FileEntry* Entry = CookedMeshes->Find(SourceHash))
+        {
+            SharedMeshData->SetCooked(CookedMeshes, *Entry);
+            return;
+        }
+    }
+
+    BuildRenderData(Source, nullptr);
+}
+
+void RenderMesh::BuildRenderData(const MeshSourceArrays& Source, std::shared_ptr<MeshDeformer> Deformer)
+{
+    TriangulateUsdGeometry(Source, Deformer.get());
+
+    if (Settings.bOptimiseIndexOrder)
+    {
+        SharedMeshData->OptimiseIndexOrder();
+    }
+    
+    // Deforming meshes get their vertex order, then play back from the vertex sources left by welding.
+    // Without a source for every vertex, e.g. normals that could not be triangulated, the mesh is built static.
+    const size_t NumVertices = SharedMeshData->Positions.size();
+    const bool bHasSources = Deformer && SharedMeshData->CornerPoints.size() == NumVertices &&
+        (!Deformer->HasVaryingNormals() || SharedMeshData->CornerNormals.size() == NumVertices);
+    if (bHasSources)
+    {
+        SharedMeshData->ProcessVertices(Settings.bIsYUp, VertexFormat::Float);
+        Deformer->SetVertexSources(std::move(SharedMeshData->CornerPoints), std::move(SharedMeshData->CornerNormals), SharedMeshData->Vertices,
+            Source.Points, Source.Normals);
+        SharedMeshData->CornerPoints.clear();
+        SharedMeshData->CornerNormals.clear();
+        SharedMeshData->Deformer = std::move(Deformer);
+        return;
+    }
+    SharedMeshData->CornerPoints.clear();
+    SharedMeshData->CornerNormals.clear();
     
+    // Meshlets follow the final index order, meshes that would be a single meshlet are culled whole anyway.
+    if (Settings.bBuildMeshlets && SharedMeshData->Indices.size() / 3 > MaxMeshletTriangles)
+    {
+        SharedMeshData->BuildMeshlets(Settings.bIsYUp);
+    }
+
+    // Simplified levels go after LOD0 in the index buffer, so they are generated once the meshlets have used it.
+    if (Settings.bGenerateLods)
+    {
+        SharedMeshData->GenerateLods();
+    }
+
     // Process data to render data.
-    SharedMeshData->ProcessVertices(Reader->IsYUp());
+    SharedMeshData->ProcessVertices(Settings.bIsYUp, Settings.Format);
+
+    // Picked from the finished LODs and bounds.
+    SharedMeshData->BuildOccluder(Settings.bIsYUp);
+}
+
+void RenderMesh::ReadSourceArrays(MeshSourceArrays& OutSource)
+{
+    // The earliest time sample, or the default value when there are none, so meshes authored only as samples still build.
+    const UsdTimeCode Time = UsdTimeCode::EarliestTime();
+    const UsdGeomMesh GeomMesh(Mesh);
+    GeomMesh.GetFaceVertexCountsAttr().Get(&OutSource.FaceVertexCounts, Time);
+    GeomMesh.GetFaceVertexIndicesAttr().Get(&OutSource.FaceVertexIndices, Time);
+    GeomMesh.GetHoleIndicesAttr().Get(&OutSource.HoleIndices, Time);
+    GeomMesh.GetOrientationAttr().Get(&OutSource.Orientation, Time);
+    GeomMesh.GetPointsAttr().Get(&OutSource.Points, Time);
+    Mesh.GetAttribute(UsdGeomTokens->normals).Get(&OutSource.Normals, Time);
+    Mesh.GetAttribute(TfToken(TokenAttrUVs)).Get(&OutSource.UVs, Time);
+
+    // Only set with the primvar, like Hydra reports it, so both front-ends hash missing primvars the same.
+    OutSource.NormalsInterpolation = OutSource.Normals.empty() ? TfToken() : GeomMesh.GetNormalsInterpolation();
+    OutSource.UVsInterpolation = OutSource.UVs.empty() ? TfToken() : UsdGeomPrimvar(Mesh.GetAttribute(TfToken(TokenAttrUVs))).GetInterpolation();
 }
 
 template <typename SrcT>
@@ -171,16 +650,63 @@ bool RenderMesh::CopyData_DXFloat4(const SrcT& SrcArray, std::vector<DirectX::XM
     return DestArray.size() == SrcArray.size();
 }
 
-void RenderMesh::TriangulateUsdGeometry()
+void RenderMesh::TriangulateUsdGeometry(const MeshSourceArrays& Source, const MeshDeformer* Deformer)
+{
+    // The triangulator gives the face vertex of every corner and the primvars are gathered straight from the source arrays. Topology
+    // it rejects and primvars that are neither face varying nor per point, e.g. uniform or constant normals, go through HdMeshUtil instead.
+    const PrimvarLayout NormalsLayout = GetPrimvarLayout(Source.Normals.size(), Source.NormalsInterpolation, Source);
+    const PrimvarLayout UVsLayout = GetPrimvarLayout(Source.UVs.size(), Source.UVsInterpolation, Source);
+    const auto IsPerFace = [](PrimvarLayout Layout) { return Layout == PrimvarLayout::Uniform || Layout == PrimvarLayout::Constant; };
+    std::vector<uint32_t> Corners;
+    if (IsPerFace(NormalsLayout) || IsPerFace(UVsLayout) || !MeshTriangulator::Triangulate(Source, Corners))
+    {
+        SharedMeshData->bTriangulatedWithMeshUtil = true;
+        TriangulateWithMeshUtil(Source, Deformer);
+    }
+    else
+    {
+        const size_t NumCorners = Corners.size();
+        const bool bNormalSources = Deformer && Deformer->HasVaryingNormals() && NormalsLayout != PrimvarLayout::None;
+        SharedMeshData->Positions.resize(NumCorners);
+        if (Deformer) { SharedMeshData->CornerPoints.resize(NumCorners); }
+        if (NormalsLayout != PrimvarLayout::None) { SharedMeshData->Normals.resize(NumCorners); }
+        if (bNormalSources) { SharedMeshData->CornerNormals.resize(NumCorners); }
+        if (UVsLayout != PrimvarLayout::None) { SharedMeshData->UVs.resize(NumCorners); }
+
+        for (size_t Idx = 0; Idx < NumCorners; Idx++)
+        {
+            const uint32_t Corner = Corners[Idx];
+            const uint32_t Point = static_cast<uint32_t>(Source.FaceVertexIndices[Corner]);
+            const GfVec3f& Pos = Source.Points[Point];
+            SharedMeshData->Positions[Idx] = DirectX::XMFLOAT3(Pos[0], Pos[1], Pos[2]);
+            if (Deformer) { SharedMeshData->CornerPoints[Idx] = Point; }
+
+            if (NormalsLayout != PrimvarLayout::None)
+            {
+                const uint32_t NormalId = NormalsLayout == PrimvarLayout::FaceVarying ? Corner : Point;
+                const GfVec3f& Normal = Source.Normals[NormalId];
+                SharedMeshData->Normals[Idx] = DirectX::XMFLOAT3(Normal[0], Normal[1], Normal[2]);
+                if (bNormalSources) { SharedMeshData->CornerNormals[Idx] = NormalId; }
+            }
+            if (UVsLayout != PrimvarLayout::None)
+            {
+                const GfVec2f& UV = Source.UVs[UVsLayout == PrimvarLayout::FaceVarying ? Corner : Point];
+                SharedMeshData->UVs[Idx] = DirectX::XMFLOAT2(UV[0], UV[1]);
+            }
+        }
+    }
+
+    // Merge identical corners into a real indexed mesh.
+    SharedMeshData->WeldVertices();
+}
+
+void RenderMesh::TriangulateWithMeshUtil(const MeshSourceArrays& Source, const MeshDeformer* Deformer)
 {
     // Use HdMeshUtil class which has triangulation algorithms, methods described here:
     // https://github.com/PixarAnimationStudios/OpenUSD/issues/329
-    // This can handle triangulation of the mesh anyway, so should use this...
-
-    // Setup triangulation tools.
-    UsdImagingMeshAdapter Adapter;
-    VtValue Topology = Adapter.GetTopology(Mesh, Mesh.GetPath(), UsdTimeCode::Default());
-    HdMeshUtil MeshUtil(&Topology.Get<HdMeshTopology>(), Mesh.GetPath());
+    // The scheme does not change the triangulation, only the arrays the topology is built from are read.
+    const HdMeshTopology Topology(PxOsdOpenSubdivTokens->none, Source.Orientation, Source.FaceVertexCounts, Source.FaceVertexIndices, Source.HoleIndices);
+    HdMeshUtil MeshUtil(&Topology, Mesh.GetPath());
 
     // Calculate new triangulation indices.
     VtVec3iArray NewIndices;
@@ -188,11 +714,9 @@ void RenderMesh::TriangulateUsdGeometry()
     MeshUtil.ComputeTriangleIndices(&NewIndices, &NewParams);
     
     // In mesh positions
-    VtArray<GfVec3f> InPositions;
-    UsdAttribute AttrPositions = Mesh.GetAttribute(UsdGeomTokens->points);
-    AttrPositions.Get<VtArray<GfVec3f>>(&InPositions);
+    const VtArray<GfVec3f>& InPositions = Source.Points;
     
-    // Unroll the positions, Our Renderer does not currently support indexed rendering. Due to USD indexing.
+    // Unroll the positions to one per triangle corner, matching the face varying primvars. WeldVertices re-indexes them.
     for (const GfVec3i& Tri : NewIndices)
     {
         for (size_t Idx = 0; Idx < 3; Idx++)
@@ -203,38 +727,27 @@ void RenderMesh::TriangulateUsdGeometry()
             OutPosition.y = static_cast<float>(Pos[1]);
             OutPosition.z = static_cast<float>(Pos[2]);
             SharedMeshData->Positions.push_back(OutPosition);
+            if (Deformer) { SharedMeshData->CornerPoints.push_back(static_cast<uint32_t>(Tri[Idx])); }
         }
     }
     
-    // Create linear indices, 0...VertNum incrementally: 0, 1, 2...
-    SharedMeshData->Indices.resize(NewIndices.size() * 3);
-    std::iota(SharedMeshData->Indices.begin(), SharedMeshData->Indices.end(), 0);
-    
-    // Triangulate the normals.
-    VtArray<GfVec3f> InNormals;
-    UsdAttribute AttrNormals = Mesh.GetAttribute(UsdGeomTokens->normals);
-    AttrNormals.Get<VtArray<GfVec3f>>(&InNormals);
-    
-    VtValue InNormalsVal(InNormals);
-    VtValue OutNormalsVal;
-    HdVtBufferSource NormalsBuffer(TfToken("TempN"), InNormalsVal);
-    MeshUtil.ComputeTriangulatedFaceVaryingPrimvar(NormalsBuffer.GetData(), static_cast<int>(NormalsBuffer.GetNumElements()), NormalsBuffer.GetTupleType().type, &OutNormalsVal);
-    VtArray<GfVec3f> TriedNrms = OutNormalsVal.Get<VtArray<GfVec3f>>();
+    // Triangulate the normals by their interpolation.
+    const PrimvarLayout NormalsLayout = GetPrimvarLayout(Source.Normals.size(), Source.NormalsInterpolation, Source);
+    const VtArray<GfVec3f> TriedNrms = TriangulatePrimvar(MeshUtil, NewIndices, NewParams, Source.Normals, NormalsLayout);
     CopyData_DXFloat3<VtArray<GfVec3f>>(TriedNrms, SharedMeshData->Normals);
 
-    // Triangulate Uvs
-    const TfToken UVToken = TfToken(TokenAttrUVs);
-    if (Mesh.HasAttribute(UVToken))
+    // The same triangulation of the normals' own indices says which source normal each corner reads, the mapping a deforming mesh replays.
+    // Static normals are welded by value as usual.
+    if (Deformer && Deformer->HasVaryingNormals() && NormalsLayout != PrimvarLayout::None)
     {
-        VtArray<GfVec2f> InUvs;
-        UsdAttribute AttrUvs = Mesh.GetAttribute(UVToken);
-        AttrUvs.Get<VtArray<GfVec2f>>(&InUvs);
-    
-        VtValue InUvsVal(InUvs);
-        VtValue OutUvsVal;
-        HdVtBufferSource UvsBuffer(TfToken("TempUvs"), InUvsVal);
-        MeshUtil.ComputeTriangulatedFaceVaryingPrimvar(UvsBuffer.GetData(), static_cast<int>(UvsBuffer.GetNumElements()), UvsBuffer.GetTupleType().type, &OutUvsVal);
-        VtArray<GfVec2f> TriedUvs = OutUvsVal.Get<VtArray<GfVec2f>>();
-        CopyData_DXFloat2<VtArray<GfVec2f>>(TriedUvs, SharedMeshData->UVs);
+        VtIntArray NormalIds(Source.Normals.size());
+        for (size_t Idx = 0; Idx < NormalIds.size(); Idx++) { NormalIds[Idx] = static_cast<int>(Idx); }
+        const VtIntArray TriedNormalIds = TriangulatePrimvar(MeshUtil, NewIndices, NewParams, NormalIds, NormalsLayout);
+        SharedMeshData->CornerNormals.assign(TriedNormalIds.begin(), TriedNormalIds.end());
     }
+
+    // Triangulate Uvs
+    const PrimvarLayout UVsLayout = GetPrimvarLayout(Source.UVs.size(), Source.UVsInterpolation, Source);
+    const VtArray<GfVec2f> TriedUvs = TriangulatePrimvar(MeshUtil, NewIndices, NewParams, Source.UVs, UVsLayout);
+    CopyData_DXFloat2<VtArray<GfVec2f>>(TriedUvs, SharedMeshData->UVs);
 }
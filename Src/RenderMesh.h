@@ -1,8 +1,14 @@
 #pragma once
 
-#include "USDScene.h"
+#include <memory>
+#include <vector>
+
 #include "pch.h"
-#include "Renderer.h"
+#include "MeshCache.h"
+#include "MeshDeformer.h"
+#include "MeshOptimiser.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
 
 // Has lots of useful accessors:
 // https://openusd.org/dev/api/class_usd_geom_point_based.html
@@ -13,19 +19,86 @@
 struct MeshData
 {
 public:
-    // Render Data
+    // Render Data, the vertices are in Vertices or QuantisedVertices depending on Format.
     std::vector<uint32_t> Indices;
     std::vector<Vertex> Vertices;
+    std::vector<QuantisedVertex> QuantisedVertices;
+    VertexFormat Format = VertexFormat::Float;
+    PositionDequantisation Dequantisation;
 
     // Import Data.
     std::vector<DirectX::XMFLOAT3> Positions;
     std::vector<DirectX::XMFLOAT3> Normals;
     std::vector<DirectX::XMFLOAT2> UVs;
     std::vector<DirectX::XMFLOAT4> Colours;
+
+    // Source point of each corner for deforming meshes, and face varying normal when the normals are time varying too. Welding also
+    // compares these so corners that merely coincide in the first frame stay apart, and leaves the sources of each vertex.
+    std::vector<uint32_t> CornerPoints;
+    std::vector<uint32_t> CornerNormals;
+
+    // Welding stats.
+    size_t NumSourceVertices = 0;
+    size_t NumDegenerateTriangles = 0;
+
+    // Set when the topology or a uniform or constant primvar sent the mesh through HdMeshUtil, never for cooked meshes.
+    bool bTriangulatedWithMeshUtil = false;
+
+    // Index order stats, only set when OptimiseIndexOrder ran.
+    bool bIndexOrderOptimised = false;
+    MeshOptimiser::VertexCacheStats CacheStatsBefore;
+    MeshOptimiser::VertexCacheStats CacheStatsAfter;
+
+    // Meshlet side table in render space, empty for meshes small enough to be a single meshlet.
+    MeshletData Clusters;
+
+    // Index ranges of the levels of detail, LOD0 first. Simplified levels follow LOD0 in Indices and share its vertices.
+    std::vector<MeshLod> Lods;
+
+    // Render space bounds, a sphere for picking a LOD from its projected error and a box around the same centre for the scene BVH.
+    DirectX::XMFLOAT3 BoundsCenter = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    float BoundsRadius = 0.0f;
+    DirectX::XMFLOAT3 BoundsExtents = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+    // Coarse LOD rasterised for occlusion culling, empty when no level is both small and close enough to the mesh.
+    OccluderMesh Occluder;
+
+    // Set when the points or normals are time sampled. Such meshes keep Float vertices and no LODs, meshlets or occluder,
+    // which would all be built from the first frame only.
+    std::shared_ptr<MeshDeformer> Deformer;
     
-    void ProcessVertices(bool bIsYUp);
+    void WeldVertices();
+    void OptimiseIndexOrder();
+    void BuildMeshlets(bool bIsYUp);
+    void GenerateLods();
+    void ProcessVertices(bool bIsYUp, VertexFormat InFormat);
+    void BuildOccluder(bool bIsYUp);
+
+    // Uses the buffers of a cooked mesh cache entry instead of Vertices and Indices, the file stays mapped while referenced.
+    void SetCooked(std::shared_ptr<const MeshCacheFile> File, const MeshCacheFormat::FileEntry& Entry);
+    bool IsCooked() const { return CookedFile != nullptr; }
+
+    // GPU buffer layout, read from the vectors or straight from the mapped cooked blobs.
+    size_t GetNumVertices() const;
+    size_t GetNumIndices() const { return IsCooked() ? NumCookedIndices : Indices.size(); }
+    const void* GetVertexData() const;
+    size_t GetVertexStride() const { return ::GetVertexStride(Format); }
+    size_t GetVertexBufferSize() const { return GetNumVertices() * GetVertexStride(); }
+
+    // Index buffer layout, the GPU copy is 16 bit whenever every vertex can be addressed with it.
+    bool Uses16BitIndices() const { return GetNumVertices() < 65536; }
+    size_t GetIndexStride() const { return Uses16BitIndices() ? sizeof(uint16_t) : sizeof(uint32_t); }
+    size_t GetIndexBufferSize() const { return GetIndexStride() * GetNumIndices(); }
+    void CopyIndices(void* Dest) const;
+    bool HasSameIndices(const MeshData& Other) const; // Same index buffer as uploaded, the vertices may differ.
 
 private:
+    std::shared_ptr<const MeshCacheFile> CookedFile;
+    const uint8_t* CookedVertices = nullptr;
+    const uint8_t* CookedIndices = nullptr;
+    size_t NumCookedVertices = 0;
+    size_t NumCookedIndices = 0;
+
     DirectX::XMFLOAT3 VectorToRenderSpace(bool bIsYUp, size_t Idx, std::vector<DirectX::XMFLOAT3>& Data);
     void GenerateVertexColour();
 };
@@ -33,13 +106,20 @@ private:
 class RenderMesh
 {
 public:
-    RenderMesh(const USDScene* InReader);
+    RenderMesh(const MeshBuildSettings& InSettings, std::shared_ptr<const MeshCacheFile> InCookedMeshes = nullptr);
     void Load(class pxr::UsdPrim& InMesh);
 
+    // Builds from the topology and primvars an HdMesh rprim synced, InMesh is the prim it came from or an invalid prim.
+    // Never deforms, an rprim whose points change is built again instead.
+    void LoadFromHydra(const pxr::UsdPrim& InMesh, const pxr::SdfPath& Id, const MeshSourceArrays& Source);
+
     std::shared_ptr<MeshData> GetMeshData() { return SharedMeshData; }
+    const pxr::UsdPrim& GetPrim() const { return Mesh; }
+    uint64_t GetSourceHash() const { return SourceHash; } // Mesh cache key of the USD data this was built from.
 
 private:
     bool ValidatePrim(pxr::UsdPrim& Mesh);
+    void ReadSourceArrays(MeshSourceArrays& OutSource);
     
     // DX Helpers to copy data of various sizes to the SharedMeshData arrays.
     template <typename SrcT>
@@ -54,10 +134,14 @@ private:
     // Helpers
     void GenerateVertexColour(std::shared_ptr<MeshData> MeshData);
 
-    void TriangulateUsdGeometry(); 
+    void BuildRenderData(const MeshSourceArrays& Source, std::shared_ptr<MeshDeformer> Deformer);
+    void TriangulateUsdGeometry(const MeshSourceArrays& Source, const MeshDeformer* Deformer);
+    void TriangulateWithMeshUtil(const MeshSourceArrays& Source, const MeshDeformer* Deformer);
     
 private:
-    const USDScene* Reader = nullptr;
+    MeshBuildSettings Settings;
+    std::shared_ptr<const MeshCacheFile> CookedMeshes;
+    uint64_t SourceHash = 0;
     pxr::UsdPrim Mesh;
     std::shared_ptr<MeshData> SharedMeshData;
 };
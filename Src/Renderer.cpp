@@ -260,12 +260,19 @@ bool Renderer::SetupMeshRootSignature()
     RtvDescRanges[0].OffsetInDescriptorsFromTableStart = 0;
     RtvDescRanges[0].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
 
-    D3D12_ROOT_PARAMETER1 RootParam[1] = {};
+    D3D12_ROOT_PARAMETER1 RootParam[2] = {};
     RootParam[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
     RootParam[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
     RootParam[0].DescriptorTable.NumDescriptorRanges = _countof(RtvDescRanges);
     RootParam[0].DescriptorTable.pDescriptorRanges = RtvDescRanges;
 
+    // Per mesh position decode, set as root constants before each draw.
+    RootParam[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    RootParam[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+    RootParam[1].Constants.ShaderRegister = 1;
+    RootParam[1].Constants.RegisterSpace = 0;
+    RootParam[1].Constants.Num32BitValues = sizeof(PositionDequantisation) / sizeof(uint32_t);
+
     D3D12_VERSIONED_ROOT_SIGNATURE_DESC RootSignatureDesc = {};
     RootSignatureDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
     RootSignatureDesc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
@@ -591,14 +598,36 @@ void Renderer::Update()
 {
     nvtx3::scoped_range r("Update Tick");
 
-    // Using Left handed coordinate systems, but matrices need to be transposed for hlsl.
-    XMMATRIX Model = DirectX::XMMatrixIdentity();
-    XMMATRIX Rot = DirectX::XMMatrixRotationY(static_cast<float>(G_MainWindow->GetTime()));
-    WVP.ModelMatrix = DirectX::XMMatrixMultiply(Model, Rot);
-    WVP.ModelMatrix = DirectX::XMMatrixTranspose(WVP.ModelMatrix);
-
+    // Model matrices come from the scene's world transforms, per mesh in the StaticMeshPipeline.
     std::shared_ptr<Camera> Cam = G_MainWindow->Scene.get()->GetCamera();
     Cam->UpdateWVP(WVP);
+
+    if (G_MainWindow->Scene->UsesHydra())
+    {
+        // Hydra tracks stage edits and time varying data itself, one sync of the dirty rprims applies both.
+        SMPipe->ApplyStreamingUpdate(G_MainWindow->Scene->UpdateHydra(G_MainWindow->GetDeltaTime()));
+    }
+    else
+    {
+        // Edits made to the stage since the last frame, only the edited rows and meshes are uploaded again.
+        SMPipe->ApplyStreamingUpdate(G_MainWindow->Scene->UpdateStageEdits());
+
+        // Streamed payloads that finished loading or were evicted since the last frame.
+        SMPipe->ApplyStreamingUpdate(G_MainWindow->Scene->UpdateStreaming());
+
+        // Time varying transforms at the timeline's current time code, only the rows that moved are copied and refitted.
+        if (G_MainWindow->Scene->UpdateAnimation(G_MainWindow->GetDeltaTime()))
+        {
+            SMPipe->UpdateAnimatedTransforms();
+        }
+    }
+    SMPipe->UpdateDeformedMeshes();
+
+    // Frustum culling in the selected cull mode, the flat SoA SIMD kernel by default or the instance BVH, then a level of detail per
+    // visible mesh and the order they are recorded in.
+    SMPipe->CullMeshes(*Cam);
+    SMPipe->SelectLods(*Cam);
+    SMPipe->BuildDrawPackets(*Cam);
     
     // Update constant buffer.
     SMPipe->Update(WVP);
@@ -621,6 +650,9 @@ void Renderer::Render()
     // Build and execute the command list.
     Cmds.clear();
 
+    // Geometry staged since the last frame is copied into the arenas before anything draws from them.
+    SMPipe->SubmitUploads();
+
     BeginFrame();
     Cmds.emplace_back(CmdListBeginFrame.Get());
 
@@ -16,13 +16,6 @@
 
 using Microsoft::WRL::ComPtr; // Import only the ComPtr
 
-struct Vertex
-{
-    DirectX::XMFLOAT3 Position;
-    DirectX::XMFLOAT3 Normals;
-    DirectX::XMFLOAT4 Colour;
-};
-
 class Renderer
 {
 public:
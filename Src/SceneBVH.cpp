@@ -0,0 +1,548 @@
+#include "SceneBVH.h"
+
+#include "Frustum.h"
+
+// Std
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+#include <tbb/parallel_reduce.h>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr uint32_t NumBins = 16;
+    constexpr uint32_t MaxLeafObjects = 8;              // Larger nodes are always split, even when the heuristic prefers a leaf.
+    constexpr uint32_t ParallelBuildObjects = 4096;     // Nodes at least this large are binned and have their children built on several threads.
+    constexpr uint32_t ParallelGrainObjects = 1024;
+    constexpr float NodeTestCost = 1.0f;                // Relative to testing one object box.
+    constexpr uint32_t InsideFlag = 0x80000000u;        // Set on stack entries whose node is entirely inside the frustum.
+    constexpr size_t FullRefitDivisor = 8;              // Refit every node once at least one object in this many moved.
+
+    struct CentroidBounds
+    {
+        BoundingBox Box;
+        BoundingBox Centroids;
+
+        void Merge(const CentroidBounds& Other)
+        {
+            Box.Grow(Other.Box);
+            Centroids.Grow(Other.Centroids);
+        }
+    };
+
+    struct Bin
+    {
+        BoundingBox Box;
+        uint32_t Count = 0;
+    };
+
+    struct BinSet
+    {
+        Bin Bins[3][NumBins];
+
+        void Merge(const BinSet& Other)
+        {
+            for (size_t Axis = 0; Axis < 3; Axis++)
+            {
+                for (size_t Idx = 0; Idx < NumBins; Idx++)
+                {
+                    Bins[Axis][Idx].Box.Grow(Other.Bins[Axis][Idx].Box);
+                    Bins[Axis][Idx].Count += Other.Bins[Axis][Idx].Count;
+                }
+            }
+        }
+    };
+
+    // Accumulates over a node's objects, on several threads when there are enough of them.
+    template <typename T, typename AccumulateFunc>
+    T ReduceObjects(uint32_t First, uint32_t Count, const AccumulateFunc& Accumulate)
+    {
+        const tbb::blocked_range<uint32_t> Range(First, First + Count, ParallelGrainObjects);
+        if (Count < ParallelBuildObjects) { return Accumulate(Range, T()); }
+
+        return tbb::parallel_reduce(Range, T(), Accumulate, [](T A, const T& B) { A.Merge(B); return A; });
+    }
+
+    float GetComponent(const XMFLOAT3& Vector, size_t Axis) { return (&Vector.x)[Axis]; }
+
+    void GrowPoint(BoundingBox& Box, const XMFLOAT3& Point)
+    {
+        Box.Min = XMFLOAT3(std::min(Box.Min.x, Point.x), std::min(Box.Min.y, Point.y), std::min(Box.Min.z, Point.z));
+        Box.Max = XMFLOAT3(std::max(Box.Max.x, Point.x), std::max(Box.Max.y, Point.y), std::max(Box.Max.z, Point.z));
+    }
+
+    // The six frustum planes transposed four to a register, the last two lanes always pass.
+    struct FrustumPlanesSoA
+    {
+        XMVECTOR X[2], Y[2], Z[2], W[2];
+        XMVECTOR AbsX[2], AbsY[2], AbsZ[2];
+
+        explicit FrustumPlanesSoA(const Frustum& ViewFrustum)
+        {
+            XMFLOAT4 Planes[8];
+            std::copy(ViewFrustum.Planes, ViewFrustum.Planes + 6, Planes);
+            Planes[6] = Planes[7] = XMFLOAT4(0.0f, 0.0f, 0.0f, FLT_MAX);
+            for (size_t Group = 0; Group < 2; Group++)
+            {
+                const XMFLOAT4* P = Planes + Group * 4;
+                X[Group] = XMVectorSet(P[0].x, P[1].x, P[2].x, P[3].x);
+                Y[Group] = XMVectorSet(P[0].y, P[1].y, P[2].y, P[3].y);
+                Z[Group] = XMVectorSet(P[0].z, P[1].z, P[2].z, P[3].z);
+                W[Group] = XMVectorSet(P[0].w, P[1].w, P[2].w, P[3].w);
+                AbsX[Group] = XMVectorAbs(X[Group]);
+                AbsY[Group] = XMVectorAbs(Y[Group]);
+                AbsZ[Group] = XMVectorAbs(Z[Group]);
+            }
+        }
+    };
+
+    enum class Containment { Outside, Intersects, Inside };
+
+    // Distance of the box centre to four planes at once, against the box's extent along each plane normal.
+    Containment ClassifyBox(const FrustumPlanesSoA& Planes, const XMFLOAT3& Min, const XMFLOAT3& Max)
+    {
+        const XMVECTOR Cx = XMVectorReplicate((Min.x + Max.x) * 0.5f), Cy = XMVectorReplicate((Min.y + Max.y) * 0.5f), Cz = XMVectorReplicate((Min.z + Max.z) * 0.5f);
+        const XMVECTOR Ex = XMVectorReplicate((Max.x - Min.x) * 0.5f), Ey = XMVectorReplicate((Max.y - Min.y) * 0.5f), Ez = XMVectorReplicate((Max.z - Min.z) * 0.5f);
+
+        bool bInside = true;
+        for (size_t Group = 0; Group < 2; Group++)
+        {
+            const XMVECTOR Distance = XMVectorMultiplyAdd(Cz, Planes.Z[Group], XMVectorMultiplyAdd(Cy, Planes.Y[Group], XMVectorMultiplyAdd(Cx, Planes.X[Group], Planes.W[Group])));
+            const XMVECTOR Radius = XMVectorMultiplyAdd(Ez, Planes.AbsZ[Group], XMVectorMultiplyAdd(Ey, Planes.AbsY[Group], XMVectorMultiply(Ex, Planes.AbsX[Group])));
+
+            // Written as not greater or equal, so the NaNs of an empty box count as outside.
+            if (!XMVector4GreaterOrEqual(XMVectorAdd(Distance, Radius), XMVectorZero())) { return Containment::Outside; }
+            bInside = bInside && XMVector4GreaterOrEqual(XMVectorSubtract(Distance, Radius), XMVectorZero());
+        }
+        return bInside ? Containment::Inside : Containment::Intersects;
+    }
+
+    // Slab test, returns the entry and exit distances, which are crossed when the ray misses.
+    void IntersectRayBox(FXMVECTOR Origin, FXMVECTOR InvDirection, const XMFLOAT3& Min, const XMFLOAT3& Max, float& OutEntry, float& OutExit)
+    {
+        const XMVECTOR T0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&Min), Origin), InvDirection);
+        const XMVECTOR T1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&Max), Origin), InvDirection);
+        XMFLOAT3 Near, Far;
+        XMStoreFloat3(&Near, XMVectorMin(T0, T1));
+        XMStoreFloat3(&Far, XMVectorMax(T0, T1));
+        OutEntry = std::max({ Near.x, Near.y, Near.z });
+        OutExit = std::min({ Far.x, Far.y, Far.z });
+    }
+}
+
+void BoundingBox::Grow(const BoundingBox& Other)
+{
+    Min = XMFLOAT3(std::min(Min.x, Other.Min.x), std::min(Min.y, Other.Min.y), std::min(Min.z, Other.Min.z));
+    Max = XMFLOAT3(std::max(Max.x, Other.Max.x), std::max(Max.y, Other.Max.y), std::max(Max.z, Other.Max.z));
+}
+
+float BoundingBox::GetSurfaceArea() const
+{
+    if (Min.x > Max.x || Min.y > Max.y || Min.z > Max.z) { return 0.0f; }
+
+    const float Dx = Max.x - Min.x, Dy = Max.y - Min.y, Dz = Max.z - Min.z;
+    return 2.0f * (Dx * Dy + Dy * Dz + Dz * Dx);
+}
+
+BoundingBox BoundingBox::FromTransformedBox(const XMFLOAT3& Center, const XMFLOAT3& Extents, FXMMATRIX World)
+{
+    // Each world axis extent is the sum of the local extents projected onto it.
+    const XMVECTOR WorldCenter = XMVector3Transform(XMLoadFloat3(&Center), World);
+    const XMVECTOR WorldExtents = XMVectorMultiplyAdd(XMVectorReplicate(Extents.z), XMVectorAbs(World.r[2]),
+        XMVectorMultiplyAdd(XMVectorReplicate(Extents.y), XMVectorAbs(World.r[1]), XMVectorMultiply(XMVectorReplicate(Extents.x), XMVectorAbs(World.r[0]))));
+
+    BoundingBox Result;
+    XMStoreFloat3(&Result.Min, XMVectorSubtract(WorldCenter, WorldExtents));
+    XMStoreFloat3(&Result.Max, XMVectorAdd(WorldCenter, WorldExtents));
+    return Result;
+}
+
+void SceneBVH::Build(const std::vector<BoundingBox>& Boxes)
+{
+    Clear();
+    if (Boxes.empty()) { return; }
+
+    ObjectBoxes = Boxes;
+    const uint32_t NumObjects = static_cast<uint32_t>(Boxes.size());
+    ObjectIndices.resize(NumObjects);
+    std::vector<XMFLOAT3> Centroids(NumObjects);
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, NumObjects, ParallelGrainObjects),
+        [&](const tbb::blocked_range<uint32_t>& Range)
+        {
+            for (uint32_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+            {
+                ObjectIndices[Idx] = Idx;
+                const BoundingBox& Box = Boxes[Idx];
+                Centroids[Idx] = XMFLOAT3((Box.Min.x + Box.Max.x) * 0.5f, (Box.Min.y + Box.Max.y) * 0.5f, (Box.Min.z + Box.Max.z) * 0.5f);
+            }
+        });
+
+    // A binary tree over N leaves has at most 2N - 1 nodes, children are claimed in pairs from the shared counter.
+    Nodes.resize(2 * static_cast<size_t>(NumObjects) - 1);
+    std::atomic<uint32_t> NumNodes = 1;
+    BuildNode(0, 0, NumObjects, Centroids, NumNodes);
+    Nodes.resize(NumNodes.load());
+
+    // Links for refitting only the paths up from moved objects.
+    Parents.assign(Nodes.size(), UINT32_MAX);
+    ObjectLeaves.resize(NumObjects);
+    for (uint32_t Idx = 0; Idx < static_cast<uint32_t>(Nodes.size()); Idx++)
+    {
+        const Node& Current = Nodes[Idx];
+        if (Current.Count == 0)
+        {
+            Parents[Current.LeftOrFirst] = Idx;
+            Parents[Current.LeftOrFirst + 1] = Idx;
+            continue;
+        }
+        for (uint32_t Object = Current.LeftOrFirst; Object < Current.LeftOrFirst + Current.Count; Object++) { ObjectLeaves[ObjectIndices[Object]] = Idx; }
+    }
+}
+
+void SceneBVH::BuildNode(uint32_t NodeIndex, uint32_t First, uint32_t Count, const std::vector<XMFLOAT3>& Centroids, std::atomic<uint32_t>& NumNodes)
+{
+    const CentroidBounds Bounds = ReduceObjects<CentroidBounds>(First, Count,
+        [&](const tbb::blocked_range<uint32_t>& Range, CentroidBounds Acc)
+        {
+            for (uint32_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+            {
+                Acc.Box.Grow(ObjectBoxes[ObjectIndices[Idx]]);
+                GrowPoint(Acc.Centroids, Centroids[ObjectIndices[Idx]]);
+            }
+            return Acc;
+        });
+
+    Node& Current = Nodes[NodeIndex];
+    Current.Min = Bounds.Box.Min;
+    Current.Max = Bounds.Box.Max;
+    Current.LeftOrFirst = First;
+    Current.Count = Count;
+    if (Count <= 2) { return; }
+
+    // Bin the centroids along every axis that has any spread.
+    float BinScale[3];
+    for (size_t Axis = 0; Axis < 3; Axis++)
+    {
+        const float Extent = GetComponent(Bounds.Centroids.Max, Axis) - GetComponent(Bounds.Centroids.Min, Axis);
+        BinScale[Axis] = Extent > 0.0f ? NumBins / Extent : 0.0f;
+    }
+    const auto GetBin = [&](const XMFLOAT3& Centroid, size_t Axis)
+    {
+        const float Offset = (GetComponent(Centroid, Axis) - GetComponent(Bounds.Centroids.Min, Axis)) * BinScale[Axis];
+        return std::min(static_cast<uint32_t>(Offset), NumBins - 1);
+    };
+
+    const BinSet Bins = ReduceObjects<BinSet>(First, Count,
+        [&](const tbb::blocked_range<uint32_t>& Range, BinSet Acc)
+        {
+            for (uint32_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+            {
+                const uint32_t Object = ObjectIndices[Idx];
+                for (size_t Axis = 0; Axis < 3; Axis++)
+                {
+                    if (BinScale[Axis] == 0.0f) { continue; }
+                    Bin& Target = Acc.Bins[Axis][GetBin(Centroids[Object], Axis)];
+                    Target.Box.Grow(ObjectBoxes[Object]);
+                    Target.Count++;
+                }
+            }
+            return Acc;
+        });
+
+    // Sweep the split planes between bins, left to right then right to left. Cost is area times objects on each side.
+    float BestCost = FLT_MAX;
+    size_t BestAxis = 0;
+    uint32_t BestSplit = 0;
+    for (size_t Axis = 0; Axis < 3; Axis++)
+    {
+        if (BinScale[Axis] == 0.0f) { continue; }
+
+        float LeftCost[NumBins - 1];
+        BoundingBox Left;
+        uint32_t LeftCount = 0;
+        for (uint32_t Split = 0; Split < NumBins - 1; Split++)
+        {
+            Left.Grow(Bins.Bins[Axis][Split].Box);
+            LeftCount += Bins.Bins[Axis][Split].Count;
+            LeftCost[Split] = Left.GetSurfaceArea() * LeftCount;
+        }
+
+        BoundingBox Right;
+        uint32_t RightCount = 0;
+        for (uint32_t Split = NumBins - 1; Split > 0; Split--)
+        {
+            Right.Grow(Bins.Bins[Axis][Split].Box);
+            RightCount += Bins.Bins[Axis][Split].Count;
+            const float Cost = LeftCost[Split - 1] + Right.GetSurfaceArea() * RightCount;
+            if (RightCount > 0 && RightCount < Count && Cost < BestCost)
+            {
+                BestCost = Cost;
+                BestAxis = Axis;
+                BestSplit = Split;
+            }
+        }
+    }
+
+    // Objects whose centroids all coincide cannot be binned apart, large groups of them are halved in their current order.
+    uint32_t LeftCount = Count / 2;
+    if (BestCost < FLT_MAX)
+    {
+        const float SplitCost = NodeTestCost + BestCost / std::max(Bounds.Box.GetSurfaceArea(), FLT_MIN);
+        if (SplitCost >= static_cast<float>(Count) && Count <= MaxLeafObjects) { return; }
+
+        const auto Middle = std::partition(ObjectIndices.begin() + First, ObjectIndices.begin() + First + Count,
+            [&](uint32_t Object) { return GetBin(Centroids[Object], BestAxis) < BestSplit; });
+        LeftCount = static_cast<uint32_t>(Middle - (ObjectIndices.begin() + First));
+    }
+    else if (Count <= MaxLeafObjects)
+    {
+        return;
+    }
+
+    const uint32_t Left = NumNodes.fetch_add(2);
+    Current.LeftOrFirst = Left;
+    Current.Count = 0;
+
+    if (Count >= ParallelBuildObjects)
+    {
+        tbb::parallel_invoke(
+            [&] { BuildNode(Left, First, LeftCount, Centroids, NumNodes); },
+            [&] { BuildNode(Left + 1, First + LeftCount, Count - LeftCount, Centroids, NumNodes); });
+    }
+    else
+    {
+        BuildNode(Left, First, LeftCount, Centroids, NumNodes);
+        BuildNode(Left + 1, First + LeftCount, Count - LeftCount, Centroids, NumNodes);
+    }
+}
+
+void SceneBVH::Refit(const std::vector<BoundingBox>& Boxes)
+{
+    if (Boxes.size() != ObjectBoxes.size())
+    {
+        Build(Boxes);
+        return;
+    }
+
+    ObjectBoxes = Boxes;
+
+    // Leaves are independent, the inner nodes then follow bottom up.
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, Nodes.size(), ParallelGrainObjects),
+        [&](const tbb::blocked_range<size_t>& Range)
+        {
+            for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+            {
+                if (Nodes[Idx].Count != 0) { FitLeaf(Nodes[Idx]); }
+            }
+        });
+
+    for (size_t Idx = Nodes.size(); Idx-- > 0;)
+    {
+        if (Nodes[Idx].Count == 0) { FitInner(Nodes[Idx]); }
+    }
+}
+
+void SceneBVH::Refit(const std::vector<BoundingBox>& Boxes, const std::vector<uint32_t>& MovedObjects)
+{
+    if (Boxes.size() != ObjectBoxes.size() || MovedObjects.size() * FullRefitDivisor >= ObjectBoxes.size())
+    {
+        Refit(Boxes);
+        return;
+    }
+
+    // Every node on a path is refitted once, children before their parent as they always follow it.
+    std::vector<uint32_t> Dirty;
+    Dirty.reserve(MovedObjects.size() * 2);
+    for (const uint32_t Object : MovedObjects)
+    {
+        ObjectBoxes[Object] = Boxes[Object];
+        Dirty.push_back(ObjectLeaves[Object]);
+    }
+    std::sort(Dirty.begin(), Dirty.end());
+    Dirty.erase(std::unique(Dirty.begin(), Dirty.end()), Dirty.end());
+    const size_t NumLeaves = Dirty.size();
+    for (size_t Idx = 0; Idx < NumLeaves; Idx++)
+    {
+        FitLeaf(Nodes[Dirty[Idx]]);
+        for (uint32_t Parent = Parents[Dirty[Idx]]; Parent != UINT32_MAX; Parent = Parents[Parent]) { Dirty.push_back(Parent); }
+    }
+
+    std::sort(Dirty.begin() + NumLeaves, Dirty.end(), std::greater<uint32_t>());
+    Dirty.erase(std::unique(Dirty.begin() + NumLeaves, Dirty.end()), Dirty.end());
+    for (size_t Idx = NumLeaves; Idx < Dirty.size(); Idx++) { FitInner(Nodes[Dirty[Idx]]); }
+}
+
+void SceneBVH::FitLeaf(Node& Leaf) const
+{
+    BoundingBox Box;
+    for (uint32_t Object = Leaf.LeftOrFirst; Object < Leaf.LeftOrFirst + Leaf.Count; Object++)
+    {
+        Box.Grow(ObjectBoxes[ObjectIndices[Object]]);
+    }
+    Leaf.Min = Box.Min;
+    Leaf.Max = Box.Max;
+}
+
+void SceneBVH::FitInner(Node& Inner) const
+{
+    const Node& Left = Nodes[Inner.LeftOrFirst];
+    const Node& Right = Nodes[Inner.LeftOrFirst + 1];
+    Inner.Min = XMFLOAT3(std::min(Left.Min.x, Right.Min.x), std::min(Left.Min.y, Right.Min.y), std::min(Left.Min.z, Right.Min.z));
+    Inner.Max = XMFLOAT3(std::max(Left.Max.x, Right.Max.x), std::max(Left.Max.y, Right.Max.y), std::max(Left.Max.z, Right.Max.z));
+}
+
+void SceneBVH::Clear()
+{
+    Nodes.clear();
+    ObjectIndices.clear();
+    ObjectBoxes.clear();
+    Parents.clear();
+    ObjectLeaves.clear();
+}
+
+void SceneBVH::QueryFrustum(const Frustum& ViewFrustum, std::vector<uint32_t>& OutObjects) const
+{
+    if (Nodes.empty()) { return; }
+
+    const FrustumPlanesSoA Planes(ViewFrustum);
+    std::vector<uint32_t> Stack;
+    Stack.reserve(64);
+    Stack.push_back(0);
+    while (!Stack.empty())
+    {
+        const uint32_t Entry = Stack.back();
+        Stack.pop_back();
+        const Node& Current = Nodes[Entry & ~InsideFlag];
+
+        // Nodes inside the frustum pass everything below them without further tests.
+        bool bInside = (Entry & InsideFlag) != 0;
+        if (!bInside)
+        {
+            const Containment Result = ClassifyBox(Planes, Current.Min, Current.Max);
+            if (Result == Containment::Outside) { continue; }
+            bInside = Result == Containment::Inside;
+        }
+
+        if (Current.Count == 0)
+        {
+            const uint32_t Flag = bInside ? InsideFlag : 0;
+            Stack.push_back((Current.LeftOrFirst + 1) | Flag);
+            Stack.push_back(Current.LeftOrFirst | Flag);
+            continue;
+        }
+
+        for (uint32_t Idx = Current.LeftOrFirst; Idx < Current.LeftOrFirst + Current.Count; Idx++)
+        {
+            const uint32_t Object = ObjectIndices[Idx];
+            const BoundingBox& Box = ObjectBoxes[Object];
+            if (bInside || ClassifyBox(Planes, Box.Min, Box.Max) != Containment::Outside) { OutObjects.push_back(Object); }
+        }
+    }
+}
+
+bool SceneBVH::Raycast(const XMFLOAT3& Origin, const XMFLOAT3& Direction, float MaxDistance, BVHRayHit& OutHit) const
+{
+    OutHit = BVHRayHit();
+    if (Nodes.empty()) { return false; }
+
+    // Zero direction components are nudged so their slabs give signed infinities instead of NaNs.
+    const auto SafeComponent = [](float Value) { return std::abs(Value) < 1e-20f ? std::copysign(1e-20f, Value) : Value; };
+    const XMVECTOR RayOrigin = XMLoadFloat3(&Origin);
+    const XMVECTOR InvDirection = XMVectorReciprocal(XMVectorSet(SafeComponent(Direction.x), SafeComponent(Direction.y), SafeComponent(Direction.z), 1.0f));
+
+    float Best = MaxDistance;
+    std::vector<std::pair<uint32_t, float>> Stack; // Node and its clamped entry distance.
+    Stack.reserve(64);
+
+    float Entry, Exit;
+    IntersectRayBox(RayOrigin, InvDirection, Nodes[0].Min, Nodes[0].Max, Entry, Exit);
+    if (Entry > Exit || Exit < 0.0f) { return false; }
+    Stack.emplace_back(0, std::max(Entry, 0.0f));
+
+    while (!Stack.empty())
+    {
+        const auto [NodeIndex, NodeEntry] = Stack.back();
+        Stack.pop_back();
+        if (NodeEntry >= Best) { continue; } // Found something closer since this was pushed.
+
+        const Node& Current = Nodes[NodeIndex];
+        if (Current.Count > 0)
+        {
+            for (uint32_t Idx = Current.LeftOrFirst; Idx < Current.LeftOrFirst + Current.Count; Idx++)
+            {
+                const uint32_t Object = ObjectIndices[Idx];
+                IntersectRayBox(RayOrigin, InvDirection, ObjectBoxes[Object].Min, ObjectBoxes[Object].Max, Entry, Exit);
+                if (Entry > Exit || Exit < 0.0f) { continue; }
+
+                const float Distance = Entry >= 0.0f ? Entry : Exit;
+                if (Distance < Best)
+                {
+                    Best = Distance;
+                    OutHit.Object = Object;
+                    OutHit.Distance = Distance;
+                }
+            }
+            continue;
+        }
+
+        // Push the farther child first so the nearer one is visited first and shrinks Best sooner.
+        std::pair<uint32_t, float> Children[2];
+        size_t NumChildren = 0;
+        for (uint32_t Child = Current.LeftOrFirst; Child < Current.LeftOrFirst + 2; Child++)
+        {
+            IntersectRayBox(RayOrigin, InvDirection, Nodes[Child].Min, Nodes[Child].Max, Entry, Exit);
+            if (Entry > Exit || Exit < 0.0f || std::max(Entry, 0.0f) >= Best) { continue; }
+            Children[NumChildren++] = { Child, std::max(Entry, 0.0f) };
+        }
+        if (NumChildren == 2 && Children[0].second < Children[1].second) { std::swap(Children[0], Children[1]); }
+        for (size_t Idx = 0; Idx < NumChildren; Idx++) { Stack.push_back(Children[Idx]); }
+    }
+
+    return OutHit.Object != UINT32_MAX;
+}
+
+BVHStats SceneBVH::GetStats() const
+{
+    BVHStats Stats;
+    Stats.NumObjects = ObjectBoxes.size();
+    Stats.NumNodes = Nodes.size();
+    if (Nodes.empty()) { return Stats; }
+
+    BoundingBox Root;
+    Root.Min = Nodes[0].Min;
+    Root.Max = Nodes[0].Max;
+    const float RootArea = std::max(Root.GetSurfaceArea(), FLT_MIN);
+
+    std::vector<std::pair<uint32_t, size_t>> Stack = { { 0, 1 } };
+    while (!Stack.empty())
+    {
+        const auto [NodeIndex, Depth] = Stack.back();
+        Stack.pop_back();
+        const Node& Current = Nodes[NodeIndex];
+
+        BoundingBox Box;
+        Box.Min = Current.Min;
+        Box.Max = Current.Max;
+        const float HitProbability = Box.GetSurfaceArea() / RootArea;
+        Stats.MaxDepth = std::max(Stats.MaxDepth, Depth);
+        if (Current.Count > 0)
+        {
+            Stats.NumLeaves++;
+            Stats.SAHCost += HitProbability * Current.Count;
+        }
+        else
+        {
+            Stats.SAHCost += HitProbability * NodeTestCost;
+            Stack.emplace_back(Current.LeftOrFirst, Depth + 1);
+            Stack.emplace_back(Current.LeftOrFirst + 1, Depth + 1);
+        }
+    }
+    return Stats;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+
+struct Frustum;
+
+// Axis aligned box, empty while Min > Max.
+struct BoundingBox
+{
+    DirectX::XMFLOAT3 Min = DirectX::XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+    DirectX::XMFLOAT3 Max = DirectX::XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    void Grow(const BoundingBox& Other);
+    float GetSurfaceArea() const;
+
+    // Box around a Center +- Extents box after a row vector Model to World matrix.
+    static BoundingBox FromTransformedBox(const DirectX::XMFLOAT3& Center, const DirectX::XMFLOAT3& Extents, DirectX::FXMMATRIX World);
+};
+
+struct BVHRayHit
+{
+    uint32_t Object = UINT32_MAX;
+    float Distance = FLT_MAX;
+};
+
+struct BVHStats
+{
+    size_t NumObjects = 0;
+    size_t NumNodes = 0;
+    size_t NumLeaves = 0;
+    size_t MaxDepth = 0;
+    float SAHCost = 0.0f; // Expected node and object box tests of a random ray through the root box.
+};
+
+// Bounding volume hierarchy over the world boxes of scene objects, objects are identified by their index in the built array.
+// Built top down with a binned surface area heuristic, large nodes are binned and split on several threads.
+class SceneBVH
+{
+public:
+    void Build(const std::vector<BoundingBox>& Boxes);
+
+    // Updates the node boxes for moved objects without changing the tree, quality drops the further they move from the build.
+    void Refit(const std::vector<BoundingBox>& Boxes);
+
+    // Same, but only MovedObjects changed. Their leaves and the nodes on the way up to the root are refitted, unless so many
+    // objects moved that refitting every node is cheaper.
+    void Refit(const std::vector<BoundingBox>& Boxes, const std::vector<uint32_t>& MovedObjects);
+    void Clear();
+
+    // Appends every object whose box is at least partly inside the frustum.
+    void QueryFrustum(const Frustum& ViewFrustum, std::vector<uint32_t>& OutObjects) const;
+
+    // Nearest object box along the ray. A box the ray starts inside counts as hit where the ray leaves it,
+    // so meshes enclosing the camera, like the walls of a room, do not hide everything inside them.
+    bool Raycast(const DirectX::XMFLOAT3& Origin, const DirectX::XMFLOAT3& Direction, float MaxDistance, BVHRayHit& OutHit) const;
+
+    bool IsEmpty() const { return Nodes.empty(); }
+    const BoundingBox& GetObjectBox(uint32_t Object) const { return ObjectBoxes[Object]; }
+    BVHStats GetStats() const;
+
+private:
+    // 32 bytes. Leaves hold Count objects from ObjectIndices[LeftOrFirst], inner nodes have Count 0 and children LeftOrFirst and LeftOrFirst + 1.
+    struct Node
+    {
+        DirectX::XMFLOAT3 Min;
+        uint32_t LeftOrFirst = 0;
+        DirectX::XMFLOAT3 Max;
+        uint32_t Count = 0;
+    };
+
+    void BuildNode(uint32_t NodeIndex, uint32_t First, uint32_t Count, const std::vector<DirectX::XMFLOAT3>& Centroids, std::atomic<uint32_t>& NumNodes);
+    void FitLeaf(Node& Leaf) const;
+    void FitInner(Node& Inner) const;
+
+    std::vector<Node> Nodes; // Children always follow their parent, so a reverse walk visits children first.
+    std::vector<uint32_t> ObjectIndices;
+    std::vector<BoundingBox> ObjectBoxes;
+    std::vector<uint32_t> Parents;      // By node, the root has none.
+    std::vector<uint32_t> ObjectLeaves; // By object, the leaf holding it.
+};
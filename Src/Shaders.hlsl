@@ -2,16 +2,33 @@
 
 cbuffer CB_WVP : register(b0)
 {
-    float4x4 ModelMatrix : packoffset(c0);
-    float4x4 ViewMatrix : packoffset(c4);
-    float4x4 ProjectionMatrix : packoffset(c8);
+    float4x4 ViewMatrix : packoffset(c0);
+    float4x4 ProjectionMatrix : packoffset(c4);
+};
+
+// Per mesh position decode, identity unless the positions are stored relative to the mesh bounds.
+cbuffer CB_Mesh : register(b1)
+{
+    float4 PositionScale : packoffset(c0);
+    float4 PositionOffset : packoffset(c1);
 };
 
 struct VS_INPUT
 {
+    // Float, half or UNORM16 positions, the input layout converts all of them to float.
     float3 Position : POSITION;
+#if OCTAHEDRAL_NORMALS
+    float2 Normal : NORMAL;
+#else
     float3 Normal : NORMAL;
+#endif
     float3 Colour : COLOR;
+
+    // Per instance Model to World matrix rows.
+    float4 World0 : WORLD0;
+    float4 World1 : WORLD1;
+    float4 World2 : WORLD2;
+    float4 World3 : WORLD3;
 };
 
 struct VS_OUTPUT
@@ -24,15 +41,32 @@ struct VS_OUTPUT
 static const float3 LightPosition = float3(1.0f, 0.0f, 5.0f);
 static const float LightIntensity = 1.0f;
 
+// Inverse of the octahedral map, the lower hemisphere is unfolded from the corners of the square.
+float3 DecodeOctahedral(float2 Encoded)
+{
+    float3 N = float3(Encoded, 1.0f - abs(Encoded.x) - abs(Encoded.y));
+    const float T = saturate(-N.z);
+    N.xy += (N.xy >= 0.0f) ? -T : T;
+    return normalize(N);
+}
+
 VS_OUTPUT VSMain(VS_INPUT In)
 {
     VS_OUTPUT Out;
-    Out.Position = mul(float4(In.Position, 1.0f), ModelMatrix);
+    const float4x4 ModelMatrix = float4x4(In.World0, In.World1, In.World2, In.World3);
+    const float3 Position = In.Position * PositionScale.xyz + PositionOffset.xyz;
+#if OCTAHEDRAL_NORMALS
+    const float3 Normal = DecodeOctahedral(In.Normal);
+#else
+    const float3 Normal = In.Normal;
+#endif
+    
+    Out.Position = mul(float4(Position, 1.0f), ModelMatrix);
     Out.Position = mul(Out.Position, ViewMatrix);
     Out.Position = mul(Out.Position, ProjectionMatrix);
 
     // Normals to WS
-    Out.Normal = mul(float4(In.Normal, 0.0f), ModelMatrix); 
+    Out.Normal = mul(float4(Normal, 0.0f), ModelMatrix); 
     
     Out.Colour = In.Colour;
     
@@ -0,0 +1,233 @@
+#include "Skinning.h"
+
+// Std
+#include <algorithm>
+#include <cfloat>
+
+using namespace DirectX;
+
+namespace
+{
+    XMVECTOR LoadLanes(const float* Lanes) { return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(Lanes)); }
+    XMVECTOR LoadRow(const XMFLOAT4X4& Matrix, size_t Row) { return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(Matrix.m[Row])); }
+
+    // Copies the rest pose and adds the weighted offsets of every active shape. False when no shape is active.
+    bool ApplyBlendShapes(const SkinnedMeshSoA& Mesh, const float* BlendShapeWeights, SkinningScratch& Scratch)
+    {
+        if (!BlendShapeWeights) { return false; }
+
+        bool bAnyActive = false;
+        for (size_t Shape = 0; Shape < Mesh.BlendShapes.size(); Shape++)
+        {
+            const float Weight = BlendShapeWeights[Shape];
+            if (Weight == 0.0f) { continue; }
+
+            if (!bAnyActive)
+            {
+                Scratch.PositionX.assign(Mesh.PositionX.begin(), Mesh.PositionX.end());
+                Scratch.PositionY.assign(Mesh.PositionY.begin(), Mesh.PositionY.end());
+                Scratch.PositionZ.assign(Mesh.PositionZ.begin(), Mesh.PositionZ.end());
+                Scratch.NormalX.assign(Mesh.NormalX.begin(), Mesh.NormalX.end());
+                Scratch.NormalY.assign(Mesh.NormalY.begin(), Mesh.NormalY.end());
+                Scratch.NormalZ.assign(Mesh.NormalZ.begin(), Mesh.NormalZ.end());
+                bAnyActive = true;
+            }
+
+            const SkinBlendShape& BlendShape = Mesh.BlendShapes[Shape];
+            for (size_t Idx = 0; Idx < BlendShape.Vertices.size(); Idx++)
+            {
+                const uint32_t Vtx = BlendShape.Vertices[Idx];
+                const XMFLOAT3& Offset = BlendShape.PositionOffsets[Idx];
+                Scratch.PositionX[Vtx] += Weight * Offset.x;
+                Scratch.PositionY[Vtx] += Weight * Offset.y;
+                Scratch.PositionZ[Vtx] += Weight * Offset.z;
+            }
+            for (size_t Idx = 0; Idx < BlendShape.NormalOffsets.size(); Idx++)
+            {
+                const uint32_t Vtx = BlendShape.Vertices[Idx];
+                const XMFLOAT3& Offset = BlendShape.NormalOffsets[Idx];
+                Scratch.NormalX[Vtx] += Weight * Offset.x;
+                Scratch.NormalY[Vtx] += Weight * Offset.y;
+                Scratch.NormalZ[Vtx] += Weight * Offset.z;
+            }
+        }
+        if (!bAnyActive) { return false; }
+
+        // The padding lanes follow the last vertex, so they never widen the bounds.
+        const size_t Last = Mesh.NumVertices - 1;
+        for (size_t Idx = Mesh.NumVertices; Idx < Scratch.PositionX.size(); Idx++)
+        {
+            for (std::vector<float>* Component : { &Scratch.PositionX, &Scratch.PositionY, &Scratch.PositionZ, &Scratch.NormalX, &Scratch.NormalY, &Scratch.NormalZ })
+            {
+                (*Component)[Idx] = (*Component)[Last];
+            }
+        }
+        return true;
+    }
+}
+
+void SkinnedMeshSoA::Resize(size_t InNumVertices, uint32_t InNumInfluences, uint32_t InNumJoints)
+{
+    NumVertices = InNumVertices;
+    NumInfluences = InNumInfluences;
+    NumJoints = InNumJoints;
+    const size_t NumPadded = GetNumGroups() * 4;
+    for (std::vector<float>* Component : { &PositionX, &PositionY, &PositionZ, &NormalX, &NormalY, &NormalZ })
+    {
+        Component->assign(NumPadded, 0.0f);
+    }
+    Colours.assign(NumVertices, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
+    Joints.assign(NumPadded * NumInfluences, uint16_t(0));
+    Weights.assign(NumPadded * NumInfluences, 0.0f);
+    BlendShapes.clear();
+}
+
+void SkinnedMeshSoA::SetVertex(size_t Idx, const XMFLOAT3& Position, const XMFLOAT3& Normal, const XMFLOAT4& Colour)
+{
+    PositionX[Idx] = Position.x;
+    PositionY[Idx] = Position.y;
+    PositionZ[Idx] = Position.z;
+    NormalX[Idx] = Normal.x;
+    NormalY[Idx] = Normal.y;
+    NormalZ[Idx] = Normal.z;
+    if (Idx < NumVertices) { Colours[Idx] = Colour; }
+}
+
+void SkinnedMeshSoA::SetInfluence(size_t Idx, uint32_t Influence, uint16_t Joint, float Weight)
+{
+    const size_t Slot = ((Idx / 4) * NumInfluences + Influence) * 4 + Idx % 4;
+    Joints[Slot] = Joint;
+    Weights[Slot] = Weight;
+}
+
+void SkinnedMeshSoA::PadGroups()
+{
+    if (NumVertices == 0) { return; }
+
+    const size_t Last = NumVertices - 1;
+    for (size_t Idx = NumVertices; Idx < GetNumGroups() * 4; Idx++)
+    {
+        SetVertex(Idx, XMFLOAT3(PositionX[Last], PositionY[Last], PositionZ[Last]), XMFLOAT3(NormalX[Last], NormalY[Last], NormalZ[Last]), XMFLOAT4());
+        for (uint32_t Influence = 0; Influence < NumInfluences; Influence++)
+        {
+            const size_t LastSlot = ((Last / 4) * NumInfluences + Influence) * 4 + Last % 4;
+            SetInfluence(Idx, Influence, Joints[LastSlot], Weights[LastSlot]);
+        }
+    }
+}
+
+size_t SkinnedMeshSoA::GetSizeBytes() const
+{
+    size_t Bytes = PositionX.size() * sizeof(float) * 6 + Colours.size() * sizeof(XMFLOAT4) + Joints.size() * sizeof(uint16_t) + Weights.size() * sizeof(float);
+    for (const SkinBlendShape& BlendShape : BlendShapes)
+    {
+        Bytes += BlendShape.Vertices.size() * sizeof(uint32_t) + (BlendShape.PositionOffsets.size() + BlendShape.NormalOffsets.size()) * sizeof(XMFLOAT3);
+    }
+    return Bytes;
+}
+
+void Skinning::Skin(const SkinnedMeshSoA& Mesh, const XMFLOAT4X4* JointMatrices, const float* BlendShapeWeights, SkinningScratch& Scratch,
+    Vertex* Dest, XMFLOAT3& OutMin, XMFLOAT3& OutMax)
+{
+    OutMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+    OutMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    if (Mesh.NumVertices == 0) { return; }
+
+    const bool bBlendShapes = ApplyBlendShapes(Mesh, BlendShapeWeights, Scratch);
+    const float* SrcX = bBlendShapes ? Scratch.PositionX.data() : Mesh.PositionX.data();
+    const float* SrcY = bBlendShapes ? Scratch.PositionY.data() : Mesh.PositionY.data();
+    const float* SrcZ = bBlendShapes ? Scratch.PositionZ.data() : Mesh.PositionZ.data();
+    const float* SrcNX = bBlendShapes ? Scratch.NormalX.data() : Mesh.NormalX.data();
+    const float* SrcNY = bBlendShapes ? Scratch.NormalY.data() : Mesh.NormalY.data();
+    const float* SrcNZ = bBlendShapes ? Scratch.NormalZ.data() : Mesh.NormalZ.data();
+
+    const XMVECTOR Zero = XMVectorZero();
+    const XMVECTOR MinLengthSq = XMVectorReplicate(1e-20f);
+    XMVECTOR MinX = XMVectorReplicate(FLT_MAX), MinY = MinX, MinZ = MinX;
+    XMVECTOR MaxX = XMVectorReplicate(-FLT_MAX), MaxY = MaxX, MaxZ = MaxX;
+
+    const size_t NumGroups = Mesh.GetNumGroups();
+    for (size_t Group = 0; Group < NumGroups; Group++)
+    {
+        const size_t First = Group * 4;
+        const XMVECTOR Px = LoadLanes(SrcX + First);
+        const XMVECTOR Py = LoadLanes(SrcY + First);
+        const XMVECTOR Pz = LoadLanes(SrcZ + First);
+        const XMVECTOR Nx = LoadLanes(SrcNX + First);
+        const XMVECTOR Ny = LoadLanes(SrcNY + First);
+        const XMVECTOR Nz = LoadLanes(SrcNZ + First);
+
+        XMVECTOR OutPx = Zero, OutPy = Zero, OutPz = Zero;
+        XMVECTOR OutNx = Zero, OutNy = Zero, OutNz = Zero;
+        const uint16_t* Joints = &Mesh.Joints[First * Mesh.NumInfluences];
+        const float* Weights = &Mesh.Weights[First * Mesh.NumInfluences];
+        for (uint32_t Influence = 0; Influence < Mesh.NumInfluences; Influence++, Joints += 4, Weights += 4)
+        {
+            const XMVECTOR Weight = LoadLanes(Weights);
+            if (XMVector4Equal(Weight, Zero)) { continue; }
+
+            // Each row of the four lanes' joint matrices, transposed so one register holds one matrix element across the lanes.
+            const XMFLOAT4X4& M0 = JointMatrices[Joints[0]];
+            const XMFLOAT4X4& M1 = JointMatrices[Joints[1]];
+            const XMFLOAT4X4& M2 = JointMatrices[Joints[2]];
+            const XMFLOAT4X4& M3 = JointMatrices[Joints[3]];
+            const XMMATRIX Row0 = XMMatrixTranspose(XMMATRIX(LoadRow(M0, 0), LoadRow(M1, 0), LoadRow(M2, 0), LoadRow(M3, 0)));
+            const XMMATRIX Row1 = XMMatrixTranspose(XMMATRIX(LoadRow(M0, 1), LoadRow(M1, 1), LoadRow(M2, 1), LoadRow(M3, 1)));
+            const XMMATRIX Row2 = XMMatrixTranspose(XMMATRIX(LoadRow(M0, 2), LoadRow(M1, 2), LoadRow(M2, 2), LoadRow(M3, 2)));
+            const XMMATRIX Row3 = XMMatrixTranspose(XMMATRIX(LoadRow(M0, 3), LoadRow(M1, 3), LoadRow(M2, 3), LoadRow(M3, 3)));
+
+            // Row vectors, p * M = x * Row0 + y * Row1 + z * Row2 + Row3. Normals skip the translation.
+            const XMVECTOR Sx = XMVectorMultiplyAdd(Pz, Row2.r[0], XMVectorMultiplyAdd(Py, Row1.r[0], XMVectorMultiplyAdd(Px, Row0.r[0], Row3.r[0])));
+            const XMVECTOR Sy = XMVectorMultiplyAdd(Pz, Row2.r[1], XMVectorMultiplyAdd(Py, Row1.r[1], XMVectorMultiplyAdd(Px, Row0.r[1], Row3.r[1])));
+            const XMVECTOR Sz = XMVectorMultiplyAdd(Pz, Row2.r[2], XMVectorMultiplyAdd(Py, Row1.r[2], XMVectorMultiplyAdd(Px, Row0.r[2], Row3.r[2])));
+            const XMVECTOR Snx = XMVectorMultiplyAdd(Nz, Row2.r[0], XMVectorMultiplyAdd(Ny, Row1.r[0], XMVectorMultiply(Nx, Row0.r[0])));
+            const XMVECTOR Sny = XMVectorMultiplyAdd(Nz, Row2.r[1], XMVectorMultiplyAdd(Ny, Row1.r[1], XMVectorMultiply(Nx, Row0.r[1])));
+            const XMVECTOR Snz = XMVectorMultiplyAdd(Nz, Row2.r[2], XMVectorMultiplyAdd(Ny, Row1.r[2], XMVectorMultiply(Nx, Row0.r[2])));
+
+            OutPx = XMVectorMultiplyAdd(Weight, Sx, OutPx);
+            OutPy = XMVectorMultiplyAdd(Weight, Sy, OutPy);
+            OutPz = XMVectorMultiplyAdd(Weight, Sz, OutPz);
+            OutNx = XMVectorMultiplyAdd(Weight, Snx, OutNx);
+            OutNy = XMVectorMultiplyAdd(Weight, Sny, OutNy);
+            OutNz = XMVectorMultiplyAdd(Weight, Snz, OutNz);
+        }
+
+        const XMVECTOR LengthSq = XMVectorMultiplyAdd(OutNz, OutNz, XMVectorMultiplyAdd(OutNy, OutNy, XMVectorMultiply(OutNx, OutNx)));
+        const XMVECTOR InvLength = XMVectorReciprocalSqrt(XMVectorMax(LengthSq, MinLengthSq));
+        OutNx = XMVectorMultiply(OutNx, InvLength);
+        OutNy = XMVectorMultiply(OutNy, InvLength);
+        OutNz = XMVectorMultiply(OutNz, InvLength);
+
+        // Padding lanes repeat the last vertex, so they can take part in the bounds.
+        MinX = XMVectorMin(MinX, OutPx); MinY = XMVectorMin(MinY, OutPy); MinZ = XMVectorMin(MinZ, OutPz);
+        MaxX = XMVectorMax(MaxX, OutPx); MaxY = XMVectorMax(MaxY, OutPy); MaxZ = XMVectorMax(MaxZ, OutPz);
+
+        XMFLOAT4 X, Y, Z, NX, NY, NZ;
+        XMStoreFloat4(&X, OutPx);
+        XMStoreFloat4(&Y, OutPy);
+        XMStoreFloat4(&Z, OutPz);
+        XMStoreFloat4(&NX, OutNx);
+        XMStoreFloat4(&NY, OutNy);
+        XMStoreFloat4(&NZ, OutNz);
+        const float* LaneX = &X.x; const float* LaneY = &Y.x; const float* LaneZ = &Z.x;
+        const float* LaneNX = &NX.x; const float* LaneNY = &NY.x; const float* LaneNZ = &NZ.x;
+
+        const size_t NumLanes = std::min<size_t>(4, Mesh.NumVertices - First);
+        for (size_t Lane = 0; Lane < NumLanes; Lane++)
+        {
+            Vertex Vtx;
+            Vtx.Position = XMFLOAT3(LaneX[Lane], LaneY[Lane], LaneZ[Lane]);
+            Vtx.Normals = XMFLOAT3(LaneNX[Lane], LaneNY[Lane], LaneNZ[Lane]);
+            Vtx.Colour = Mesh.Colours[First + Lane];
+            Dest[First + Lane] = Vtx;
+        }
+    }
+
+    XMFLOAT4 LaneMinX, LaneMinY, LaneMinZ, LaneMaxX, LaneMaxY, LaneMaxZ;
+    XMStoreFloat4(&LaneMinX, MinX); XMStoreFloat4(&LaneMinY, MinY); XMStoreFloat4(&LaneMinZ, MinZ);
+    XMStoreFloat4(&LaneMaxX, MaxX); XMStoreFloat4(&LaneMaxY, MaxY); XMStoreFloat4(&LaneMaxZ, MaxZ);
+    OutMin = XMFLOAT3(std::min({ LaneMinX.x, LaneMinX.y, LaneMinX.z, LaneMinX.w }), std::min({ LaneMinY.x, LaneMinY.y, LaneMinY.z, LaneMinY.w }),
+        std::min({ LaneMinZ.x, LaneMinZ.y, LaneMinZ.z, LaneMinZ.w }));
+    OutMax = XMFLOAT3(std::max({ LaneMaxX.x, LaneMaxX.y, LaneMaxX.z, LaneMaxX.w }), std::max({ LaneMaxY.x, LaneMaxY.y, LaneMaxY.z, LaneMaxY.w }),
+        std::max({ LaneMaxZ.x, LaneMaxZ.y, LaneMaxZ.z, LaneMaxZ.w }));
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "pch.h"
+
+// Sparse offsets of one blend shape, or of one of its inbetweens, on the skinned vertices. In render space.
+struct SkinBlendShape
+{
+    std::vector<uint32_t> Vertices;
+    std::vector<DirectX::XMFLOAT3> PositionOffsets;
+    std::vector<DirectX::XMFLOAT3> NormalOffsets; // Empty when the shape leaves the normals alone.
+};
+
+// Rest pose of a skinned mesh in render space, as separate component arrays so the kernel skins four vertices per register.
+// Padded to whole groups of four by repeating the last vertex. Joints and weights are laid out group by group, one influence
+// after another, so the four lanes of one influence are contiguous. Unused influences have zero weight.
+struct SkinnedMeshSoA
+{
+    std::vector<float> PositionX, PositionY, PositionZ;
+    std::vector<float> NormalX, NormalY, NormalZ;
+    std::vector<DirectX::XMFLOAT4> Colours; // Not padded, copied through.
+    std::vector<uint16_t> Joints;
+    std::vector<float> Weights;
+    std::vector<SkinBlendShape> BlendShapes;
+    size_t NumVertices = 0;
+    uint32_t NumInfluences = 0;
+    uint32_t NumJoints = 0; // Joint matrices Skin reads, every joint index is below this.
+
+    void Resize(size_t InNumVertices, uint32_t InNumInfluences, uint32_t InNumJoints);
+    void SetVertex(size_t Idx, const DirectX::XMFLOAT3& Position, const DirectX::XMFLOAT3& Normal, const DirectX::XMFLOAT4& Colour);
+    void SetInfluence(size_t Idx, uint32_t Influence, uint16_t Joint, float Weight);
+    void PadGroups(); // Fills the padding lanes with the last vertex, once every vertex is set.
+    size_t GetNumGroups() const { return (NumVertices + 3) / 4; }
+    size_t GetSizeBytes() const;
+};
+
+// Rest pose with the blend shapes applied, kept by the caller so a frame allocates nothing.
+struct SkinningScratch
+{
+    std::vector<float> PositionX, PositionY, PositionZ;
+    std::vector<float> NormalX, NormalY, NormalZ;
+};
+
+namespace Skinning
+{
+    // Linear blend skinning with one row vector matrix per joint, taking the rest pose to the mesh's render space. Blend shapes
+    // with a non-zero weight are added to the rest pose first. Normals go through the same matrices and are renormalised, which
+    // assumes joints without shear or non-uniform scale. Writes every vertex in the Float format, front to back so Dest may be
+    // write combined upload memory, and the box around their positions.
+    void Skin(const SkinnedMeshSoA& Mesh, const DirectX::XMFLOAT4X4* JointMatrices, const float* BlendShapeWeights, SkinningScratch& Scratch,
+        Vertex* Dest, DirectX::XMFLOAT3& OutMin, DirectX::XMFLOAT3& OutMax);
+}
@@ -0,0 +1,130 @@
+#include "StageEdits.h"
+
+// Std
+#include <algorithm>
+#include <set>
+
+// USD
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/mesh.h"
+#include "pxr/usd/usdGeom/pointInstancer.h"
+#include "pxr/usd/usdGeom/tokens.h"
+#include "pxr/usd/usdGeom/xformable.h"
+
+using namespace pxr;
+
+StageEditKind StageEdits::ClassifyProperty(const UsdPrim& Prim, const TfToken& Name)
+{
+    if (UsdGeomXformable::IsTransformationAffectedByAttrNamed(Name)) { return StageEditKind::Transform; }
+
+    if (Prim.IsA<UsdGeomPointInstancer>())
+    {
+        // Moving instances rewrites their rows, anything that changes how many instances each prototype has moves the rows.
+        if (Name == UsdGeomTokens->positions || Name == UsdGeomTokens->orientations || Name == UsdGeomTokens->scales)
+        {
+            return StageEditKind::Transform;
+        }
+        if (Name == UsdGeomTokens->protoIndices || Name == UsdGeomTokens->prototypes || Name == UsdGeomTokens->invisibleIds
+            || Name == UsdGeomTokens->ids)
+        {
+            return StageEditKind::Resync;
+        }
+        return StageEditKind::None;
+    }
+
+    if (Prim.IsA<UsdGeomMesh>())
+    {
+        if (Name == UsdGeomTokens->faceVertexCounts || Name == UsdGeomTokens->faceVertexIndices || Name == UsdGeomTokens->holeIndices
+            || Name == UsdGeomTokens->orientation)
+        {
+            return StageEditKind::Topology;
+        }
+
+        // The skeleton binding decides the joints the mesh is skinned with, it is bound again with the rebuilt mesh.
+        const std::string& NameString = Name.GetString();
+        if (TfStringStartsWith(NameString, "skel:")) { return StageEditKind::Topology; }
+        if (Name == UsdGeomTokens->points || Name == UsdGeomTokens->normals || TfStringStartsWith(NameString, "primvars:"))
+        {
+            return StageEditKind::Primvar;
+        }
+    }
+    return StageEditKind::None;
+}
+
+void StageEdits::Classify(const UsdNotice::ObjectsChanged& Notice, std::vector<StageEdit>& OutEdits)
+{
+    const UsdStageWeakPtr Stage = Notice.GetStage();
+    const auto AddProperty = [&](const SdfPath& Path)
+    {
+        const SdfPath PrimPath = Path.GetPrimPath();
+        const UsdPrim Prim = Stage->GetPrimAtPath(PrimPath);
+        const StageEditKind Kind = Prim ? ClassifyProperty(Prim, Path.GetNameToken()) : StageEditKind::None;
+        if (Kind != StageEditKind::None) { OutEdits.push_back(StageEdit{ PrimPath, Kind }); }
+    };
+
+    for (const SdfPath& Path : Notice.GetResyncedPaths())
+    {
+        if (Path.IsPrimPropertyPath()) { AddProperty(Path); }
+        else if (Path.IsAbsoluteRootOrPrimPath()) { OutEdits.push_back(StageEdit{ Path, StageEditKind::Resync }); }
+    }
+    for (const SdfPath& Path : Notice.GetChangedInfoOnlyPaths())
+    {
+        if (Path.IsPrimPropertyPath()) { AddProperty(Path); }
+    }
+}
+
+void StageEdits::Coalesce(std::vector<StageEdit>& Edits)
+{
+    // Only the outermost resyncs are kept, anything inside one is collected again anyway.
+    SdfPathVector Resynced;
+    for (const StageEdit& Edit : Edits)
+    {
+        if (Edit.Kind == StageEditKind::Resync) { Resynced.push_back(Edit.Path); }
+    }
+    SdfPath::RemoveDescendentPaths(&Resynced);
+
+    const std::set<SdfPath> ResyncedSet(Resynced.begin(), Resynced.end());
+    const auto IsResynced = [&ResyncedSet](const SdfPath& Path)
+    {
+        for (SdfPath Ancestor = Path; !Ancestor.IsEmpty(); Ancestor = Ancestor.GetParentPath())
+        {
+            if (ResyncedSet.count(Ancestor) != 0) { return true; }
+        }
+        return false;
+    };
+
+    std::vector<StageEdit> Merged;
+    Merged.reserve(Edits.size());
+    for (const SdfPath& Path : Resynced) { Merged.push_back(StageEdit{ Path, StageEditKind::Resync }); }
+    for (const StageEdit& Edit : Edits)
+    {
+        if (Edit.Kind == StageEditKind::None || Edit.Kind == StageEditKind::Resync || IsResynced(Edit.Path)) { continue; }
+        Merged.push_back(Edit);
+    }
+
+    std::sort(Merged.begin(), Merged.end(), [](const StageEdit& A, const StageEdit& B)
+        {
+            return A.Path != B.Path ? A.Path < B.Path : A.Kind < B.Kind;
+        });
+
+    Merged.erase(std::unique(Merged.begin(), Merged.end(), [](const StageEdit& A, const StageEdit& B)
+        {
+            return A.Path == B.Path && A.Kind == B.Kind;
+        }), Merged.end());
+
+    // Sorted by kind within a prim, so a Primvar edit is directly followed by the Topology edit that absorbs it.
+    Edits.clear();
+    for (size_t Idx = 0; Idx < Merged.size(); Idx++)
+    {
+        const StageEdit& Edit = Merged[Idx];
+        const bool bAbsorbed = Edit.Kind == StageEditKind::Primvar && Idx + 1 < Merged.size() && Merged[Idx + 1].Path == Edit.Path
+            && Merged[Idx + 1].Kind == StageEditKind::Topology;
+        if (!bAbsorbed) { Edits.push_back(Edit); }
+    }
+}
+
+bool StageEdits::InvalidatesXformQueries(const std::vector<StageEdit>& Edits)
+{
+    return std::any_of(Edits.begin(), Edits.end(),
+        [](const StageEdit& Edit) { return Edit.Kind == StageEditKind::Transform || Edit.Kind == StageEditKind::Resync; });
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Usd
+#include "pxr/usd/sdf/path.h"
+#include "pxr/usd/usd/notice.h"
+#include "pxr/usd/usd/prim.h"
+
+// What an edit to the stage invalidates, from the cheapest to apply to the most expensive.
+enum class StageEditKind : uint8_t
+{
+    None,      // Nothing the renderer reads, e.g. visibility, extent or custom attributes.
+    Transform, // Instance rows of the prim and everything below it are evaluated again.
+    Primvar,   // Vertex data of one mesh, it is rebuilt and only its vertex buffer replaced when the indices come out the same.
+    Topology,  // Faces of one mesh, it is rebuilt with new vertex and index buffers.
+    Resync,    // Prims were added, removed or recomposed below the path, its subtree is collected again.
+};
+
+// One edit on a prim, property changes are reported on the prim they belong to.
+struct StageEdit
+{
+    pxr::SdfPath Path;
+    StageEditKind Kind = StageEditKind::None;
+};
+
+namespace StageEdits
+{
+    // Kind of a change to one property of Prim, by its name and the prim's schema.
+    StageEditKind ClassifyProperty(const pxr::UsdPrim& Prim, const pxr::TfToken& Name);
+
+    // Appends the edits of one notice. Resynced prims are Resync edits, resynced properties were added or removed and are
+    // classified like a value change, changed prim metadata is ignored.
+    void Classify(const pxr::UsdNotice::ObjectsChanged& Notice, std::vector<StageEdit>& OutEdits);
+
+    // Sorts by path and merges the edits of several notices: one edit per prim and kind, Topology absorbs Primvar on the same
+    // prim and a resync absorbs every edit at or below its path.
+    void Coalesce(std::vector<StageEdit>& Edits);
+
+    // Transform or resync edits may have changed a prim's xform ops or their time samples, which a UsdGeomXformCache
+    // kept across frames holds resolved queries of, so it has to be cleared.
+    bool InvalidatesXformQueries(const std::vector<StageEdit>& Edits);
+}
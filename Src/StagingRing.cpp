@@ -0,0 +1,78 @@
+#include "StagingRing.h"
+
+void StagingRing::Reset(uint64_t InCapacity)
+{
+    Batches.clear();
+    Capacity = InCapacity;
+    Head = 0;
+    Used = 0;
+    OpenBytes = 0;
+    NumWraps = 0;
+}
+
+bool StagingRing::Allocate(uint64_t Size, uint64_t Alignment, uint64_t& OutOffset)
+{
+    if (Size == 0 || Size > Capacity) { return false; }
+
+    // An allocation that would run past the end starts over at 0, the skipped end stays used until its batch retires.
+    uint64_t Offset = (Head + Alignment - 1) / Alignment * Alignment;
+    bool bWraps = false;
+    if (Offset + Size > Capacity)
+    {
+        Offset = 0;
+        bWraps = true;
+    }
+    const uint64_t Padding = bWraps ? Capacity - Head : Offset - Head;
+    if (Used + Padding + Size > Capacity) { return false; }
+
+    Head = Offset + Size == Capacity ? 0 : Offset + Size;
+    Used += Padding + Size;
+    OpenBytes += Padding + Size;
+    NumWraps += bWraps ? 1 : 0;
+    OutOffset = Offset;
+    return true;
+}
+
+void StagingRing::Submit(uint64_t FenceValue)
+{
+    if (OpenBytes == 0) { return; }
+
+    Batches.push_back(Batch{ FenceValue, OpenBytes });
+    OpenBytes = 0;
+}
+
+void StagingRing::Retire(uint64_t CompletedValue)
+{
+    while (!Batches.empty() && Batches.front().FenceValue <= CompletedValue)
+    {
+        Used -= Batches.front().Bytes;
+        Batches.pop_front();
+    }
+
+    // Empty, the next allocation may as well start at the beginning rather than wrap sooner.
+    if (Used == 0) { Head = 0; }
+}
+
+bool StagingRing::WaitForOldest(StagingFence& Fence)
+{
+    if (Batches.empty()) { return false; }
+
+    Fence.Wait(Batches.front().FenceValue);
+    Retire(Fence.GetCompletedValue());
+    return true;
+}
+
+void StagingCopies::Append(std::vector<StagedCopy>& Copies, const StagedCopy& Copy)
+{
+    if (!Copies.empty())
+    {
+        StagedCopy& Last = Copies.back();
+        if (Last.Destination == Copy.Destination && Last.DestinationOffset + Last.Size == Copy.DestinationOffset
+            && Last.SourceOffset + Last.Size == Copy.SourceOffset)
+        {
+            Last.Size += Copy.Size;
+            return;
+        }
+    }
+    Copies.push_back(Copy);
+}
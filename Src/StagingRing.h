@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Fence the staging ring waits on: the upload fence on the command queue in the renderer, a fake one in the tools.
+class StagingFence
+{
+public:
+    virtual ~StagingFence() = default;
+    virtual uint64_t GetCompletedValue() const = 0;
+    virtual void Wait(uint64_t Value) = 0; // Returns once the completed value has reached Value.
+};
+
+// One copy from the staging ring into a destination buffer.
+struct StagedCopy
+{
+    uint32_t Destination = 0;
+    uint64_t DestinationOffset = 0;
+    uint64_t SourceOffset = 0; // In the ring.
+    uint64_t Size = 0;
+};
+
+// Byte ranges of a persistently mapped upload buffer, allocated one after another and wrapping around at its end. Allocations since
+// the last Submit form the open batch, Submit closes it with the fence value signalled after its copies and Retire frees every
+// batch whose fence value has completed, oldest first.
+class StagingRing
+{
+public:
+    void Reset(uint64_t InCapacity); // Everything free, nothing in flight.
+
+    // False when the free space is too small until older batches retire, the open batch has to be submitted first if it holds them.
+    bool Allocate(uint64_t Size, uint64_t Alignment, uint64_t& OutOffset);
+    void Submit(uint64_t FenceValue);
+    void Retire(uint64_t CompletedValue);
+    bool WaitForOldest(StagingFence& Fence); // Waits for the oldest submitted batch and retires it, false when none is in flight.
+
+    uint64_t GetCapacity() const { return Capacity; }
+    uint64_t GetUsed() const { return Used; }           // Including the ends skipped when wrapping.
+    uint64_t GetOpenBytes() const { return OpenBytes; }
+    size_t GetNumInFlight() const { return Batches.size(); }
+    size_t GetNumWraps() const { return NumWraps; }
+
+private:
+    struct Batch
+    {
+        uint64_t FenceValue = 0;
+        uint64_t Bytes = 0;
+    };
+
+    std::deque<Batch> Batches; // Submitted, oldest first.
+    uint64_t Capacity = 0;
+    uint64_t Head = 0;         // Where the next allocation starts, the free space runs from here around to the oldest batch.
+    uint64_t Used = 0;
+    uint64_t OpenBytes = 0;
+    size_t NumWraps = 0;
+};
+
+namespace StagingCopies
+{
+    // Appends a copy, merged into the last one when it continues it in both buffers, so a run of meshes staged in order is one copy.
+    void Append(std::vector<StagedCopy>& Copies, const StagedCopy& Copy);
+}
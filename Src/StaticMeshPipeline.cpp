@@ -7,31 +7,74 @@
 #include <dxgi1_6.h>
 
 // DXRenderer
+#include "Camera.h"
 #include "MainWindow.h"
 #include "Renderer.h"
 #include "pch.h"
 #include "RenderMesh.h"
+#include "MeshDeformer.h"
 #include "USDScene.h"
 
 // NVTX
 #include <nvtx3/nvtx3.hpp>
 
+// Std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+namespace
+{
+    // Instances closer than this are treated as this close, so a camera inside a bounding sphere still gets a finite error.
+    constexpr float MinLodDistance = 0.01f;
+
+    // Smallest arena buffer, so a scene streaming in small meshes does not repack on every one.
+    constexpr UINT64 MinArenaBytes = 1ull << 20;
+
+    // Staging ring size. Meshes larger than a quarter of it are staged in pieces, so loading keeps a few batches in flight.
+    constexpr UINT64 StagingRingBytes = 32ull << 20;
+    constexpr UINT64 MaxStagingChunk = StagingRingBytes / 4;
+    constexpr UINT64 StagingAlignment = 16;
+
+    // Heaps buffers are placed in, larger buffers get a heap of their own.
+    constexpr UINT64 HeapBlockBytes = 64ull << 20;
+}
+
 
 StaticMeshPipeline::StaticMeshPipeline(Renderer* InRenderer)
 {
     NVTX3_FUNC_RANGE();
 
     R = InRenderer;
+    DefaultHeaps.Init(R->Device.Get(), D3D12_HEAP_TYPE_DEFAULT, HeapBlockBytes);
+    UploadHeaps.Init(R->Device.Get(), D3D12_HEAP_TYPE_UPLOAD, HeapBlockBytes);
+
+    for (uint32_t Format = 0; Format < VertexFormatCount; Format++)
+    {
+        VertexArenas[Format].Stride = static_cast<UINT>(GetVertexStride(static_cast<VertexFormat>(Format)));
+        VertexArenas[Format].Index = Format;
+    }
+    IndexArenas[0].Stride = sizeof(uint16_t);
+    IndexArenas[1].Stride = sizeof(uint32_t);
+    for (uint32_t Idx = 0; Idx < 2; Idx++)
+    {
+        IndexArenas[Idx].bIndices = true;
+        IndexArenas[Idx].Index = VertexFormatCount + Idx;
+    }
 
-    ProcessScene(); // Load the one and only mesh.
-    
     CompileShaders();
     CreatePSO();
+    if (!CreateDrawSignature()) { bIndirectDraws = false; }
     SetupConstantBuffer();
-    SetupIndexBuffer();
-    SetupVertexBuffer();
+    CreateUploadObjects();
+    ProcessScene();
 
-    HRESULT HR = R->Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, R->CmdAllocator.Get(), MeshPSO.Get(), IID_PPV_ARGS(&CmdList));
+    HRESULT HR = R->Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, R->CmdAllocator.Get(), MeshPSOs[0].Get(), IID_PPV_ARGS(&CmdList));
     if (FAILED(HR))
     {
         MessageBoxW(nullptr, L"Failed to create 'StaticMeshPipeline' command list!", L"Error", MB_OK);
@@ -46,7 +89,7 @@ ComPtr<ID3D12GraphicsCommandList> StaticMeshPipeline::PopulateCmdList()
 
     HRESULT HR;
 
-    HR = CmdList->Reset(R->CmdAllocator.Get(), MeshPSO.Get());
+    HR = CmdList->Reset(R->CmdAllocator.Get(), MeshPSOs[0].Get());
     if (FAILED(HR))
     {
         MessageBoxW(nullptr, L"Failed to reset the StaticMeshPipeline command list!", L"Error", MB_OK);
@@ -62,7 +105,6 @@ ComPtr<ID3D12GraphicsCommandList> StaticMeshPipeline::PopulateCmdList()
     ScissorRect.left = 0;
     ScissorRect.top = 0;
     CmdList->RSSetScissorRects(1, &ScissorRect);
-    CmdList->SetPipelineState(MeshPSO.Get());
 
     // Set the RT for the Output merger for this PSO.
     R->SetBackBufferOM(CmdList);
@@ -73,13 +115,68 @@ ComPtr<ID3D12GraphicsCommandList> StaticMeshPipeline::PopulateCmdList()
     D3D12_GPU_DESCRIPTOR_HANDLE CbHandle(ConstantBufferHeap->GetGPUDescriptorHandleForHeapStart());
     CmdList->SetGraphicsRootDescriptorTable(0, CbHandle);
     
-    // Mesh rendering
-    CmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    CmdList->IASetVertexBuffers(0, 1, &VertexBufferView);
-    CmdList->IASetIndexBuffer(&IndexBufferView);
+    // Mesh rendering, one instanced draw per mesh. The instance stream's start location selects its Model matrices.
+    ArenaStats.NumBindings = 0;
+    SortStats.NumPipelineChanges = 0;
+    if (!Meshes.empty())
+    {
+        CmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        CmdList->IASetVertexBuffers(1, 1, &TransformBufferView);
+
+        // The PSO only changes when the vertex format does, scenes are normally built in a single format. Meshes of one format
+        // share a vertex arena, so the buffers are only bound again between formats, index sizes and the deform ring. Sorted
+        // packets group all three.
+        VertexFormat BoundFormat = VertexFormat::Count;
+        const D3D12_VERTEX_BUFFER_VIEW* BoundVertices = nullptr;
+        const D3D12_INDEX_BUFFER_VIEW* BoundIndices = nullptr;
+        const auto BindMesh = [&](const MeshBuffers& Mesh)
+        {
+            if (Mesh.Format != BoundFormat)
+            {
+                CmdList->SetPipelineState(MeshPSOs[static_cast<size_t>(Mesh.Format)].Get());
+                BoundFormat = Mesh.Format;
+                SortStats.NumPipelineChanges++;
+            }
+            const D3D12_VERTEX_BUFFER_VIEW* Vertices = Mesh.bInDeformRing ? &DeformRingView : &GetVertexArena(Mesh).VertexView;
+            if (Vertices != BoundVertices)
+            {
+                CmdList->IASetVertexBuffers(0, 1, Vertices);
+                BoundVertices = Vertices;
+                ArenaStats.NumBindings++;
+            }
+            const D3D12_INDEX_BUFFER_VIEW* Indices = &GetIndexArena(Mesh).IndexView;
+            if (Indices != BoundIndices)
+            {
+                CmdList->IASetIndexBuffer(Indices);
+                BoundIndices = Indices;
+                ArenaStats.NumBindings++;
+            }
+        };
 
-    const UINT NumIndices = static_cast<UINT>(CurrentMesh->Indices.size()); 
-    CmdList->DrawIndexedInstanced(NumIndices, 1, 0 ,0, 0);
+        if (bRecordIndirect)
+        {
+            // Every command of a batch sets its mesh's dequantisation constants and draws, so recording no longer grows with the draws.
+            for (const IndirectDrawBatch& Batch : IndirectDraws.Batches)
+            {
+                BindMesh(Meshes[Batch.Mesh]);
+                CmdList->ExecuteIndirect(DrawSignature.Get(), Batch.NumCommands, ArgumentBuffer.Get(), static_cast<UINT64>(Batch.FirstCommand) * sizeof(IndirectDrawCommand), nullptr, 0);
+            }
+            SortStats.NumExecuteIndirect = IndirectDraws.Batches.size();
+        }
+        else
+        {
+            for (const DrawPacket& Packet : DrawPackets)
+            {
+                const MeshBuffers& Mesh = Meshes[Packet.Mesh];
+                BindMesh(Mesh);
+                CmdList->SetGraphicsRoot32BitConstants(1, sizeof(PositionDequantisation) / sizeof(UINT), &Mesh.Dequantisation, 0);
+
+                const MeshLod& Lod = Mesh.Lods[Mesh.SelectedLod];
+                const INT BaseVertex = static_cast<INT>(Mesh.bInDeformRing ? Mesh.RingBaseVertex : Mesh.BaseVertex);
+                CmdList->DrawIndexedInstanced(Lod.NumIndices, Mesh.NumInstances, Mesh.FirstIndex + Lod.FirstIndex, BaseVertex, Mesh.FirstInstance);
+            }
+        }
+    }
     
     // Finalise command list and queues.
     CmdList->EndEvent();
@@ -93,24 +190,384 @@ ComPtr<ID3D12GraphicsCommandList> StaticMeshPipeline::PopulateCmdList()
     return CmdList;
 }
 
-inline void StaticMeshPipeline::ProcessScene()
+void StaticMeshPipeline::ProcessScene()
 {
-    if (G_MainWindow->Scene->GetMeshes().size() <= 0)
+    nvtx3::scoped_range r("SMPipe-ProcessScene");
+
+    if (G_MainWindow->Scene->GetMeshes().empty())
     {
         return;
     }
-    
-    std::shared_ptr<RenderMesh> RMesh = G_MainWindow->Scene->GetMeshes()[0]; // Only one for now.
-    CurrentMesh = RMesh->GetMeshData();
+
+    SetupMeshBuffers(0);
+}
+
+bool StaticMeshPipeline::SetupMeshBuffers(size_t FirstMesh)
+{
+    const std::vector<std::shared_ptr<RenderMesh>> SceneMeshes = G_MainWindow->Scene->GetMeshes();
+    const std::vector<MeshInstanceRange>& InstanceRanges = G_MainWindow->Scene->GetInstanceRanges();
+
+    // Meshes before FirstMesh keep their ranges, only their rows in the transform buffer may have moved.
+    Meshes.resize(SceneMeshes.size());
+    if (!ReserveArenas(FirstMesh)) { return false; }
+    for (size_t Idx = 0; Idx < SceneMeshes.size(); Idx++)
+    {
+        MeshBuffers& Buffers = Meshes[Idx];
+        Buffers.FirstInstance = InstanceRanges[Idx].FirstInstance;
+        Buffers.NumInstances = InstanceRanges[Idx].NumInstances;
+        if (Idx < FirstMesh) { continue; }
+        
+        if (!SetupMeshGeometry(*SceneMeshes[Idx]->GetMeshData(), Buffers, false)) { return false; }
+    }
+
+    // Slots follow the mesh indices, so the ring is laid out again whenever the meshes change.
+    if (!SetupDeformRing()) { return false; }
+    return SetupTransformBuffer();
+}
+
+bool StaticMeshPipeline::SetupMeshGeometry(const MeshData& Data, MeshBuffers& Buffers, bool bKeepIndexBuffer)
+{
+    // A rebuilt mesh hands its old ranges back first, unchanged indices stay where they are.
+    FreeMeshGeometry(Buffers, bKeepIndexBuffer);
+    Buffers.bInDeformRing = false;
+    if (Data.GetNumIndices() == 0)
+    {
+        // Every triangle was degenerate.
+        Buffers.Lods.clear();
+        Buffers.Occluder = OccluderMesh();
+        return true;
+    }
+
+    Buffers.Format = Data.Format;
+    if (!AllocateArenaRange(GetVertexArena(Buffers), Data.GetNumVertices(), Buffers.BaseVertex)) { return false; }
+    Buffers.NumVertices = static_cast<UINT>(Data.GetNumVertices());
+    if (!WriteMeshVertices(Buffers, Data)) { return false; }
+    if (!bKeepIndexBuffer)
+    {
+        Buffers.b16BitIndices = Data.Uses16BitIndices();
+        if (!AllocateArenaRange(GetIndexArena(Buffers), Data.GetNumIndices(), Buffers.FirstIndex)) { return false; }
+        Buffers.NumIndices = static_cast<UINT>(Data.GetNumIndices());
+        if (!WriteMeshIndices(Buffers, Data)) { return false; }
+    }
+    Buffers.Dequantisation = Data.Dequantisation;
+    Buffers.Lods = Data.Lods;
+    Buffers.SelectedLod = 0;
+    Buffers.BoundsCenter = Data.BoundsCenter;
+    Buffers.BoundsRadius = Data.BoundsRadius;
+    Buffers.BoundsExtents = Data.BoundsExtents;
+    Buffers.Occluder = Data.Occluder;
+    return true;
+}
+
+void StaticMeshPipeline::FreeMeshGeometry(MeshBuffers& Buffers, bool bKeepIndexBuffer)
+{
+    if (Buffers.NumVertices > 0)
+    {
+        GetVertexArena(Buffers).Allocator.Free(Buffers.BaseVertex, Buffers.NumVertices);
+        Buffers.NumVertices = 0;
+    }
+    if (!bKeepIndexBuffer && Buffers.NumIndices > 0)
+    {
+        GetIndexArena(Buffers).Allocator.Free(Buffers.FirstIndex, Buffers.NumIndices);
+        Buffers.NumIndices = 0;
+    }
+}
+
+void StaticMeshPipeline::CullMeshes(const Camera& View)
+{
+    nvtx3::scoped_range r("SMPipe-CullMeshes");
+
+    const auto Start = std::chrono::steady_clock::now();
+    const Frustum ViewFrustum = View.GetFrustum(R->AspectRatio);
+
+    CullStats = CullDrawStats();
+    CullStats.NumInstances = Bounds.size();
+    CullKernelStats KernelStats;
+    VisibleInstances.clear();
+    switch (CullMode)
+    {
+    case MeshCullMode::Flat:
+        FrustumCulling::Cull(CullBounds, ViewFrustum, VisibleInstances, KernelStats);
+        CullStats.NumSphereCulled = KernelStats.NumSphereCulled;
+        CullStats.NumBoxCulled = KernelStats.NumBoxCulled;
+        break;
+    case MeshCullMode::BVH:
+        InstanceBVH.QueryFrustum(ViewFrustum, VisibleInstances);
+        break;
+    default:
+        for (uint32_t Row = 0; Row < static_cast<uint32_t>(Bounds.size()); Row++) { VisibleInstances.push_back(Row); }
+        break;
+    }
+
+    if (bOcclusionCulling) { CullOccluded(View); }
+
+    // Instances share their mesh's draw, so a mesh is drawn whole when any of its instances is visible.
+    for (MeshBuffers& Mesh : Meshes) { Mesh.bVisible = false; }
+    for (const uint32_t Row : VisibleInstances) { Meshes[InstanceMeshes[Row]].bVisible = true; }
+
+    DrawList.clear();
+    for (UINT MeshIdx = 0; MeshIdx < static_cast<UINT>(Meshes.size()); MeshIdx++)
+    {
+        const MeshBuffers& Mesh = Meshes[MeshIdx];
+        if (Mesh.NumIndices == 0) { continue; }
+
+        CullStats.NumMeshes++;
+        if (Mesh.bVisible) { DrawList.push_back(MeshIdx); }
+    }
+    CullStats.NumVisibleMeshes = DrawList.size();
+    CullStats.NumVisibleInstances = VisibleInstances.size();
+    CullStats.CullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+void StaticMeshPipeline::CullOccluded(const Camera& View)
+{
+    nvtx3::scoped_range r("SMPipe-CullOccluded");
+
+    // The largest instances in view with an occluder are drawn into the buffer, then every visible instance is tested against it.
+    const DirectX::XMVECTOR Eye = View.GetPosition();
+    OccluderCandidates.clear();
+    for (const uint32_t Row : VisibleInstances)
+    {
+        if (Meshes[InstanceMeshes[Row]].Occluder.IsEmpty()) { continue; }
+
+        const InstanceBounds& Instance = Bounds[Row];
+        const float CenterDistance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&Instance.Center), Eye)));
+        OccluderCandidates.push_back(OccluderCandidate{ Row, Instance.Radius / std::max(CenterDistance, MinLodDistance) });
+    }
+    OcclusionCulling::SelectOccluders(OccluderCandidates);
+
+    const std::vector<DirectX::XMFLOAT4X4>& Transforms = G_MainWindow->Scene->GetInstanceTransforms();
+    Occluders.clear();
+    for (const OccluderCandidate& Candidate : OccluderCandidates)
+    {
+        Occluders.push_back(OccluderInstance{ &Meshes[InstanceMeshes[Candidate.Object]].Occluder, Transforms[Candidate.Object] });
+    }
+
+    const uint32_t BufferHeight = static_cast<uint32_t>(std::ceil(OcclusionCulling::BufferWidth / R->AspectRatio));
+    Occlusion.Resize(OcclusionCulling::BufferWidth, BufferHeight);
+
+    OcclusionStats Stats;
+    Occlusion.Render(Occluders, DirectX::XMMatrixMultiply(View.GetViewMatrix(), View.GetProjectionMatrix(R->AspectRatio)), Stats);
+    OcclusionCulling::RemoveOccluded(Occlusion, InstanceBoxes, VisibleInstances, Stats);
+
+    CullStats.NumOccluders = Stats.NumOccluders;
+    CullStats.NumOccluderTriangles = Stats.NumOccluderTriangles;
+    CullStats.NumOccluded = Stats.NumOccluded;
+    CullStats.OcclusionMs = Stats.RasterMs + Stats.TestMs;
+}
+
+bool StaticMeshPipeline::Pick(const DirectX::XMFLOAT3& Origin, const DirectX::XMFLOAT3& Direction, MeshPickResult& OutResult) const
+{
+    BVHRayHit Hit;
+    if (!InstanceBVH.Raycast(Origin, Direction, FLT_MAX, Hit)) { return false; }
+
+    OutResult.Mesh = InstanceMeshes[Hit.Object];
+    OutResult.Instance = Hit.Object - Meshes[OutResult.Mesh].FirstInstance;
+    OutResult.Distance = Hit.Distance;
+    return true;
+}
+
+void StaticMeshPipeline::SelectLods(const Camera& View)
+{
+    nvtx3::scoped_range r("SMPipe-SelectLods");
+
+    // An error of E at distance D covers E / D * PixelsPerRadian pixels, with the vertical field of view spanning the viewport.
+    const float PixelsPerRadian = R->Viewport.Height / (2.0f * std::tan(DirectX::XMConvertToRadians(View.GetFieldOfView()) * 0.5f));
+    const DirectX::XMVECTOR Eye = View.GetPosition();
+
+    LodStats = LodDrawStats();
+    for (MeshBuffers& Mesh : Meshes)
+    {
+        Mesh.SelectedLod = 0;
+        if (Mesh.NumIndices == 0 || !Mesh.bVisible) { continue; }
+
+        if (Mesh.Lods.size() > 1)
+        {
+            // Every instance shares the draw, so the instance with the largest projected error picks the LOD for all of them.
+            float MaxErrorScale = 0.0f;
+            for (UINT Row = Mesh.FirstInstance; Row < Mesh.FirstInstance + Mesh.NumInstances; Row++)
+            {
+                const InstanceBounds& Instance = Bounds[Row];
+                const float CenterDistance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&Instance.Center), Eye)));
+                MaxErrorScale = std::max(MaxErrorScale, Instance.Scale / std::max(CenterDistance - Instance.Radius, MinLodDistance));
+            }
+
+            // Coarsest level that stays within the pixel error.
+            const float PixelsPerError = MaxErrorScale * PixelsPerRadian;
+            while (Mesh.SelectedLod + 1 < Mesh.Lods.size() && Mesh.Lods[Mesh.SelectedLod + 1].Error * PixelsPerError <= MaxLodPixelError)
+            {
+                Mesh.SelectedLod++;
+            }
+        }
+
+        LodStats.NumTriangles += static_cast<size_t>(Mesh.Lods[Mesh.SelectedLod].NumIndices / 3) * Mesh.NumInstances;
+        LodStats.NumLod0Triangles += static_cast<size_t>(Mesh.Lods[0].NumIndices / 3) * Mesh.NumInstances;
+    }
+}
+
+void StaticMeshPipeline::BuildDrawPackets(const Camera& View)
+{
+    nvtx3::scoped_range r("SMPipe-BuildDrawPackets");
+
+    const auto Start = std::chrono::steady_clock::now();
+    SortStats = DrawSortStats();
+
+    // A mesh's depth is the nearest point of its nearest visible instance's sphere, as its instances share the draw.
+    const DirectX::XMVECTOR Eye = View.GetPosition();
+    MeshDepths.assign(Meshes.size(), FLT_MAX);
+    for (const uint32_t Row : VisibleInstances)
+    {
+        const InstanceBounds& Instance = Bounds[Row];
+        const float CenterDistance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&Instance.Center), Eye)));
+        float& Depth = MeshDepths[InstanceMeshes[Row]];
+        Depth = std::min(Depth, CenterDistance - Instance.Radius);
+    }
+
+    // The vertex format picks the PSO. Meshes have no materials yet, the buffers they bind stand in for one: the deform ring or
+    // their format's arena, and the 16 or 32 bit index arena.
+    DrawPackets.clear();
+    for (const UINT MeshIdx : DrawList)
+    {
+        const MeshBuffers& Mesh = Meshes[MeshIdx];
+        const uint32_t Material = (Mesh.bInDeformRing ? 2u : 0u) | (Mesh.b16BitIndices ? 0u : 1u);
+        DrawPackets.push_back(DrawPacket{ DrawSorting::MakeKey(DrawPass::Opaque, static_cast<uint32_t>(Mesh.Format), Material, MeshDepths[MeshIdx]), MeshIdx });
+    }
+    if (bSortDraws)
+    {
+        DrawSorter.Sort(DrawPackets);
+        SortStats.NumSortPasses = DrawSorter.GetNumPasses();
+    }
+    // Fixed here, the menu may change bIndirectDraws before the command list is recorded.
+    bRecordIndirect = bIndirectDraws && DrawSignature;
+    if (bRecordIndirect) { BuildIndirectDraws(); }
+
+    SortStats.NumPackets = DrawPackets.size();
+    SortStats.SortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+void StaticMeshPipeline::BuildIndirectDraws()
+{
+    // The command each packet's mesh would be drawn with directly.
+    MeshCommands.resize(Meshes.size());
+    for (const DrawPacket& Packet : DrawPackets)
+    {
+        const MeshBuffers& Mesh = Meshes[Packet.Mesh];
+        const MeshLod& Lod = Mesh.Lods[Mesh.SelectedLod];
+        IndirectDrawCommand& Command = MeshCommands[Packet.Mesh];
+        Command.Dequantisation = Mesh.Dequantisation;
+        Command.IndexCountPerInstance = Lod.NumIndices;
+        Command.InstanceCount = Mesh.NumInstances;
+        Command.StartIndexLocation = Mesh.FirstIndex + Lod.FirstIndex;
+        Command.BaseVertexLocation = static_cast<INT>(Mesh.bInDeformRing ? Mesh.RingBaseVertex : Mesh.BaseVertex);
+        Command.StartInstanceLocation = Mesh.FirstInstance;
+    }
+    IndirectDraws::Build(MeshCommands, DrawPackets, IndirectDraws);
+    SortStats.NumCompacted = IndirectDraws.NumCompacted;
+    if (IndirectDraws.Commands.empty()) { return; }
+
+    if (IndirectDraws.Commands.size() > ArgumentCapacity)
+    {
+        // Half as much again, so a scene streaming in meshes does not grow it every frame.
+        ArgumentBuffer.Reset();
+        ArgumentData = nullptr;
+        ArgumentCapacity = 0;
+        const size_t Capacity = std::max<size_t>(IndirectDraws.Commands.size() * 3 / 2, 1024);
+        D3D12_RANGE ReadRange;
+        ReadRange.Begin = 0;
+        ReadRange.End = 0;
+        if (!CreateUploadBuffer(Capacity * sizeof(IndirectDrawCommand), ArgumentBuffer)
+            || FAILED(ArgumentBuffer->Map(0, &ReadRange, reinterpret_cast<void**>(&ArgumentData))))
+        {
+            MessageBoxW(nullptr, L"Failed to create indirect argument buffer!", L"Error", MB_OK);
+            PostQuitMessage(1);
+            IndirectDraws.Clear();
+            return;
+        }
+        ArgumentBuffer->SetName(L"Indirect Argument Buffer");
+        ArgumentCapacity = Capacity;
+    }
+    memcpy(ArgumentData, IndirectDraws.Commands.data(), IndirectDraws.Commands.size() * sizeof(IndirectDrawCommand));
 }
 
 void StaticMeshPipeline::ResetScene()
 {
-    IndexBuffer.Reset();
-    VertexBuffer.Reset();
+    Meshes.clear();
+    ResetArenas();
+    DrawList.clear();
+    DrawPackets.clear();
+    IndirectDraws.Clear();
+    TransformBuffer.Reset();
+    InstanceBVH.Clear();
+    CullBounds.Resize(0);
+    Bounds.clear();
+    InstanceBoxes.clear();
+    InstanceMeshes.clear();
+    ResetDeformRing();
     ProcessScene();
-    SetupIndexBuffer();
-    SetupVertexBuffer();
+}
+
+void StaticMeshPipeline::ApplyStreamingUpdate(const SceneStreamingUpdate& Streaming)
+{
+    if (!Streaming.bChanged) { return; }
+
+    nvtx3::scoped_range r("SMPipe-ApplyStreamingUpdate");
+
+    // The previous frame has finished by now, ranges of evicted and replaced meshes can be reused straight away.
+    for (auto It = Streaming.RemovedMeshes.rbegin(); It != Streaming.RemovedMeshes.rend(); ++It)
+    {
+        FreeMeshGeometry(Meshes[*It], false);
+        Meshes.erase(Meshes.begin() + *It);
+    }
+
+    const std::vector<std::shared_ptr<RenderMesh>> SceneMeshes = G_MainWindow->Scene->GetMeshes();
+    if (SceneMeshes.empty())
+    {
+        Meshes.clear();
+        DrawList.clear();
+        DrawPackets.clear();
+        IndirectDraws.Clear();
+        TransformBuffer.Reset();
+        InstanceBVH.Clear();
+        CullBounds.Resize(0);
+        Bounds.clear();
+        InstanceBoxes.clear();
+        InstanceMeshes.clear();
+        ResetDeformRing();
+        ResetArenas();
+        return;
+    }
+
+    // Meshes rebuilt by a stage edit get new ranges, every other mesh keeps its own. Their old ranges are handed back before the
+    // arenas are compacted, which writes every mesh from its current data.
+    for (const SceneMeshRebuild& Rebuild : Streaming.RebuiltMeshes)
+    {
+        FreeMeshGeometry(Meshes[Rebuild.Mesh], Rebuild.bSameIndices);
+    }
+    if (!Streaming.RemovedMeshes.empty()) { CompactArenas(); }
+    for (const SceneMeshRebuild& Rebuild : Streaming.RebuiltMeshes)
+    {
+        if (!SetupMeshGeometry(*SceneMeshes[Rebuild.Mesh]->GetMeshData(), Meshes[Rebuild.Mesh], Rebuild.bSameIndices)) { return; }
+    }
+
+    if (Streaming.bRowsMoved || !Streaming.RemovedMeshes.empty() || Streaming.FirstNewMesh < SceneMeshes.size())
+    {
+        SetupMeshBuffers(Streaming.FirstNewMesh);
+        return;
+    }
+
+    // Same rows, only the rebuilt meshes' bounds and the edited rows change.
+    const std::vector<DirectX::XMFLOAT4X4>& Transforms = G_MainWindow->Scene->GetInstanceTransforms();
+    if (!Streaming.RebuiltMeshes.empty())
+    {
+        if (!SetupDeformRing()) { return; }
+        for (const SceneMeshRebuild& Rebuild : Streaming.RebuiltMeshes)
+        {
+            const MeshBuffers& Mesh = Meshes[Rebuild.Mesh];
+            for (UINT Row = Mesh.FirstInstance; Row < Mesh.FirstInstance + Mesh.NumInstances; Row++) { UpdateInstanceBounds(Row, Transforms[Row]); }
+        }
+    }
+    WriteTransformRows(Streaming.ChangedRows);
+    InstanceBVH.Refit(InstanceBoxes);
 }
 
 void StaticMeshPipeline::Update(const CB_WVP& WVP)
@@ -148,6 +605,14 @@ bool StaticMeshPipeline::CompileShaders()
         PostQuitMessage(1);
         return bResult;
     }
+    const D3D_SHADER_MACRO OctahedralDefines[] = { { "OCTAHEDRAL_NORMALS", "1" }, { nullptr, nullptr } };
+    HR = D3DCompileFromFile(L"./Shaders.hlsl", OctahedralDefines, nullptr, "VSMain", "vs_5_0", CompileFlags, 0, &VSOctahedral, nullptr);
+    if (FAILED(HR))
+    {
+        MessageBoxW(nullptr, L"Failed to compile vertex shaders!", L"Error", MB_OK);
+        PostQuitMessage(1);
+        return bResult;
+    }
     HR = D3DCompileFromFile(L"./Shaders.hlsl", nullptr, nullptr, "PSMain", "ps_5_0", CompileFlags, 0, &PS, nullptr);
     if (FAILED(HR))
     {
@@ -161,14 +626,59 @@ bool StaticMeshPipeline::CompileShaders()
 }
 
 bool StaticMeshPipeline::CreatePSO()
+{
+    for (size_t Format = 0; Format < static_cast<size_t>(VertexFormat::Count); Format++)
+    {
+        if (!CreatePSO(static_cast<VertexFormat>(Format))) { return false; }
+    }
+    return true;
+}
+
+bool StaticMeshPipeline::CreateDrawSignature()
+{
+    // Matches IndirectDrawCommand. Changing root constants needs the root signature they belong to.
+    D3D12_INDIRECT_ARGUMENT_DESC Arguments[2] = {};
+    Arguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+    Arguments[0].Constant.RootParameterIndex = 1;
+    Arguments[0].Constant.DestOffsetIn32BitValues = 0;
+    Arguments[0].Constant.Num32BitValuesToSet = sizeof(PositionDequantisation) / sizeof(UINT);
+    Arguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+    D3D12_COMMAND_SIGNATURE_DESC SignatureDesc = {};
+    SignatureDesc.ByteStride = sizeof(IndirectDrawCommand);
+    SignatureDesc.NumArgumentDescs = _countof(Arguments);
+    SignatureDesc.pArgumentDescs = Arguments;
+
+    HRESULT HR = R->Device->CreateCommandSignature(&SignatureDesc, R->RootSig.Get(), IID_PPV_ARGS(&DrawSignature));
+    if (FAILED(HR))
+    {
+        std::cout << "Failed to create the indirect draw command signature, drawing directly.\n";
+        return false;
+    }
+    return true;
+}
+
+bool StaticMeshPipeline::CreatePSO(VertexFormat Format)
 {
     bool bResult = false;
+
+    // Slot 0 layout of the vertex format, the quantised formats are converted to float by the input assembler.
+    const bool bQuantised = Format != VertexFormat::Float;
+    const DXGI_FORMAT PositionFormat =
+        Format == VertexFormat::QuantisedHalf ? DXGI_FORMAT_R16G16B16A16_FLOAT :
+        Format == VertexFormat::QuantisedBounds ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32_FLOAT;
     
     D3D12_INPUT_ELEMENT_DESC InElementDesc[] =  // Define the vertex input layout.
     {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+        { "POSITION", 0, PositionFormat, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, bQuantised ? DXGI_FORMAT_R16G16_SNORM : DXGI_FORMAT_R32G32B32_FLOAT, 0, bQuantised ? 8u : 12u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "COLOR", 0, bQuantised ? DXGI_FORMAT_R8G8B8A8_UNORM : DXGI_FORMAT_R32G32B32A32_FLOAT, 0, bQuantised ? 12u : 24u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+
+        // Slot 1: Model to World matrix rows, stepped once per instance.
+        { "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+        { "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }
     };
     
     D3D12_RASTERIZER_DESC Raster_Desc{};
@@ -217,7 +727,8 @@ bool StaticMeshPipeline::CreatePSO()
     D3D12_GRAPHICS_PIPELINE_STATE_DESC PipeStateDesc = {};
     PipeStateDesc.InputLayout = { InElementDesc, _countof(InElementDesc) }; // Array of shader intrinsics
     PipeStateDesc.pRootSignature = R->RootSig.Get();
-    PipeStateDesc.VS = {reinterpret_cast<UINT8*>(VS->GetBufferPointer()), VS->GetBufferSize()};
+    ID3DBlob* FormatVS = bQuantised ? VSOctahedral.Get() : VS.Get();
+    PipeStateDesc.VS = {reinterpret_cast<UINT8*>(FormatVS->GetBufferPointer()), FormatVS->GetBufferSize()};
     PipeStateDesc.PS = {reinterpret_cast<UINT8*>(PS->GetBufferPointer()), PS->GetBufferSize()};
     PipeStateDesc.RasterizerState = Raster_Desc;
     PipeStateDesc.BlendState = Blend_Desc;
@@ -229,6 +740,7 @@ bool StaticMeshPipeline::CreatePSO()
     PipeStateDesc.RTVFormats[0] = G_MainWindow->RendererDX->FrameBufferFormat;
     PipeStateDesc.SampleDesc.Count = 1;
 
+    ComPtr<ID3D12PipelineState>& MeshPSO = MeshPSOs[static_cast<size_t>(Format)];
     HRESULT HR = R->Device->CreateGraphicsPipelineState(&PipeStateDesc, IID_PPV_ARGS(&MeshPSO));
     if (FAILED(HR))
     {
@@ -236,7 +748,7 @@ bool StaticMeshPipeline::CreatePSO()
         PostQuitMessage(1);
         return bResult;
     }
-    MeshPSO->SetName(L"Pipeline State (PSO) - Mesh");
+    MeshPSO->SetName(bQuantised ? L"Pipeline State (PSO) - Mesh Quantised" : L"Pipeline State (PSO) - Mesh");
 
     bResult = true;
     return bResult;
@@ -261,29 +773,7 @@ bool StaticMeshPipeline::SetupConstantBuffer()
         return bResult;
     }
 
-    D3D12_HEAP_PROPERTIES HeapProps;
-    HeapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-    HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-    HeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-    HeapProps.CreationNodeMask = 0;
-    HeapProps.VisibleNodeMask = 0;
-
-    D3D12_RESOURCE_DESC CbResourceDesc;
-    CbResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    CbResourceDesc.Alignment = 0;
-    CbResourceDesc.Width = (sizeof(R->WVP) + 255) & ~255;
-    CbResourceDesc.Height = 1;
-    CbResourceDesc.DepthOrArraySize = 1;
-    CbResourceDesc.MipLevels = 1;
-    CbResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
-    CbResourceDesc.SampleDesc.Count = 1;
-    CbResourceDesc.SampleDesc.Quality = 0;
-    CbResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-    CbResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-    HR = R->Device->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE, &CbResourceDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&ConstantBuffer));
-    if (FAILED(HR))
+    if (!CreateUploadBuffer((sizeof(R->WVP) + 255) & ~255, ConstantBuffer))
     {
         MessageBoxW(nullptr, L"Failed to create constant buffer!", L"Error", MB_OK);
         PostQuitMessage(1);
@@ -323,139 +813,615 @@ bool StaticMeshPipeline::SetupConstantBuffer()
     return bResult;
 }
 
-bool StaticMeshPipeline::SetupVertexBuffer()
+bool StaticMeshPipeline::CreateUploadBuffer(UINT64 Size, PlacedBuffer& OutBuffer)
 {
-    HRESULT HR;
-    bool bResult = false;
+    return UploadHeaps.CreateBuffer(Size, D3D12_RESOURCE_STATE_GENERIC_READ, OutBuffer);
+}
+
+bool StaticMeshPipeline::CreateDefaultBuffer(UINT64 Size, PlacedBuffer& OutBuffer)
+{
+    return DefaultHeaps.CreateBuffer(Size, D3D12_RESOURCE_STATE_COMMON, OutBuffer);
+}
+
+bool StaticMeshPipeline::CreateArenaBuffer(GeometryArena& Arena, UINT64 Capacity)
+{
+    ReleaseArena(Arena);
+
+    Capacity = std::max(Capacity, MinArenaBytes / Arena.Stride);
+    const UINT64 Size = Capacity * Arena.Stride;
+    if (!CreateDefaultBuffer(Size, Arena.Buffer))
+    {
+        MessageBoxW(nullptr, L"Failed to create geometry arena buffer!", L"Error", MB_OK);
+        PostQuitMessage(1);
+        return false;
+    }
+    Arena.Buffer->SetName(Arena.bIndices ? L"Index Arena Buffer" : L"Vertex Arena Buffer");
+    Arena.State = D3D12_RESOURCE_STATE_COMMON;
+    Arena.Allocator.Reset(Capacity);
+
+    if (Arena.bIndices)
+    {
+        Arena.IndexView.BufferLocation = Arena.Buffer->GetGPUVirtualAddress();
+        Arena.IndexView.Format = Arena.Stride == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+        Arena.IndexView.SizeInBytes = static_cast<UINT>(Size);
+    }
+    else
+    {
+        Arena.VertexView.BufferLocation = Arena.Buffer->GetGPUVirtualAddress();
+        Arena.VertexView.StrideInBytes = Arena.Stride;
+        Arena.VertexView.SizeInBytes = static_cast<UINT>(Size);
+    }
+    return true;
+}
+
+bool StaticMeshPipeline::AllocateArenaRange(GeometryArena& Arena, UINT64 Size, UINT& OutOffset)
+{
+    uint64_t Offset = 0;
+    if (!Arena.Allocator.Allocate(Size, Offset))
+    {
+        // Doubled, or half as much again as it has to hold, so growing stays rare.
+        const UINT64 Capacity = std::max(Arena.Allocator.GetCapacity() * 2, (Arena.Allocator.GetUsed() + Size) * 3 / 2);
+        if (!RepackArena(Arena, Capacity) || !Arena.Allocator.Allocate(Size, Offset)) { return false; }
+    }
+    OutOffset = static_cast<UINT>(Offset);
+    return true;
+}
+
+bool StaticMeshPipeline::RepackArena(GeometryArena& Arena, UINT64 Capacity)
+{
+    nvtx3::scoped_range r("SMPipe-RepackArena");
+
+    // The old buffer is kept until copies already submitted to it have completed, copies still pending are dropped. Every mesh
+    // holding a range is staged again in mesh order from its CPU copy, so the copies into the new buffer merge into a few.
+    if (!CreateArenaBuffer(Arena, Capacity)) { return false; }
+    ArenaStats.NumRepacks++;
+
+    const std::vector<std::shared_ptr<RenderMesh>> SceneMeshes = G_MainWindow->Scene->GetMeshes();
+    for (size_t MeshIdx = 0; MeshIdx < Meshes.size(); MeshIdx++)
+    {
+        MeshBuffers& Mesh = Meshes[MeshIdx];
+        uint64_t Offset = 0;
+        if (Arena.bIndices)
+        {
+            if (Mesh.NumIndices == 0 || &GetIndexArena(Mesh) != &Arena) { continue; }
+            if (!Arena.Allocator.Allocate(Mesh.NumIndices, Offset)) { return false; }
+            Mesh.FirstIndex = static_cast<UINT>(Offset);
+            if (!WriteMeshIndices(Mesh, *SceneMeshes[MeshIdx]->GetMeshData())) { return false; }
+        }
+        else
+        {
+            if (Mesh.NumVertices == 0 || &GetVertexArena(Mesh) != &Arena) { continue; }
+            if (!Arena.Allocator.Allocate(Mesh.NumVertices, Offset)) { return false; }
+            Mesh.BaseVertex = static_cast<UINT>(Offset);
+            if (!WriteMeshVertices(Mesh, *SceneMeshes[MeshIdx]->GetMeshData())) { return false; }
+        }
+    }
+    return true;
+}
+
+bool StaticMeshPipeline::ReserveArenas(size_t FirstMesh)
+{
+    // What the meshes from FirstMesh on need in each arena, so loading a scene grows every arena at most once.
+    const std::vector<std::shared_ptr<RenderMesh>> SceneMeshes = G_MainWindow->Scene->GetMeshes();
+    UINT64 VertexNeeds[static_cast<size_t>(VertexFormat::Count)] = {};
+    UINT64 IndexNeeds[2] = {};
+    for (size_t MeshIdx = FirstMesh; MeshIdx < SceneMeshes.size(); MeshIdx++)
+    {
+        const MeshData& Data = *SceneMeshes[MeshIdx]->GetMeshData();
+        if (Data.GetNumIndices() == 0) { continue; }
+
+        VertexNeeds[static_cast<size_t>(Data.Format)] += Data.GetNumVertices();
+        IndexNeeds[Data.Uses16BitIndices() ? 0 : 1] += Data.GetNumIndices();
+    }
+
+    const auto Reserve = [this](GeometryArena& Arena, UINT64 Needed)
+    {
+        if (Needed == 0 || Arena.Allocator.GetFree() >= Needed) { return true; }
+        return RepackArena(Arena, (Arena.Allocator.GetUsed() + Needed) * 5 / 4);
+    };
+    for (size_t Format = 0; Format < static_cast<size_t>(VertexFormat::Count); Format++)
+    {
+        if (!Reserve(VertexArenas[Format], VertexNeeds[Format])) { return false; }
+    }
+    return Reserve(IndexArenas[0], IndexNeeds[0]) && Reserve(IndexArenas[1], IndexNeeds[1]);
+}
+
+void StaticMeshPipeline::CompactArenas()
+{
+    // Holes left by removed meshes are closed once they waste a quarter of an arena, which also shrinks it to what it holds.
+    const auto Compact = [this](GeometryArena& Arena)
+    {
+        if (!Arena.Buffer) { return; }
+        if (Arena.Allocator.GetUsed() == 0)
+        {
+            ReleaseArena(Arena);
+            return;
+        }
+        if (Arena.Allocator.GetFragmented() * 4 > Arena.Allocator.GetCapacity())
+        {
+            RepackArena(Arena, Arena.Allocator.GetUsed() * 5 / 4);
+        }
+    };
+    for (GeometryArena& Arena : VertexArenas) { Compact(Arena); }
+    for (GeometryArena& Arena : IndexArenas) { Compact(Arena); }
+}
+
+void StaticMeshPipeline::ResetArenas()
+{
+    for (GeometryArena& Arena : VertexArenas) { ReleaseArena(Arena); }
+    for (GeometryArena& Arena : IndexArenas) { ReleaseArena(Arena); }
+    ArenaStats = ArenaDrawStats();
+}
+
+void StaticMeshPipeline::ReleaseArena(GeometryArena& Arena)
+{
+    std::erase_if(PendingCopies, [&Arena](const StagedCopy& Copy) { return Copy.Destination == Arena.Index; });
+    if (Arena.Buffer) { RetiredBuffers.emplace_back(std::move(Arena.Buffer), UploadFenceValue); }
+    Arena.Buffer.Reset();
+    Arena.State = D3D12_RESOURCE_STATE_COMMON;
+    Arena.Allocator.Reset(0);
+    Arena.VertexView = D3D12_VERTEX_BUFFER_VIEW{};
+    Arena.IndexView = D3D12_INDEX_BUFFER_VIEW{};
+}
+
+bool StaticMeshPipeline::WriteMeshVertices(const MeshBuffers& Mesh, const MeshData& Data)
+{
+    GeometryArena& Arena = GetVertexArena(Mesh);
+    return StageArenaWrite(Arena, static_cast<UINT64>(Mesh.BaseVertex) * Arena.Stride, Data.GetVertexData(), Data.GetVertexBufferSize());
+}
+
+bool StaticMeshPipeline::WriteMeshIndices(const MeshBuffers& Mesh, const MeshData& Data)
+{
+    // Indices are converted to the arena's size while they are written, straight into the ring when they fit in one piece.
+    GeometryArena& Arena = GetIndexArena(Mesh);
+    const UINT64 Offset = static_cast<UINT64>(Mesh.FirstIndex) * Arena.Stride;
+    const UINT64 Size = Data.GetIndexBufferSize();
+    if (Size <= MaxStagingChunk)
+    {
+        UINT8* Staged = StageArenaRange(Arena, Offset, Size);
+        if (!Staged) { return false; }
+        Data.CopyIndices(Staged);
+        return true;
+    }
+    IndexScratch.resize(Size);
+    Data.CopyIndices(IndexScratch.data());
+    return StageArenaWrite(Arena, Offset, IndexScratch.data(), Size);
+}
+
+bool StaticMeshPipeline::CreateUploadObjects()
+{
+    if (!CreateUploadBuffer(StagingRingBytes, StagingBuffer))
+    {
+        MessageBoxW(nullptr, L"Failed to create staging ring buffer!", L"Error", MB_OK);
+        PostQuitMessage(1);
+        return false;
+    }
 
-    // Load the meshes!
-    const UINT VertexBufferSize = sizeof(Vertex) * static_cast<UINT>(CurrentMesh->Vertices.size());
-
-    D3D12_HEAP_PROPERTIES HeapProps;
-    HeapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-    HeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-    HeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-    HeapProps.CreationNodeMask = 1;
-    HeapProps.VisibleNodeMask = 1;
-
-    D3D12_RESOURCE_DESC VertexBufferResourceDesc;
-    VertexBufferResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    VertexBufferResourceDesc.Alignment = 0;
-    VertexBufferResourceDesc.Width = VertexBufferSize;
-    VertexBufferResourceDesc.Height = 1;
-    VertexBufferResourceDesc.DepthOrArraySize = 1;
-    VertexBufferResourceDesc.MipLevels = 1;
-    VertexBufferResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
-    VertexBufferResourceDesc.SampleDesc.Count = 1;
-    VertexBufferResourceDesc.SampleDesc.Quality = 0;
-    VertexBufferResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-    VertexBufferResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-     
-    HR = R->Device->CreateCommittedResource(&HeapProps, D3D12_HEAP_FLAG_NONE, &VertexBufferResourceDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&VertexBuffer));
+    // Mapped for the ring's lifetime, like the deform ring.
+    D3D12_RANGE ReadRange;
+    ReadRange.Begin = 0;
+    ReadRange.End = 0;
+    if (FAILED(StagingBuffer->Map(0, &ReadRange, reinterpret_cast<void**>(&StagingData))))
+    {
+        MessageBoxW(nullptr, L"Failed to map staging ring buffer!", L"Error", MB_OK);
+        PostQuitMessage(1);
+        return false;
+    }
+    StagingBuffer->SetName(L"Staging Ring Buffer");
+    Staging.Reset(StagingRingBytes);
+
+    for (UploadContext& Context : UploadContexts)
+    {
+        if (FAILED(R->Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&Context.Allocator))))
+        {
+            MessageBoxW(nullptr, L"Failed to create upload command allocator!", L"Error", MB_OK);
+            PostQuitMessage(1);
+            return false;
+        }
+    }
+    HRESULT HR = R->Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, UploadContexts[0].Allocator.Get(), nullptr, IID_PPV_ARGS(&UploadCmdList));
     if (FAILED(HR))
     {
-        MessageBoxW(nullptr, L"Failed to create vertex buffer!", L"Error", MB_OK);
+        MessageBoxW(nullptr, L"Failed to create upload command list!", L"Error", MB_OK);
         PostQuitMessage(1);
-        return bResult;
+        return false;
+    }
+    UploadCmdList->Close();
+
+    HR = R->Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&UploadFence.Fence));
+    UploadFence.Event = CreateEvent(nullptr, false, false, nullptr);
+    if (FAILED(HR) || !UploadFence.Event)
+    {
+        MessageBoxW(nullptr, L"Failed to create upload fence!", L"Error", MB_OK);
+        PostQuitMessage(1);
+        return false;
     }
+    return true;
+}
 
-    // Copy the triangle data to the vertex buffer.
-    UINT8* VertexDataBegin;
+UINT8* StaticMeshPipeline::StageArenaRange(GeometryArena& Arena, UINT64 Offset, UINT64 Size)
+{
+    // A full ring first submits what is staged, then waits for the oldest batch in flight until the range fits.
+    uint64_t RingOffset = 0;
+    while (!Staging.Allocate(Size, StagingAlignment, RingOffset))
+    {
+        if (Staging.GetOpenBytes() > 0)
+        {
+            if (!SubmitUploads()) { return nullptr; }
+            continue;
+        }
+        if (!Staging.WaitForOldest(UploadFence)) { return nullptr; }
+        ArenaStats.NumStagingStalls++;
+    }
 
-    // We do not intend to read from this resource on the CPU.
+    StagingCopies::Append(PendingCopies, StagedCopy{ Arena.Index, Offset, RingOffset, Size });
+    ArenaStats.NumStagedBytes += Size;
+    return StagingData + RingOffset;
+}
+
+bool StaticMeshPipeline::StageArenaWrite(GeometryArena& Arena, UINT64 Offset, const void* Source, UINT64 Size)
+{
+    const UINT8* Bytes = static_cast<const UINT8*>(Source);
+    for (UINT64 Done = 0; Done < Size; Done += MaxStagingChunk)
+    {
+        const UINT64 Chunk = std::min(Size - Done, MaxStagingChunk);
+        UINT8* Staged = StageArenaRange(Arena, Offset + Done, Chunk);
+        if (!Staged) { return false; }
+        memcpy(Staged, Bytes + Done, Chunk);
+    }
+    return true;
+}
+
+bool StaticMeshPipeline::SubmitUploads()
+{
+    nvtx3::scoped_range r("SMPipe-SubmitUploads");
+
+    // Ring space of dropped copies only waits for what was submitted before it.
+    if (PendingCopies.empty())
+    {
+        Staging.Submit(UploadFenceValue);
+        ReleaseRetiredBuffers();
+        return true;
+    }
+
+    UploadContext& Context = UploadContexts[NextUploadContext];
+    NextUploadContext = (NextUploadContext + 1) % _countof(UploadContexts);
+    if (Context.FenceValue > UploadFence.GetCompletedValue())
+    {
+        UploadFence.Wait(Context.FenceValue);
+        ArenaStats.NumStagingStalls++;
+    }
+    if (FAILED(Context.Allocator->Reset()) || FAILED(UploadCmdList->Reset(Context.Allocator.Get(), nullptr)))
+    {
+        MessageBoxW(nullptr, L"Failed to reset the upload command list!", L"Error", MB_OK);
+        PostQuitMessage(1);
+        return false;
+    }
+
+    // Every arena written is a copy destination for the whole list, then goes back to being read by draws.
+    D3D12_RESOURCE_BARRIER Barriers[VertexFormatCount + 2] = {};
+    UINT NumBarriers = 0;
+    bool bWritten[VertexFormatCount + 2] = {};
+    for (const StagedCopy& Copy : PendingCopies) { bWritten[Copy.Destination] = true; }
+    const auto Transition = [&](bool bToCopy)
+    {
+        NumBarriers = 0;
+        for (uint32_t Idx = 0; Idx < VertexFormatCount + 2; Idx++)
+        {
+            if (!bWritten[Idx]) { continue; }
+
+            GeometryArena& Arena = GetArena(Idx);
+            const D3D12_RESOURCE_STATES ReadState = Arena.bIndices ? D3D12_RESOURCE_STATE_INDEX_BUFFER : D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+            D3D12_RESOURCE_BARRIER& Barrier = Barriers[NumBarriers++];
+            Barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            Barrier.Transition.pResource = Arena.Buffer.Get();
+            Barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            Barrier.Transition.StateBefore = bToCopy ? Arena.State : D3D12_RESOURCE_STATE_COPY_DEST;
+            Barrier.Transition.StateAfter = bToCopy ? D3D12_RESOURCE_STATE_COPY_DEST : ReadState;
+            Arena.State = Barrier.Transition.StateAfter;
+        }
+        UploadCmdList->ResourceBarrier(NumBarriers, Barriers);
+    };
+
+    Transition(true);
+    for (const StagedCopy& Copy : PendingCopies)
+    {
+        UploadCmdList->CopyBufferRegion(GetArena(Copy.Destination).Buffer.Get(), Copy.DestinationOffset, StagingBuffer.Get(), Copy.SourceOffset, Copy.Size);
+    }
+    Transition(false);
+    UploadCmdList->Close();
+
+    ID3D12CommandList* Lists[] = { UploadCmdList.Get() };
+    R->CmdQueue->ExecuteCommandLists(_countof(Lists), Lists);
+    R->CmdQueue->Signal(UploadFence.Fence.Get(), ++UploadFenceValue);
+    Context.FenceValue = UploadFenceValue;
+    Staging.Submit(UploadFenceValue);
+
+    ArenaStats.NumCopies += PendingCopies.size();
+    ArenaStats.NumSubmits++;
+    PendingCopies.clear();
+    ReleaseRetiredBuffers();
+    return true;
+}
+
+void StaticMeshPipeline::ReleaseRetiredBuffers()
+{
+    const UINT64 Completed = UploadFence.GetCompletedValue();
+    Staging.Retire(Completed);
+    std::erase_if(RetiredBuffers, [Completed](const std::pair<PlacedBuffer, UINT64>& Retired) { return Retired.second <= Completed; });
+}
+
+void QueueStagingFence::Wait(uint64_t Value)
+{
+    if (Fence->GetCompletedValue() >= Value) { return; }
+    Fence->SetEventOnCompletion(Value, Event);
+    WaitForSingleObject(Event, INFINITE);
+}
+
+ArenaDrawStats StaticMeshPipeline::GetArenaStats() const
+{
+    ArenaDrawStats Stats = ArenaStats;
+    const auto Add = [&Stats](const GeometryArena& Arena)
+    {
+        if (!Arena.Buffer) { return; }
+        Stats.NumArenas++;
+        Stats.UsedBytes += static_cast<size_t>(Arena.Allocator.GetUsed()) * Arena.Stride;
+        Stats.CapacityBytes += static_cast<size_t>(Arena.Allocator.GetCapacity()) * Arena.Stride;
+    };
+    for (const GeometryArena& Arena : VertexArenas) { Add(Arena); }
+    for (const GeometryArena& Arena : IndexArenas) { Add(Arena); }
+    return Stats;
+}
+
+void StaticMeshPipeline::UpdateInstanceBounds(UINT Row, const DirectX::XMFLOAT4X4& Transform)
+{
+    // Rows of meshes without triangles keep an empty box, which the BVH never returns and flat culling never passes.
+    const MeshBuffers& Mesh = Meshes[InstanceMeshes[Row]];
+    if (Mesh.NumIndices == 0)
+    {
+        Bounds[Row] = InstanceBounds();
+        InstanceBoxes[Row] = BoundingBox();
+        CullBounds.SetNeverVisible(Row);
+        return;
+    }
+
+    const DirectX::XMMATRIX World = DirectX::XMLoadFloat4x4(&Transform);
+    InstanceBounds& Instance = Bounds[Row];
+    DirectX::XMStoreFloat3(&Instance.Center, DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&Mesh.BoundsCenter), World));
+    Instance.Scale = std::max({ DirectX::XMVectorGetX(DirectX::XMVector3Length(World.r[0])), DirectX::XMVectorGetX(DirectX::XMVector3Length(World.r[1])),
+        DirectX::XMVectorGetX(DirectX::XMVector3Length(World.r[2])) });
+    Instance.Radius = Mesh.BoundsRadius * Instance.Scale;
+
+    const BoundingBox& Box = InstanceBoxes[Row] = BoundingBox::FromTransformedBox(Mesh.BoundsCenter, Mesh.BoundsExtents, World);
+
+    // Flat culling tests the sphere and the world box around the same centre.
+    const DirectX::XMFLOAT3 Extents((Box.Max.x - Box.Min.x) * 0.5f, (Box.Max.y - Box.Min.y) * 0.5f, (Box.Max.z - Box.Min.z) * 0.5f);
+    CullBounds.Set(Row, Instance.Center, Instance.Radius, Extents);
+}
+
+void StaticMeshPipeline::UpdateAnimatedTransforms()
+{
+    nvtx3::scoped_range r("SMPipe-UpdateAnimatedTransforms");
+
+    const std::vector<uint32_t>& Rows = G_MainWindow->Scene->GetTimeVaryingTransforms();
+    if (Rows.empty() || !WriteTransformRows(Rows)) { return; }
+
+    // The tree's shape stays, only the boxes on the way up from the moved rows grow or shrink.
+    InstanceBVH.Refit(InstanceBoxes, Rows);
+}
+
+bool StaticMeshPipeline::WriteTransformRows(const std::vector<uint32_t>& Rows)
+{
+    const std::vector<DirectX::XMFLOAT4X4>& Transforms = G_MainWindow->Scene->GetInstanceTransforms();
+    if (!TransformBuffer || Rows.empty() || Transforms.size() != Bounds.size()) { return false; }
+
+    // The previous frame has finished with the buffer, Render waits for it before returning.
+    UINT8* TransformDataBegin;
     D3D12_RANGE ReadRange;
     ReadRange.Begin = 0;
     ReadRange.End = 0;
+    
+    if (FAILED(TransformBuffer->Map(0, &ReadRange, reinterpret_cast<void**>(&TransformDataBegin))))
+    {
+        MessageBoxW(nullptr, L"Failed to map transform buffer!", L"Error", MB_OK);
+        PostQuitMessage(1);
+        return false;
+    }
+    DirectX::XMFLOAT4X4* Mapped = reinterpret_cast<DirectX::XMFLOAT4X4*>(TransformDataBegin);
+    for (const uint32_t Row : Rows)
+    {
+        Mapped[Row] = Transforms[Row];
+        UpdateInstanceBounds(Row, Transforms[Row]);
+    }
+    TransformBuffer->Unmap(0, nullptr);
+    return true;
+}
+
+void StaticMeshPipeline::ResetDeformRing()
+{
+    DeformRing.Reset();
+    DeformRingData = nullptr;
+    DeformRingView = D3D12_VERTEX_BUFFER_VIEW{};
+    for (MeshBuffers& Mesh : Meshes) { Mesh.bInDeformRing = false; }
+    DeformRegionSize = 0;
+    NumDeformRegions = 0;
+    DeformRegion = 0;
+    DeformSlots.clear();
+    DeformStats = DeformDrawStats();
+}
+
+bool StaticMeshPipeline::SetupDeformRing()
+{
+    ResetDeformRing();
 
-    HR = VertexBuffer->Map(0, &ReadRange, reinterpret_cast<void**>(&VertexDataBegin));
+    // Slots are packed back to back, the only allocation until the scene's meshes change again.
+    const std::vector<std::shared_ptr<RenderMesh>> SceneMeshes = G_MainWindow->Scene->GetMeshes();
+    for (UINT MeshIdx = 0; MeshIdx < static_cast<UINT>(Meshes.size()); MeshIdx++)
+    {
+        const std::shared_ptr<MeshData> Data = SceneMeshes[MeshIdx]->GetMeshData();
+        if (!Data->Deformer || Meshes[MeshIdx].NumIndices == 0) { continue; }
+
+        DeformingMeshSlot Slot;
+        Slot.Mesh = MeshIdx;
+        Slot.Offset = DeformRegionSize;
+        Slot.Deformer = Data->Deformer;
+        DeformSlots.push_back(Slot);
+        DeformRegionSize += Data->Deformer->GetVertexBufferSize();
+    }
+    if (DeformSlots.empty()) { return true; }
+
+    NumDeformRegions = R->FrameBufferCount;
+    if (!CreateUploadBuffer(DeformRegionSize * NumDeformRegions, DeformRing))
+    {
+        MessageBoxW(nullptr, L"Failed to create deform ring buffer!", L"Error", MB_OK);
+        PostQuitMessage(1);
+        return false;
+    }
+
+    // Mapped for the ring's lifetime, upload heap memory stays coherent and never needs unmapping to be read by the GPU.
+    D3D12_RANGE ReadRange;
+    ReadRange.Begin = 0;
+    ReadRange.End = 0;
+    HRESULT HR = DeformRing->Map(0, &ReadRange, reinterpret_cast<void**>(&DeformRingData));
     if (FAILED(HR))
     {
-        MessageBoxW(nullptr, L"Failed to map vertex buffer!", L"Error", MB_OK);
+        MessageBoxW(nullptr, L"Failed to map deform ring buffer!", L"Error", MB_OK);
         PostQuitMessage(1);
-        return bResult;
+        return false;
     }
-    memcpy(VertexDataBegin, CurrentMesh->Vertices.data(), VertexBufferSize);
-    VertexBuffer->Unmap(0, nullptr);
+    DeformRing->SetName(L"Deform Ring Buffer");
+    DeformRingView.BufferLocation = DeformRing->GetGPUVirtualAddress();
+    DeformRingView.StrideInBytes = sizeof(Vertex);
+    DeformRingView.SizeInBytes = static_cast<UINT>(DeformRegionSize * NumDeformRegions);
+    DeformStats.NumMeshes = DeformSlots.size();
+    return true;
+}
 
-    // Initialize the vertex buffer view.
-    VertexBufferView.BufferLocation = VertexBuffer->GetGPUVirtualAddress();
-    VertexBufferView.StrideInBytes = sizeof(Vertex);
-    VertexBufferView.SizeInBytes = VertexBufferSize;
+void StaticMeshPipeline::UpdateDeformedMeshes()
+{
+    if (DeformSlots.empty()) { return; }
 
-    VertexBuffer->SetName(L"Vertex Buffer");
+    nvtx3::scoped_range r("SMPipe-UpdateDeformedMeshes");
+    const auto StartTime = std::chrono::steady_clock::now();
 
-    R->Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&R->Fence));
-    R->FenceValue = 1;
-    R->FenceEvent = CreateEvent(nullptr, false, false, nullptr);
-    R->WaitForPreviousFrame();
+    DeformStats = DeformDrawStats();
+    DeformStats.NumMeshes = DeformSlots.size();
 
-    bResult = true;
-    return bResult;
+    // Changed meshes are skinned or gathered on several threads, each into its own slot of this region.
+    // Views of the changed meshes move to this region, the previous frame's draws read the region before it.
+    ChangedDeformSlots.clear();
+    for (UINT Idx = 0; Idx < DeformSlots.size(); Idx++)
+    {
+        if (DeformSlots[Idx].Deformer->GetVersion() != DeformSlots[Idx].WrittenVersion) { ChangedDeformSlots.push_back(Idx); }
+    }
+
+    const UINT64 RegionOffset = DeformRegion * DeformRegionSize;
+    UINT64 WrittenEnd = UINT64_MAX; // End of the last slot written, for counting contiguous runs.
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, ChangedDeformSlots.size()),
+        [&](const tbb::blocked_range<size_t>& Range)
+        {
+            for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+            {
+                DeformingMeshSlot& Slot = DeformSlots[ChangedDeformSlots[Idx]];
+                Slot.Deformer->WriteVertices(reinterpret_cast<Vertex*>(DeformRingData + RegionOffset + Slot.Offset), Slot.WrittenBounds);
+            }
+        });
+
+    const std::vector<DirectX::XMFLOAT4X4>& Transforms = G_MainWindow->Scene->GetInstanceTransforms();
+    DeformedRows.clear();
+    for (const UINT SlotIdx : ChangedDeformSlots)
+    {
+        DeformingMeshSlot& Slot = DeformSlots[SlotIdx];
+        const MeshDeformer& Deformer = *Slot.Deformer;
+        Slot.WrittenVersion = Deformer.GetVersion();
+
+        MeshBuffers& Mesh = Meshes[Slot.Mesh];
+        const UINT VertexBufferSize = static_cast<UINT>(Deformer.GetVertexBufferSize());
+        Mesh.bInDeformRing = true;
+        Mesh.RingBaseVertex = static_cast<UINT>((RegionOffset + Slot.Offset) / sizeof(Vertex));
+        Mesh.BoundsCenter = Slot.WrittenBounds.Center;
+        Mesh.BoundsRadius = Slot.WrittenBounds.Radius;
+        Mesh.BoundsExtents = Slot.WrittenBounds.Extents;
+        if (Transforms.size() == Bounds.size())
+        {
+            for (UINT Row = Mesh.FirstInstance; Row < Mesh.FirstInstance + Mesh.NumInstances; Row++)
+            {
+                UpdateInstanceBounds(Row, Transforms[Row]);
+                DeformedRows.push_back(Row);
+            }
+        }
+
+        // Slots are contiguous, so meshes written one after another extend the same run.
+        const UINT64 Begin = RegionOffset + Slot.Offset;
+        DeformStats.NumWrittenRuns += Begin != WrittenEnd ? 1 : 0;
+        WrittenEnd = Begin + VertexBufferSize;
+
+        DeformStats.NumWritten++;
+        DeformStats.NumVertices += Deformer.GetNumVertices();
+        DeformStats.NumBytes += VertexBufferSize;
+    }
+
+    if (DeformStats.NumWritten > 0)
+    {
+        DeformRegion = (DeformRegion + 1) % NumDeformRegions;
+        InstanceBVH.Refit(InstanceBoxes, DeformedRows);
+    }
+    DeformStats.WriteMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
 }
 
-bool StaticMeshPipeline::SetupIndexBuffer()
+bool StaticMeshPipeline::SetupTransformBuffer()
 {
     HRESULT HR;
     bool bResult = false;
-    
-    // Declare Handles
-    const UINT IndexBufferSize = sizeof(uint32_t) * static_cast<UINT>(CurrentMesh->Indices.size());
-
-    D3D12_HEAP_PROPERTIES HeapIndexProps;
-    HeapIndexProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-    HeapIndexProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-    HeapIndexProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-    HeapIndexProps.CreationNodeMask = 1;
-    HeapIndexProps.VisibleNodeMask = 1;
-
-    D3D12_RESOURCE_DESC IndexBufferResourceDesc;
-    IndexBufferResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    IndexBufferResourceDesc.Alignment = 0;
-    IndexBufferResourceDesc.Width = IndexBufferSize;
-    IndexBufferResourceDesc.Height = 1;
-    IndexBufferResourceDesc.DepthOrArraySize = 1;
-    IndexBufferResourceDesc.MipLevels = 1;
-    IndexBufferResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
-    IndexBufferResourceDesc.SampleDesc.Count = 1;
-    IndexBufferResourceDesc.SampleDesc.Quality = 0;
-    IndexBufferResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-    IndexBufferResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-    HR = R->Device->CreateCommittedResource(
-        &HeapIndexProps, D3D12_HEAP_FLAG_NONE, &IndexBufferResourceDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&IndexBuffer));
-    if (FAILED(HR))
+
+    const std::vector<DirectX::XMFLOAT4X4>& Transforms = G_MainWindow->Scene->GetInstanceTransforms();
+    const UINT TransformBufferSize = sizeof(DirectX::XMFLOAT4X4) * static_cast<UINT>(Transforms.size());
+
+    if (!CreateUploadBuffer(TransformBufferSize, TransformBuffer))
     {
-        MessageBoxW(nullptr, L"Failed to create index buffer!", L"Error", MB_OK);
+        MessageBoxW(nullptr, L"Failed to create transform buffer!", L"Error", MB_OK);
         PostQuitMessage(1);
         return bResult;
     }
 
-    // Copy data to DirectX 12 driver memory:
-    UINT8* pVertexDataBegin;
-
-    // We do not intend to read from this resource on the CPU.
-    D3D12_RANGE IdxReadRange;
-    IdxReadRange.Begin = 0;
-    IdxReadRange.End = 0;
+    // Row major, read as the rows of a float4x4 in the vertex shader so no transpose is needed.
+    UINT8* TransformDataBegin;
+    D3D12_RANGE ReadRange;
+    ReadRange.Begin = 0;
+    ReadRange.End = 0;
     
-    HR = IndexBuffer->Map(0, &IdxReadRange, reinterpret_cast<void**>(&pVertexDataBegin));
+    HR = TransformBuffer->Map(0, &ReadRange, reinterpret_cast<void**>(&TransformDataBegin));
     if (FAILED(HR))
     {
-        MessageBoxW(nullptr, L"Failed to Map index buffer!", L"Error", MB_OK);
+        MessageBoxW(nullptr, L"Failed to map transform buffer!", L"Error", MB_OK);
         PostQuitMessage(1);
         return bResult;
     }
-    memcpy(pVertexDataBegin, CurrentMesh->Indices.data(), IndexBufferSize);
-    IndexBuffer->Unmap(0, nullptr);
+    memcpy(TransformDataBegin, Transforms.data(), TransformBufferSize);
+    TransformBuffer->Unmap(0, nullptr);
+
+    // Instance bounds for picking LODs and culling, from each mesh's sphere and box and the rows it draws with.
+    Bounds.assign(Transforms.size(), InstanceBounds());
+    InstanceBoxes.assign(Transforms.size(), BoundingBox());
+    InstanceMeshes.assign(Transforms.size(), 0);
+    CullBounds.Resize(Transforms.size());
+    for (UINT MeshIdx = 0; MeshIdx < static_cast<UINT>(Meshes.size()); MeshIdx++)
+    {
+        const MeshBuffers& Mesh = Meshes[MeshIdx];
+        std::fill_n(InstanceMeshes.begin() + Mesh.FirstInstance, Mesh.NumInstances, MeshIdx);
+    }
+    for (UINT Row = 0; Row < static_cast<UINT>(Transforms.size()); Row++)
+    {
+        UpdateInstanceBounds(Row, Transforms[Row]);
+    }
 
-    IndexBuffer->SetName(L"Mesh Index Buffer");
+    InstanceBVH.Build(InstanceBoxes);
 
-    // Initialize the index buffer view.
-    IndexBufferView.BufferLocation = IndexBuffer->GetGPUVirtualAddress();
-    IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-    IndexBufferView.SizeInBytes = IndexBufferSize;
+    TransformBuffer->SetName(L"Mesh Transform Buffer");
+    
+    TransformBufferView.BufferLocation = TransformBuffer->GetGPUVirtualAddress();
+    TransformBufferView.StrideInBytes = sizeof(DirectX::XMFLOAT4X4);
+    TransformBufferView.SizeInBytes = TransformBufferSize;
 
     bResult = true;
     return bResult;
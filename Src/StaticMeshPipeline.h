@@ -3,14 +3,177 @@
 #include <wrl/client.h>
 
 #include "pch.h"
+#include "ArenaAllocator.h"
+#include "DrawSorting.h"
+#include "FrustumCulling.h"
+#include "GpuMemory.h"
+#include "IndirectDraws.h"
+#include "MeshDeformer.h"
+#include "MeshSimplifier.h"
+#include "OcclusionCulling.h"
+#include "SceneBVH.h"
+#include "StagingRing.h"
 
 #include <d3dcommon.h>
 #include <d3d12.h>
 #include <memory>
+#include <vector>
 
 
 using Microsoft::WRL::ComPtr; // Import only the ComPtr
 
+// Draw arguments of one scene mesh. Its vertices and indices live in the arenas shared by every mesh of the same vertex format and index size.
+struct MeshBuffers
+{
+    VertexFormat Format = VertexFormat::Float;
+    PositionDequantisation Dequantisation;
+    UINT BaseVertex = 0;  // In the vertex arena of Format.
+    UINT NumVertices = 0; // Both counts are 0 while the mesh holds no range, e.g. when every triangle was degenerate.
+    UINT FirstIndex = 0;  // In its index arena, the LOD index ranges start from here.
+    UINT NumIndices = 0;
+    bool b16BitIndices = true;
+    bool bInDeformRing = false; // Drawn from the deform ring at RingBaseVertex once its deformer has written it.
+    UINT RingBaseVertex = 0;
+    UINT FirstInstance = 0; // First row of the mesh's Model to World matrices in the transform buffer.
+    UINT NumInstances = 0;
+
+    // Levels of detail in the index buffer, one is drawn for every instance.
+    std::vector<MeshLod> Lods;
+    size_t SelectedLod = 0;
+    DirectX::XMFLOAT3 BoundsCenter = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    float BoundsRadius = 0.0f;
+    DirectX::XMFLOAT3 BoundsExtents = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    OccluderMesh Occluder; // CPU copy for the occlusion buffer, empty when the mesh never occludes.
+
+    bool bVisible = true; // Any instance inside the frustum this frame.
+};
+
+// One default heap buffer holding the vertices of every mesh of one vertex format, or the indices of every mesh of one index size,
+// so the whole scene draws with a handful of bindings from video memory. Written through copies from the staging ring.
+struct GeometryArena
+{
+    PlacedBuffer Buffer;
+    ArenaAllocator Allocator;
+    UINT Stride = 0;
+    bool bIndices = false;
+    uint32_t Index = 0; // Destination of its staged copies.
+    D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+    D3D12_VERTEX_BUFFER_VIEW VertexView{}; // Whichever the arena holds.
+    D3D12_INDEX_BUFFER_VIEW IndexView{};
+};
+
+// Geometry arena memory of the scene's meshes, and the bindings the last frame needed.
+struct ArenaDrawStats
+{
+    size_t NumArenas = 0; // With a buffer.
+    size_t UsedBytes = 0;
+    size_t CapacityBytes = 0;
+    size_t NumRepacks = 0;  // Since the scene was loaded, every mesh in the arena is written again when it grows or is compacted.
+    size_t NumBindings = 0; // Vertex and index buffers set in the last frame.
+    size_t NumStagedBytes = 0;  // Since the scene was loaded, through the staging ring.
+    size_t NumCopies = 0;       // CopyBufferRegion calls, copies continuing each other are merged.
+    size_t NumSubmits = 0;      // Upload command lists executed.
+    size_t NumStagingStalls = 0; // Waits for the GPU to retire staging space or an upload command allocator.
+};
+
+// The upload fence, signalled on the command queue after every batch of staged copies.
+class QueueStagingFence final : public StagingFence
+{
+public:
+    ComPtr<ID3D12Fence> Fence;
+    HANDLE Event = nullptr;
+
+    ~QueueStagingFence() override { if (Event) { CloseHandle(Event); } }
+    uint64_t GetCompletedValue() const override { return Fence->GetCompletedValue(); }
+    void Wait(uint64_t Value) override;
+};
+
+// Command allocator of one upload submission, reused once its fence value has completed.
+struct UploadContext
+{
+    ComPtr<ID3D12CommandAllocator> Allocator;
+    UINT64 FenceValue = 0;
+};
+
+// Draw packets recorded in the last frame, and the pipeline changes their order left.
+struct DrawSortStats
+{
+    size_t NumPackets = 0;
+    size_t NumSortPasses = 0; // Key bytes the radix sort scattered, bytes every key shares are skipped.
+    size_t NumPipelineChanges = 0;
+    size_t NumExecuteIndirect = 0; // Batches of packets, none when drawing directly.
+    size_t NumCompacted = 0;       // Packets left out of the argument buffer for drawing nothing.
+    double SortMs = 0.0;      // Keying and sorting the packets, and building the argument buffer.
+};
+
+// World space bounding sphere of one instance, with the largest scale of its Model to World matrix.
+struct InstanceBounds
+{
+    DirectX::XMFLOAT3 Center;
+    float Radius = 0.0f;
+    float Scale = 1.0f;
+};
+
+// How instances are frustum culled before the draw list is built.
+enum class MeshCullMode
+{
+    None,
+    Flat,   // Every instance's sphere and box through the SIMD kernel.
+    BVH,    // Instance boxes through the scene BVH.
+};
+
+// Meshes and instances left after frustum and occlusion culling in the last frame.
+struct CullDrawStats
+{
+    size_t NumMeshes = 0;
+    size_t NumVisibleMeshes = 0;
+    size_t NumInstances = 0;
+    size_t NumVisibleInstances = 0;
+    size_t NumSphereCulled = 0; // Flat culling only.
+    size_t NumBoxCulled = 0;
+    size_t NumOccluders = 0;    // Occlusion culling only.
+    size_t NumOccluderTriangles = 0;
+    size_t NumOccluded = 0;     // Inside the frustum but hidden behind occluders.
+    double OcclusionMs = 0.0;
+    double CullMs = 0.0;        // Both passes.
+};
+
+// What a ray from the viewport hit first, by its instance bounding box.
+struct MeshPickResult
+{
+    size_t Mesh = 0;     // Index into the scene meshes.
+    UINT Instance = 0;   // Instance of that mesh.
+    float Distance = 0.0f;
+};
+
+// Slot of a deforming mesh in every region of the deform ring.
+struct DeformingMeshSlot
+{
+    UINT Mesh = 0;
+    UINT64 Offset = 0; // From the start of a region.
+    std::shared_ptr<class MeshDeformer> Deformer;
+    uint64_t WrittenVersion = UINT64_MAX; // Deformer version the mesh's vertex buffer view shows.
+    DeformedBounds WrittenBounds;
+};
+
+// Deforming mesh vertices written to the ring in the last frame.
+struct DeformDrawStats
+{
+    size_t NumMeshes = 0;
+    size_t NumWritten = 0;
+    size_t NumVertices = 0;
+    size_t NumBytes = 0;
+    size_t NumWrittenRuns = 0; // Contiguous runs of slots written. Only reported, the ring stays mapped so nothing flushes them.
+    double WriteMs = 0.0;
+};
+
+// Triangles submitted in the last frame, counting every instance of the meshes drawn.
+struct LodDrawStats
+{
+    size_t NumTriangles = 0;
+    size_t NumLod0Triangles = 0; // What the same frame would draw at full detail.
+};
+
 class StaticMeshPipeline
 {
 public:
@@ -19,38 +182,154 @@ public:
     ComPtr<ID3D12GraphicsCommandList> PopulateCmdList();
 
     void Update(const CB_WVP& WVP);
+    void CullMeshes(const class Camera& View);
+    void SelectLods(const class Camera& View);
+    void BuildDrawPackets(const class Camera& View); // Keys the draw list's meshes and sorts them into the order they are recorded.
+    bool Pick(const DirectX::XMFLOAT3& Origin, const DirectX::XMFLOAT3& Direction, MeshPickResult& OutResult) const;
+    const CullDrawStats& GetCullStats() const { return CullStats; }
+    const LodDrawStats& GetLodStats() const { return LodStats; }
+    const DrawSortStats& GetSortStats() const { return SortStats; }
+    const OcclusionBuffer& GetOcclusionBuffer() const { return Occlusion; }
     void ResetScene();
+    void ApplyStreamingUpdate(const struct SceneStreamingUpdate& Streaming); // Also applies UpdateStageEdits, only edited meshes and rows are uploaded.
+    void UpdateAnimatedTransforms(); // Copies the scene's time varying rows into the transform buffer and refits their bounds.
+    void UpdateDeformedMeshes();     // Writes the meshes whose deformer changed into this frame's region of the deform ring.
+    const DeformDrawStats& GetDeformStats() const { return DeformStats; }
+    ArenaDrawStats GetArenaStats() const;
+    bool SubmitUploads(); // Executes the copies staged since the last call, before the frame's command lists.
 
 private:
     void ProcessScene();
+    bool SetupMeshBuffers(size_t FirstMesh);
+    bool SetupMeshGeometry(const struct MeshData& Data, MeshBuffers& Buffers, bool bKeepIndexBuffer);
+    void FreeMeshGeometry(MeshBuffers& Buffers, bool bKeepIndexBuffer);
+    void CullOccluded(const class Camera& View);
 
     bool CompileShaders();
     bool CreatePSO();
+    bool CreatePSO(VertexFormat Format);
+    bool CreateDrawSignature();
+    void BuildIndirectDraws();
     bool SetupConstantBuffer();
-    bool SetupVertexBuffer();
-    bool SetupIndexBuffer();
+    GeometryArena& GetVertexArena(const MeshBuffers& Mesh) { return VertexArenas[static_cast<size_t>(Mesh.Format)]; }
+    GeometryArena& GetIndexArena(const MeshBuffers& Mesh) { return IndexArenas[Mesh.b16BitIndices ? 0 : 1]; }
+    GeometryArena& GetArena(uint32_t Index) { return Index < VertexFormatCount ? VertexArenas[Index] : IndexArenas[Index - VertexFormatCount]; }
+    bool CreateArenaBuffer(GeometryArena& Arena, UINT64 Capacity);
+    void ReleaseArena(GeometryArena& Arena); // Its buffer is kept until the copies already submitted to it have completed.
+    bool AllocateArenaRange(GeometryArena& Arena, UINT64 Size, UINT& OutOffset); // Grows the arena when no free range fits.
+    bool RepackArena(GeometryArena& Arena, UINT64 Capacity);
+    bool ReserveArenas(size_t FirstMesh); // Grows each arena once for the meshes from FirstMesh on.
+    void CompactArenas();
+    void ResetArenas();
+    bool WriteMeshVertices(const MeshBuffers& Mesh, const struct MeshData& Data);
+    bool WriteMeshIndices(const MeshBuffers& Mesh, const struct MeshData& Data);
+    bool CreateUploadObjects();
+    UINT8* StageArenaRange(GeometryArena& Arena, UINT64 Offset, UINT64 Size); // Ring memory to write that is copied to Offset, at most MaxStagingChunk.
+    bool StageArenaWrite(GeometryArena& Arena, UINT64 Offset, const void* Source, UINT64 Size);
+    void ReleaseRetiredBuffers();
+    bool SetupTransformBuffer();
+    bool SetupDeformRing();
+    void ResetDeformRing();
+    void UpdateInstanceBounds(UINT Row, const DirectX::XMFLOAT4X4& Transform);
+    bool WriteTransformRows(const std::vector<uint32_t>& Rows); // Copies rows of the scene's transforms and their bounds, the BVH is refit after.
+
+    // Helpers
+    bool CreateUploadBuffer(UINT64 Size, PlacedBuffer& OutBuffer);
+    bool CreateDefaultBuffer(UINT64 Size, PlacedBuffer& OutBuffer);
 
 public:
-    // PSO
-    ComPtr<ID3D12PipelineState> MeshPSO;
+    // PSOs, one per vertex format. They only differ in input layout and how VSMain decodes normals.
+    ComPtr<ID3D12PipelineState> MeshPSOs[static_cast<size_t>(VertexFormat::Count)];
 
     // CmdList
     ComPtr<ID3D12GraphicsCommandList> CmdList;
     
     // Shaders and object resources.
     ComPtr<ID3DBlob> VS;
+    ComPtr<ID3DBlob> VSOctahedral; // VSMain for octahedral normals.
     ComPtr<ID3DBlob> PS;
 
+    // Heaps the buffers below are placed in, declared first so they outlive them.
+    PlacedBufferAllocator DefaultHeaps;
+    PlacedBufferAllocator UploadHeaps;
+
     // Mesh Buffers
-    D3D12_INDEX_BUFFER_VIEW IndexBufferView;
-    D3D12_VERTEX_BUFFER_VIEW VertexBufferView;
-    ComPtr<ID3D12Resource> VertexBuffer;
-    ComPtr<ID3D12Resource> IndexBuffer;    
-    ComPtr<ID3D12Resource> ConstantBuffer;
+    std::vector<MeshBuffers> Meshes;
+    GeometryArena VertexArenas[static_cast<size_t>(VertexFormat::Count)];
+    GeometryArena IndexArenas[2]; // 16 and 32 bit indices.
+    static constexpr uint32_t VertexFormatCount = static_cast<uint32_t>(VertexFormat::Count);
+
+    // Geometry uploads. Mesh data is written to a persistently mapped upload ring and copied into the arenas by one command list
+    // per frame, the ring's space is reused once the fence signalled after those copies has completed.
+    PlacedBuffer StagingBuffer;
+    UINT8* StagingData = nullptr;
+    StagingRing Staging;
+    std::vector<StagedCopy> PendingCopies; // Staged since the last submission.
+    UploadContext UploadContexts[3];
+    UINT NextUploadContext = 0;
+    ComPtr<ID3D12GraphicsCommandList> UploadCmdList;
+    QueueStagingFence UploadFence;
+    UINT64 UploadFenceValue = 0;
+    std::vector<std::pair<PlacedBuffer, UINT64>> RetiredBuffers; // Released once the fence value has completed.
+    std::vector<UINT8> IndexScratch; // Converted indices of meshes too large to stage in one piece.
+    PlacedBuffer TransformBuffer; // Per instance vertex stream of Model to World matrices.
+    D3D12_VERTEX_BUFFER_VIEW TransformBufferView{};
+    std::vector<InstanceBounds> Bounds; // Per row of the transform buffer.
+    std::vector<BoundingBox> InstanceBoxes; // World box of each row, empty for meshes without triangles.
+    std::vector<UINT> InstanceMeshes;   // Mesh drawing each row of the transform buffer.
+    SceneBVH InstanceBVH;               // Over the rows' world boxes, objects are transform buffer rows.
+    CullBoundsSoA CullBounds;           // The rows' world spheres and boxes for flat culling.
+    std::vector<UINT> DrawList;         // Meshes with a visible instance this frame, in mesh order.
+    std::vector<DrawPacket> DrawPackets; // The draw list's meshes in the order they are recorded.
+
+    // Deforming meshes. A persistently mapped upload ring with one region per frame buffer, each holding a slot for every
+    // deforming mesh. A changed mesh is written to the next region and its vertex buffer view moved there, so the CPU never
+    // writes a range the GPU may still read and unchanged meshes are not copied at all.
+    PlacedBuffer DeformRing;
+    UINT8* DeformRingData = nullptr;
+    D3D12_VERTEX_BUFFER_VIEW DeformRingView{}; // The whole ring, meshes in it draw with their slot's base vertex.
+    UINT64 DeformRegionSize = 0;
+    UINT NumDeformRegions = 0;
+    UINT DeformRegion = 0;             // Region the next changed meshes are written to.
+    std::vector<DeformingMeshSlot> DeformSlots;
+    std::vector<UINT> ChangedDeformSlots; // Slots written this frame, in slot order.
+    std::vector<uint32_t> DeformedRows;   // Instance rows of the meshes written this frame, their boxes are refitted.
+
+    // Indirect draws. Every packet's command is written to a persistently mapped upload buffer, rewritten in place each frame
+    // as the renderer waits for the previous one. Grows when the packets outgrow it.
+    ComPtr<ID3D12CommandSignature> DrawSignature; // Dequantisation root constants, then DrawIndexedInstanced.
+    PlacedBuffer ArgumentBuffer;
+    UINT8* ArgumentData = nullptr;
+    size_t ArgumentCapacity = 0;                   // In commands.
+    std::vector<IndirectDrawCommand> MeshCommands; // Per mesh, filled for the meshes drawn this frame.
+    IndirectDrawList IndirectDraws;
+    PlacedBuffer ConstantBuffer;
     ComPtr<ID3D12DescriptorHeap> ConstantBufferHeap;
 
+    MeshCullMode CullMode = MeshCullMode::Flat;
+    bool bOcclusionCulling = true; // Instances left by frustum culling are tested against the largest ones in view.
+
+    // Draws are sorted by pipeline, bindings and then front to back, otherwise recorded in mesh order.
+    bool bSortDraws = true;
+
+    // Packets are recorded through ExecuteIndirect, one call per batch sharing pipeline and bindings, otherwise one draw each.
+    bool bIndirectDraws = true;
+
+    // Largest projected error a LOD may have, in pixels.
+    float MaxLodPixelError = 1.0f;
+
 private:
     class Renderer* R; 
-
-    std::shared_ptr<struct MeshData> CurrentMesh;
+    CullDrawStats CullStats;
+    LodDrawStats LodStats;
+    DeformDrawStats DeformStats;
+    ArenaDrawStats ArenaStats;
+    DrawSortStats SortStats;
+    DrawPacketSorter DrawSorter;
+    bool bRecordIndirect = false; // This frame's packets went into the argument buffer.
+    std::vector<float> MeshDepths; // Nearest visible instance of each mesh, for the packet keys.
+    std::vector<uint32_t> VisibleInstances;
+    OcclusionBuffer Occlusion;
+    std::vector<OccluderCandidate> OccluderCandidates;
+    std::vector<OccluderInstance> Occluders;
 };
@@ -0,0 +1,275 @@
+#include "TlsfAllocator.h"
+
+// Std
+#include <algorithm>
+#include <bit>
+
+double TlsfStats::GetFragmentation() const
+{
+    const uint64_t FreeBytes = GetFreeBytes();
+    return FreeBytes == 0 ? 0.0 : 1.0 - static_cast<double>(LargestFreeRange) / static_cast<double>(FreeBytes);
+}
+
+TlsfAllocator::TlsfAllocator(MemoryBlockSource& InSource, uint64_t InBlockSize, uint64_t InGranularity)
+    : Source(InSource)
+    , BlockSize(std::max<uint64_t>(InBlockSize / InGranularity, 1))
+    , Granularity(InGranularity)
+{
+    for (auto& Heads : FreeHeads) { std::fill(std::begin(Heads), std::end(Heads), NoNode); }
+}
+
+TlsfAllocator::~TlsfAllocator()
+{
+    for (uint32_t Block = 0; Block < static_cast<uint32_t>(Blocks.size()); Block++)
+    {
+        if (Blocks[Block].Size > 0) { Source.DestroyBlock(Block); }
+    }
+}
+
+void TlsfAllocator::MapSize(uint64_t Size, uint32_t& OutFirst, uint32_t& OutSecond)
+{
+    // Below SecondLevelCount granules every size has its own bin.
+    if (Size < SecondLevelCount)
+    {
+        OutFirst = 0;
+        OutSecond = static_cast<uint32_t>(Size);
+        return;
+    }
+    const uint32_t HighBit = static_cast<uint32_t>(std::bit_width(Size)) - 1;
+    OutFirst = HighBit - SecondLevelLog2 + 1;
+    OutSecond = static_cast<uint32_t>(Size >> (HighBit - SecondLevelLog2)) - SecondLevelCount;
+}
+
+uint32_t TlsfAllocator::FindFree(uint64_t Size) const
+{
+    // Rounded up to the next bin, so the first range of any bin from there on fits without walking a list.
+    if (Size >= SecondLevelCount)
+    {
+        const uint32_t HighBit = static_cast<uint32_t>(std::bit_width(Size)) - 1;
+        Size += (uint64_t(1) << (HighBit - SecondLevelLog2)) - 1;
+    }
+    uint32_t First, Second;
+    MapSize(Size, First, Second);
+    if (First >= FirstLevelCount) { return NoNode; }
+
+    uint32_t SecondMap = SecondLevelBitmaps[First] & (~0u << Second);
+    if (SecondMap == 0)
+    {
+        const uint64_t FirstMap = First + 1 < 64 ? FirstLevelBitmap & (~uint64_t(0) << (First + 1)) : 0;
+        if (FirstMap == 0) { return NoNode; }
+        First = static_cast<uint32_t>(std::countr_zero(FirstMap));
+        SecondMap = SecondLevelBitmaps[First];
+    }
+    return FreeHeads[First][std::countr_zero(SecondMap)];
+}
+
+void TlsfAllocator::InsertFree(uint32_t NodeIdx)
+{
+    uint32_t First, Second;
+    MapSize(Nodes[NodeIdx].Size, First, Second);
+
+    Node& Inserted = Nodes[NodeIdx];
+    Inserted.bFree = true;
+    Inserted.PrevFree = NoNode;
+    Inserted.NextFree = FreeHeads[First][Second];
+    if (Inserted.NextFree != NoNode) { Nodes[Inserted.NextFree].PrevFree = NodeIdx; }
+    FreeHeads[First][Second] = NodeIdx;
+    FirstLevelBitmap |= uint64_t(1) << First;
+    SecondLevelBitmaps[First] |= 1u << Second;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t NodeIdx)
+{
+    Node& Removed = Nodes[NodeIdx];
+    if (Removed.PrevFree != NoNode) { Nodes[Removed.PrevFree].NextFree = Removed.NextFree; }
+    if (Removed.NextFree != NoNode) { Nodes[Removed.NextFree].PrevFree = Removed.PrevFree; }
+
+    uint32_t First, Second;
+    MapSize(Removed.Size, First, Second);
+    if (FreeHeads[First][Second] == NodeIdx)
+    {
+        FreeHeads[First][Second] = Removed.NextFree;
+        if (Removed.NextFree == NoNode)
+        {
+            SecondLevelBitmaps[First] &= ~(1u << Second);
+            if (SecondLevelBitmaps[First] == 0) { FirstLevelBitmap &= ~(uint64_t(1) << First); }
+        }
+    }
+    Removed.bFree = false;
+    Removed.PrevFree = NoNode;
+    Removed.NextFree = NoNode;
+}
+
+uint32_t TlsfAllocator::NewNode()
+{
+    if (!UnusedNodes.empty())
+    {
+        const uint32_t NodeIdx = UnusedNodes.back();
+        UnusedNodes.pop_back();
+        Nodes[NodeIdx] = Node();
+        return NodeIdx;
+    }
+    Nodes.emplace_back();
+    return static_cast<uint32_t>(Nodes.size() - 1);
+}
+
+void TlsfAllocator::ReleaseNode(uint32_t NodeIdx)
+{
+    UnusedNodes.push_back(NodeIdx);
+}
+
+uint32_t TlsfAllocator::CreateBlock(uint64_t Size, bool bDedicated)
+{
+    uint32_t Block;
+    if (!UnusedBlocks.empty())
+    {
+        Block = UnusedBlocks.back();
+        UnusedBlocks.pop_back();
+    }
+    else
+    {
+        Block = static_cast<uint32_t>(Blocks.size());
+        Blocks.emplace_back();
+    }
+    if (!Source.CreateBlock(Block, Size * Granularity))
+    {
+        UnusedBlocks.push_back(Block);
+        return NoNode;
+    }
+    Blocks[Block] = BlockRecord{ Size, bDedicated };
+
+    const uint32_t NodeIdx = NewNode();
+    Nodes[NodeIdx].Size = Size;
+    Nodes[NodeIdx].Block = Block;
+    return NodeIdx;
+}
+
+void TlsfAllocator::DestroyBlock(uint32_t NodeIdx)
+{
+    const uint32_t Block = Nodes[NodeIdx].Block;
+    Source.DestroyBlock(Block);
+    Blocks[Block] = BlockRecord();
+    UnusedBlocks.push_back(Block);
+    ReleaseNode(NodeIdx);
+}
+
+bool TlsfAllocator::Allocate(uint64_t Size, TlsfAllocation& OutAllocation)
+{
+    const uint64_t Granules = std::max<uint64_t>((Size + Granularity - 1) / Granularity, 1);
+
+    uint32_t NodeIdx;
+    if (Granules > BlockSize)
+    {
+        NodeIdx = CreateBlock(Granules, true);
+    }
+    else
+    {
+        NodeIdx = FindFree(Granules);
+        if (NodeIdx != NoNode) { RemoveFree(NodeIdx); }
+        else { NodeIdx = CreateBlock(BlockSize, false); }
+    }
+    if (NodeIdx == NoNode) { return false; }
+    if (NodeIdx == SpareBlock) { SpareBlock = NoNode; }
+
+    // The rest of the range stays free behind the allocation.
+    if (Nodes[NodeIdx].Size > Granules)
+    {
+        const uint32_t RestIdx = NewNode();
+        Node& Allocated = Nodes[NodeIdx];
+        Node& Rest = Nodes[RestIdx];
+        Rest.Offset = Allocated.Offset + Granules;
+        Rest.Size = Allocated.Size - Granules;
+        Rest.Block = Allocated.Block;
+        Rest.PrevPhysical = NodeIdx;
+        Rest.NextPhysical = Allocated.NextPhysical;
+        if (Rest.NextPhysical != NoNode) { Nodes[Rest.NextPhysical].PrevPhysical = RestIdx; }
+        Allocated.NextPhysical = RestIdx;
+        Allocated.Size = Granules;
+        InsertFree(RestIdx);
+    }
+
+    NumAllocations++;
+    RequestedBytes += Size;
+    AllocatedGranules += Granules;
+
+    const Node& Allocated = Nodes[NodeIdx];
+    OutAllocation.Block = Allocated.Block;
+    OutAllocation.Offset = Allocated.Offset * Granularity;
+    OutAllocation.Size = Size;
+    OutAllocation.Node = NodeIdx;
+    return true;
+}
+
+void TlsfAllocator::Free(TlsfAllocation& Allocation)
+{
+    if (!Allocation.IsValid()) { return; }
+
+    uint32_t NodeIdx = Allocation.Node;
+    NumAllocations--;
+    RequestedBytes -= Allocation.Size;
+    AllocatedGranules -= Nodes[NodeIdx].Size;
+    Allocation = TlsfAllocation();
+
+    // Merged with free neighbours, the surviving node is the lower one.
+    const uint32_t PrevIdx = Nodes[NodeIdx].PrevPhysical;
+    if (PrevIdx != NoNode && Nodes[PrevIdx].bFree)
+    {
+        RemoveFree(PrevIdx);
+        Node& Prev = Nodes[PrevIdx];
+        Prev.Size += Nodes[NodeIdx].Size;
+        Prev.NextPhysical = Nodes[NodeIdx].NextPhysical;
+        if (Prev.NextPhysical != NoNode) { Nodes[Prev.NextPhysical].PrevPhysical = PrevIdx; }
+        ReleaseNode(NodeIdx);
+        NodeIdx = PrevIdx;
+    }
+    const uint32_t NextIdx = Nodes[NodeIdx].NextPhysical;
+    if (NextIdx != NoNode && Nodes[NextIdx].bFree)
+    {
+        RemoveFree(NextIdx);
+        Node& Merged = Nodes[NodeIdx];
+        Merged.Size += Nodes[NextIdx].Size;
+        Merged.NextPhysical = Nodes[NextIdx].NextPhysical;
+        if (Merged.NextPhysical != NoNode) { Nodes[Merged.NextPhysical].PrevPhysical = NodeIdx; }
+        ReleaseNode(NextIdx);
+    }
+
+    // An empty block goes back to the source, unless it is the first spare one.
+    const Node& Merged = Nodes[NodeIdx];
+    if (Merged.PrevPhysical == NoNode && Merged.NextPhysical == NoNode)
+    {
+        if (Blocks[Merged.Block].bDedicated || SpareBlock != NoNode)
+        {
+            DestroyBlock(NodeIdx);
+            return;
+        }
+        SpareBlock = NodeIdx;
+    }
+    InsertFree(NodeIdx);
+}
+
+TlsfStats TlsfAllocator::GetStats() const
+{
+    TlsfStats Stats;
+    for (const BlockRecord& Block : Blocks)
+    {
+        if (Block.Size == 0) { continue; }
+        Stats.NumBlocks++;
+        Stats.BlockBytes += Block.Size * Granularity;
+    }
+    Stats.NumAllocations = NumAllocations;
+    Stats.RequestedBytes = RequestedBytes;
+    Stats.AllocatedBytes = AllocatedGranules * Granularity;
+
+    for (uint32_t First = 0; First < FirstLevelCount; First++)
+    {
+        for (uint32_t Second = 0; Second < SecondLevelCount; Second++)
+        {
+            for (uint32_t NodeIdx = FreeHeads[First][Second]; NodeIdx != NoNode; NodeIdx = Nodes[NodeIdx].NextFree)
+            {
+                Stats.NumFreeRanges++;
+                Stats.LargestFreeRange = std::max(Stats.LargestFreeRange, Nodes[NodeIdx].Size * Granularity);
+            }
+        }
+    }
+    return Stats;
+}
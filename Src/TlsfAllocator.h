@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Large memory blocks the TLSF allocator sub-allocates, ID3D12Heaps in the renderer and nothing but their sizes in the tools.
+class MemoryBlockSource
+{
+public:
+    virtual ~MemoryBlockSource() = default;
+    virtual bool CreateBlock(uint32_t Block, uint64_t Size) = 0; // Block indices are reused once destroyed.
+    virtual void DestroyBlock(uint32_t Block) = 0;
+};
+
+struct TlsfAllocation
+{
+    uint32_t Block = 0;
+    uint64_t Offset = 0;  // In bytes from the start of the block, a multiple of the granularity.
+    uint64_t Size = 0;    // As requested.
+    uint32_t Node = UINT32_MAX;
+
+    bool IsValid() const { return Node != UINT32_MAX; }
+};
+
+struct TlsfStats
+{
+    size_t NumBlocks = 0;
+    size_t NumAllocations = 0;
+    size_t NumFreeRanges = 0;
+    uint64_t BlockBytes = 0;
+    uint64_t RequestedBytes = 0;
+    uint64_t AllocatedBytes = 0;   // Requests rounded up to the granularity, the difference is waste.
+    uint64_t LargestFreeRange = 0;
+
+    uint64_t GetFreeBytes() const { return BlockBytes - AllocatedBytes; }
+    uint64_t GetWastedBytes() const { return AllocatedBytes - RequestedBytes; }
+    double GetFragmentation() const; // 1 - largest free range / free bytes, 0 when all free memory is one range.
+};
+
+// Two level segregated fit allocator over blocks from a MemoryBlockSource. Free ranges are binned by the highest set bit of their size
+// and 16 linear steps below it, with a bitmap for each level, so allocating and freeing take the same few bit scans whatever the number
+// of ranges. A request is rounded up to the next bin, any range there fits it, and neighbouring free ranges merge when freed.
+// Requests larger than a block get a block of their own. Offsets are multiples of the granularity, 64 KB for placed resources.
+class TlsfAllocator
+{
+public:
+    TlsfAllocator(MemoryBlockSource& InSource, uint64_t InBlockSize, uint64_t InGranularity);
+    ~TlsfAllocator();
+    TlsfAllocator(const TlsfAllocator&) = delete;
+    TlsfAllocator& operator=(const TlsfAllocator&) = delete;
+
+    bool Allocate(uint64_t Size, TlsfAllocation& OutAllocation); // False when the source could not create a block.
+    void Free(TlsfAllocation& Allocation);                       // Invalidates Allocation.
+
+    TlsfStats GetStats() const; // Walks the free ranges for the largest one.
+    uint64_t GetGranularity() const { return Granularity; }
+
+private:
+    static constexpr uint32_t SecondLevelLog2 = 4;
+    static constexpr uint32_t SecondLevelCount = 1u << SecondLevelLog2;
+    static constexpr uint32_t FirstLevelCount = 48;
+    static constexpr uint32_t NoNode = UINT32_MAX;
+
+    // A range of a block, in granules. Ranges of a block are linked in address order, free ranges also into their bin's list.
+    struct Node
+    {
+        uint64_t Offset = 0;
+        uint64_t Size = 0;
+        uint32_t Block = 0;
+        uint32_t PrevPhysical = NoNode;
+        uint32_t NextPhysical = NoNode;
+        uint32_t PrevFree = NoNode;
+        uint32_t NextFree = NoNode;
+        bool bFree = false;
+    };
+
+    struct BlockRecord
+    {
+        uint64_t Size = 0; // In granules, 0 while the index is unused.
+        bool bDedicated = false;
+    };
+
+    static void MapSize(uint64_t Size, uint32_t& OutFirst, uint32_t& OutSecond);
+    uint32_t FindFree(uint64_t Size) const;
+    void InsertFree(uint32_t NodeIdx);
+    void RemoveFree(uint32_t NodeIdx);
+    uint32_t NewNode();
+    void ReleaseNode(uint32_t NodeIdx);
+    uint32_t CreateBlock(uint64_t Size, bool bDedicated); // Node of the whole block, NoNode when the source failed.
+    void DestroyBlock(uint32_t NodeIdx);
+
+    MemoryBlockSource& Source;
+    uint64_t BlockSize = 0;   // In granules.
+    uint64_t Granularity = 0;
+
+    uint64_t FirstLevelBitmap = 0;
+    uint32_t SecondLevelBitmaps[FirstLevelCount] = {};
+    uint32_t FreeHeads[FirstLevelCount][SecondLevelCount];
+
+    std::vector<Node> Nodes;
+    std::vector<uint32_t> UnusedNodes;
+    std::vector<BlockRecord> Blocks;
+    std::vector<uint32_t> UnusedBlocks;
+    uint32_t SpareBlock = NoNode; // Whole free node of one empty block kept for the next allocations, so a block is not created and destroyed in turn.
+
+    size_t NumAllocations = 0;
+    uint64_t RequestedBytes = 0;
+    uint64_t AllocatedGranules = 0;
+};
@@ -5,6 +5,7 @@
 #include "Camera.h"
 #include "Renderer.h"
 #include "MainWindow.h"
+#include "RenderMesh.h"
 #include "USDScene.h"
 
 // ImGui 
@@ -15,6 +16,8 @@
 
 // Windows - Open File Dialog
 #include <Windows.h>
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <shobjidl.h>
 #include <shobjidl_core.h>
@@ -92,6 +95,8 @@ void UIBase::RenderUI()
     WindowMenuBar();
     
     if (HasWindowFlag(UIWindowFlags::Overlay)) { ShowInfoOverlay(); }
+    if (HasWindowFlag(UIWindowFlags::OcclusionBuffer)) { ShowOcclusionBuffer(); }
+    if (HasWindowFlag(UIWindowFlags::Timeline)) { ShowTimeline(); }
     if (HasWindowFlag(UIWindowFlags::DemoUI)) { ImGui::ShowDemoWindow(); }
 
 }
@@ -104,10 +109,63 @@ void UIBase::WindowMenuBar()
                 // Open work here...
                 OpenSceneBrowser();
             }
+            if (ImGui::MenuItem("Reload Stage"))
+            {
+                // Only what changed on disk is rebuilt and uploaded again.
+                G_MainWindow->Scene->ReloadStage();
+            }
+            if (ImGui::MenuItem("Stream Payloads", nullptr, bStreamPayloads))
+            {
+                bStreamPayloads = !bStreamPayloads;
+            }
+            if (ImGui::MenuItem("Load Through Hydra", nullptr, G_MainWindow->Scene->GetFrontEnd() == SceneFrontEnd::Hydra))
+            {
+                // Applies from the next open, to compare against the USD traversal on the same scene.
+                const bool bHydra = G_MainWindow->Scene->GetFrontEnd() == SceneFrontEnd::Hydra;
+                G_MainWindow->Scene->SetFrontEnd(bHydra ? SceneFrontEnd::Traversal : SceneFrontEnd::Hydra);
+            }
+            if (ImGui::MenuItem("Optimise Meshes", nullptr, bOptimiseMeshes))
+            {
+                bOptimiseMeshes = !bOptimiseMeshes;
+            }
+            if (ImGui::MenuItem("Generate LODs", nullptr, bGenerateLods))
+            {
+                bGenerateLods = !bGenerateLods;
+            }
+            if (ImGui::BeginMenu("Vertex Format"))
+            {
+                if (ImGui::MenuItem("Float (40 bytes)", nullptr, MeshVertexFormat == VertexFormat::Float)) { MeshVertexFormat = VertexFormat::Float; }
+                if (ImGui::MenuItem("Half Positions (16 bytes)", nullptr, MeshVertexFormat == VertexFormat::QuantisedHalf)) { MeshVertexFormat = VertexFormat::QuantisedHalf; }
+                if (ImGui::MenuItem("Bounds Relative Positions (16 bytes)", nullptr, MeshVertexFormat == VertexFormat::QuantisedBounds)) { MeshVertexFormat = VertexFormat::QuantisedBounds; }
+                ImGui::EndMenu();
+            }
+            if (ImGui::BeginMenu("Culling"))
+            {
+                MeshCullMode& CullMode = G_MainWindow->RendererDX->SMPipe->CullMode;
+                if (ImGui::MenuItem("None", nullptr, CullMode == MeshCullMode::None)) { CullMode = MeshCullMode::None; }
+                if (ImGui::MenuItem("Flat SIMD", nullptr, CullMode == MeshCullMode::Flat)) { CullMode = MeshCullMode::Flat; }
+                if (ImGui::MenuItem("BVH", nullptr, CullMode == MeshCullMode::BVH)) { CullMode = MeshCullMode::BVH; }
+                ImGui::Separator();
+                bool& bOcclusionCulling = G_MainWindow->RendererDX->SMPipe->bOcclusionCulling;
+                if (ImGui::MenuItem("Occlusion", nullptr, bOcclusionCulling)) { bOcclusionCulling = !bOcclusionCulling; }
+                ImGui::EndMenu();
+            }
+            bool& bSortDraws = G_MainWindow->RendererDX->SMPipe->bSortDraws;
+            if (ImGui::MenuItem("Sort Draws", nullptr, bSortDraws)) { bSortDraws = !bSortDraws; }
+            bool& bIndirectDraws = G_MainWindow->RendererDX->SMPipe->bIndirectDraws;
+            if (ImGui::MenuItem("Indirect Draws", nullptr, bIndirectDraws)) { bIndirectDraws = !bIndirectDraws; }
             if (ImGui::MenuItem("Show Info Overlay", nullptr, HasWindowFlag(UIWindowFlags::Overlay)))
             {
                 WindowFlags ^= static_cast<int>(UIWindowFlags::Overlay);
             }
+            if (ImGui::MenuItem("Show Occlusion Buffer", nullptr, HasWindowFlag(UIWindowFlags::OcclusionBuffer)))
+            {
+                WindowFlags ^= static_cast<int>(UIWindowFlags::OcclusionBuffer);
+            }
+            if (ImGui::MenuItem("Show Timeline", nullptr, HasWindowFlag(UIWindowFlags::Timeline)))
+            {
+                WindowFlags ^= static_cast<int>(UIWindowFlags::Timeline);
+            }
             if (ImGui::MenuItem("Show Demo Window", nullptr, HasWindowFlag(UIWindowFlags::DemoUI)))
             {
                 WindowFlags ^= static_cast<int>(UIWindowFlags::DemoUI);
@@ -163,6 +221,72 @@ void UIBase::ShowInfoOverlay()
             ImGui::Text("Mouse Position: (%.1f,%.1f)", io.MousePos.x, io.MousePos.y);
         else
             ImGui::Text("Mouse Position: <invalid>");
+        
+        ImGui::Separator();
+        const SceneLoadStats& LoadStats = G_MainWindow->Scene->GetLoadStats();
+        ImGui::Text("Scene: %zu meshes, %zu prims", LoadStats.NumMeshes, LoadStats.NumPrims);
+        ImGui::Text("Instances: %zu (%zu prototypes, %zu point instancers)", LoadStats.NumInstances, LoadStats.NumPrototypes, LoadStats.NumPointInstancers);
+        ImGui::Text("Geometry: %.2f MB (%.2f MB flattened)", LoadStats.GeometryBytes / (1024.0 * 1024.0), LoadStats.FlattenedGeometryBytes / (1024.0 * 1024.0));
+        ImGui::Text("Vertices: %zu (welded from %zu)", LoadStats.NumVertices, LoadStats.NumSourceVertices);
+        ImGui::Text("Cooked: %zu of %zu meshes", LoadStats.NumCookedMeshes, LoadStats.NumMeshes);
+        ImGui::Text("Meshlets: %zu (%.2f MB)", LoadStats.NumMeshlets, LoadStats.MeshletBytes / (1024.0 * 1024.0));
+        if (LoadStats.NumDeformingMeshes > 0)
+        {
+            const DeformDrawStats& DeformStats = G_MainWindow->RendererDX->SMPipe->GetDeformStats();
+            ImGui::Text("Deforming: %zu / %zu meshes written (%zu skinned), %zu vertices in %zu runs (%.3f ms)", DeformStats.NumWritten, DeformStats.NumMeshes,
+                LoadStats.NumSkinnedMeshes, DeformStats.NumVertices, DeformStats.NumWrittenRuns, DeformStats.WriteMs);
+        }
+        const CullDrawStats& CullStats = G_MainWindow->RendererDX->SMPipe->GetCullStats();
+        ImGui::Text("Culling: %zu / %zu meshes, %zu / %zu instances visible (%.3f ms)", CullStats.NumVisibleMeshes, CullStats.NumMeshes,
+            CullStats.NumVisibleInstances, CullStats.NumInstances, CullStats.CullMs);
+        if (G_MainWindow->RendererDX->SMPipe->CullMode == MeshCullMode::Flat)
+        {
+            ImGui::Text("  %zu culled by sphere, %zu more by box", CullStats.NumSphereCulled, CullStats.NumBoxCulled);
+        }
+        if (G_MainWindow->RendererDX->SMPipe->bOcclusionCulling)
+        {
+            ImGui::Text("  %zu occluded by %zu occluders, %zu triangles (%.3f ms)", CullStats.NumOccluded, CullStats.NumOccluders, CullStats.NumOccluderTriangles, CullStats.OcclusionMs);
+        }
+        const LodDrawStats& LodStats = G_MainWindow->RendererDX->SMPipe->GetLodStats();
+        ImGui::Text("Triangles: %zu drawn, %zu at full detail", LodStats.NumTriangles, LodStats.NumLod0Triangles);
+        const ArenaDrawStats ArenaStats = G_MainWindow->RendererDX->SMPipe->GetArenaStats();
+        ImGui::Text("Geometry: %zu arenas, %.1f / %.1f MB used, %zu bindings, %zu repacks", ArenaStats.NumArenas, ArenaStats.UsedBytes / (1024.0 * 1024.0),
+            ArenaStats.CapacityBytes / (1024.0 * 1024.0), ArenaStats.NumBindings, ArenaStats.NumRepacks);
+        ImGui::Text("  %.1f MB staged in %zu copies, %zu submits, %zu stalls", ArenaStats.NumStagedBytes / (1024.0 * 1024.0), ArenaStats.NumCopies,
+            ArenaStats.NumSubmits, ArenaStats.NumStagingStalls);
+        const TlsfStats DefaultHeapStats = G_MainWindow->RendererDX->SMPipe->DefaultHeaps.GetStats();
+        const TlsfStats UploadHeapStats = G_MainWindow->RendererDX->SMPipe->UploadHeaps.GetStats();
+        ImGui::Text("Heaps: %zu default, %zu upload, %.1f / %.1f MB placed, %.0f%% fragmented, %.1f MB alignment waste", DefaultHeapStats.NumBlocks,
+            UploadHeapStats.NumBlocks, (DefaultHeapStats.AllocatedBytes + UploadHeapStats.AllocatedBytes) / (1024.0 * 1024.0),
+            (DefaultHeapStats.BlockBytes + UploadHeapStats.BlockBytes) / (1024.0 * 1024.0), 100.0 * DefaultHeapStats.GetFragmentation(),
+            (DefaultHeapStats.GetWastedBytes() + UploadHeapStats.GetWastedBytes()) / (1024.0 * 1024.0));
+        const DrawSortStats& SortStats = G_MainWindow->RendererDX->SMPipe->GetSortStats();
+        ImGui::Text("Draws: %zu packets, %zu pipeline changes, %zu sort passes (%.3f ms)", SortStats.NumPackets, SortStats.NumPipelineChanges,
+            SortStats.NumSortPasses, SortStats.SortMs);
+        if (G_MainWindow->RendererDX->SMPipe->bIndirectDraws)
+        {
+            ImGui::Text("  %zu ExecuteIndirect batches, %zu empty draws compacted", SortStats.NumExecuteIndirect, SortStats.NumCompacted);
+        }
+        ImGui::Text("Picked: %s", PickedMesh.empty() ? "<none>" : PickedMesh.c_str());
+        ImGui::Text("Load: %.1f ms (%d threads)", LoadStats.TotalMs, LoadStats.NumThreads);
+        ImGui::Text("  Open %.1f | Traverse %.1f | Meshes %.1f", LoadStats.OpenMs, LoadStats.TraverseMs, LoadStats.MeshBuildMs);
+        if (G_MainWindow->Scene->UsesHydra())
+        {
+            const SceneAnimationStats& HydraStats = G_MainWindow->Scene->GetAnimationStats();
+            ImGui::Text("Hydra: sync %.3f ms, %zu meshes rebuilt, %zu rows moved", HydraStats.EvaluateMs, HydraStats.NumDeformedMeshes, HydraStats.NumRows);
+        }
+        const SceneEditStats& EditStats = G_MainWindow->Scene->GetEditStats();
+        if (EditStats.NumBatches > 0)
+        {
+            ImGui::Text("Edits: %zu batches, last %zu edits, %zu rows, %zu meshes rebuilt, %zu removed, %zu added (%.3f ms)", EditStats.NumBatches,
+                EditStats.NumEdits, EditStats.NumRows, EditStats.NumRebuiltMeshes, EditStats.NumRemovedMeshes, EditStats.NumAddedMeshes, EditStats.ApplyMs);
+        }
+        if (G_MainWindow->Scene->IsStreaming())
+        {
+            const PayloadStreamingStats Streaming = G_MainWindow->Scene->GetStreamingStats();
+            ImGui::Text("Payloads: %zu / %zu resident (%zu loads, %zu evictions)", Streaming.NumResident, Streaming.NumPayloads, Streaming.NumLoads, Streaming.NumEvictions);
+            ImGui::Text("  %.1f / %.0f MB budget", Streaming.ResidentBytes / (1024.0 * 1024.0), Streaming.BudgetBytes / (1024.0 * 1024.0));
+        }
         if (ImGui::BeginPopupContextWindow())
         {
             if (ImGui::MenuItem("Custom",       NULL, location == -1)) location = -1;
@@ -178,11 +302,115 @@ void UIBase::ShowInfoOverlay()
     ImGui::End();
 }
 
+void UIBase::ShowOcclusionBuffer()
+{
+    bool bOpen = true;
+    if (ImGui::Begin("Occlusion Buffer", &bOpen, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        const OcclusionBuffer& Buffer = G_MainWindow->RendererDX->SMPipe->GetOcclusionBuffer();
+        const std::vector<float>& Depth = Buffer.GetDepth();
+        const std::shared_ptr<Camera> Cam = G_MainWindow->Scene->GetCamera();
+        if (Depth.empty() || !G_MainWindow->RendererDX->SMPipe->bOcclusionCulling)
+        {
+            ImGui::Text("Occlusion culling is off.");
+        }
+        else
+        {
+            // Distance on a log scale from white at the near plane to black at the far plane, which is also where nothing was drawn.
+            const float PixelSize = 2.0f * DpiScaling;
+            const float Near = Cam->GetNearPlane();
+            const float Far = Cam->GetFarPlane();
+            const auto ToGrey = [Near, Far](float Z)
+            {
+                const float Distance = Near * Far / (Far - Z * (Far - Near));
+                const float Shade = 1.0f - std::log(Distance / Near) / std::log(Far / Near);
+                return static_cast<int>(std::clamp(Shade, 0.0f, 1.0f) * 255.0f);
+            };
+
+            // Runs of equal shade along each row are drawn as one rectangle.
+            const ImVec2 Origin = ImGui::GetCursorScreenPos();
+            ImDrawList* DrawList = ImGui::GetWindowDrawList();
+            for (uint32_t Y = 0; Y < Buffer.GetHeight(); Y++)
+            {
+                uint32_t RunStart = 0;
+                int RunGrey = ToGrey(Depth[static_cast<size_t>(Y) * Buffer.GetWidth()]);
+                for (uint32_t X = 1; X <= Buffer.GetWidth(); X++)
+                {
+                    const int Grey = X < Buffer.GetWidth() ? ToGrey(Depth[static_cast<size_t>(Y) * Buffer.GetWidth() + X]) : -1;
+                    if (Grey == RunGrey) { continue; }
+
+                    DrawList->AddRectFilled(ImVec2(Origin.x + RunStart * PixelSize, Origin.y + Y * PixelSize), ImVec2(Origin.x + X * PixelSize, Origin.y + (Y + 1) * PixelSize),
+                        IM_COL32(RunGrey, RunGrey, RunGrey, 255));
+                    RunStart = X;
+                    RunGrey = Grey;
+                }
+            }
+            ImGui::Dummy(ImVec2(Buffer.GetWidth() * PixelSize, Buffer.GetHeight() * PixelSize));
+        }
+    }
+    ImGui::End();
+
+    if (!bOpen) { WindowFlags &= ~static_cast<int>(UIWindowFlags::OcclusionBuffer); }
+}
+
+void UIBase::ShowTimeline()
+{
+    bool bOpen = true;
+    if (ImGui::Begin("Timeline", &bOpen, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        SceneTimeline& Timeline = G_MainWindow->Scene->GetTimeline();
+        if (!Timeline.HasRange())
+        {
+            ImGui::Text("The stage has no time range.");
+        }
+        else
+        {
+            if (ImGui::Button(Timeline.bPlaying ? "Pause" : "Play"))
+            {
+                // Playing again from the end of a non looping timeline starts over.
+                if (!Timeline.bPlaying && Timeline.CurrentTimeCode >= Timeline.EndTimeCode) { Timeline.CurrentTimeCode = Timeline.StartTimeCode; }
+                Timeline.bPlaying = !Timeline.bPlaying;
+            }
+            ImGui::SameLine();
+            ImGui::Checkbox("Loop", &Timeline.bLooping);
+            ImGui::SliderScalar("Time Code", ImGuiDataType_Double, &Timeline.CurrentTimeCode, &Timeline.StartTimeCode, &Timeline.EndTimeCode, "%.2f");
+            ImGui::Text("%.2f time codes per second", Timeline.TimeCodesPerSecond);
+        }
+
+        const SceneAnimationStats& Stats = G_MainWindow->Scene->GetAnimationStats();
+        ImGui::Separator();
+        ImGui::Text("Evaluated: %zu prims, %zu point instancers", Stats.NumPlacements, Stats.NumPointInstancers);
+        ImGui::Text("Rows: %zu in %.3f ms", Stats.NumRows, Stats.EvaluateMs);
+        ImGui::Text("Deformed: %zu meshes sampled in %.3f ms", Stats.NumDeformedMeshes, Stats.SampleMs);
+        ImGui::Text("Deferred: %zu frames", Stats.NumDeferredFrames);
+    }
+    ImGui::End();
+
+    if (!bOpen) { WindowFlags &= ~static_cast<int>(UIWindowFlags::Timeline); }
+}
+
 void UIBase::ViewportDrag()
 {
     const bool bActive = ImGui::IsAnyItemActive() || ImGui::IsAnyItemHovered() || ImGui::IsAnyItemFocused();
 
     std::shared_ptr<Camera> Cam = G_MainWindow->Scene.get()->GetCamera();
+
+    // A left click that never became a drag picks the mesh under the cursor.
+    const ImGuiIO& IO = ImGui::GetIO();
+    const bool bClicked = ImGui::IsMouseReleased(ImGuiMouseButton_Left) && IO.MouseDragMaxDistanceSqr[ImGuiMouseButton_Left] < IO.MouseDragThreshold * IO.MouseDragThreshold;
+    if (!bActive && bClicked && !ImGui::IsWindowHovered(ImGuiHoveredFlags_AnyWindow) && ImGui::IsMousePosValid())
+    {
+        const std::unique_ptr<Renderer>& R = G_MainWindow->RendererDX;
+        DirectX::XMFLOAT3 Origin, Direction;
+        Cam->GetPickRay(IO.MousePos.x, IO.MousePos.y, static_cast<float>(R->Width), static_cast<float>(R->Height), Origin, Direction);
+
+        MeshPickResult Pick;
+        PickedMesh.clear();
+        if (R->SMPipe->Pick(Origin, Direction, Pick))
+        {
+            PickedMesh = G_MainWindow->Scene->GetMeshes()[Pick.Mesh]->GetPrim().GetPath().GetString() + " [" + std::to_string(Pick.Instance) + "]";
+        }
+    }
     
     if (!bActive && ImGui::IsMouseDragging(ImGuiMouseButton_Left))
     {
@@ -319,7 +547,10 @@ bool UIBase::OpenSceneBrowser()
 
     // Open Scene
     G_MainWindow->Scene->ClearScene();
-    G_MainWindow->Scene->LoadScene(SelectedPath);
+    G_MainWindow->Scene->SetOptimiseMeshes(bOptimiseMeshes);
+    G_MainWindow->Scene->SetVertexFormat(MeshVertexFormat);
+    G_MainWindow->Scene->SetGenerateLods(bGenerateLods);
+    G_MainWindow->Scene->LoadScene(SelectedPath, bStreamPayloads ? ScenePayloadMode::Streamed : ScenePayloadMode::LoadAll);
     G_MainWindow->RendererDX->SMPipe->ResetScene();
     
     return TRUE;
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "ImGuiDescHeap.h"
+#include "pch.h"
+
+#include <string>
 
 // ImGui rendering heap desc global.
 inline ImguiDescHeapAllocator ImguiHeapAlloc;
@@ -10,6 +13,8 @@ enum class UIWindowFlags : int
     None            = 0,
     Overlay         = 1 << 0,
     DemoUI          = 1 << 1,
+    OcclusionBuffer = 1 << 2,
+    Timeline        = 1 << 3,
 };
 
 class UIBase
@@ -26,6 +31,8 @@ private:
     // UI Functions
     void WindowMenuBar();
     void ShowInfoOverlay();
+    void ShowOcclusionBuffer();
+    void ShowTimeline();
     
     // UX Functions
     void ViewportDrag();
@@ -38,6 +45,11 @@ private:
     
 private:
     int WindowFlags = 0;
+    bool bStreamPayloads = false; // Open scenes with payloads unloaded and stream them in around the camera.
+    bool bOptimiseMeshes = true; // Reorder mesh indices for the vertex cache and overdraw when loading.
+    bool bGenerateLods = true; // Build simplified LODs of each mesh when loading, picked per frame by screen space error.
+    VertexFormat MeshVertexFormat = VertexFormat::QuantisedBounds;
+    std::string PickedMesh; // Prim path and instance of the last mesh clicked in the viewport.
     
     // UI Scaling
     float DpiScaling = 1.0f;
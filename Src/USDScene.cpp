@@ -1,71 +1,1491 @@
 #include "USDScene.h"
 
+#include "HydraScene.h"
 #include "RenderMesh.h"
 #include "Camera.h"
+#include "PointInstancer.h"
+#include "MeshCache.h"
 #include <nvtx3/nvtx3.hpp>
 
-// USD
+// Std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
 #include <iostream>
+#include <set>
+#include <unordered_map>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 
+// USD
 #include "pxr/usd/usd/stage.h"
 #include "pxr/usd/usdGeom/xform.h"
+#include "pxr/usd/usdGeom/mesh.h"
 #include "pxr/usd/usdGeom/sphere.h"
 #include "pxr/usd/sdf/path.h"
 #include "pxr/usd/usd/primRange.h"
 #include "pxr/usd/usdGeom/xformCommonAPI.h"
+#include "pxr/usd/usdGeom/xformCache.h"
+#include "pxr/usd/usdGeom/bboxCache.h"
+#include "pxr/usd/usdSkel/animation.h"
+#include "pxr/usd/usdSkel/binding.h"
+#include "pxr/usd/usdSkel/blendShape.h"
+#include "pxr/usd/usdSkel/cache.h"
+#include "pxr/usd/usdSkel/root.h"
+#include "pxr/usd/usdSkel/skeleton.h"
 
 // Useful USD References: https://github.com/LittleCoinCoin/OpenUSD-setup-vcpkg-template/blob/main/OpenUSD-setup-vcpkg/src/main.cpp
 
 using namespace pxr;
 
+namespace
+{
+    // Whether a prim's local to world transform may change over time, up to the first prim resetting the xform stack.
+    bool IsWorldTransformTimeVarying(UsdGeomXformCache& XformCache, UsdPrim Prim)
+    {
+        for (; Prim && !Prim.IsPseudoRoot(); Prim = Prim.GetParent())
+        {
+            if (XformCache.TransformMightBeTimeVarying(Prim)) { return true; }
+            if (XformCache.GetResetXformStack(Prim)) { return false; }
+        }
+        return false;
+    }
+
+    // Root prim of the USD prototype a path is in.
+    SdfPath GetPrototypeRootPath(SdfPath Path)
+    {
+        while (Path.GetPathElementCount() > 1) { Path = Path.GetParentPath(); }
+        return Path;
+    }
+}
+
 USDScene::USDScene()
 {
     MainCamera = std::make_shared<Camera>();
 }
 
-void USDScene::LoadScene(const std::string& Path)
+USDScene::~USDScene() = default;
+
+void USDScene::LoadScene(const std::string& Path, ScenePayloadMode PayloadMode)
 {
     nvtx3::scoped_range r{ "Load USD Scene" };
 
-    Stage = UsdStage::Open(Path);
+    using Clock = std::chrono::steady_clock;
+    const auto ToMs = [](Clock::duration Duration) { return std::chrono::duration<double, std::milli>(Duration).count(); };
+    LoadStats = SceneLoadStats();
+    Streamer.reset();
+    Hydra.reset();
+    HydraMeshIndices.clear();
+    
+    const Clock::time_point StartTime = Clock::now();
+
+    // Streaming opens every payload unloaded, the first frame only has what is authored outside of them.
+    // Hydra populates from the whole stage, it always loads them.
+    const bool bHydra = FrontEnd == SceneFrontEnd::Hydra;
+    const bool bStreamed = PayloadMode == ScenePayloadMode::Streamed && !bHydra;
+    Stage = UsdStage::Open(Path, bStreamed ? UsdStage::LoadNone : UsdStage::LoadAll);
+    if (!Stage)
+    {
+        std::cerr << "USDScene::LoadScene: Failed to open stage at '" << Path << "'" << std::endl;
+        return;
+    }
+
+    // Edits to the stage from here on are applied incrementally, see UpdateStageEdits. Hydra tracks its own changes.
+    TfNotice::Revoke(ObjectsChangedKey);
+    if (!bHydra)
+    {
+        ObjectsChangedKey = TfNotice::Register(TfCreateWeakPtr(this), &USDScene::OnObjectsChanged, UsdStageWeakPtr(Stage));
+    }
 
     TfToken UpAxis;  
     Stage->GetMetadata(UsdGeomTokens->upAxis, &UpAxis);
     bIsYUp = (UpAxis == UsdGeomTokens->y);
+
+    // Playback starts at the first authored time code, stages without a time range show that one frame.
+    Timeline.StartTimeCode = Stage->GetStartTimeCode();
+    Timeline.EndTimeCode = Stage->GetEndTimeCode();
+    Timeline.TimeCodesPerSecond = Stage->GetTimeCodesPerSecond() > 0.0 ? Stage->GetTimeCodesPerSecond() : 24.0;
+    Timeline.CurrentTimeCode = Timeline.StartTimeCode;
+    AnimationStats = SceneAnimationStats();
+    EditStats = SceneEditStats();
+    AnimationXformCache.Clear();
+    bTransformsDirty = true;
     
-    UsdPrimRange Prims = Stage->TraverseAll();  
+    // Cooked geometry from a previous cook, meshes whose USD data is unchanged skip triangulation.
+    CookedMeshes = MeshCacheFile::Open(MeshCache::GetCachePath(Path));
+    
+    const Clock::time_point OpenTime = Clock::now();
+    Clock::time_point TraverseTime;
+    Clock::time_point BuildTime;
+    std::vector<UsdPrim> Payloads;
+    if (bHydra)
+    {
+        // Stage 1: the scene delegate inserts an rprim per mesh and an instancer per instancing prototype or point instancer.
+        Hydra = std::make_unique<HydraScene>(Stage, GetMeshBuildSettings(), CookedMeshes);
+        Hydra->Populate();
+        TraverseTime = Clock::now();
 
-    for (UsdPrim Prim : Prims)
+        // Stage 2: the first sync builds every rprim's mesh, Hydra spreads the rprims across all cores.
+        Hydra->Sync(UsdTimeCode(Timeline.CurrentTimeCode));
+        BuildTime = Clock::now();
+
+        // Stage 3: the rprims' world transforms are already synced, they are only laid out as rows.
+        SceneStreamingUpdate Update;
+        LayoutHydraMeshes(Update);
+    }
+    else
     {
-        if (!Prim.IsValid()) { continue; }
+        // Stage 1: cheap serial walk of the stage, only gathering the prims we can render.
+        SceneChunk Chunk;
+        CollectRenderablePrims(Stage->GetPseudoRoot(), UsdTimeCode(Timeline.StartTimeCode), Chunk, bStreamed ? &Payloads : nullptr);
+        TraverseTime = Clock::now();
+
+        // Stage 2: validation, triangulation and vertex processing for each mesh across all cores.
+        BuildRenderMeshes(Chunk);
+        BindSkinnedMeshes(Chunk);
+        BuildTime = Clock::now();
+
+        // Stage 3: world transforms of every instance through one shared xform cache.
+        ComputeWorldTransforms(Chunk, UsdTimeCode(Timeline.CurrentTimeCode));
+        AppendChunk(Chunk);
+    }
+    
+    const Clock::time_point TransformTime = Clock::now();
+
+    LoadStats.OpenMs = ToMs(OpenTime - StartTime);
+    LoadStats.TraverseMs = ToMs(TraverseTime - OpenTime);
+    LoadStats.MeshBuildMs = ToMs(BuildTime - TraverseTime);
+    LoadStats.TransformMs = ToMs(TransformTime - BuildTime);
+    LoadStats.TotalMs = ToMs(TransformTime - StartTime);
+    LoadStats.NumThreads = tbb::this_task_arena::max_concurrency();
+    PrintLoadStats();
+
+    // The rest of the scene fills in as the payloads stream, see UpdateStreaming.
+    if (!Payloads.empty())
+    {
+        std::vector<PayloadBounds> Bounds;
+        GatherPayloadBounds(Payloads, Bounds);
         
-        SdfPath PrimPath = Prim.GetPath();
-        TfToken Type = Prim.GetTypeName();
+        Streamer = std::make_unique<PayloadStreamer>(StreamingBudgetBytes,
+            [this](uint32_t Id, const SdfPath& PayloadPath, std::vector<PayloadBounds>& OutNested) { return LoadPayload(Id, PayloadPath, OutNested); },
+            [this](const std::vector<SdfPath>& Paths) { UnloadPayloads(Paths); });
+        Streamer->AddPayloads(Bounds);
+        Streamer->Start();
         
-        std::cout << "Prim name: " << Prim.GetName() << std::endl;
-        std::cout << "Path: " << PrimPath << std::endl;
-        std::cout << "Type: " << Type << std::endl;
-        std ::cout << "\n";
+        std::cout << "USDScene::LoadScene: Streaming " << Bounds.size() << " payloads within " << StreamingBudgetBytes / (1024 * 1024) << " MB\n";
+    }
+}
+
+void USDScene::CollectRenderablePrims(const UsdPrim& Root, UsdTimeCode Time, SceneChunk& Chunk, std::vector<UsdPrim>* OutPayloads, bool bSkipPayloads) const
+{
+    nvtx3::scoped_range r{ "Collect Renderable Prims" };
+
+    const TfToken XformType("Xform");
+    const TfToken MeshType("Mesh");
+    
+    std::vector<MeshSource>& OutSources = Chunk.Sources;
+    std::vector<UsdPrim> InstancePrims;
+    std::vector<UsdPrim> InstancerPrims;
+    
+    UsdPrimRange Prims(Root, UsdPrimAllPrimsPredicate);
+
+    for (UsdPrimRange::iterator It = Prims.begin(); It != Prims.end(); ++It)
+    {
+        const UsdPrim& Prim = *It;
+        if (!Prim.IsValid() || Prim.IsPseudoRoot()) { continue; }
+        Chunk.NumPrims++;
+
+        // Unloaded payloads are left to the streamer, anything nested below them is found once they load.
+        if (OutPayloads && Prim.HasAuthoredPayloads() && !Prim.IsLoaded())
+        {
+            OutPayloads->emplace_back(Prim);
+            It.PruneChildren();
+            continue;
+        }
+
+        // Resyncs in a streamed scene leave the payloads below their root to the chunks they stream with.
+        if (bSkipPayloads && Prim != Root && Prim.HasAuthoredPayloads())
+        {
+            It.PruneChildren();
+            continue;
+        }
+
+        const TfToken Type = Prim.GetTypeName();
+        if (Prim.IsInstance())
+        {
+            // The geometry below an instance lives in its shared prototype, which is loaded once below. An instanceable mesh's own
+            // points and faces are on the instance prim and are drawn like any other mesh.
+            if (Type == MeshType)
+            {
+                MeshSource Source;
+                Source.Prim = Prim;
+                Source.Placements.push_back(InstancePlacement{ Prim, GfMatrix4d(1.0) });
+                OutSources.emplace_back(std::move(Source));
+            }
+            InstancePrims.emplace_back(Prim);
+            It.PruneChildren();
+            continue;
+        }
         
-        if (Type == TfToken("Xform"))
+        if (Type == XformType)
+        {
+            continue;
+        }
+        else if (Type == MeshType)
+        {
+            MeshSource Source;
+            Source.Prim = Prim;
+            Source.Placements.push_back(InstancePlacement{ Prim, GfMatrix4d(1.0) });
+            OutSources.emplace_back(std::move(Source));
+        }
+        else if (Prim.IsA<UsdGeomPointInstancer>())
+        {
+            // Prototypes are usually authored below the instancer, they are only drawn through it.
+            InstancerPrims.emplace_back(Prim);
+            It.PruneChildren();
+        }
+        else if (Prim.IsA<UsdSkelRoot>())
         {
-            std::cout << "Processing Xform..." << "\n";
+            // Skinned meshes below are collected as usual, the skel root binds them to their skeleton once they are built.
+            Chunk.SkelRoots.emplace_back(Prim);
         }
-        else if (Type == TfToken("Mesh"))
+        else if (Prim.IsA<UsdSkelSkeleton>() || Prim.IsA<UsdSkelAnimation>() || Prim.IsA<UsdSkelBlendShape>())
         {
-            std::shared_ptr<RenderMesh> Mesh = std::make_shared<RenderMesh>(this);
-            Mesh->Load(Prim);
-            Meshes.emplace_back(Mesh);
+            continue;
         }
         else
         {
-            std::cout << "Processing unsupported type: " << Prim.GetTypeName() << "\n";
+            std::cout << "Processing unsupported type: " << Type << " at: " << Prim.GetPath() << "\n";
+        }
+    }
+
+    // Meshes below a prototype root, relative to an anchor prim. Nested instances are flattened into the result.
+    struct PrototypeMesh
+    {
+        size_t MeshIdx = 0;
+        GfMatrix4d Offset{1.0};
+    };
+    
+    // Default time would ignore offsets and instancer arrays authored only as time samples.
+    UsdGeomXformCache XformCache(Time);
+    std::unordered_map<SdfPath, std::vector<PrototypeMesh>, SdfPath::Hash> PrototypeMeshes;
+    
+    const std::function<const std::vector<PrototypeMesh>&(const UsdPrim&, const UsdPrim&)> GatherMeshes =
+        [&](const UsdPrim& PrototypeRoot, const UsdPrim& Anchor) -> const std::vector<PrototypeMesh>&
+    {
+        const auto Found = PrototypeMeshes.find(PrototypeRoot.GetPath());
+        if (Found != PrototypeMeshes.end()) { return Found->second; }
+
+        std::vector<PrototypeMesh> Result;
+        bool bResetsXformStack = false;
+        
+        UsdPrimRange PrototypePrims(PrototypeRoot, UsdPrimAllPrimsPredicate);
+        for (UsdPrimRange::iterator It = PrototypePrims.begin(); It != PrototypePrims.end(); ++It)
+        {
+            const UsdPrim& Prim = *It;
+            Chunk.NumPrims++;
+
+            if (Prim.IsInstance())
+            {
+                const UsdPrim Prototype = Prim.GetPrototype();
+                const GfMatrix4d InstanceOffset = XformCache.ComputeRelativeTransform(Prim, Anchor, &bResetsXformStack);
+                if (Prim.GetTypeName() == MeshType)
+                {
+                    Result.push_back(PrototypeMesh{ OutSources.size(), InstanceOffset });
+                    MeshSource Source;
+                    Source.Prim = Prim;
+                    OutSources.emplace_back(std::move(Source));
+                }
+                for (const PrototypeMesh& Nested : GatherMeshes(Prototype, Prototype))
+                {
+                    Result.push_back(PrototypeMesh{ Nested.MeshIdx, Nested.Offset * InstanceOffset });
+                }
+                It.PruneChildren();
+            }
+            else if (Prim.IsA<UsdGeomPointInstancer>())
+            {
+                // Its rows would need one copy per enclosing instance, its prototypes are not gathered as plain meshes either.
+                std::cout << "USDScene: Point instancer '" << Prim.GetPath() << "' inside the prototype of '" << PrototypeRoot.GetPath()
+                    << "' is not supported, skipping.\n";
+                It.PruneChildren();
+            }
+            else if (Prim.GetTypeName() == MeshType)
+            {
+                Result.push_back(PrototypeMesh{ OutSources.size(), XformCache.ComputeRelativeTransform(Prim, Anchor, &bResetsXformStack) });
+                MeshSource Source;
+                Source.Prim = Prim;
+                OutSources.emplace_back(std::move(Source));
+            }
+        }
+
+        Chunk.NumPrototypes++;
+        return PrototypeMeshes.emplace(PrototypeRoot.GetPath(), std::move(Result)).first->second;
+    };
+
+    // USD instancing, the prototype root stands in for the instance prim so meshes are relative to it.
+    for (const UsdPrim& Instance : InstancePrims)
+    {
+        const UsdPrim Prototype = Instance.GetPrototype();
+        for (const PrototypeMesh& ProtoMesh : GatherMeshes(Prototype, Prototype))
+        {
+            OutSources[ProtoMesh.MeshIdx].Placements.push_back(InstancePlacement{ Instance, ProtoMesh.Offset });
+        }
+    }
+
+    // Point instancers, the prototype root's own transform applies below the per instance transform.
+    for (const UsdPrim& InstancerPrim : InstancerPrims)
+    {
+        const UsdGeomPointInstancer Instancer(InstancerPrim);
+        SdfPathVector PrototypePaths;
+        Instancer.GetPrototypesRel().GetForwardedTargets(&PrototypePaths);
+
+        PointInstanceArrays Arrays;
+        if (!Arrays.Read(Instancer, Time))
+        {
+            std::cout << "USDScene: Point instancer '" << InstancerPrim.GetPath() << "' has mismatched positions and protoIndices, skipping.\n";
+            continue;
+        }
+        
+        std::vector<uint32_t> Counts;
+        PointInstancing::CountInstances(Arrays, PrototypePaths.size(), Counts);
+
+        const uint32_t InstancerIdx = static_cast<uint32_t>(Chunk.PointInstancers.size());
+        PointInstancerBlock Block;
+        Block.Prim = InstancerPrim;
+        Block.NumPrototypes = PrototypePaths.size();
+        Block.Counts = Counts;
+        Block.Owner = Chunk.Owner;
+        Chunk.PointInstancers.emplace_back(std::move(Block));
+        
+        for (size_t Proto = 0; Proto < PrototypePaths.size(); Proto++)
+        {
+            const UsdPrim PrototypeRoot = Stage->GetPrimAtPath(PrototypePaths[Proto]);
+            if (!PrototypeRoot || Counts[Proto] == 0) { continue; }
+            
+            for (const PrototypeMesh& ProtoMesh : GatherMeshes(PrototypeRoot, PrototypeRoot.GetParent()))
+            {
+                OutSources[ProtoMesh.MeshIdx].PointInstances.push_back(
+                    PointInstancerRef{ InstancerIdx, static_cast<uint32_t>(Proto), Counts[Proto], ProtoMesh.Offset });
+            }
         }
     }
 }
 
+void USDScene::BuildRenderMeshes(SceneChunk& Chunk) const
+{
+    nvtx3::scoped_range r{ "Build Render Meshes" };
+
+    std::vector<MeshSource>& Sources = Chunk.Sources;
+
+    // Every prim owns its own output slot, so the result keeps the traversal order regardless of scheduling.
+    std::vector<std::shared_ptr<RenderMesh>> Loaded(Sources.size());
+    const MeshBuildSettings Settings = GetMeshBuildSettings();
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, Sources.size()),
+        [&](const tbb::blocked_range<size_t>& Range)
+        {
+            for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+            {
+                UsdPrim Prim = Sources[Idx].Prim;
+                std::shared_ptr<RenderMesh> Mesh = std::make_shared<RenderMesh>(Settings, CookedMeshes);
+                Mesh->Load(Prim);
+                Loaded[Idx] = Mesh;
+            }
+        });
+
+    // Drop the prims that failed validation, they have no render data. Instance rows are laid out per mesh.
+    Chunk.Meshes.reserve(Loaded.size());
+    for (size_t Idx = 0; Idx < Loaded.size(); Idx++)
+    {
+        MeshSource& Source = Sources[Idx];
+        const std::shared_ptr<MeshData> Data = Loaded[Idx]->GetMeshData();
+        if (Data == nullptr || (Source.Placements.empty() && Source.PointInstances.empty())) { continue; }
+
+        MeshInstanceRange Range;
+        Range.FirstInstance = static_cast<uint32_t>(Chunk.NumInstanceRows);
+        for (InstancePlacement& Placement : Source.Placements)
+        {
+            Placement.Row = static_cast<uint32_t>(Chunk.NumInstanceRows++);
+            Chunk.Placements.emplace_back(Placement);
+        }
+        for (const PointInstancerRef& Ref : Source.PointInstances)
+        {
+            Chunk.PointInstancers[Ref.InstancerIdx].Meshes.push_back(
+                PointInstancerMesh{ Ref.PrototypeIdx, static_cast<uint32_t>(Chunk.NumInstanceRows), Ref.NumInstances, Ref.Offset });
+            Chunk.NumInstanceRows += Ref.NumInstances;
+        }
+        Range.NumInstances = static_cast<uint32_t>(Chunk.NumInstanceRows) - Range.FirstInstance;
+        
+        Chunk.ResidentBytes += Data->GetVertexBufferSize() + Data->GetIndexBufferSize();
+        Chunk.InstanceRanges.push_back(Range);
+        Chunk.Meshes.emplace_back(Loaded[Idx]);
+    }
+    
+    Chunk.ResidentBytes += Chunk.NumInstanceRows * sizeof(DirectX::XMFLOAT4X4);
+    Chunk.Sources.clear();
+}
+
+MeshBuildSettings USDScene::GetMeshBuildSettings() const
+{
+    MeshBuildSettings Settings;
+    Settings.bIsYUp = bIsYUp;
+    Settings.bOptimiseIndexOrder = bOptimiseMeshes;
+    Settings.Format = MeshVertexFormat;
+    Settings.bGenerateLods = bGenerateLods;
+    return Settings;
+}
+
+void USDScene::BindSkinnedMeshes(const SceneChunk& Chunk) const
+{
+    if (Chunk.SkelRoots.empty()) { return; }
+
+    nvtx3::scoped_range r{ "Bind Skinned Meshes" };
+
+    // Meshes with joint influences were built deforming, the skel roots above them decide which skeleton poses them.
+    std::unordered_map<SdfPath, MeshDeformer*, SdfPath::Hash> Skinnable;
+    for (const std::shared_ptr<RenderMesh>& Mesh : Chunk.Meshes)
+    {
+        const std::shared_ptr<MeshData> Data = Mesh->GetMeshData();
+        if (Data->Deformer && Data->Deformer->HasJointInfluences()) { Skinnable.emplace(Mesh->GetPrim().GetPath(), Data->Deformer.get()); }
+    }
+    if (Skinnable.empty()) { return; }
+
+    UsdSkelCache SkelCache;
+    for (const UsdPrim& Prim : Chunk.SkelRoots)
+    {
+        const UsdSkelRoot SkelRoot(Prim);
+        SkelCache.Populate(SkelRoot, UsdPrimDefaultPredicate);
+
+        std::vector<UsdSkelBinding> Bindings;
+        SkelCache.ComputeSkelBindings(SkelRoot, &Bindings, UsdPrimDefaultPredicate);
+        for (const UsdSkelBinding& Binding : Bindings)
+        {
+            const UsdSkelSkeletonQuery SkelQuery = SkelCache.GetSkelQuery(Binding.GetSkeleton());
+            for (const UsdSkelSkinningQuery& SkinQuery : Binding.GetSkinningTargets())
+            {
+                const auto Found = Skinnable.find(SkinQuery.GetPrim().GetPath());
+                if (Found == Skinnable.end()) { continue; }
+
+                if (!Found->second->BindSkeleton(SkelQuery, SkinQuery))
+                {
+                    std::cout << "Skinned mesh could not be bound to: " << Binding.GetSkeleton().GetPath() << " at: " << Found->first << "\n";
+                }
+            }
+        }
+    }
+}
+
+void USDScene::ComputeWorldTransforms(SceneChunk& Chunk, UsdTimeCode Time) const
+{
+    nvtx3::scoped_range r{ "Compute World Transforms" };
+
+    // The cache keeps every ancestor's local to world matrix, so shared parents are only evaluated once.
+    UsdGeomXformCache XformCache(Time);
+
+    // Memoised per prim, so each ancestor's xformOps are only queried once across all instances.
+    std::unordered_map<SdfPath, bool, SdfPath::Hash> TimeVaryingCache;
+    const std::function<bool(const UsdPrim&)> MightBeTimeVarying = [&](const UsdPrim& Prim) -> bool
+    {
+        if (!Prim || Prim.IsPseudoRoot()) { return false; }
+
+        const auto Found = TimeVaryingCache.find(Prim.GetPath());
+        if (Found != TimeVaryingCache.end()) { return Found->second; }
+
+        bool bTimeVarying = XformCache.TransformMightBeTimeVarying(Prim);
+        if (!bTimeVarying && !XformCache.GetResetXformStack(Prim))
+        {
+            bTimeVarying = MightBeTimeVarying(Prim.GetParent());
+        }
+        TimeVaryingCache.emplace(Prim.GetPath(), bTimeVarying);
+        return bTimeVarying;
+    };
+
+    // Rows a point instancer no longer fills, e.g. after a mask change, stay zero and draw nothing.
+    Chunk.InstanceTransforms.assign(Chunk.NumInstanceRows, DirectX::XMFLOAT4X4());
+    Chunk.TransformTimeVarying.assign(Chunk.NumInstanceRows, 0);
+
+    for (const InstancePlacement& Placement : Chunk.Placements)
+    {
+        Chunk.InstanceTransforms[Placement.Row] = ToRenderSpace(Placement.Offset * XformCache.GetLocalToWorldTransform(Placement.XformPrim));
+        Chunk.TransformTimeVarying[Placement.Row] = MightBeTimeVarying(Placement.XformPrim) ? 1 : 0;
+    }
+
+    for (PointInstancerBlock& Block : Chunk.PointInstancers)
+    {
+        UpdatePointInstancer(Block, XformCache, Time, Chunk.InstanceTransforms);
+
+        Block.bTimeVarying = MightBeTimeVarying(Block.Prim) || PointInstanceArrays::MightBeTimeVarying(UsdGeomPointInstancer(Block.Prim));
+        if (!Block.bTimeVarying) { continue; }
+        
+        for (const PointInstancerMesh& Mesh : Block.Meshes)
+        {
+            std::fill_n(Chunk.TransformTimeVarying.begin() + Mesh.FirstInstance, Mesh.NumInstances, uint8_t(1));
+        }
+    }
+}
+
+void USDScene::AdvanceTimeline(double DeltaSeconds)
+{
+    if (Timeline.bPlaying && Timeline.HasRange())
+    {
+        double TimeCode = Timeline.CurrentTimeCode + DeltaSeconds * Timeline.TimeCodesPerSecond;
+        if (TimeCode > Timeline.EndTimeCode)
+        {
+            if (Timeline.bLooping)
+            {
+                TimeCode = Timeline.StartTimeCode + std::fmod(TimeCode - Timeline.StartTimeCode, Timeline.EndTimeCode - Timeline.StartTimeCode);
+            }
+            else
+            {
+                TimeCode = Timeline.EndTimeCode;
+                Timeline.bPlaying = false;
+            }
+        }
+        Timeline.CurrentTimeCode = TimeCode;
+    }
+}
+
+bool USDScene::UpdateAnimation(double DeltaSeconds)
+{
+    if (!Stage) { return false; }
+
+    AdvanceTimeline(DeltaSeconds);
+
+    // Static rows and meshes never change after loading, only evaluate when the time moved or rows and meshes were added since.
+    const bool bEvaluateTransforms = !TimeVaryingTransforms.empty() && (bTransformsDirty || Timeline.CurrentTimeCode != EvaluatedTimeCode);
+    const bool bSampleDeformers = !Deformers.empty() && (bDeformersDirty || Timeline.CurrentTimeCode != SampledTimeCode);
+    if (!bEvaluateTransforms && !bSampleDeformers) { return false; }
+
+    // The streaming worker holds the stage while composing a payload, keep showing the last transforms rather than stall the frame.
+    std::unique_lock<std::mutex> Lock(StageMutex, std::try_to_lock);
+    if (!Lock.owns_lock())
+    {
+        AnimationStats.NumDeferredFrames++;
+        return false;
+    }
+    
+    if (bSampleDeformers) { SampleDeformers(UsdTimeCode(Timeline.CurrentTimeCode)); }
+    if (!bEvaluateTransforms) { return false; }
+    
+    EvaluateTransforms(UsdTimeCode(Timeline.CurrentTimeCode));
+    return true;
+}
+
+void USDScene::SampleDeformers(UsdTimeCode Time)
+{
+    nvtx3::scoped_range r{ "Sample Deforming Meshes" };
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point StartTime = Clock::now();
+
+    // Only the time varying primvars are read, the vertices are gathered into the ring buffer by the mesh pipeline.
+    size_t NumDeformed = 0;
+    for (const std::shared_ptr<MeshDeformer>& Deformer : Deformers)
+    {
+        NumDeformed += Deformer->Sample(Time) ? 1 : 0;
+    }
+    SampledTimeCode = Time.GetValue();
+    bDeformersDirty = false;
+
+    AnimationStats.NumDeformedMeshes = NumDeformed;
+    AnimationStats.SampleMs = std::chrono::duration<double, std::milli>(Clock::now() - StartTime).count();
+}
+
+void USDScene::EvaluateTransforms(UsdTimeCode Time)
+{
+    nvtx3::scoped_range r{ "Evaluate Animated Transforms" };
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point StartTime = Clock::now();
+
+    const uint32_t Published = PublishedTransforms.load(std::memory_order_relaxed);
+    std::vector<DirectX::XMFLOAT4X4>& Front = TransformBuffers[Published];
+    std::vector<DirectX::XMFLOAT4X4>& Back = TransformBuffers[Published ^ 1];
+
+    // Loading or streaming changed the rows, bring the back buffer up to date and find the placements worth evaluating.
+    if (bTransformsDirty)
+    {
+        Back = Front;
+        TimeVaryingPlacements.clear();
+        for (size_t Idx = 0; Idx < Placements.size(); Idx++)
+        {
+            if (TransformTimeVarying[Placements[Idx].Row]) { TimeVaryingPlacements.push_back(static_cast<uint32_t>(Idx)); }
+        }
+        bTransformsDirty = false;
+    }
+    else
+    {
+        // Only the time varying rows differ between the buffers.
+        for (const uint32_t Row : TimeVaryingTransforms) { Back[Row] = Front[Row]; }
+    }
+
+    // One cache for every time varying prim, ancestors shared between them are evaluated once.
+    AnimationXformCache.SetTime(Time);
+    for (const uint32_t Idx : TimeVaryingPlacements)
+    {
+        const InstancePlacement& Placement = Placements[Idx];
+        Back[Placement.Row] = ToRenderSpace(Placement.Offset * AnimationXformCache.GetLocalToWorldTransform(Placement.XformPrim));
+    }
+
+    size_t NumPointInstancers = 0;
+    for (const PointInstancerBlock& Block : PointInstancers)
+    {
+        if (!Block.bTimeVarying) { continue; }
+        UpdatePointInstancer(Block, AnimationXformCache, Time, Back);
+        NumPointInstancers++;
+    }
+
+    PublishedTransforms.store(Published ^ 1, std::memory_order_release);
+    EvaluatedTimeCode = Time.GetValue();
+
+    AnimationStats.NumPlacements = TimeVaryingPlacements.size();
+    AnimationStats.NumPointInstancers = NumPointInstancers;
+    AnimationStats.NumRows = TimeVaryingTransforms.size();
+    AnimationStats.EvaluateMs = std::chrono::duration<double, std::milli>(Clock::now() - StartTime).count();
+}
+
+void USDScene::UpdatePointInstancer(const PointInstancerBlock& Block, UsdGeomXformCache& XformCache, UsdTimeCode Time,
+    std::vector<DirectX::XMFLOAT4X4>& Transforms) const
+{
+    nvtx3::scoped_range r{ "Update Point Instancer" };
+
+    PointInstanceArrays Arrays;
+    if (!Arrays.Read(UsdGeomPointInstancer(Block.Prim), Time)) { return; }
+
+    // Instance matrices already include the instancer's world transform, sorted by prototype.
+    const DirectX::XMFLOAT4X4 InstancerWorld = ToRenderSpace(XformCache.GetLocalToWorldTransform(Block.Prim));
+    SortedInstanceTransforms Sorted;
+    PointInstancing::BuildSortedTransforms(Arrays, Block.NumPrototypes, bIsYUp, InstancerWorld, Sorted);
+
+    // Each prototype mesh gets its own copy with its offset below the instance transform. Rows are laid out for the counts at load,
+    // rows past this time's instances collapse to nothing and instances past the rows are not drawn.
+    const DirectX::XMFLOAT4X4 Collapsed(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+    for (const PointInstancerMesh& Mesh : Block.Meshes)
+    {
+        const uint32_t SortedFirst = Sorted.PrototypeOffsets[Mesh.PrototypeIdx];
+        const uint32_t NumSorted = Sorted.PrototypeOffsets[Mesh.PrototypeIdx + 1] - SortedFirst;
+        const uint32_t NumRows = std::min(Mesh.NumInstances, NumSorted);
+        
+        const DirectX::XMFLOAT4X4 OffsetF = ToRenderSpace(Mesh.Offset);
+        const DirectX::XMMATRIX Offset = DirectX::XMLoadFloat4x4(&OffsetF);
+        
+        tbb::parallel_for(tbb::blocked_range<uint32_t>(0, NumRows, 4096),
+            [&](const tbb::blocked_range<uint32_t>& Range)
+            {
+                for (uint32_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+                {
+                    const DirectX::XMMATRIX Instance = DirectX::XMLoadFloat4x4(&Sorted.Transforms[SortedFirst + Idx]);
+                    DirectX::XMStoreFloat4x4(&Transforms[Mesh.FirstInstance + Idx], DirectX::XMMatrixMultiply(Offset, Instance));
+                }
+            });
+        std::fill(Transforms.begin() + Mesh.FirstInstance + NumRows, Transforms.begin() + Mesh.FirstInstance + Mesh.NumInstances, Collapsed);
+    }
+}
+
+void USDScene::GatherPayloadBounds(const std::vector<UsdPrim>& Payloads, std::vector<PayloadBounds>& OutBounds) const
+{
+    if (Payloads.empty()) { return; }
+
+    // An unloaded payload only has what the referencing layer authors, usually an extentsHint on the asset root.
+    UsdGeomBBoxCache BBoxCache(UsdTimeCode::Default(), { UsdGeomTokens->default_, UsdGeomTokens->render }, true);
+    UsdGeomXformCache XformCache(UsdTimeCode::Default());
+
+    OutBounds.reserve(OutBounds.size() + Payloads.size());
+    for (const UsdPrim& Prim : Payloads)
+    {
+        PayloadBounds Bounds;
+        Bounds.Path = Prim.GetPath();
+
+        GfVec3d Center;
+        const GfRange3d Range = BBoxCache.ComputeWorldBound(Prim).ComputeAlignedRange();
+        if (!Range.IsEmpty())
+        {
+            Center = Range.GetMidpoint();
+            Bounds.Radius = static_cast<float>(Range.GetSize().GetLength() * 0.5);
+        }
+        else
+        {
+            Center = XformCache.GetLocalToWorldTransform(Prim).ExtractTranslation();
+        }
+
+        // Same Y/Z swap as the vertices for Z up stages.
+        Bounds.Center = DirectX::XMFLOAT3(
+            static_cast<float>(Center[0]),
+            static_cast<float>(Center[bIsYUp ? 1 : 2]),
+            static_cast<float>(Center[bIsYUp ? 2 : 1]));
+        OutBounds.emplace_back(std::move(Bounds));
+    }
+}
+
+void USDScene::AppendChunk(SceneChunk& Chunk)
+{
+    nvtx3::scoped_range r{ "Append Scene Chunk" };
+
+    // Chunk rows start at zero, they go after the scene's current rows.
+    const uint32_t FirstRow = static_cast<uint32_t>(NumInstanceRows);
+    
+    for (InstancePlacement& Placement : Chunk.Placements)
+    {
+        Placement.Row += FirstRow;
+        Placements.emplace_back(std::move(Placement));
+    }
+    for (PointInstancerBlock& Block : Chunk.PointInstancers)
+    {
+        for (PointInstancerMesh& Mesh : Block.Meshes) { Mesh.FirstInstance += FirstRow; }
+        PointInstancers.emplace_back(std::move(Block));
+    }
+    for (MeshInstanceRange& Range : Chunk.InstanceRanges)
+    {
+        Range.FirstInstance += FirstRow;
+        InstanceRanges.push_back(Range);
+    }
+    
+    Meshes.insert(Meshes.end(), Chunk.Meshes.begin(), Chunk.Meshes.end());
+    MeshOwners.insert(MeshOwners.end(), Chunk.Meshes.size(), Chunk.Owner);
+    if (Chunk.Owner != 0 && !Chunk.PayloadPath.IsEmpty()) { PayloadOwners[Chunk.PayloadPath] = Chunk.Owner; }
+    
+    std::vector<DirectX::XMFLOAT4X4>& InstanceTransforms = GetPublishedTransforms();
+    InstanceTransforms.insert(InstanceTransforms.end(), Chunk.InstanceTransforms.begin(), Chunk.InstanceTransforms.end());
+    TransformTimeVarying.insert(TransformTimeVarying.end(), Chunk.TransformTimeVarying.begin(), Chunk.TransformTimeVarying.end());
+    for (size_t Row = 0; Row < Chunk.NumInstanceRows; Row++)
+    {
+        if (Chunk.TransformTimeVarying[Row]) { TimeVaryingTransforms.push_back(FirstRow + static_cast<uint32_t>(Row)); }
+    }
+    NumInstanceRows += Chunk.NumInstanceRows;
+    AnimationXformCache.Clear(); // The chunk's prims may be composed differently than when their queries were cached.
+    bTransformsDirty = true;
+    bDeformersDirty = true;
+
+    LoadStats.NumPrims += Chunk.NumPrims;
+    LoadStats.NumPrototypes += Chunk.NumPrototypes;
+    RefreshSceneStats();
+}
+
+void USDScene::RemoveOwners(const std::vector<uint32_t>& Owners, SceneStreamingUpdate& Update)
+{
+    nvtx3::scoped_range r{ "Remove Evicted Payloads" };
+
+    const auto IsRemoved = [&Owners](uint32_t Owner) { return std::find(Owners.begin(), Owners.end(), Owner) != Owners.end(); };
+
+    // Every row belongs to exactly one mesh's range, so dropping the rows of a payload's meshes drops the meshes.
+    std::vector<uint8_t> KeepRow(NumInstanceRows, 1);
+    for (size_t Idx = 0; Idx < Meshes.size(); Idx++)
+    {
+        if (!IsRemoved(MeshOwners[Idx])) { continue; }
+        
+        const MeshInstanceRange& Range = InstanceRanges[Idx];
+        std::fill_n(KeepRow.begin() + Range.FirstInstance, Range.NumInstances, uint8_t(0));
+    }
+    for (auto It = PayloadOwners.begin(); It != PayloadOwners.end();)
+    {
+        It = IsRemoved(It->second) ? PayloadOwners.erase(It) : std::next(It);
+    }
+
+    RemoveRows(KeepRow, Update);
+}
+
+void USDScene::RemoveRows(const std::vector<uint8_t>& KeepRow, SceneStreamingUpdate& Update)
+{
+    // Compact the rows in place and remember where each one went.
+    std::vector<DirectX::XMFLOAT4X4>& InstanceTransforms = GetPublishedTransforms();
+    std::vector<uint32_t> RowRemap(NumInstanceRows + 1);
+    uint32_t NumKept = 0;
+    TimeVaryingTransforms.clear();
+    for (size_t Row = 0; Row < NumInstanceRows; Row++)
+    {
+        RowRemap[Row] = NumKept;
+        if (!KeepRow[Row]) { continue; }
+        
+        InstanceTransforms[NumKept] = InstanceTransforms[Row];
+        TransformTimeVarying[NumKept] = TransformTimeVarying[Row];
+        if (TransformTimeVarying[NumKept]) { TimeVaryingTransforms.push_back(NumKept); }
+        NumKept++;
+    }
+    RowRemap[NumInstanceRows] = NumKept;
+    Update.bRowsMoved = Update.bRowsMoved || NumKept != NumInstanceRows;
+    InstanceTransforms.resize(NumKept);
+    TransformTimeVarying.resize(NumKept);
+    NumInstanceRows = NumKept;
+    AnimationXformCache.Clear(); // Removed prims may still have cached queries.
+    bTransformsDirty = true;
+
+    Placements.erase(std::remove_if(Placements.begin(), Placements.end(),
+        [&KeepRow](const InstancePlacement& Placement) { return !KeepRow[Placement.Row]; }), Placements.end());
+    for (InstancePlacement& Placement : Placements) { Placement.Row = RowRemap[Placement.Row]; }
+
+    // A point instancer's mesh keeps all of its rows or none, an instancer without meshes left has nothing to draw.
+    for (PointInstancerBlock& Block : PointInstancers)
+    {
+        Block.Meshes.erase(std::remove_if(Block.Meshes.begin(), Block.Meshes.end(),
+            [&KeepRow](const PointInstancerMesh& Mesh) { return !KeepRow[Mesh.FirstInstance]; }), Block.Meshes.end());
+        for (PointInstancerMesh& Mesh : Block.Meshes) { Mesh.FirstInstance = RowRemap[Mesh.FirstInstance]; }
+    }
+    PointInstancers.erase(std::remove_if(PointInstancers.begin(), PointInstancers.end(),
+        [](const PointInstancerBlock& Block) { return Block.Meshes.empty(); }), PointInstancers.end());
+
+    size_t NumMeshesKept = 0;
+    for (size_t Idx = 0; Idx < Meshes.size(); Idx++)
+    {
+        const MeshInstanceRange& Range = InstanceRanges[Idx];
+        const uint32_t FirstInstance = RowRemap[Range.FirstInstance];
+        const uint32_t NumInstances = RowRemap[Range.FirstInstance + Range.NumInstances] - FirstInstance;
+        if (NumInstances == 0)
+        {
+            Update.RemovedMeshes.push_back(Idx);
+            continue;
+        }
+
+        Meshes[NumMeshesKept] = std::move(Meshes[Idx]);
+        MeshOwners[NumMeshesKept] = MeshOwners[Idx];
+        InstanceRanges[NumMeshesKept] = MeshInstanceRange{ FirstInstance, NumInstances };
+        NumMeshesKept++;
+    }
+    Meshes.resize(NumMeshesKept);
+    MeshOwners.resize(NumMeshesKept);
+    InstanceRanges.resize(NumMeshesKept);
+
+    RefreshSceneStats();
+}
+
+void USDScene::RefreshSceneStats()
+{
+    LoadStats.NumMeshes = Meshes.size();
+    LoadStats.NumInstances = NumInstanceRows;
+    LoadStats.NumPointInstancers = PointInstancers.size();
+    LoadStats.NumSourceVertices = 0;
+    LoadStats.NumVertices = 0;
+    LoadStats.NumDegenerateTriangles = 0;
+    LoadStats.GeometryBytes = 0;
+    LoadStats.FlattenedGeometryBytes = 0;
+    LoadStats.NumCookedMeshes = 0;
+    LoadStats.NumMeshUtilMeshes = 0;
+    LoadStats.NumMeshlets = 0;
+    LoadStats.MeshletBytes = 0;
+    LoadStats.NumSkinnedMeshes = 0;
+    Deformers.clear();
+    
+    for (size_t Idx = 0; Idx < Meshes.size(); Idx++)
+    {
+        const std::shared_ptr<MeshData> Data = Meshes[Idx]->GetMeshData();
+        if (Data->Deformer)
+        {
+            Deformers.push_back(Data->Deformer);
+            LoadStats.NumSkinnedMeshes += Data->Deformer->IsSkinned() ? 1 : 0;
+        }
+        const size_t MeshBytes = Data->GetVertexBufferSize() + Data->GetIndexBufferSize();
+        LoadStats.NumSourceVertices += Data->NumSourceVertices;
+        LoadStats.NumVertices += Data->GetNumVertices();
+        LoadStats.NumDegenerateTriangles += Data->NumDegenerateTriangles;
+        LoadStats.NumCookedMeshes += Data->IsCooked() ? 1 : 0;
+        LoadStats.NumMeshUtilMeshes += Data->bTriangulatedWithMeshUtil ? 1 : 0;
+        LoadStats.NumMeshlets += Data->Clusters.Meshlets.size();
+        LoadStats.MeshletBytes += Data->Clusters.GetSizeBytes();
+        LoadStats.GeometryBytes += MeshBytes;
+        LoadStats.FlattenedGeometryBytes += MeshBytes * InstanceRanges[Idx].NumInstances;
+    }
+    LoadStats.NumDeformingMeshes = Deformers.size();
+    LoadStats.InstanceBytes = NumInstanceRows * sizeof(DirectX::XMFLOAT4X4);
+}
+
+SceneStreamingUpdate USDScene::UpdateStreaming()
+{
+    SceneStreamingUpdate Update;
+    Update.FirstNewMesh = Meshes.size();
+    if (!Streamer) { return Update; }
+
+    nvtx3::scoped_range r{ "Update Streaming" };
+
+    // Payloads are ranked by their projected size from the current camera.
+    DirectX::XMFLOAT3 Position;
+    DirectX::XMFLOAT3 Forward;
+    DirectX::XMStoreFloat3(&Position, MainCamera->GetPosition());
+    DirectX::XMStoreFloat3(&Forward, MainCamera->GetViewDirection());
+    Streamer->SetView(Position, Forward, std::tan(DirectX::XMConvertToRadians(MainCamera->GetFieldOfView()) * 0.5f));
+
+    // Evictions are taken first, any chunk of an evicted payload is already queued by then and gets dropped.
+    const std::vector<uint32_t> Evicted = Streamer->TakeEvictions();
+    std::vector<SceneChunk> Chunks;
+    {
+        std::lock_guard<std::mutex> Lock(StreamedChunksMutex);
+        Chunks.swap(StreamedChunks);
+    }
+
+    if (!Evicted.empty())
+    {
+        RemoveOwners(Evicted, Update);
+        Chunks.erase(std::remove_if(Chunks.begin(), Chunks.end(), [&Evicted](const SceneChunk& Chunk)
+            {
+                return std::find(Evicted.begin(), Evicted.end(), Chunk.Owner) != Evicted.end();
+            }), Chunks.end());
+
+        // Nothing on the main thread references the evicted prims anymore, the worker can unload them.
+        Streamer->ConfirmEvictions(Evicted);
+    }
+
+    Update.FirstNewMesh = Meshes.size();
+    for (SceneChunk& Chunk : Chunks)
+    {
+        AppendChunk(Chunk);
+    }
+
+    Update.bChanged = !Update.RemovedMeshes.empty() || Meshes.size() != Update.FirstNewMesh;
+    return Update;
+}
+
+void USDScene::LayoutHydraMeshes(SceneStreamingUpdate& Update)
+{
+    nvtx3::scoped_range r{ "Layout Hydra Meshes" };
+
+    // Every rprim with a mesh and at least one instance is a scene mesh, laid out from scratch.
+    RemoveRows(std::vector<uint8_t>(NumInstanceRows, 0), Update);
+    Update.FirstNewMesh = 0;
+    HydraMeshIndices.clear();
+
+    SceneChunk Chunk;
+    for (const HydraMesh* Mesh : Hydra->GetMeshes())
+    {
+        const std::vector<GfMatrix4d>& WorldTransforms = Mesh->GetWorldTransforms();
+        if (!Mesh->GetRenderMesh() || WorldTransforms.empty()) { continue; }
+
+        HydraMeshIndices[Mesh] = Chunk.Meshes.size();
+        Chunk.InstanceRanges.push_back(MeshInstanceRange{ static_cast<uint32_t>(Chunk.NumInstanceRows), static_cast<uint32_t>(WorldTransforms.size()) });
+        Chunk.Meshes.push_back(Mesh->GetRenderMesh());
+        for (const GfMatrix4d& World : WorldTransforms) { Chunk.InstanceTransforms.push_back(ToRenderSpace(World)); }
+        Chunk.NumInstanceRows += WorldTransforms.size();
+    }
+
+    // Hydra marks the rprims that moved, no row has to be evaluated every frame.
+    Chunk.TransformTimeVarying.assign(Chunk.NumInstanceRows, 0);
+    Chunk.NumPrims = Hydra->GetNumRprims();
+    LoadStats.NumPrims = 0;
+    AppendChunk(Chunk);
+}
+
+SceneStreamingUpdate USDScene::UpdateHydra(double DeltaSeconds)
+{
+    SceneStreamingUpdate Update;
+    Update.FirstNewMesh = Meshes.size();
+    if (!Hydra) { return Update; }
+
+    nvtx3::scoped_range r{ "Update Hydra" };
+
+    AdvanceTimeline(DeltaSeconds);
+
+    // Edits are made holding the stage mutex with either front-end.
+    HydraSyncResult Result;
+    {
+        std::lock_guard<std::mutex> Lock(StageMutex);
+        Result = Hydra->Sync(UsdTimeCode(Timeline.CurrentTimeCode));
+    }
+    AnimationStats.EvaluateMs = Result.SyncMs;
+    if (Result.Changed.empty() && !Result.bMeshesChanged) { return Update; }
+
+    const bool bRelayout = Result.bMeshesChanged || std::any_of(Result.Changed.begin(), Result.Changed.end(),
+        [](const HydraMeshChange& Change) { return (Change.Changes & HydraMesh::ChangedInstances) != 0; });
+    if (bRelayout)
+    {
+        LayoutHydraMeshes(Update);
+    }
+    else
+    {
+        // Rows and meshes stay where they are, only the changed ones are written and uploaded again.
+        std::vector<DirectX::XMFLOAT4X4>& InstanceTransforms = GetPublishedTransforms();
+        for (const HydraMeshChange& Change : Result.Changed)
+        {
+            // Rprims without anything to draw have no scene mesh, any change giving them one lays them out again.
+            const auto Found = HydraMeshIndices.find(Change.Mesh);
+            if (Found == HydraMeshIndices.end()) { continue; }
+
+            const size_t MeshIdx = Found->second;
+            if (Change.Changes & HydraMesh::ChangedGeometry)
+            {
+                Meshes[MeshIdx] = Change.Mesh->GetRenderMesh();
+                Update.RebuiltMeshes.push_back(SceneMeshRebuild{ MeshIdx, (Change.Changes & HydraMesh::ChangedIndices) == 0 });
+            }
+            if (Change.Changes & HydraMesh::ChangedTransforms)
+            {
+                const MeshInstanceRange& Range = InstanceRanges[MeshIdx];
+                const std::vector<GfMatrix4d>& WorldTransforms = Change.Mesh->GetWorldTransforms();
+                for (uint32_t Idx = 0; Idx < Range.NumInstances; Idx++)
+                {
+                    InstanceTransforms[Range.FirstInstance + Idx] = ToRenderSpace(WorldTransforms[Idx]);
+                    Update.ChangedRows.push_back(Range.FirstInstance + Idx);
+                }
+            }
+        }
+        std::sort(Update.RebuiltMeshes.begin(), Update.RebuiltMeshes.end(),
+            [](const SceneMeshRebuild& A, const SceneMeshRebuild& B) { return A.Mesh < B.Mesh; });
+        if (!Update.RebuiltMeshes.empty()) { RefreshSceneStats(); }
+        bTransformsDirty = bTransformsDirty || !Update.ChangedRows.empty();
+    }
+
+    AnimationStats.NumRows = Update.ChangedRows.size();
+    AnimationStats.NumDeformedMeshes = Update.RebuiltMeshes.size();
+    Update.bChanged = bRelayout || !Update.RebuiltMeshes.empty() || !Update.ChangedRows.empty();
+    return Update;
+}
+
+void USDScene::OnObjectsChanged(const UsdNotice::ObjectsChanged& Notice, const UsdStageWeakPtr& Sender)
+{
+    // The streaming worker's own loads and unloads already arrive as chunks and evictions.
+    if (bLoadingPayloads) { return; }
+
+    std::vector<StageEdit> Edits;
+    StageEdits::Classify(Notice, Edits);
+    if (Edits.empty()) { return; }
+
+    std::lock_guard<std::mutex> Lock(PendingEditsMutex);
+    PendingEdits.insert(PendingEdits.end(), Edits.begin(), Edits.end());
+}
+
+void USDScene::ReloadStage()
+{
+    if (!Stage) { return; }
+
+    nvtx3::scoped_range r{ "Reload Stage" };
+    std::lock_guard<std::mutex> Lock(StageMutex);
+    Stage->Reload();
+}
+
+SceneStreamingUpdate USDScene::UpdateStageEdits()
+{
+    SceneStreamingUpdate Update;
+    Update.FirstNewMesh = Meshes.size();
+
+    std::vector<StageEdit> Edits;
+    {
+        std::lock_guard<std::mutex> Lock(PendingEditsMutex);
+        Edits.swap(PendingEdits);
+    }
+    if (Edits.empty() || !Stage) { return Update; }
+
+    nvtx3::scoped_range r{ "Update Stage Edits" };
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point StartTime = Clock::now();
+
+    // Unlike animation this waits for the streaming worker, edits are rare and dropping them would lose them.
+    std::lock_guard<std::mutex> Lock(StageMutex);
+    StageEdits::Coalesce(Edits);
+    if (StageEdits::InvalidatesXformQueries(Edits)) { AnimationXformCache.Clear(); }
+
+    SdfPathVector Resynced;
+    std::vector<SdfPath> TransformPaths;
+    std::vector<StageEdit> MeshEdits;
+    for (const StageEdit& Edit : Edits)
+    {
+        if (Edit.Kind == StageEditKind::Resync) { Resynced.push_back(Edit.Path); }
+        else if (Edit.Kind == StageEditKind::Transform) { TransformPaths.push_back(Edit.Path); }
+        else { MeshEdits.push_back(Edit); }
+    }
+
+    // Cheapest first, both may turn an edit into a resync when it changes more than it can apply in place.
+    ApplyTransformEdits(TransformPaths, Resynced, Update);
+    RebuildMeshes(MeshEdits, Resynced, Update);
+    if (!Resynced.empty())
+    {
+        ResyncSubtrees(Resynced, Update);
+
+        // Rebuilt meshes that were resynced as well are gone, the others move down past the removed ones.
+        std::vector<SceneMeshRebuild> Rebuilt;
+        for (const SceneMeshRebuild& Rebuild : Update.RebuiltMeshes)
+        {
+            const auto Removed = std::lower_bound(Update.RemovedMeshes.begin(), Update.RemovedMeshes.end(), Rebuild.Mesh);
+            if (Removed != Update.RemovedMeshes.end() && *Removed == Rebuild.Mesh) { continue; }
+            const size_t NumRemovedBefore = static_cast<size_t>(Removed - Update.RemovedMeshes.begin());
+            Rebuilt.push_back(SceneMeshRebuild{ Rebuild.Mesh - NumRemovedBefore, Rebuild.bSameIndices });
+        }
+        Update.RebuiltMeshes.swap(Rebuilt);
+    }
+
+    // Moved rows are uploaded again as a whole.
+    const bool bNewRows = Update.bRowsMoved || !Update.RemovedMeshes.empty() || Meshes.size() != Update.FirstNewMesh;
+    if (bNewRows) { Update.ChangedRows.clear(); }
+    Update.bChanged = bNewRows || !Update.RebuiltMeshes.empty() || !Update.ChangedRows.empty();
+
+    // Shown in the overlay rather than logged, interactive edits arrive every frame.
+    EditStats.NumBatches++;
+    EditStats.NumEdits = Edits.size();
+    EditStats.NumRows = Update.ChangedRows.size();
+    EditStats.NumRebuiltMeshes = Update.RebuiltMeshes.size();
+    EditStats.NumRemovedMeshes = Update.RemovedMeshes.size();
+    EditStats.NumAddedMeshes = Meshes.size() - Update.FirstNewMesh;
+    EditStats.ApplyMs = std::chrono::duration<double, std::milli>(Clock::now() - StartTime).count();
+    return Update;
+}
+
+void USDScene::ApplyTransformEdits(const std::vector<SdfPath>& Paths, SdfPathVector& OutResynced, SceneStreamingUpdate& Update)
+{
+    if (Paths.empty()) { return; }
+
+    nvtx3::scoped_range r{ "Apply Transform Edits" };
+
+    // Prototypes of instances and point instancers are flattened into offsets below their instance, those are collected again.
+    std::vector<SdfPath> Edited;
+    for (const SdfPath& Path : Paths)
+    {
+        bool bFlattened = UsdPrim::IsPathInPrototype(Path);
+        for (UsdPrim Prim = Stage->GetPrimAtPath(Path.GetParentPath()); Prim && !Prim.IsPseudoRoot() && !bFlattened; Prim = Prim.GetParent())
+        {
+            bFlattened = Prim.IsA<UsdGeomPointInstancer>();
+        }
+
+        if (bFlattened) { OutResynced.push_back(Path); }
+        else { Edited.push_back(Path); }
+    }
+    const auto IsEdited = [&Edited](const SdfPath& Path)
+    {
+        return std::any_of(Edited.begin(), Edited.end(), [&Path](const SdfPath& EditedPath) { return Path.HasPrefix(EditedPath); });
+    };
+
+    // Rows of the edited prims and everything below them, written into the published buffer like newly loaded rows.
+    const UsdTimeCode Time(Timeline.CurrentTimeCode);
+    UsdGeomXformCache XformCache(Time);
+    std::vector<DirectX::XMFLOAT4X4>& Transforms = GetPublishedTransforms();
+    for (const InstancePlacement& Placement : Placements)
+    {
+        // Prims a resync expired are dropped with their rows.
+        if (!Placement.XformPrim.IsValid() || !IsEdited(Placement.XformPrim.GetPath())) { continue; }
+
+        Transforms[Placement.Row] = ToRenderSpace(Placement.Offset * XformCache.GetLocalToWorldTransform(Placement.XformPrim));
+        TransformTimeVarying[Placement.Row] = IsWorldTransformTimeVarying(XformCache, Placement.XformPrim) ? 1 : 0;
+        Update.ChangedRows.push_back(Placement.Row);
+    }
+
+    for (PointInstancerBlock& Block : PointInstancers)
+    {
+        if (!Block.Prim.IsValid() || !IsEdited(Block.Prim.GetPath())) { continue; }
+
+        // Moved instances keep their rows, a different number of instances per prototype needs the rows laid out again.
+        const UsdGeomPointInstancer Instancer(Block.Prim);
+        PointInstanceArrays Arrays;
+        std::vector<uint32_t> Counts;
+        if (Arrays.Read(Instancer, Time)) { PointInstancing::CountInstances(Arrays, Block.NumPrototypes, Counts); }
+        if (Counts != Block.Counts)
+        {
+            OutResynced.push_back(Block.Prim.GetPath());
+            continue;
+        }
+
+        UpdatePointInstancer(Block, XformCache, Time, Transforms);
+        Block.bTimeVarying = IsWorldTransformTimeVarying(XformCache, Block.Prim) || PointInstanceArrays::MightBeTimeVarying(Instancer);
+        for (const PointInstancerMesh& Mesh : Block.Meshes)
+        {
+            std::fill_n(TransformTimeVarying.begin() + Mesh.FirstInstance, Mesh.NumInstances, uint8_t(Block.bTimeVarying ? 1 : 0));
+            for (uint32_t Row = Mesh.FirstInstance; Row < Mesh.FirstInstance + Mesh.NumInstances; Row++) { Update.ChangedRows.push_back(Row); }
+        }
+    }
+
+    // An edit may have added or removed time samples, and the unpublished buffer no longer matches.
+    TimeVaryingTransforms.clear();
+    for (uint32_t Row = 0; Row < static_cast<uint32_t>(NumInstanceRows); Row++)
+    {
+        if (TransformTimeVarying[Row]) { TimeVaryingTransforms.push_back(Row); }
+    }
+    bTransformsDirty = true;
+}
+
+void USDScene::RebuildMeshes(const std::vector<StageEdit>& Edits, SdfPathVector& OutResynced, SceneStreamingUpdate& Update)
+{
+    if (Edits.empty()) { return; }
+
+    nvtx3::scoped_range r{ "Rebuild Edited Meshes" };
+
+    // A mesh inside a USD prototype is one scene mesh shared by all of its instances, rebuilding it updates every instance.
+    std::unordered_map<SdfPath, std::vector<size_t>, SdfPath::Hash> MeshIndices;
+    for (size_t Idx = 0; Idx < Meshes.size(); Idx++)
+    {
+        if (Meshes[Idx]->GetPrim().IsValid()) { MeshIndices[Meshes[Idx]->GetPrim().GetPath()].push_back(Idx); }
+    }
+
+    struct MeshRebuild
+    {
+        size_t Mesh = 0;
+        StageEditKind Kind = StageEditKind::Primvar;
+        std::shared_ptr<RenderMesh> Rebuilt;
+    };
+    std::vector<MeshRebuild> Rebuilds;
+    for (const StageEdit& Edit : Edits)
+    {
+        const auto Found = MeshIndices.find(Edit.Path);
+        if (Found != MeshIndices.end())
+        {
+            for (const size_t Idx : Found->second) { Rebuilds.push_back(MeshRebuild{ Idx, Edit.Kind, nullptr }); }
+        }
+        else if (const UsdPrim Prim = Stage->GetPrimAtPath(Edit.Path); Prim && Prim.IsA<UsdGeomMesh>())
+        {
+            // Not drawn so far, e.g. it failed validation, it may be valid now.
+            OutResynced.push_back(Edit.Path);
+        }
+    }
+
+    const MeshBuildSettings Settings = GetMeshBuildSettings();
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, Rebuilds.size(), 1),
+        [&](const tbb::blocked_range<size_t>& Range)
+        {
+            for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+            {
+                UsdPrim Prim = Meshes[Rebuilds[Idx].Mesh]->GetPrim();
+                Rebuilds[Idx].Rebuilt = std::make_shared<RenderMesh>(Settings, CookedMeshes);
+                Rebuilds[Idx].Rebuilt->Load(Prim);
+            }
+        });
+
+    // Skinned meshes are bound again through the skel root above them.
+    SceneChunk Skinned;
+    for (MeshRebuild& Rebuild : Rebuilds)
+    {
+        const std::shared_ptr<MeshData> Data = Rebuild.Rebuilt->GetMeshData();
+        const UsdPrim Prim = Meshes[Rebuild.Mesh]->GetPrim();
+        if (Data == nullptr)
+        {
+            // No longer valid, the resync drops it with its rows.
+            OutResynced.push_back(Prim.GetPath());
+            continue;
+        }
+
+        // Vertex edits usually leave the triangles alone, the old index buffer is then kept.
+        const std::shared_ptr<MeshData> Previous = Meshes[Rebuild.Mesh]->GetMeshData();
+        const bool bSameIndices = Rebuild.Kind == StageEditKind::Primvar && Previous->HasSameIndices(*Data);
+
+        if (Data->Deformer && Data->Deformer->HasJointInfluences())
+        {
+            const UsdSkelRoot SkelRoot = UsdSkelRoot::Find(Prim);
+            if (SkelRoot && std::find(Skinned.SkelRoots.begin(), Skinned.SkelRoots.end(), SkelRoot.GetPrim()) == Skinned.SkelRoots.end())
+            {
+                Skinned.SkelRoots.push_back(SkelRoot.GetPrim());
+            }
+            Skinned.Meshes.push_back(Rebuild.Rebuilt);
+        }
+
+        Meshes[Rebuild.Mesh] = Rebuild.Rebuilt;
+        Update.RebuiltMeshes.push_back(SceneMeshRebuild{ Rebuild.Mesh, bSameIndices });
+    }
+    BindSkinnedMeshes(Skinned);
+
+    std::sort(Update.RebuiltMeshes.begin(), Update.RebuiltMeshes.end(),
+        [](const SceneMeshRebuild& A, const SceneMeshRebuild& B) { return A.Mesh < B.Mesh; });
+    RefreshSceneStats();
+    bDeformersDirty = true;
+}
+
+void USDScene::ResyncSubtrees(const SdfPathVector& Paths, SceneStreamingUpdate& Update)
+{
+    nvtx3::scoped_range r{ "Resync Stage Subtrees" };
+
+    // Prototypes are only drawn through the instances placing them, edits inside one collect those instances again.
+    SdfPathVector Roots;
+    std::vector<SdfPath> Prototypes;
+    std::set<SdfPath> VisitedPrototypes;
+    for (const SdfPath& Path : Paths)
+    {
+        if (UsdPrim::IsPathInPrototype(Path)) { Prototypes.push_back(GetPrototypeRootPath(Path)); }
+        else { Roots.push_back(Path); }
+    }
+    while (!Prototypes.empty())
+    {
+        const SdfPath PrototypePath = Prototypes.back();
+        Prototypes.pop_back();
+        if (!VisitedPrototypes.insert(PrototypePath).second) { continue; }
+
+        const UsdPrim Prototype = Stage->GetPrimAtPath(PrototypePath);
+        if (!Prototype) { continue; } // Gone, USD resyncs its instances too.
+        for (const UsdPrim& Instance : Prototype.GetInstances())
+        {
+            if (UsdPrim::IsPathInPrototype(Instance.GetPath())) { Prototypes.push_back(GetPrototypeRootPath(Instance.GetPath())); }
+            else { Roots.push_back(Instance.GetPath()); }
+        }
+    }
+
+    // Point instancer prototypes are only drawn through the instancer, the outermost one is collected again.
+    for (SdfPath& Root : Roots)
+    {
+        for (UsdPrim Prim = Stage->GetPrimAtPath(Root.GetParentPath()); Prim && !Prim.IsPseudoRoot(); Prim = Prim.GetParent())
+        {
+            if (Prim.IsA<UsdGeomPointInstancer>()) { Root = Prim.GetPath(); }
+        }
+    }
+    SdfPath::RemoveDescendentPaths(&Roots);
+
+    // Rows placed by a prim below a root go, unless a streamed payload below the root owns them.
+    std::vector<uint32_t> RootOwners(Roots.size());
+    for (size_t Idx = 0; Idx < Roots.size(); Idx++) { RootOwners[Idx] = FindPayloadOwner(Roots[Idx]); }
+    const auto IsResynced = [&](const SdfPath& Path, uint32_t Owner)
+    {
+        for (size_t Idx = 0; Idx < Roots.size(); Idx++)
+        {
+            if (Owner == RootOwners[Idx] && Path.HasPrefix(Roots[Idx])) { return true; }
+        }
+        return false;
+    };
+
+    std::vector<uint32_t> RowOwners(NumInstanceRows, 0);
+    for (size_t Idx = 0; Idx < Meshes.size(); Idx++)
+    {
+        std::fill_n(RowOwners.begin() + InstanceRanges[Idx].FirstInstance, InstanceRanges[Idx].NumInstances, MeshOwners[Idx]);
+    }
+
+    std::vector<uint8_t> KeepRow(NumInstanceRows, 1);
+    for (const InstancePlacement& Placement : Placements)
+    {
+        if (IsResynced(Placement.XformPrim.GetPath(), RowOwners[Placement.Row])) { KeepRow[Placement.Row] = 0; }
+    }
+    for (const PointInstancerBlock& Block : PointInstancers)
+    {
+        if (!IsResynced(Block.Prim.GetPath(), Block.Owner)) { continue; }
+        for (const PointInstancerMesh& Mesh : Block.Meshes) { std::fill_n(KeepRow.begin() + Mesh.FirstInstance, Mesh.NumInstances, uint8_t(0)); }
+    }
+    RemoveRows(KeepRow, Update);
+    Update.FirstNewMesh = Meshes.size();
+
+    // Each root is collected like a payload. Instances get their own copy of a prototype's meshes, as with streamed payloads.
+    for (size_t Idx = 0; Idx < Roots.size(); Idx++)
+    {
+        const UsdPrim Root = Stage->GetPrimAtPath(Roots[Idx]);
+        if (!Root) { continue; } // Removed, its rows are gone already.
+
+        SceneChunk Chunk;
+        Chunk.Owner = RootOwners[Idx];
+        CollectRenderablePrims(Root, UsdTimeCode(Timeline.CurrentTimeCode), Chunk, nullptr, Streamer != nullptr);
+        BuildRenderMeshes(Chunk);
+
+        // A skel root above the resynced prim is not part of the traversal.
+        const UsdSkelRoot SkelRoot = UsdSkelRoot::Find(Root);
+        if (SkelRoot && SkelRoot.GetPrim() != Root) { Chunk.SkelRoots.push_back(SkelRoot.GetPrim()); }
+        BindSkinnedMeshes(Chunk);
+        ComputeWorldTransforms(Chunk, UsdTimeCode(Timeline.CurrentTimeCode));
+
+        // Counted when the scene was loaded.
+        Chunk.NumPrims = 0;
+        Chunk.NumPrototypes = 0;
+        AppendChunk(Chunk);
+    }
+}
+
+uint32_t USDScene::FindPayloadOwner(const SdfPath& Path) const
+{
+    for (SdfPath Ancestor = Path; !Ancestor.IsEmpty(); Ancestor = Ancestor.GetParentPath())
+    {
+        const auto Found = PayloadOwners.find(Ancestor);
+        if (Found != PayloadOwners.end()) { return Found->second; }
+    }
+    return 0;
+}
+
+size_t USDScene::LoadPayload(uint32_t Id, const SdfPath& Path, std::vector<PayloadBounds>& OutNested)
+{
+    SceneChunk Chunk;
+    Chunk.Owner = Id;
+    Chunk.PayloadPath = Path;
+    {
+        // Loading recomposes the payload's subtree, nothing else may read the stage meanwhile.
+        std::lock_guard<std::mutex> Lock(StageMutex);
+        bLoadingPayloads = true;
+        Stage->Load(Path, UsdLoadWithoutDescendants);
+        bLoadingPayloads = false;
+        
+        const UsdPrim Root = Stage->GetPrimAtPath(Path);
+        if (!Root) { return 0; }
+
+        std::vector<UsdPrim> Nested;
+        CollectRenderablePrims(Root, UsdTimeCode(Timeline.StartTimeCode), Chunk, &Nested);
+        BuildRenderMeshes(Chunk);
+        BindSkinnedMeshes(Chunk);
+        // The timeline may have moved on, UpdateAnimation evaluates the appended rows again at the current time.
+        ComputeWorldTransforms(Chunk, UsdTimeCode(Timeline.StartTimeCode));
+        GatherPayloadBounds(Nested, OutNested);
+    }
+
+    const size_t Bytes = Chunk.ResidentBytes;
+    std::lock_guard<std::mutex> Lock(StreamedChunksMutex);
+    StreamedChunks.emplace_back(std::move(Chunk));
+    return Bytes;
+}
+
+void USDScene::UnloadPayloads(const std::vector<SdfPath>& Paths)
+{
+    std::lock_guard<std::mutex> Lock(StageMutex);
+    bLoadingPayloads = true;
+    Stage->LoadAndUnload(SdfPathSet(), SdfPathSet(Paths.begin(), Paths.end()));
+    bLoadingPayloads = false;
+}
+
+DirectX::XMFLOAT4X4 USDScene::ToRenderSpace(const GfMatrix4d& Matrix) const
+{
+    // Vertices have Y and Z swapped for Z up stages, apply the same basis change to the matrix: S * M * S.
+    const int Axis[4] = { 0, bIsYUp ? 1 : 2, bIsYUp ? 2 : 1, 3 };
+    
+    DirectX::XMFLOAT4X4 Out;
+    for (int Row = 0; Row < 4; Row++)
+    {
+        for (int Col = 0; Col < 4; Col++)
+        {
+            Out.m[Row][Col] = static_cast<float>(Matrix[Axis[Row]][Axis[Col]]);
+        }
+    }
+    return Out;
+}
+
+void USDScene::PrintLoadStats() const
+{
+    constexpr double MB = 1.0 / (1024.0 * 1024.0);
+    std::cout << "USDScene::LoadScene: " << LoadStats.NumMeshes << " meshes from " << LoadStats.NumPrims << (Hydra ? " rprims through Hydra" : " prims")
+        << " on " << LoadStats.NumThreads << " threads\n";
+    std::cout << "    Instancing: " << LoadStats.NumInstances << " instances of " << LoadStats.NumMeshes << " meshes, " << LoadStats.NumPrototypes << " prototypes, "
+        << LoadStats.NumPointInstancers << " point instancers\n";
+    std::cout << "    Vertices:   " << LoadStats.NumSourceVertices << " -> " << LoadStats.NumVertices << " after welding, "
+        << LoadStats.NumDegenerateTriangles << " degenerate triangles dropped\n";
+    std::cout << "    Cooked:     " << LoadStats.NumCookedMeshes << " of " << LoadStats.NumMeshes << " meshes from the mesh cache, "
+        << LoadStats.NumMeshUtilMeshes << " triangulated through HdMeshUtil\n";
+    std::cout << "    Deforming:  " << LoadStats.NumDeformingMeshes << " meshes, " << LoadStats.NumSkinnedMeshes << " skinned\n";
+    std::cout << "    Meshlets:   " << LoadStats.NumMeshlets << " (" << LoadStats.MeshletBytes * MB << " MB)\n";
+    std::cout << "    Memory:     " << LoadStats.GeometryBytes * MB << " MB geometry + " << LoadStats.InstanceBytes * MB << " MB transforms ("
+        << LoadStats.FlattenedGeometryBytes * MB << " MB without instancing)\n";
+    std::cout << "    Open:       " << LoadStats.OpenMs << " ms\n";
+    std::cout << "    Traverse:   " << LoadStats.TraverseMs << " ms\n";
+    std::cout << "    Mesh Build: " << LoadStats.MeshBuildMs << " ms\n";
+    std::cout << "    Transforms: " << LoadStats.TransformMs << " ms, " << TimeVaryingTransforms.size() << " time varying\n";
+    std::cout << "    Total:      " << LoadStats.TotalMs << " ms" << std::endl;
+}
+
 void USDScene::ClearScene()
 {
+    // Joins the streaming worker and releases Hydra's prims before the stage goes away.
+    Streamer.reset();
+    Hydra.reset();
+    HydraMeshIndices.clear();
+    {
+        std::lock_guard<std::mutex> Lock(StreamedChunksMutex);
+        StreamedChunks.clear();
+    }
+    PayloadOwners.clear();
+
+    // Stop listening before the stage goes away, edits not applied yet are for the old scene.
+    TfNotice::Revoke(ObjectsChangedKey);
+    {
+        std::lock_guard<std::mutex> Lock(PendingEditsMutex);
+        PendingEdits.clear();
+    }
+    
     Stage.Reset();
+    CookedMeshes.reset();
     Meshes.clear();
+    MeshOwners.clear();
+    InstanceRanges.clear();
+    Placements.clear();
+    PointInstancers.clear();
+    NumInstanceRows = 0;
+    TransformBuffers[0].clear();
+    TransformBuffers[1].clear();
+    TransformTimeVarying.clear();
+    TimeVaryingTransforms.clear();
+    TimeVaryingPlacements.clear();
+    AnimationXformCache.Clear();
+    bTransformsDirty = true;
+    Deformers.clear();
+    bDeformersDirty = true;
 }
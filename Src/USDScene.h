@@ -1,9 +1,26 @@
 #pragma once
 
+#include <atomic>
 #include <string>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+// DX
+#include <DirectXMath.h>
 
 //Usd
 #include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usd/notice.h"
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/tf/notice.h"
+#include "pxr/base/tf/weakBase.h"
+#include "pxr/usd/usdGeom/xformCache.h"
+
+#include "PayloadStreamer.h"
+#include "StageEdits.h"
+#include "pch.h"
 
 namespace RendererAssets
 {
@@ -16,18 +33,179 @@ namespace RendererAssets
     
 }
 
-class USDScene
+// Per-stage wall clock timings of the last LoadScene, in milliseconds.
+struct SceneLoadStats
+{
+    double OpenMs = 0.0;        // UsdStage::Open and stage metadata.
+    double TraverseMs = 0.0;    // Serial traversal collecting renderable prims.
+    double MeshBuildMs = 0.0;   // Parallel RenderMesh construction.
+    double TransformMs = 0.0;   // World transform pass.
+    double TotalMs = 0.0;
+
+    size_t NumPrims = 0;
+    size_t NumMeshes = 0;         // Unique geometry, each prototype mesh counts once.
+    size_t NumPrototypes = 0;     // USD instancing prototypes.
+    size_t NumInstances = 0;      // Drawn mesh instances.
+    size_t NumPointInstancers = 0;
+    size_t NumSourceVertices = 0; // Unrolled triangle corners before welding.
+    size_t NumVertices = 0;       // Unique vertices after welding.
+    size_t NumDegenerateTriangles = 0; // Triangles dropped by welding.
+    size_t NumCookedMeshes = 0;   // Meshes mapped from the cooked mesh cache instead of triangulated.
+    size_t NumMeshUtilMeshes = 0; // Meshes triangulated through HdMeshUtil instead of the triangulator.
+    size_t NumMeshlets = 0;       // Culling clusters over all unique meshes.
+    size_t NumDeformingMeshes = 0; // Meshes with time sampled points or normals, or skinned.
+    size_t NumSkinnedMeshes = 0;   // Deforming meshes posed by a UsdSkel skeleton.
+    int NumThreads = 0;
+
+    // Memory
+    size_t GeometryBytes = 0;          // Vertex and index buffers as uploaded.
+    size_t FlattenedGeometryBytes = 0; // The same scene with every instance holding its own copy.
+    size_t InstanceBytes = 0;          // Per instance transform buffer.
+    size_t MeshletBytes = 0;           // Meshlet side tables, CPU only.
+};
+
+// Playback over the stage's start and end time codes.
+struct SceneTimeline
+{
+    double StartTimeCode = 0.0;
+    double EndTimeCode = 0.0;
+    double TimeCodesPerSecond = 24.0;
+    double CurrentTimeCode = 0.0;
+    bool bPlaying = true;
+    bool bLooping = true;
+
+    bool HasRange() const { return EndTimeCode > StartTimeCode; }
+};
+
+// What the last transform evaluation of UpdateAnimation touched.
+struct SceneAnimationStats
+{
+    size_t NumPlacements = 0;     // Time varying mesh and instance prims.
+    size_t NumPointInstancers = 0;
+    size_t NumRows = 0;           // Instance transforms rewritten.
+    size_t NumDeferredFrames = 0; // Frames the streaming worker held the stage, the transforms then wait a frame.
+    double EvaluateMs = 0.0;
+    size_t NumDeformedMeshes = 0; // Deforming meshes whose vertices changed in their last sample.
+    double SampleMs = 0.0;
+};
+
+// Stage edits applied since the scene was loaded, and what the last batch of them changed.
+struct SceneEditStats
+{
+    size_t NumBatches = 0;       // UpdateStageEdits calls that had edits to apply.
+    size_t NumEdits = 0;         // Coalesced edits of the last batch.
+    size_t NumRows = 0;          // Instance transforms the last batch rewrote.
+    size_t NumRebuiltMeshes = 0;
+    size_t NumRemovedMeshes = 0;
+    size_t NumAddedMeshes = 0;
+    double ApplyMs = 0.0;
+};
+
+// How LoadScene treats payloads.
+enum class ScenePayloadMode
+{
+    LoadAll,    // Blocks until every payload is loaded and triangulated.
+    Streamed,   // Opens with UsdStage::LoadNone, payloads then stream in around the camera on a background thread.
+};
+
+// How LoadScene turns the stage into scene meshes.
+enum class SceneFrontEnd
+{
+    Traversal,  // USDScene's own traversal, with payload streaming and stage edits applied by UpdateStageEdits.
+    Hydra,      // A UsdImagingDelegate syncing mesh rprims, see HydraScene. Payloads are always loaded.
+};
+
+// A mesh rebuilt in place by a stage edit, its instance rows stay where they are.
+struct SceneMeshRebuild
+{
+    size_t Mesh = 0;           // Index from after the update's removals.
+    bool bSameIndices = false; // Only the vertices changed, the mesh keeps its index buffer.
+};
+
+// How the mesh list changed in one UpdateStreaming or UpdateStageEdits, removals apply before the appended meshes.
+struct SceneStreamingUpdate
+{
+    std::vector<size_t> RemovedMeshes; // Ascending, indices from before the update.
+    size_t FirstNewMesh = 0;
+    std::vector<SceneMeshRebuild> RebuiltMeshes;
+    std::vector<uint32_t> ChangedRows; // Rows rewritten in place, only set when no rows were removed or appended.
+    bool bRowsMoved = false;           // Rows were removed, the remaining ones moved down.
+    bool bChanged = false;
+};
+
+// Range of a mesh's rows in the instance transform array.
+struct MeshInstanceRange
+{
+    uint32_t FirstInstance = 0;
+    uint32_t NumInstances = 0;
+};
+
+// Listens to the stage it loads, so it derives from TfWeakBase for TfNotice.
+class USDScene : public pxr::TfWeakBase
 {
 public:
     USDScene();
+    ~USDScene();
 
-    void LoadScene(const std::string& Path);
+    void LoadScene(const std::string& Path, ScenePayloadMode PayloadMode = ScenePayloadMode::LoadAll);
     void ClearScene();
 
+    // Main thread, once per frame. Applies streamed in and evicted payloads and passes the camera to the streamer.
+    SceneStreamingUpdate UpdateStreaming();
+    bool IsStreaming() const { return Streamer != nullptr; }
+    PayloadStreamingStats GetStreamingStats() const { return Streamer ? Streamer->GetStats() : PayloadStreamingStats(); }
+    void SetStreamingBudget(size_t Bytes) { StreamingBudgetBytes = Bytes; }
+
+    // Main thread, once per frame. Applies the edits made to the stage since the last call: transform edits rewrite their rows,
+    // primvar and topology edits rebuild only the edited meshes and resyncs collect the resynced subtree again. Stage edits have to
+    // be made holding GetStageMutex().
+    SceneStreamingUpdate UpdateStageEdits();
+    const SceneEditStats& GetEditStats() const { return EditStats; }
+
+    // Applies from the next load, -hydra on the command line selects Hydra at startup.
+    void SetFrontEnd(SceneFrontEnd InFrontEnd) { FrontEnd = InFrontEnd; }
+    SceneFrontEnd GetFrontEnd() const { return FrontEnd; }
+    bool UsesHydra() const { return Hydra != nullptr; }
+
+    // Main thread, once per frame in place of UpdateStageEdits, UpdateStreaming and UpdateAnimation for a scene loaded through Hydra.
+    // Advances the timeline, then syncs the rprims stage edits and the time made dirty. Rebuilt rprims replace their scene mesh and
+    // moved ones rewrite their rows, anything changing the layout lays every mesh out again.
+    SceneStreamingUpdate UpdateHydra(double DeltaSeconds);
+
+    // Reads every layer of the stage from disk again, what changed is applied by UpdateStageEdits like any other edit.
+    void ReloadStage();
+
+    // Reorder triangles and vertices of newly built meshes for the vertex cache and overdraw, applies from the next load.
+    void SetOptimiseMeshes(bool bOptimise) { bOptimiseMeshes = bOptimise; }
+
+    // Vertex buffer encoding of newly built meshes, applies from the next load.
+    void SetVertexFormat(VertexFormat Format) { MeshVertexFormat = Format; }
+
+    // Simplified levels of detail for newly built meshes, applies from the next load.
+    void SetGenerateLods(bool bGenerate) { bGenerateLods = bGenerate; }
+
+    // Main thread, once per frame. Advances the timeline and re-evaluates only the time varying transforms and deforming meshes
+    // when the time moved. Returns true when a new set of transforms was published, the changed rows are GetTimeVaryingTransforms().
+    // Deformed meshes bump their MeshDeformer version instead.
+    bool UpdateAnimation(double DeltaSeconds);
+    SceneTimeline& GetTimeline() { return Timeline; }
+    const SceneAnimationStats& GetAnimationStats() const { return AnimationStats; }
+    
+    // Held by the streaming worker while it loads, anything reading the stage during streaming takes it too.
+    std::mutex& GetStageMutex() { return StageMutex; }
+
     const std::vector<std::shared_ptr<class RenderMesh>> GetMeshes() const { return Meshes; }
+    
+    // World transforms in render space, grouped per mesh by GetInstanceRanges() which follows the GetMeshes() order.
+    // The last published buffer, animation only ever writes the other one so reading this takes no lock.
+    const std::vector<DirectX::XMFLOAT4X4>& GetInstanceTransforms() const { return TransformBuffers[PublishedTransforms.load(std::memory_order_acquire)]; }
+    const std::vector<MeshInstanceRange>& GetInstanceRanges() const { return InstanceRanges; }
+    bool IsTransformTimeVarying(size_t InstanceIdx) const { return TransformTimeVarying[InstanceIdx] != 0; }
+    const std::vector<uint32_t>& GetTimeVaryingTransforms() const { return TimeVaryingTransforms; }
     const std::shared_ptr<class Camera> GetCamera() const { return MainCamera; }
     
     const bool IsYUp() const { return bIsYUp; }
+    const SceneLoadStats& GetLoadStats() const { return LoadStats; }
     
     // Example files.
     void LoadExampleTri() { LoadScene(RendererAssets::Tri); } 
@@ -37,13 +215,171 @@ public:
     void LoadExampleCube() { LoadScene(RendererAssets::Cube); }
     void LoadFaceAndTri() { LoadScene(RendererAssets::FaceAndTri); }
 
+private:
+    // Where one instance of a mesh sits, World = Offset * LocalToWorld(XformPrim).
+    // XformPrim is the mesh itself, or the instance prim with Offset being the mesh relative to its prototype.
+    struct InstancePlacement
+    {
+        pxr::UsdPrim XformPrim;
+        pxr::GfMatrix4d Offset{1.0};
+        uint32_t Row = 0; // Row in the instance transforms.
+    };
+
+    // The instances of one prototype of a point instancer that use a mesh.
+    struct PointInstancerRef
+    {
+        uint32_t InstancerIdx = 0;
+        uint32_t PrototypeIdx = 0;
+        uint32_t NumInstances = 0;
+        pxr::GfMatrix4d Offset{1.0}; // Mesh relative to the parent of the prototype root.
+    };
+    
+    // A renderable mesh prim found by the traversal, and every instance of it.
+    struct MeshSource
+    {
+        pxr::UsdPrim Prim;
+        std::vector<InstancePlacement> Placements;
+        std::vector<PointInstancerRef> PointInstances;
+    };
+
+    // A point instancer whose instance arrays are converted in bulk into contiguous rows per prototype mesh.
+    struct PointInstancerMesh
+    {
+        uint32_t PrototypeIdx = 0;
+        uint32_t FirstInstance = 0;
+        uint32_t NumInstances = 0;
+        pxr::GfMatrix4d Offset{1.0};
+    };
+    struct PointInstancerBlock
+    {
+        pxr::UsdPrim Prim;
+        size_t NumPrototypes = 0;
+        std::vector<PointInstancerMesh> Meshes;
+        std::vector<uint32_t> Counts; // Drawn instances of each prototype when collected.
+        bool bTimeVarying = false;
+        uint32_t Owner = 0;
+    };
+
+    // Everything below one root, built off the main thread with its own instance rows starting at zero.
+    // The root is the pseudo root for the initial load, or a payload prim when streaming.
+    struct SceneChunk
+    {
+        uint32_t Owner = 0; // Streamed payload id, zero for everything outside payloads.
+        pxr::SdfPath PayloadPath; // Of the streamed payload.
+        std::vector<MeshSource> Sources;
+        std::vector<std::shared_ptr<class RenderMesh>> Meshes;
+        std::vector<MeshInstanceRange> InstanceRanges;
+        std::vector<InstancePlacement> Placements;
+        std::vector<PointInstancerBlock> PointInstancers;
+        std::vector<pxr::UsdPrim> SkelRoots;
+        size_t NumInstanceRows = 0;
+        std::vector<DirectX::XMFLOAT4X4> InstanceTransforms;
+        std::vector<uint8_t> TransformTimeVarying;
+        size_t NumPrims = 0;
+        size_t NumPrototypes = 0;
+        size_t ResidentBytes = 0;
+    };
+    
+    // Loading stages, only read the stage so a streaming worker can run them. Point instancer counts and prototype offsets are
+    // read at Time, the same time the chunk's world transforms are computed at.
+    void CollectRenderablePrims(const pxr::UsdPrim& Root, pxr::UsdTimeCode Time, SceneChunk& Chunk, std::vector<pxr::UsdPrim>* OutPayloads,
+        bool bSkipLoadedPayloads = false) const;
+    void BuildRenderMeshes(SceneChunk& Chunk) const;
+    void BindSkinnedMeshes(const SceneChunk& Chunk) const;
+    void ComputeWorldTransforms(SceneChunk& Chunk, pxr::UsdTimeCode Time) const;
+    void UpdatePointInstancer(const PointInstancerBlock& Block, pxr::UsdGeomXformCache& XformCache, pxr::UsdTimeCode Time,
+        std::vector<DirectX::XMFLOAT4X4>& Transforms) const;
+    void GatherPayloadBounds(const std::vector<pxr::UsdPrim>& Payloads, std::vector<PayloadBounds>& OutBounds) const;
+
+    // Main thread, moves a chunk's meshes and rows into the scene or removes those of evicted payloads.
+    void AppendChunk(SceneChunk& Chunk);
+    void RemoveOwners(const std::vector<uint32_t>& Owners, SceneStreamingUpdate& Update);
+    void RemoveRows(const std::vector<uint8_t>& KeepRow, SceneStreamingUpdate& Update); // Meshes left without rows go too.
+    void RefreshSceneStats();
+
+    // Stage edits. The listener only records them, UpdateStageEdits applies them between frames.
+    void OnObjectsChanged(const pxr::UsdNotice::ObjectsChanged& Notice, const pxr::UsdStageWeakPtr& Sender);
+    void ApplyTransformEdits(const std::vector<pxr::SdfPath>& Paths, pxr::SdfPathVector& OutResynced, SceneStreamingUpdate& Update);
+    void RebuildMeshes(const std::vector<StageEdit>& Edits, pxr::SdfPathVector& OutResynced, SceneStreamingUpdate& Update);
+    void ResyncSubtrees(const pxr::SdfPathVector& Paths, SceneStreamingUpdate& Update);
+    uint32_t FindPayloadOwner(const pxr::SdfPath& Path) const;
+    struct MeshBuildSettings GetMeshBuildSettings() const;
+
+    // Hydra front-end, scene meshes and rows from the synced rprims.
+    void LayoutHydraMeshes(SceneStreamingUpdate& Update);
+
+    void AdvanceTimeline(double DeltaSeconds);
+
+    // Main thread, writes the time varying rows at Time into the unpublished transform buffer and publishes it.
+    void EvaluateTransforms(pxr::UsdTimeCode Time);
+    void SampleDeformers(pxr::UsdTimeCode Time);
+    std::vector<DirectX::XMFLOAT4X4>& GetPublishedTransforms() { return TransformBuffers[PublishedTransforms.load(std::memory_order_relaxed)]; }
+
+    // Streaming worker callbacks.
+    size_t LoadPayload(uint32_t Id, const pxr::SdfPath& Path, std::vector<PayloadBounds>& OutNested);
+    void UnloadPayloads(const std::vector<pxr::SdfPath>& Paths);
+
+    // Transform Helpers
+    DirectX::XMFLOAT4X4 ToRenderSpace(const pxr::GfMatrix4d& Matrix) const;
+    void PrintLoadStats() const;
+
 private:
     // USD Objects
     pxr::UsdStageRefPtr Stage;
+    std::shared_ptr<const class MeshCacheFile> CookedMeshes;
 
     // Render Scene Objects
     std::vector<std::shared_ptr<class RenderMesh>> Meshes;
     std::shared_ptr<class Camera> MainCamera;
+
+    // Instances of every mesh, flags are non zero where the transform may change over time.
+    std::vector<uint32_t> MeshOwners; // Payload each mesh was streamed in with, follows the GetMeshes() order.
+    std::vector<MeshInstanceRange> InstanceRanges;
+    std::vector<InstancePlacement> Placements;
+    std::vector<PointInstancerBlock> PointInstancers;
+    size_t NumInstanceRows = 0;
+    std::vector<uint8_t> TransformTimeVarying;
+    std::vector<uint32_t> TimeVaryingTransforms; // Instance indices of the time varying transforms.
+
+    // Double buffered instance transforms. Loading and streaming edit the published buffer between frames,
+    // animation rewrites the time varying rows of the other one and then publishes it.
+    std::vector<DirectX::XMFLOAT4X4> TransformBuffers[2];
+    std::atomic<uint32_t> PublishedTransforms{ 0 };
+
+    // Animation
+    SceneTimeline Timeline;
+    SceneAnimationStats AnimationStats;
+    SceneEditStats EditStats;
+    pxr::UsdGeomXformCache AnimationXformCache; // Kept across frames, cleared when edits, streaming or resyncs change the prims it caches ops of.
+    std::vector<uint32_t> TimeVaryingPlacements; // Indices into Placements.
+    double EvaluatedTimeCode = 0.0;
+    bool bTransformsDirty = true; // Rows changed since the last evaluation, the unpublished buffer has to be copied again.
+    std::vector<std::shared_ptr<class MeshDeformer>> Deformers; // Of the deforming meshes, follows the GetMeshes() order.
+    double SampledTimeCode = 0.0;
+    bool bDeformersDirty = true; // Meshes were added since the last sample.
     
     bool bIsYUp = true;
+    bool bOptimiseMeshes = true;
+    bool bGenerateLods = true;
+    VertexFormat MeshVertexFormat = VertexFormat::QuantisedBounds;
+    SceneLoadStats LoadStats;
+
+    // Payload streaming
+    std::mutex StageMutex;
+    std::unique_ptr<PayloadStreamer> Streamer;
+    size_t StreamingBudgetBytes = size_t(1024) * 1024 * 1024;
+    std::mutex StreamedChunksMutex;
+    std::vector<SceneChunk> StreamedChunks; // Loaded by the worker, waiting for the main thread.
+    std::unordered_map<pxr::SdfPath, uint32_t, pxr::SdfPath::Hash> PayloadOwners; // Resident payloads, by prim path.
+
+    // Stage edits
+    pxr::TfNotice::Key ObjectsChangedKey;
+    bool bLoadingPayloads = false; // The worker's own loads and unloads, already handled as chunks. Only touched under StageMutex.
+    std::mutex PendingEditsMutex;
+    std::vector<StageEdit> PendingEdits;
+
+    // Hydra front-end
+    SceneFrontEnd FrontEnd = SceneFrontEnd::Traversal;
+    std::unique_ptr<class HydraScene> Hydra;
+    std::unordered_map<const class HydraMesh*, size_t> HydraMeshIndices; // Scene mesh of each rprim with something to draw.
 };
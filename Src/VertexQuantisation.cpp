@@ -0,0 +1,142 @@
+#include "VertexQuantisation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+#include "DirectXPackedVector.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+    float SignNotZero(float Value) { return Value >= 0.0f ? 1.0f : -1.0f; }
+
+    // Round to nearest, matching the D3D UNORM and SNORM conversion rules on the way back.
+    int16_t ToSnorm16(float Value) { return static_cast<int16_t>(std::lround(std::clamp(Value, -1.0f, 1.0f) * 32767.0f)); }
+    float FromSnorm16(int16_t Value) { return std::max(static_cast<float>(Value) / 32767.0f, -1.0f); }
+    uint16_t ToUnorm16(float Value) { return static_cast<uint16_t>(std::lround(std::clamp(Value, 0.0f, 1.0f) * 65535.0f)); }
+    float FromUnorm16(uint16_t Value) { return static_cast<float>(Value) / 65535.0f; }
+    uint8_t ToUnorm8(float Value) { return static_cast<uint8_t>(std::lround(std::clamp(Value, 0.0f, 1.0f) * 255.0f)); }
+    float FromUnorm8(uint8_t Value) { return static_cast<float>(Value) / 255.0f; }
+}
+
+void VertexQuantisation::EncodeOctahedral(const XMFLOAT3& Normal, int16_t Out[2])
+{
+    const float L1 = std::abs(Normal.x) + std::abs(Normal.y) + std::abs(Normal.z);
+    if (L1 == 0.0f)
+    {
+        Out[0] = 0;
+        Out[1] = 0;
+        return;
+    }
+
+    float X = Normal.x / L1;
+    float Y = Normal.y / L1;
+    if (Normal.z < 0.0f)
+    {
+        // The lower hemisphere folds over the diagonals onto the corners of the square.
+        const float FoldedX = (1.0f - std::abs(Y)) * SignNotZero(X);
+        const float FoldedY = (1.0f - std::abs(X)) * SignNotZero(Y);
+        X = FoldedX;
+        Y = FoldedY;
+    }
+    Out[0] = ToSnorm16(X);
+    Out[1] = ToSnorm16(Y);
+}
+
+XMFLOAT3 VertexQuantisation::DecodeOctahedral(const int16_t In[2])
+{
+    const float X = FromSnorm16(In[0]);
+    const float Y = FromSnorm16(In[1]);
+    const float Z = 1.0f - std::abs(X) - std::abs(Y);
+    const float T = std::clamp(-Z, 0.0f, 1.0f);
+
+    XMFLOAT3 Normal(X + (X >= 0.0f ? -T : T), Y + (Y >= 0.0f ? -T : T), Z);
+    XMStoreFloat3(&Normal, XMVector3Normalize(XMLoadFloat3(&Normal)));
+    return Normal;
+}
+
+uint32_t VertexQuantisation::EncodeHalf2(const XMFLOAT2& Value)
+{
+    return static_cast<uint32_t>(XMConvertFloatToHalf(Value.x)) | (static_cast<uint32_t>(XMConvertFloatToHalf(Value.y)) << 16);
+}
+
+XMFLOAT2 VertexQuantisation::DecodeHalf2(uint32_t Packed)
+{
+    return XMFLOAT2(XMConvertHalfToFloat(static_cast<HALF>(Packed & 0xFFFF)), XMConvertHalfToFloat(static_cast<HALF>(Packed >> 16)));
+}
+
+VertexFormat VertexQuantisation::Encode(const std::vector<Vertex>& Vertices, VertexFormat Format, std::vector<QuantisedVertex>& OutVertices, PositionDequantisation& OutDequantisation)
+{
+    OutVertices.resize(Vertices.size());
+    OutDequantisation = PositionDequantisation();
+
+    XMVECTOR Min = XMVectorReplicate(FLT_MAX);
+    XMVECTOR Max = XMVectorReplicate(-FLT_MAX);
+    for (const Vertex& Vtx : Vertices)
+    {
+        const XMVECTOR Position = XMLoadFloat3(&Vtx.Position);
+        Min = XMVectorMin(Min, Position);
+        Max = XMVectorMax(Max, Position);
+    }
+
+    if (Format == VertexFormat::QuantisedHalf && !Vertices.empty())
+    {
+        const XMVECTOR Extreme = XMVectorMax(XMVectorAbs(Min), XMVectorAbs(Max));
+        if (std::max({ XMVectorGetX(Extreme), XMVectorGetY(Extreme), XMVectorGetZ(Extreme) }) > MaxHalf) { Format = VertexFormat::QuantisedBounds; }
+    }
+
+    // Flat axes get a zero scale, every vertex decodes to the offset exactly.
+    XMFLOAT3 BoundsMin, BoundsExtent;
+    XMStoreFloat3(&BoundsMin, Min);
+    XMStoreFloat3(&BoundsExtent, XMVectorSubtract(Max, Min));
+    if (Format == VertexFormat::QuantisedBounds && !Vertices.empty())
+    {
+        OutDequantisation.Scale = XMFLOAT4(BoundsExtent.x, BoundsExtent.y, BoundsExtent.z, 0.0f);
+        OutDequantisation.Offset = XMFLOAT4(BoundsMin.x, BoundsMin.y, BoundsMin.z, 0.0f);
+    }
+    const auto ToBounds = [](float Value, float BoundMin, float Extent) { return Extent > 0.0f ? ToUnorm16((Value - BoundMin) / Extent) : uint16_t(0); };
+
+    for (size_t Idx = 0; Idx < Vertices.size(); Idx++)
+    {
+        const Vertex& Vtx = Vertices[Idx];
+        QuantisedVertex& Out = OutVertices[Idx];
+
+        if (Format == VertexFormat::QuantisedBounds)
+        {
+            Out.Position[0] = ToBounds(Vtx.Position.x, BoundsMin.x, BoundsExtent.x);
+            Out.Position[1] = ToBounds(Vtx.Position.y, BoundsMin.y, BoundsExtent.y);
+            Out.Position[2] = ToBounds(Vtx.Position.z, BoundsMin.z, BoundsExtent.z);
+        }
+        else
+        {
+            Out.Position[0] = XMConvertFloatToHalf(Vtx.Position.x);
+            Out.Position[1] = XMConvertFloatToHalf(Vtx.Position.y);
+            Out.Position[2] = XMConvertFloatToHalf(Vtx.Position.z);
+        }
+        Out.Position[3] = 0;
+
+        EncodeOctahedral(Vtx.Normals, Out.Normal);
+
+        Out.Colour[0] = ToUnorm8(Vtx.Colour.x);
+        Out.Colour[1] = ToUnorm8(Vtx.Colour.y);
+        Out.Colour[2] = ToUnorm8(Vtx.Colour.z);
+        Out.Colour[3] = ToUnorm8(Vtx.Colour.w);
+    }
+    return Format;
+}
+
+Vertex VertexQuantisation::Decode(const QuantisedVertex& Quantised, VertexFormat Format, const PositionDequantisation& Dequantisation)
+{
+    Vertex Vtx;
+    for (size_t Axis = 0; Axis < 3; Axis++)
+    {
+        const float Stored = Format == VertexFormat::QuantisedBounds ? FromUnorm16(Quantised.Position[Axis]) : XMConvertHalfToFloat(Quantised.Position[Axis]);
+        (&Vtx.Position.x)[Axis] = Stored * (&Dequantisation.Scale.x)[Axis] + (&Dequantisation.Offset.x)[Axis];
+    }
+    Vtx.Normals = DecodeOctahedral(Quantised.Normal);
+    Vtx.Colour = XMFLOAT4(FromUnorm8(Quantised.Colour[0]), FromUnorm8(Quantised.Colour[1]), FromUnorm8(Quantised.Colour[2]), FromUnorm8(Quantised.Colour[3]));
+    return Vtx;
+}
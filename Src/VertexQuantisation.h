@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+#include "pch.h"
+
+// Encoding and decoding of the compact vertex formats. The GPU decode in Shaders.hlsl mirrors Decode.
+namespace VertexQuantisation
+{
+    // Largest magnitude a half float holds, QuantisedHalf meshes beyond it fall back to QuantisedBounds.
+    constexpr float MaxHalf = 65504.0f;
+
+    // Unit vector to and from an octahedral map in SNORM16, the sphere is folded onto a square so both axes use their full range.
+    void EncodeOctahedral(const DirectX::XMFLOAT3& Normal, int16_t Out[2]);
+    DirectX::XMFLOAT3 DecodeOctahedral(const int16_t In[2]);
+
+    // Texture coordinates as two half floats.
+    uint32_t EncodeHalf2(const DirectX::XMFLOAT2& Value);
+    DirectX::XMFLOAT2 DecodeHalf2(uint32_t Packed);
+
+    // Encodes render space vertices in Format and returns the format used, which differs when half positions would overflow.
+    VertexFormat Encode(const std::vector<Vertex>& Vertices, VertexFormat Format, std::vector<QuantisedVertex>& OutVertices, PositionDequantisation& OutDequantisation);
+
+    // What the input assembler and VSMain reconstruct from a quantised vertex.
+    Vertex Decode(const QuantisedVertex& Quantised, VertexFormat Format, const PositionDequantisation& Dequantisation);
+}
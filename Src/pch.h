@@ -1,14 +1,50 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include "DirectXMath.h"
 
 // Global ptr to the main window instance.
 inline class MainWindow* G_MainWindow = nullptr;
 
-// ConstBuffer
+// ConstBuffer, the Model to World matrix comes per instance from the transform buffer.
 struct CB_WVP
 {
-    DirectX::XMMATRIX ModelMatrix = DirectX::XMMatrixIdentity(); // Model to World
     DirectX::XMMATRIX ViewMatrix = DirectX::XMMatrixIdentity(); // World to View / Camera 
     DirectX::XMMATRIX ProjectionMatrix = DirectX::XMMatrixIdentity(); // View to 2D Projection
-};
\ No newline at end of file
+};
+
+// Vertex layout of the mesh vertex buffers, also the layout of the cooked mesh cache.
+struct Vertex
+{
+    DirectX::XMFLOAT3 Position;
+    DirectX::XMFLOAT3 Normals;
+    DirectX::XMFLOAT4 Colour;
+};
+
+// Compact vertex layout, decoded by the input assembler and VSMain.
+struct QuantisedVertex
+{
+    uint16_t Position[4]; // Half floats, or UNORM16 relative to the mesh bounds. W is unused.
+    int16_t Normal[2];    // Octahedral unit vector, SNORM16.
+    uint8_t Colour[4];    // RGBA8 UNORM.
+};
+
+// Encoding of a mesh's vertex buffer, chosen when it is built.
+enum class VertexFormat : uint8_t
+{
+    Float,           // Vertex, 40 bytes.
+    QuantisedHalf,   // QuantisedVertex with half float positions, 16 bytes.
+    QuantisedBounds, // QuantisedVertex with positions relative to the mesh bounds, 16 bytes.
+    Count
+};
+
+inline size_t GetVertexStride(VertexFormat Format) { return Format == VertexFormat::Float ? sizeof(Vertex) : sizeof(QuantisedVertex); }
+
+// Per mesh root constants of the position decode, Position = Stored * Scale + Offset. Identity unless the positions are bounds relative.
+struct PositionDequantisation
+{
+    DirectX::XMFLOAT4 Scale = DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 0.0f);
+    DirectX::XMFLOAT4 Offset = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+};
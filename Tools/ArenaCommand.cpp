@@ -0,0 +1,181 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+#include "ToolTiming.h"
+
+#include "ArenaAllocator.h"
+
+// Std
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr size_t DefaultOperationCounts[] = { 1000000 };
+    constexpr uint64_t InitialCapacity = 1 << 20;
+    constexpr uint64_t MaxRangeSize = 65536; // Vertex or index counts of scene meshes, mostly small with a long tail.
+    constexpr size_t MaxLiveRanges = 4096;  // Frees win once this many ranges are allocated, so the arena settles.
+    constexpr size_t CheckEvery = 997;      // Operations between full checks against the live ranges.
+    constexpr size_t ReloadEvery = 50000;   // Operations between reloads that drop half of the meshes at once.
+
+    using ToolTiming::Clock;
+    using ToolTiming::ToMs;
+
+    // The live ranges must not overlap, and the free ranges must be exactly the gaps between them, merged.
+    bool CheckRanges(const ArenaAllocator& Arena, const std::map<uint64_t, uint64_t>& Live)
+    {
+        uint64_t Cursor = 0;
+        uint64_t Used = 0;
+        uint64_t LastGap = 0;
+        size_t NumGaps = 0;
+        for (const auto& Range : Live)
+        {
+            if (Range.first < Cursor) { return false; }
+            if (Range.first > Cursor) { NumGaps++; }
+            LastGap = 0;
+            Cursor = Range.first + Range.second;
+            Used += Range.second;
+        }
+        if (Cursor > Arena.GetCapacity()) { return false; }
+        if (Cursor < Arena.GetCapacity())
+        {
+            NumGaps++;
+            LastGap = Arena.GetCapacity() - Cursor;
+        }
+        return Used == Arena.GetUsed() && NumGaps == Arena.GetNumFreeRanges() && Arena.GetFragmented() == Arena.GetFree() - LastGap;
+    }
+
+    // What StaticMeshPipeline does, a new buffer with every live range allocated again in order.
+    void Repack(ArenaAllocator& Arena, std::map<uint64_t, uint64_t>& Live, uint64_t Capacity)
+    {
+        std::vector<uint64_t> Sizes;
+        Sizes.reserve(Live.size());
+        for (const auto& Range : Live) { Sizes.push_back(Range.second); }
+
+        Arena.Reset(Capacity);
+        Live.clear();
+        for (const uint64_t Size : Sizes)
+        {
+            uint64_t Offset = 0;
+            Arena.Allocate(Size, Offset);
+            Live.emplace(Offset, Size);
+        }
+    }
+
+    bool RunFuzz(size_t NumOperations)
+    {
+        std::mt19937 Random(1234);
+        ArenaAllocator Arena;
+        Arena.Reset(InitialCapacity);
+        std::map<uint64_t, uint64_t> Live;
+        std::vector<uint64_t> LiveOffsets; // Same ranges as Live, for picking one at random.
+
+        size_t NumAllocations = 0;
+        size_t NumFrees = 0;
+        size_t NumGrows = 0;
+        size_t NumCompactions = 0;
+        size_t MaxFreeRanges = 0;
+        double AllocatorMs = 0.0;
+        const auto RebuildOffsets = [&]()
+        {
+            LiveOffsets.clear();
+            for (const auto& Range : Live) { LiveOffsets.push_back(Range.first); }
+        };
+        const auto FreeAt = [&](size_t Pick)
+        {
+            const uint64_t Offset = LiveOffsets[Pick];
+            const auto Start = Clock::now();
+            Arena.Free(Offset, Live[Offset]);
+            AllocatorMs += ToMs(Clock::now() - Start);
+            Live.erase(Offset);
+            LiveOffsets[Pick] = LiveOffsets.back();
+            LiveOffsets.pop_back();
+            NumFrees++;
+        };
+
+        for (size_t Operation = 1; Operation <= NumOperations; Operation++)
+        {
+            const bool bAllocate = LiveOffsets.empty() || (LiveOffsets.size() < MaxLiveRanges && Random() % 2 == 0);
+            if (bAllocate)
+            {
+                const uint64_t Size = ToolTiming::LongTailSize(Random, 4.0, MaxRangeSize);
+                uint64_t Offset = 0;
+                const auto Start = Clock::now();
+                const bool bAllocated = Arena.Allocate(Size, Offset);
+                AllocatorMs += ToMs(Clock::now() - Start);
+                if (!bAllocated)
+                {
+                    Repack(Arena, Live, std::max(Arena.GetCapacity() * 2, (Arena.GetUsed() + Size) * 3 / 2));
+                    RebuildOffsets();
+                    NumGrows++;
+                    if (!Arena.Allocate(Size, Offset))
+                    {
+                        std::cerr << "arena: Allocation of " << Size << " failed after growing.\n";
+                        return false;
+                    }
+                }
+                Live.emplace(Offset, Size);
+                LiveOffsets.push_back(Offset);
+                NumAllocations++;
+            }
+            else
+            {
+                FreeAt(Random() % LiveOffsets.size());
+            }
+
+            // A reload drops half of the meshes, the arena is compacted once its holes waste a quarter of it.
+            if (Operation % ReloadEvery == 0)
+            {
+                for (size_t Drop = LiveOffsets.size() / 2; Drop > 0; Drop--) { FreeAt(Random() % LiveOffsets.size()); }
+                if (Arena.GetFragmented() * 4 > Arena.GetCapacity())
+                {
+                    Repack(Arena, Live, std::max(Arena.GetUsed() * 5 / 4, InitialCapacity));
+                    RebuildOffsets();
+                    NumCompactions++;
+                    if (Arena.GetFragmented() != 0 || Arena.GetNumFreeRanges() > 1)
+                    {
+                        std::cerr << "arena: Compaction left holes.\n";
+                        return false;
+                    }
+                }
+            }
+
+            MaxFreeRanges = std::max(MaxFreeRanges, Arena.GetNumFreeRanges());
+            if (Operation % CheckEvery == 0 && !CheckRanges(Arena, Live))
+            {
+                std::cerr << "arena: Ranges inconsistent after " << Operation << " operations.\n";
+                return false;
+            }
+        }
+
+        // Freeing everything merges back into the one range of the whole arena.
+        RebuildOffsets();
+        while (!LiveOffsets.empty()) { FreeAt(LiveOffsets.size() - 1); }
+        const bool bEmpty = Arena.GetUsed() == 0 && Arena.GetNumFreeRanges() == 1 && Arena.GetFragmented() == 0;
+
+        std::cout << NumOperations << " operations: " << NumAllocations << " allocations, " << NumFrees << " frees, "
+            << AllocatorMs * 1e6 / (NumAllocations + NumFrees) << " ns each\n"
+            << "    " << NumGrows << " grows, " << NumCompactions << " compactions, final capacity " << Arena.GetCapacity()
+            << " elements, at most " << MaxFreeRanges << " free ranges\n";
+        if (!bEmpty) { std::cerr << "arena: Freeing every range did not merge the arena back into one range.\n"; }
+        return bEmpty;
+    }
+}
+
+int RunArenaCommand(const std::vector<std::string>& Args)
+{
+    std::vector<size_t> Counts;
+    if (!ToolScene::ParseCounts(Args, DefaultOperationCounts, "arena", "operation", Counts)) { return 1; }
+
+    bool bPassed = true;
+    for (const size_t Count : Counts)
+    {
+        bPassed &= RunFuzz(Count);
+    }
+
+    std::cout << "arena: " << (bPassed ? "Ranges never overlapped and free ranges always merged.\n" : "Arena check failed!\n");
+    return bPassed ? 0 : 1;
+}
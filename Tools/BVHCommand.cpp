@@ -0,0 +1,250 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+#include "ToolTiming.h"
+
+#include "Frustum.h"
+#include "FrustumCulling.h"
+#include "SceneBVH.h"
+
+// Std
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr size_t DefaultObjectCounts[] = { 1000, 10000, 100000 };
+    constexpr size_t NumTimedRuns = 5;
+    constexpr size_t NumViews = 256;
+    constexpr size_t NumRays = 100000;
+    constexpr size_t NumCheckedRays = 2000;
+    constexpr float ObjectsPerUnitVolume = 0.05f; // Scenes grow with the object count, so each view sees a similar share.
+
+    using ToolTiming::Clock;
+    using ToolTiming::ToMs;
+
+    template <typename Func>
+    double MedianMs(const Func& Run)
+    {
+        std::vector<double> Times;
+        for (size_t Idx = 0; Idx < NumTimedRuns; Idx++)
+        {
+            const auto Start = Clock::now();
+            Run();
+            Times.push_back(ToMs(Clock::now() - Start));
+        }
+        std::sort(Times.begin(), Times.end());
+        return Times[Times.size() / 2];
+    }
+
+    // Boxes of very different sizes scattered through a cube, like props, furniture and buildings in one scene.
+    std::vector<BoundingBox> MakeBoxes(size_t Count, float SceneSize, std::mt19937& Random)
+    {
+        std::uniform_real_distribution<float> Position(0.0f, SceneSize);
+        std::lognormal_distribution<float> Size(-0.5f, 0.8f);
+
+        std::vector<BoundingBox> Boxes(Count);
+        for (BoundingBox& Box : Boxes)
+        {
+            const XMFLOAT3 Center(Position(Random), Position(Random), Position(Random));
+            const XMFLOAT3 Half(Size(Random), Size(Random), Size(Random));
+            Box.Min = XMFLOAT3(Center.x - Half.x, Center.y - Half.y, Center.z - Half.z);
+            Box.Max = XMFLOAT3(Center.x + Half.x, Center.y + Half.y, Center.z + Half.z);
+        }
+        return Boxes;
+    }
+
+    XMFLOAT3 RandomDirection(std::mt19937& Random)
+    {
+        std::normal_distribution<float> Normal;
+        XMFLOAT3 Direction;
+        XMStoreFloat3(&Direction, XMVector3Normalize(XMVectorSet(Normal(Random), Normal(Random), Normal(Random), 0.0f)));
+        return Direction;
+    }
+
+    // Same arithmetic as the BVH's SIMD test, one plane at a time.
+    bool BruteForceIntersects(const Frustum& ViewFrustum, const BoundingBox& Box)
+    {
+        const float Cx = (Box.Min.x + Box.Max.x) * 0.5f, Cy = (Box.Min.y + Box.Max.y) * 0.5f, Cz = (Box.Min.z + Box.Max.z) * 0.5f;
+        const float Ex = (Box.Max.x - Box.Min.x) * 0.5f, Ey = (Box.Max.y - Box.Min.y) * 0.5f, Ez = (Box.Max.z - Box.Min.z) * 0.5f;
+        for (const XMFLOAT4& Plane : ViewFrustum.Planes)
+        {
+            const float Distance = Cz * Plane.z + (Cy * Plane.y + (Cx * Plane.x + Plane.w));
+            const float Radius = Ez * std::abs(Plane.z) + (Ey * std::abs(Plane.y) + Ex * std::abs(Plane.x));
+            if (!(Distance + Radius >= 0.0f)) { return false; }
+        }
+        return true;
+    }
+
+    float BruteForceRaycast(const std::vector<BoundingBox>& Boxes, const XMFLOAT3& Origin, const XMFLOAT3& Direction)
+    {
+        float Best = FLT_MAX;
+        for (const BoundingBox& Box : Boxes)
+        {
+            float Entry = -FLT_MAX, Exit = FLT_MAX;
+            for (size_t Axis = 0; Axis < 3; Axis++)
+            {
+                const float O = (&Origin.x)[Axis], D = (&Direction.x)[Axis];
+                const float InvD = 1.0f / (std::abs(D) < 1e-20f ? std::copysign(1e-20f, D) : D);
+                const float T0 = ((&Box.Min.x)[Axis] - O) * InvD, T1 = ((&Box.Max.x)[Axis] - O) * InvD;
+                Entry = std::max(Entry, std::min(T0, T1));
+                Exit = std::min(Exit, std::max(T0, T1));
+            }
+            if (Entry > Exit || Exit < 0.0f) { continue; }
+            Best = std::min(Best, Entry >= 0.0f ? Entry : Exit);
+        }
+        return Best;
+    }
+
+    // Builds, refits and queries one synthetic scene, returns false when a query disagrees with brute force.
+    bool RunBenchmark(size_t NumObjects)
+    {
+        std::mt19937 Random(static_cast<uint32_t>(NumObjects));
+        const float SceneSize = std::cbrt(NumObjects / ObjectsPerUnitVolume);
+        std::vector<BoundingBox> Boxes = MakeBoxes(NumObjects, SceneSize, Random);
+
+        SceneBVH BVH;
+        const double BuildMs = MedianMs([&] { BVH.Build(Boxes); });
+        const BVHStats Stats = BVH.GetStats();
+
+        // Every object moves a little, as animated transforms would between frames.
+        std::uniform_real_distribution<float> Jitter(-0.1f, 0.1f);
+        std::vector<BoundingBox> Moved = Boxes;
+        for (BoundingBox& Box : Moved)
+        {
+            const XMFLOAT3 Offset(Jitter(Random), Jitter(Random), Jitter(Random));
+            Box.Min = XMFLOAT3(Box.Min.x + Offset.x, Box.Min.y + Offset.y, Box.Min.z + Offset.z);
+            Box.Max = XMFLOAT3(Box.Max.x + Offset.x, Box.Max.y + Offset.y, Box.Max.z + Offset.z);
+        }
+        const double RefitMs = MedianMs([&] { BVH.Refit(Moved); });
+        Boxes = Moved;
+
+        // Then a few objects move further, like a handful of animated rows in a static scene. The queries below check the result.
+        std::vector<uint32_t> MovedObjects;
+        for (uint32_t Object = 0; Object < static_cast<uint32_t>(NumObjects); Object += 100)
+        {
+            BoundingBox& Box = Moved[Object];
+            const float Offset = SceneSize * 0.25f;
+            Box.Min = XMFLOAT3(Box.Min.x + Offset, Box.Min.y - Offset, Box.Min.z);
+            Box.Max = XMFLOAT3(Box.Max.x + Offset, Box.Max.y - Offset, Box.Max.z);
+            MovedObjects.push_back(Object);
+        }
+        const double PartialRefitMs = MedianMs([&] { BVH.Refit(Moved, MovedObjects); });
+        Boxes = Moved;
+
+        // Views from inside the scene, with the default camera's field of view and the scene as the far plane.
+        std::uniform_real_distribution<float> Position(0.0f, SceneSize);
+        std::vector<Frustum> Views(NumViews);
+        for (Frustum& View : Views)
+        {
+            const XMVECTOR Eye = XMVectorSet(Position(Random), Position(Random), Position(Random), 1.0f);
+            const XMFLOAT3 Forward = RandomDirection(Random);
+            const XMMATRIX ViewMatrix = XMMatrixLookToRH(Eye, XMLoadFloat3(&Forward), std::abs(Forward.y) < 0.99f ? XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
+            View = Frustum::FromViewProjection(XMMatrixMultiply(ViewMatrix, XMMatrixPerspectiveFovRH(XMConvertToRadians(45.0f), 16.0f / 9.0f, 0.01f, SceneSize)));
+        }
+
+        std::vector<uint32_t> Visible;
+        size_t NumVisible = 0;
+        const auto FrustumStart = Clock::now();
+        for (const Frustum& View : Views)
+        {
+            Visible.clear();
+            BVH.QueryFrustum(View, Visible);
+            NumVisible += Visible.size();
+        }
+        const double FrustumMs = ToMs(Clock::now() - FrustumStart);
+
+        size_t NumBruteForceVisible = 0;
+        const auto BruteForceStart = Clock::now();
+        for (const Frustum& View : Views)
+        {
+            for (const BoundingBox& Box : Boxes) { NumBruteForceVisible += BruteForceIntersects(View, Box) ? 1 : 0; }
+        }
+        const double BruteForceMs = ToMs(Clock::now() - BruteForceStart);
+
+        // The flat kernel over the same boxes, each with the sphere around it. A box inside the frustum always has its sphere inside too.
+        CullBoundsSoA FlatBounds;
+        FlatBounds.Resize(NumObjects);
+        for (size_t Idx = 0; Idx < NumObjects; Idx++)
+        {
+            const BoundingBox& Box = Boxes[Idx];
+            const XMFLOAT3 Center((Box.Min.x + Box.Max.x) * 0.5f, (Box.Min.y + Box.Max.y) * 0.5f, (Box.Min.z + Box.Max.z) * 0.5f);
+            const XMFLOAT3 Extents((Box.Max.x - Box.Min.x) * 0.5f, (Box.Max.y - Box.Min.y) * 0.5f, (Box.Max.z - Box.Min.z) * 0.5f);
+            FlatBounds.Set(Idx, Center, std::sqrt(Extents.x * Extents.x + Extents.y * Extents.y + Extents.z * Extents.z), Extents);
+        }
+        CullKernelStats FlatStats;
+        const auto FlatStart = Clock::now();
+        for (const Frustum& View : Views)
+        {
+            Visible.clear();
+            FrustumCulling::Cull(FlatBounds, View, Visible, FlatStats);
+        }
+        const double FlatMs = ToMs(Clock::now() - FlatStart);
+
+        std::vector<XMFLOAT3> Origins(NumRays), Directions(NumRays);
+        for (size_t Idx = 0; Idx < NumRays; Idx++)
+        {
+            Origins[Idx] = XMFLOAT3(Position(Random), Position(Random), Position(Random));
+            Directions[Idx] = RandomDirection(Random);
+        }
+        std::vector<BVHRayHit> Hits(NumRays);
+        const auto RayStart = Clock::now();
+        for (size_t Idx = 0; Idx < NumRays; Idx++) { BVH.Raycast(Origins[Idx], Directions[Idx], FLT_MAX, Hits[Idx]); }
+        const double RayMs = ToMs(Clock::now() - RayStart);
+
+        size_t NumRayMismatches = 0;
+        for (size_t Idx = 0; Idx < NumCheckedRays; Idx++)
+        {
+            const float Expected = BruteForceRaycast(Boxes, Origins[Idx], Directions[Idx]);
+            const bool bMatch = Expected == FLT_MAX ? Hits[Idx].Object == UINT32_MAX : std::abs(Hits[Idx].Distance - Expected) <= 1e-4f * std::max(1.0f, Expected);
+            NumRayMismatches += bMatch ? 0 : 1;
+        }
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << NumObjects << " objects: " << Stats.NumNodes << " nodes, " << Stats.NumLeaves << " leaves, depth " << Stats.MaxDepth
+            << ", SAH cost " << Stats.SAHCost << "\n";
+        std::cout << "    Build " << BuildMs << " ms, refit " << RefitMs << " ms, refit of " << MovedObjects.size() << " moved objects "
+            << PartialRefitMs << " ms\n";
+        std::cout << "    Frustum " << 1000.0 * FrustumMs / NumViews << " us per query, " << NumVisible / NumViews << " visible on average, brute force "
+            << 1000.0 * BruteForceMs / NumViews << " us\n";
+        std::cout << "    Flat cull " << 1000.0 * FlatMs / NumViews << " us per view, " << FlatStats.NumSphereCulled / NumViews << " culled by sphere, "
+            << FlatStats.NumBoxCulled / NumViews << " more by box\n";
+        std::cout << "    Rays " << NumRays / (RayMs / 1000.0) / 1.0e6 << " M/s\n";
+
+        bool bPassed = true;
+        if (NumVisible != NumBruteForceVisible)
+        {
+            std::cerr << "bvh: Frustum queries found " << NumVisible << " objects, brute force " << NumBruteForceVisible << "\n";
+            bPassed = false;
+        }
+        if (FlatStats.NumVisible != NumBruteForceVisible)
+        {
+            std::cerr << "bvh: Flat culling found " << FlatStats.NumVisible << " objects, brute force " << NumBruteForceVisible << "\n";
+            bPassed = false;
+        }
+        if (NumRayMismatches > 0)
+        {
+            std::cerr << "bvh: " << NumRayMismatches << " of " << NumCheckedRays << " rays disagree with brute force\n";
+            bPassed = false;
+        }
+        return bPassed;
+    }
+}
+
+int RunBVHCommand(const std::vector<std::string>& Args)
+{
+    std::vector<size_t> Counts;
+    if (!ToolScene::ParseCounts(Args, DefaultObjectCounts, "bvh", "object", Counts)) { return 1; }
+
+    size_t NumFailed = 0;
+    for (const size_t Count : Counts)
+    {
+        NumFailed += RunBenchmark(Count) ? 0 : 1;
+    }
+    return NumFailed == 0 ? 0 : 1;
+}
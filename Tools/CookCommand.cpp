@@ -0,0 +1,117 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+
+#include "RenderMesh.h"
+#include "MeshCache.h"
+
+// Std
+#include <chrono>
+#include <iostream>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+// USD
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/metrics.h"
+#include "pxr/usd/usdGeom/tokens.h"
+
+using namespace pxr;
+
+namespace
+{
+    struct CookResult
+    {
+        bool bSucceeded = false;
+        size_t NumMeshes = 0;
+        size_t NumEntries = 0;  // Unique meshes after de-duplicating by content hash.
+        size_t NumBytes = 0;
+        double Ms = 0.0;
+    };
+
+    // Builds every mesh the renderer can reach exactly as USDScene would, and writes them to the scene's mesh cache.
+    CookResult CookScene(const std::string& Path)
+    {
+        CookResult Result;
+        const auto StartTime = std::chrono::steady_clock::now();
+
+        UsdStageRefPtr Stage = UsdStage::Open(Path);
+        if (!Stage) { return Result; }
+
+        // Cooked with the renderer's default settings.
+        MeshBuildSettings Settings;
+        Settings.bIsYUp = UsdGeomGetStageUpAxis(Stage) == UsdGeomTokens->y;
+
+        const std::vector<UsdPrim> MeshPrims = ToolScene::GatherMeshPrims(Stage);
+
+        MeshCacheWriter Writer;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, MeshPrims.size()),
+            [&](const tbb::blocked_range<size_t>& Range)
+            {
+                for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+                {
+                    RenderMesh Mesh(Settings);
+                    UsdPrim Prim = MeshPrims[Idx];
+                    Mesh.Load(Prim);
+                    // Deforming meshes are rebuilt every frame from the stage and never read from the cache.
+                    const std::shared_ptr<MeshData> Data = Mesh.GetMeshData();
+                    if (Data && !Data->Deformer)
+                    {
+                        Writer.Add(Mesh.GetSourceHash(), *Data);
+                    }
+                }
+            });
+
+        Result.bSucceeded = Writer.Write(MeshCache::GetCachePath(Path));
+        Result.NumMeshes = MeshPrims.size();
+        Result.NumEntries = Writer.GetNumEntries();
+        Result.NumBytes = Writer.GetBlobBytes();
+        Result.Ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+        return Result;
+    }
+}
+
+int RunCookCommand(const std::vector<std::string>& Args)
+{
+    if (Args.empty())
+    {
+        std::cerr << "cook: Expected at least one USD file or directory.\n";
+        return 1;
+    }
+
+    const std::vector<std::string> Files = ToolScene::CollectUsdFiles(Args, "cook");
+
+    // Whole scenes in parallel, each also builds its meshes in parallel.
+    const auto StartTime = std::chrono::steady_clock::now();
+    std::vector<CookResult> Results(Files.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, Files.size(), 1),
+        [&](const tbb::blocked_range<size_t>& Range)
+        {
+            for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+            {
+                Results[Idx] = CookScene(Files[Idx]);
+            }
+        });
+    const double TotalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+
+    constexpr double MB = 1.0 / (1024.0 * 1024.0);
+    size_t NumFailed = 0;
+    size_t TotalBytes = 0;
+    for (size_t Idx = 0; Idx < Files.size(); Idx++)
+    {
+        const CookResult& Result = Results[Idx];
+        if (!Result.bSucceeded)
+        {
+            std::cerr << "cook: Failed '" << Files[Idx] << "'\n";
+            NumFailed++;
+            continue;
+        }
+        std::cout << Files[Idx] << ": " << Result.NumMeshes << " meshes, " << Result.NumEntries << " unique, "
+            << Result.NumBytes * MB << " MB in " << Result.Ms << " ms\n";
+        TotalBytes += Result.NumBytes;
+    }
+    std::cout << "cook: " << Files.size() - NumFailed << " of " << Files.size() << " scenes, " << TotalBytes * MB << " MB in " << TotalMs << " ms\n";
+
+    return NumFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,241 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+#include "ToolTiming.h"
+
+#include "RenderMesh.h"
+#include "MeshDeformer.h"
+
+// Std
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// USD
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/mesh.h"
+#include "pxr/usd/usdGeom/metrics.h"
+#include "pxr/usd/usdGeom/primvarsAPI.h"
+#include "pxr/usd/usdGeom/tokens.h"
+#include "pxr/usd/sdf/types.h"
+
+using namespace pxr;
+
+namespace
+{
+    using ToolTiming::Clock;
+    using ToolTiming::ToMs;
+
+    // A flat grid of 317x317 points, a little over 100k, whose points rise into a wave between time codes 0 and 10. Normals are static.
+    constexpr int GridQuads = 316;
+    constexpr double GridEndTime = 10.0;
+    constexpr float GridSize = 10.0f;
+    constexpr float PositionTolerance = 1e-4f;
+
+    float WaveHeight(float X, float Z) { return std::sin(X) * std::cos(Z); }
+
+    UsdPrim BuildWaveGrid(const UsdStageRefPtr& Stage)
+    {
+        UsdGeomSetStageUpAxis(Stage, UsdGeomTokens->y);
+        Stage->SetStartTimeCode(0.0);
+        Stage->SetEndTimeCode(GridEndTime);
+
+        constexpr int NumSide = GridQuads + 1;
+        VtArray<GfVec3f> Rest, Wave;
+        for (int Z = 0; Z < NumSide; Z++)
+        {
+            for (int X = 0; X < NumSide; X++)
+            {
+                const float PosX = X * GridSize / GridQuads;
+                const float PosZ = Z * GridSize / GridQuads;
+                Rest.push_back(GfVec3f(PosX, 0.0f, PosZ));
+                Wave.push_back(GfVec3f(PosX, WaveHeight(PosX, PosZ), PosZ));
+            }
+        }
+
+        VtIntArray Counts, Indices;
+        VtArray<GfVec3f> Normals;
+        VtArray<GfVec2f> UVs;
+        for (int Z = 0; Z < GridQuads; Z++)
+        {
+            for (int X = 0; X < GridQuads; X++)
+            {
+                Counts.push_back(4);
+                for (const int Corner : { Z * NumSide + X, Z * NumSide + X + 1, (Z + 1) * NumSide + X + 1, (Z + 1) * NumSide + X })
+                {
+                    Indices.push_back(Corner);
+                    Normals.push_back(GfVec3f(0.0f, 1.0f, 0.0f));
+                    UVs.push_back(GfVec2f(Rest[Corner][0] / GridSize, Rest[Corner][2] / GridSize));
+                }
+            }
+        }
+
+        UsdGeomMesh Mesh = UsdGeomMesh::Define(Stage, SdfPath("/WaveGrid"));
+        Mesh.CreateFaceVertexCountsAttr().Set(Counts);
+        Mesh.CreateFaceVertexIndicesAttr().Set(Indices);
+        Mesh.CreatePointsAttr().Set(Rest, UsdTimeCode(0.0));
+        Mesh.GetPointsAttr().Set(Wave, UsdTimeCode(GridEndTime));
+        Mesh.CreateNormalsAttr().Set(Normals);
+        Mesh.SetNormalsInterpolation(UsdGeomTokens->faceVarying);
+        UsdGeomPrimvarsAPI(Mesh).CreatePrimvar(TfToken("st"), SdfValueTypeNames->TexCoord2fArray, UsdGeomTokens->faceVarying).Set(UVs);
+        return Mesh.GetPrim();
+    }
+
+    // Plays the grid back and checks every written vertex against the interpolated wave.
+    bool RunSyntheticCheck()
+    {
+        UsdStageRefPtr Stage = UsdStage::CreateInMemory();
+        UsdPrim Prim = BuildWaveGrid(Stage);
+
+        MeshBuildSettings Settings;
+        RenderMesh Mesh(Settings);
+        Mesh.Load(Prim);
+        const std::shared_ptr<MeshData> Data = Mesh.GetMeshData();
+        if (!Data || !Data->Deformer)
+        {
+            std::cerr << "deform: The wave grid was not built as a deforming mesh.\n";
+            return false;
+        }
+
+        // Every corner of a point shares its normal and UV, so welding by source point leaves exactly one vertex per point.
+        MeshDeformer& Deformer = *Data->Deformer;
+        const size_t NumPoints = static_cast<size_t>(GridQuads + 1) * (GridQuads + 1);
+        bool bPassed = true;
+        if (Deformer.GetNumVertices() != NumPoints)
+        {
+            std::cerr << "deform: Welded to " << Deformer.GetNumVertices() << " vertices, expected " << NumPoints << ".\n";
+            bPassed = false;
+        }
+
+        std::vector<Vertex> Vertices(Deformer.GetNumVertices());
+        size_t NumFrames = 0;
+        size_t NumBadVertices = 0;
+        size_t NumUnchangedFrames = 0;
+        double SampleMs = 0.0;
+        double WriteMs = 0.0;
+        for (double Time = 0.0; Time <= GridEndTime; Time += 0.25)
+        {
+            const Clock::time_point StartTime = Clock::now();
+            const bool bChanged = Deformer.Sample(UsdTimeCode(Time));
+            const Clock::time_point SampleTime = Clock::now();
+            DeformedBounds Bounds;
+            Deformer.WriteVertices(Vertices.data(), Bounds);
+            const Clock::time_point WriteTime = Clock::now();
+
+            SampleMs += ToMs(SampleTime - StartTime);
+            WriteMs += ToMs(WriteTime - SampleTime);
+            NumUnchangedFrames += bChanged ? 0 : 1;
+            NumFrames++;
+
+            const float Weight = static_cast<float>(Time / GridEndTime);
+            for (const Vertex& Vtx : Vertices)
+            {
+                const float Expected = WaveHeight(Vtx.Position.x, Vtx.Position.z) * Weight;
+                const bool bBadPosition = std::abs(Vtx.Position.y - Expected) > PositionTolerance;
+                const bool bBadNormal = Vtx.Normals.x != 0.0f || Vtx.Normals.y != 1.0f || Vtx.Normals.z != 0.0f;
+                const bool bOutside = Vtx.Position.y < Bounds.Center.y - Bounds.Extents.y || Vtx.Position.y > Bounds.Center.y + Bounds.Extents.y;
+                NumBadVertices += (bBadPosition || bBadNormal || bOutside) ? 1 : 0;
+            }
+        }
+
+        // Past the last time sample the points are held, the sample there was already read.
+        const bool bHeldSkipped = !Deformer.Sample(UsdTimeCode(GridEndTime + 5.0));
+
+        std::cout << "Synthetic wave grid: " << Deformer.GetNumVertices() << " vertices, " << Data->GetNumIndices() / 3 << " triangles, "
+            << NumFrames << " frames, " << Deformer.GetVertexBufferSize() / (1024.0 * 1024.0) << " MB per frame\n"
+            << "    sample " << SampleMs / NumFrames << " ms, write " << WriteMs / NumFrames << " ms per frame, "
+            << NumBadVertices << " vertices off the wave, " << NumUnchangedFrames << " unchanged frames\n";
+
+        if (NumBadVertices > 0 || NumUnchangedFrames > 0)
+        {
+            std::cerr << "deform: Written vertices do not follow the time samples.\n";
+            bPassed = false;
+        }
+        if (!bHeldSkipped)
+        {
+            std::cerr << "deform: A held sample was read again.\n";
+            bPassed = false;
+        }
+        return bPassed;
+    }
+
+    // Plays every deforming mesh of a scene over its time range, one frame per time code.
+    bool MeasureScene(const std::string& Path)
+    {
+        UsdStageRefPtr Stage = UsdStage::Open(Path);
+        if (!Stage) { return false; }
+
+        MeshBuildSettings Settings;
+        Settings.bIsYUp = UsdGeomGetStageUpAxis(Stage) == UsdGeomTokens->y;
+
+        std::vector<std::shared_ptr<MeshData>> Deforming;
+        size_t NumMeshes = 0;
+        size_t NumVertices = 0;
+        for (UsdPrim Prim : ToolScene::GatherMeshPrims(Stage))
+        {
+            RenderMesh Mesh(Settings);
+            Mesh.Load(Prim);
+            const std::shared_ptr<MeshData> Data = Mesh.GetMeshData();
+            NumMeshes++;
+            if (!Data || !Data->Deformer) { continue; }
+
+            Deforming.push_back(Data);
+            NumVertices += Data->Deformer->GetNumVertices();
+        }
+
+        std::cout << Path << ": " << Deforming.size() << " of " << NumMeshes << " meshes deforming, " << NumVertices << " vertices\n";
+        if (Deforming.empty()) { return true; }
+
+        // One buffer as large as the largest mesh, like a ring slot reused every frame.
+        size_t MaxVertices = 0;
+        for (const std::shared_ptr<MeshData>& Data : Deforming) { MaxVertices = std::max(MaxVertices, Data->Deformer->GetNumVertices()); }
+        std::vector<Vertex> Vertices(MaxVertices);
+
+        const double StartCode = Stage->GetStartTimeCode();
+        const double EndCode = std::max(Stage->GetEndTimeCode(), StartCode);
+        size_t NumFrames = 0;
+        size_t NumWritten = 0;
+        double SampleMs = 0.0;
+        double WriteMs = 0.0;
+        for (double Time = StartCode; Time <= EndCode; Time += 1.0)
+        {
+            for (const std::shared_ptr<MeshData>& Data : Deforming)
+            {
+                const Clock::time_point StartTime = Clock::now();
+                const bool bChanged = Data->Deformer->Sample(UsdTimeCode(Time));
+                const Clock::time_point SampleTime = Clock::now();
+                SampleMs += ToMs(SampleTime - StartTime);
+                if (!bChanged && NumFrames > 0) { continue; }
+
+                DeformedBounds Bounds;
+                Data->Deformer->WriteVertices(Vertices.data(), Bounds);
+                WriteMs += ToMs(Clock::now() - SampleTime);
+                NumWritten++;
+            }
+            NumFrames++;
+        }
+
+        size_t NumRejected = 0;
+        for (const std::shared_ptr<MeshData>& Data : Deforming) { NumRejected += Data->Deformer->GetNumRejectedSamples(); }
+        std::cout << "    " << NumFrames << " frames, " << NumWritten << " mesh writes, sample " << SampleMs / NumFrames << " ms, write "
+            << WriteMs / NumFrames << " ms per frame, " << NumRejected << " samples rejected\n";
+        return true;
+    }
+}
+
+int RunDeformCommand(const std::vector<std::string>& Args)
+{
+    bool bPassed = RunSyntheticCheck();
+
+    size_t NumFailed = 0;
+    for (const std::string& File : ToolScene::CollectUsdFiles(Args, "deform"))
+    {
+        if (!MeasureScene(File))
+        {
+            std::cerr << "deform: Failed '" << File << "'\n";
+            NumFailed++;
+        }
+    }
+
+    std::cout << "deform: " << (bPassed ? "Deforming playback matches the time samples.\n" : "Deforming playback check failed!\n");
+    return bPassed && NumFailed == 0 ? 0 : 1;
+}
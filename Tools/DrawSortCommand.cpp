@@ -0,0 +1,151 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+#include "ToolTiming.h"
+
+#include "DrawSorting.h"
+
+// Std
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr size_t DefaultPacketCounts[] = { 100000, 300000, 1000000 };
+    constexpr size_t NumTimedRuns = 7;
+
+    using ToolTiming::Clock;
+    using ToolTiming::ToMs;
+
+    // How varied the keys are: a scene like the renderer draws today, and one with several passes, many PSOs and materials.
+    struct KeyMix
+    {
+        const char* Name;
+        uint32_t NumPasses;
+        uint32_t NumPipelines;
+        uint32_t NumMaterials;
+    };
+    constexpr KeyMix KeyMixes[] = {
+        { "renderer", 1, 3, 4 },
+        { "wide", 3, 64, 4096 },
+    };
+
+    std::vector<DrawPacket> MakePackets(size_t Count, const KeyMix& Mix, std::mt19937& Random)
+    {
+        std::uniform_int_distribution<uint32_t> Pass(0, Mix.NumPasses - 1);
+        std::uniform_int_distribution<uint32_t> Pipeline(0, Mix.NumPipelines - 1);
+        std::uniform_int_distribution<uint32_t> Material(0, Mix.NumMaterials - 1);
+        std::lognormal_distribution<float> Depth(3.0f, 1.5f);
+
+        std::vector<DrawPacket> Packets(Count);
+        for (size_t Idx = 0; Idx < Count; Idx++)
+        {
+            Packets[Idx].Key = DrawSorting::MakeKey(static_cast<DrawPass>(Pass(Random)), Pipeline(Random), Material(Random), Depth(Random));
+            Packets[Idx].Mesh = static_cast<uint32_t>(Idx);
+        }
+        return Packets;
+    }
+
+    // Median time of sorting a fresh copy of the packets, the copy is not timed. The sorted copy of the last run is kept.
+    template <typename Func>
+    double MedianSortMs(const std::vector<DrawPacket>& Packets, std::vector<DrawPacket>& OutSorted, const Func& Sort)
+    {
+        std::vector<double> Times;
+        for (size_t Run = 0; Run < NumTimedRuns; Run++)
+        {
+            OutSorted = Packets;
+            const auto Start = Clock::now();
+            Sort(OutSorted);
+            Times.push_back(ToMs(Clock::now() - Start));
+        }
+        std::sort(Times.begin(), Times.end());
+        return Times[Times.size() / 2];
+    }
+
+    // The key fields must order like the draws should be recorded.
+    bool CheckKeys()
+    {
+        bool bPassed = true;
+        const auto Expect = [&bPassed](bool bCondition, const char* What)
+        {
+            if (!bCondition)
+            {
+                std::cerr << "drawsort: " << What << "\n";
+                bPassed = false;
+            }
+        };
+
+        const float Depths[] = { -10.0f, -0.001f, 0.0f, 0.001f, 0.5f, 1.0f, 1.0001f, 10.0f, 1000.0f, 1e6f, 1e30f };
+        for (size_t Idx = 1; Idx < std::size(Depths); Idx++)
+        {
+            Expect(DrawSorting::MakeKey(DrawPass::Opaque, 0, 0, Depths[Idx - 1]) < DrawSorting::MakeKey(DrawPass::Opaque, 0, 0, Depths[Idx]),
+                "Nearer depths do not sort first.");
+        }
+        Expect(DrawSorting::MakeKey(DrawPass::Opaque, 0, 1, 0.0f) > DrawSorting::MakeKey(DrawPass::Opaque, 0, 0, 1e30f), "Depth outranks the material.");
+        Expect(DrawSorting::MakeKey(DrawPass::Opaque, 1, 0, 0.0f) > DrawSorting::MakeKey(DrawPass::Opaque, 0, 0xFFFFFFFFu, 1e30f), "Material outranks the pipeline.");
+        Expect(DrawSorting::MakeKey(static_cast<DrawPass>(1), 0, 0, 0.0f) > DrawSorting::MakeKey(DrawPass::Opaque, 0xFFFFFFFFu, 0, 1e30f), "Pipeline outranks the pass.");
+        for (uint32_t Pipeline = 0; Pipeline < (1u << DrawSorting::PipelineBits); Pipeline++)
+        {
+            if (DrawSorting::GetPipeline(DrawSorting::MakeKey(DrawPass::Opaque, Pipeline, 0xFFFFFFFFu, -1.0f)) != Pipeline)
+            {
+                Expect(false, "The pipeline does not round trip through the key.");
+                break;
+            }
+        }
+        return bPassed;
+    }
+
+    bool RunBenchmark(size_t NumPackets, const KeyMix& Mix, DrawPacketSorter& Sorter)
+    {
+        std::mt19937 Random(static_cast<uint32_t>(NumPackets));
+        const std::vector<DrawPacket> Packets = MakePackets(NumPackets, Mix, Random);
+
+        std::vector<DrawPacket> RadixSorted;
+        std::vector<DrawPacket> StdSorted;
+        Sorter.Sort(RadixSorted = Packets); // Sizes the scratch memory like the frames before would have.
+        const double RadixMs = MedianSortMs(Packets, RadixSorted, [&Sorter](std::vector<DrawPacket>& Sorted) { Sorter.Sort(Sorted); });
+        const double StdMs = MedianSortMs(Packets, StdSorted, [](std::vector<DrawPacket>& Sorted)
+        {
+            std::sort(Sorted.begin(), Sorted.end(), [](const DrawPacket& A, const DrawPacket& B) { return A.Key < B.Key; });
+        });
+
+        // Same keys as std::sort, and packets with equal keys still in the order they were added.
+        bool bPassed = true;
+        for (size_t Idx = 0; Idx < NumPackets; Idx++)
+        {
+            if (RadixSorted[Idx].Key != StdSorted[Idx].Key
+                || (Idx > 0 && RadixSorted[Idx - 1].Key == RadixSorted[Idx].Key && RadixSorted[Idx - 1].Mesh > RadixSorted[Idx].Mesh))
+            {
+                std::cerr << "drawsort: " << Mix.Name << " packets out of order at " << Idx << ".\n";
+                bPassed = false;
+                break;
+            }
+        }
+
+        std::cout << NumPackets << " " << Mix.Name << " packets: radix " << RadixMs << " ms (" << Sorter.GetNumPasses() << " passes, "
+            << NumPackets / RadixMs / 1000.0 << " M packets/s), std::sort " << StdMs << " ms, " << StdMs / RadixMs << "x\n";
+        return bPassed;
+    }
+}
+
+int RunDrawSortCommand(const std::vector<std::string>& Args)
+{
+    std::vector<size_t> Counts;
+    if (!ToolScene::ParseCounts(Args, DefaultPacketCounts, "drawsort", "packet", Counts)) { return 1; }
+
+    bool bPassed = CheckKeys();
+    DrawPacketSorter Sorter;
+    for (const size_t Count : Counts)
+    {
+        for (const KeyMix& Mix : KeyMixes)
+        {
+            bPassed &= RunBenchmark(Count, Mix, Sorter);
+        }
+    }
+
+    std::cout << "drawsort: " << (bPassed ? "Radix sorted packets match std::sort and keep their order on equal keys.\n" : "Draw sort check failed!\n");
+    return bPassed ? 0 : 1;
+}
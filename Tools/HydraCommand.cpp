@@ -0,0 +1,257 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+#include "ToolTiming.h"
+
+#include "HydraScene.h"
+#include "RenderMesh.h"
+
+// Std
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+// USD
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/mesh.h"
+#include "pxr/usd/usdGeom/metrics.h"
+#include "pxr/usd/usdGeom/pointInstancer.h"
+#include "pxr/usd/usdGeom/tokens.h"
+#include "pxr/usd/usdGeom/xform.h"
+#include "pxr/usd/usdGeom/xformCommonAPI.h"
+
+using namespace pxr;
+
+namespace
+{
+    using ToolTiming::Clock;
+    using ToolTiming::ToMs;
+
+    // Frames synced when a scene has a time range, and meshes nudged one at a time when it has none.
+    constexpr size_t MaxPlaybackFrames = 48;
+    constexpr size_t MaxEditedMeshes = 8;
+
+    // A translated mesh, a prototype drawn by two native instances and a translated point instancer drawing a quad three times.
+    UsdStageRefPtr BuildInstancingStage()
+    {
+        UsdStageRefPtr Stage = UsdStage::CreateInMemory();
+        UsdGeomSetStageUpAxis(Stage, UsdGeomTokens->y);
+
+        UsdGeomXform::Define(Stage, SdfPath("/World"));
+        UsdGeomXformCommonAPI(ToolScene::DefineQuad(Stage, SdfPath("/World/Quad"), true)).SetTranslate(GfVec3d(1.0, 2.0, 3.0));
+
+        Stage->CreateClassPrim(SdfPath("/Prototypes"));
+        ToolScene::DefineQuad(Stage, SdfPath("/Prototypes/Box/Mesh"), true);
+        for (const double Offset : { 10.0, 20.0 })
+        {
+            const UsdGeomXform Instance = UsdGeomXform::Define(Stage, SdfPath("/World/Instance" + std::to_string(static_cast<int>(Offset))));
+            UsdGeomXformCommonAPI(Instance).SetTranslate(GfVec3d(Offset, 0.0, 0.0));
+            Instance.GetPrim().GetReferences().AddInternalReference(SdfPath("/Prototypes/Box"));
+            Instance.GetPrim().SetInstanceable(true);
+        }
+
+        UsdGeomPointInstancer Instancer = UsdGeomPointInstancer::Define(Stage, SdfPath("/World/Instancer"));
+        UsdGeomXformCommonAPI(Instancer).SetTranslate(GfVec3d(0.0, 5.0, 0.0));
+        ToolScene::DefineQuad(Stage, SdfPath("/World/Instancer/Protos/Box"), true);
+        Instancer.CreatePrototypesRel().AddTarget(SdfPath("/World/Instancer/Protos/Box"));
+        Instancer.CreateProtoIndicesAttr().Set(VtIntArray{ 0, 0, 0 });
+        Instancer.CreatePositionsAttr().Set(VtArray<GfVec3f>{ GfVec3f(0, 0, 0), GfVec3f(2, 0, 0), GfVec3f(4, 0, 0) });
+        return Stage;
+    }
+
+    // Translations of every drawn instance, sorted so they compare regardless of rprim order.
+    std::vector<GfVec3d> GatherTranslations(const HydraScene& Scene)
+    {
+        std::vector<GfVec3d> Translations;
+        for (const HydraMesh* Mesh : Scene.GetMeshes())
+        {
+            if (!Mesh->GetRenderMesh()) { continue; }
+            for (const GfMatrix4d& World : Mesh->GetWorldTransforms()) { Translations.push_back(World.ExtractTranslation()); }
+        }
+        std::sort(Translations.begin(), Translations.end(), [](const GfVec3d& A, const GfVec3d& B)
+            {
+                return A[0] != B[0] ? A[0] < B[0] : A[1] != B[1] ? A[1] < B[1] : A[2] < B[2];
+            });
+        return Translations;
+    }
+
+    bool CheckTranslations(const char* Name, const HydraScene& Scene, std::vector<GfVec3d> Expected)
+    {
+        const std::vector<GfVec3d> Translations = GatherTranslations(Scene);
+        std::sort(Expected.begin(), Expected.end(), [](const GfVec3d& A, const GfVec3d& B)
+            {
+                return A[0] != B[0] ? A[0] < B[0] : A[1] != B[1] ? A[1] < B[1] : A[2] < B[2];
+            });
+        const bool bMatches = Translations.size() == Expected.size() && std::equal(Translations.begin(), Translations.end(), Expected.begin(),
+            [](const GfVec3d& A, const GfVec3d& B) { return (A - B).GetLength() < 1e-5; });
+
+        std::cout << "    " << Name << ": " << Translations.size() << " instances";
+        if (!bMatches)
+        {
+            std::cout << "  <- expected";
+            for (const GfVec3d& Translation : Expected) { std::cout << " (" << Translation[0] << ", " << Translation[1] << ", " << Translation[2] << ")"; }
+        }
+        std::cout << "\n";
+        return bMatches;
+    }
+
+    // Syncs the synthetic stage through Hydra and checks every instance lands where the USD traversal puts it, then that edits
+    // only change what they touched.
+    bool RunSyntheticCheck()
+    {
+        const UsdStageRefPtr Stage = BuildInstancingStage();
+        MeshBuildSettings Settings;
+        HydraScene Scene(Stage, Settings, nullptr);
+        Scene.Populate();
+        Scene.Sync(UsdTimeCode::Default());
+
+        bool bPassed = CheckTranslations("initial sync", Scene, { GfVec3d(1, 2, 3), GfVec3d(10, 0, 0), GfVec3d(20, 0, 0),
+            GfVec3d(0, 5, 0), GfVec3d(2, 5, 0), GfVec3d(4, 5, 0) });
+
+        // Moving instances rewrites transforms of the same number of instances and rebuilds nothing.
+        UsdGeomPointInstancer(Stage->GetPrimAtPath(SdfPath("/World/Instancer"))).GetPositionsAttr()
+            .Set(VtArray<GfVec3f>{ GfVec3f(0, 1, 0), GfVec3f(2, 1, 0), GfVec3f(4, 1, 0) });
+        HydraSyncResult Result = Scene.Sync(UsdTimeCode::Default());
+        const bool bOnlyMoved = !Result.bMeshesChanged && !Result.Changed.empty() && std::all_of(Result.Changed.begin(), Result.Changed.end(),
+            [](const HydraMeshChange& Change) { return Change.Changes == HydraMesh::ChangedTransforms; });
+        std::cout << "    move instances: " << Result.Changed.size() << " rprims changed" << (bOnlyMoved ? "\n" : "  <- expected only moved rprims\n");
+        bPassed = CheckTranslations("moved instances", Scene, { GfVec3d(1, 2, 3), GfVec3d(10, 0, 0), GfVec3d(20, 0, 0),
+            GfVec3d(0, 6, 0), GfVec3d(2, 6, 0), GfVec3d(4, 6, 0) }) && bOnlyMoved && bPassed;
+
+        // Scaling the points rebuilds the one mesh and keeps its triangles.
+        UsdGeomMesh(Stage->GetPrimAtPath(SdfPath("/World/Quad"))).GetPointsAttr()
+            .Set(VtArray<GfVec3f>{ GfVec3f(0, 0, 0), GfVec3f(2, 0, 0), GfVec3f(2, 2, 0), GfVec3f(0, 2, 0) });
+        Result = Scene.Sync(UsdTimeCode::Default());
+        const bool bRebuilt = !Result.bMeshesChanged && Result.Changed.size() == 1 && Result.Changed[0].Changes == HydraMesh::ChangedGeometry;
+        std::cout << "    move points: " << Result.Changed.size() << " rprims changed" << (bRebuilt ? "\n" : "  <- expected one mesh rebuilt with the same indices\n");
+        bPassed = bPassed && bRebuilt;
+
+        // Removing an instance leaves the prototype with fewer instances.
+        Stage->RemovePrim(SdfPath("/World/Instance20"));
+        Result = Scene.Sync(UsdTimeCode::Default());
+        bPassed = CheckTranslations("remove an instance", Scene, { GfVec3d(1, 2, 3), GfVec3d(10, 0, 0), GfVec3d(0, 6, 0), GfVec3d(2, 6, 0),
+            GfVec3d(4, 6, 0) }) && bPassed;
+        return bPassed;
+    }
+
+    // Loads the scene through the USD traversal and through Hydra, then times Hydra syncing a playback or a few edits.
+    bool MeasureScene(const std::string& Path)
+    {
+        // Traversal: gather the meshes and their instances, then build every mesh on all cores like USDScene.
+        const Clock::time_point TraversalStart = Clock::now();
+        UsdStageRefPtr Stage = UsdStage::Open(Path);
+        if (!Stage) { return false; }
+
+        MeshBuildSettings Settings;
+        Settings.bIsYUp = UsdGeomGetStageUpAxis(Stage) == UsdGeomTokens->y;
+
+        std::vector<UsdPrim> Prims;
+        std::vector<ToolMeshInstance> Instances;
+        ToolScene::GatherMeshInstances(Stage, Prims, Instances);
+        std::vector<std::shared_ptr<MeshData>> Built(Prims.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, Prims.size()), [&](const tbb::blocked_range<size_t>& Range)
+            {
+                for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+                {
+                    RenderMesh Mesh(Settings);
+                    Mesh.Load(Prims[Idx]);
+                    Built[Idx] = Mesh.GetMeshData();
+                }
+            });
+        const double TraversalMs = ToMs(Clock::now() - TraversalStart);
+        const size_t NumTraversalMeshes = static_cast<size_t>(std::count_if(Built.begin(), Built.end(), [](const auto& Data) { return Data != nullptr; }));
+        Built.clear();
+        Prims.clear();
+        Stage.Reset();
+
+        // Hydra: a fresh stage so both loads open it cold.
+        const Clock::time_point HydraStart = Clock::now();
+        Stage = UsdStage::Open(Path);
+        if (!Stage) { return false; }
+
+        HydraScene Scene(Stage, Settings, nullptr);
+        Scene.Populate();
+        const double PopulateMs = ToMs(Clock::now() - HydraStart);
+        Scene.Sync(Stage->HasAuthoredTimeCodeRange() ? UsdTimeCode(Stage->GetStartTimeCode()) : UsdTimeCode::Default());
+        const double HydraMs = ToMs(Clock::now() - HydraStart);
+
+        size_t NumHydraMeshes = 0;
+        size_t NumHydraInstances = 0;
+        for (const HydraMesh* Mesh : Scene.GetMeshes())
+        {
+            if (!Mesh->GetRenderMesh()) { continue; }
+            NumHydraMeshes++;
+            NumHydraInstances += Mesh->GetWorldTransforms().size();
+        }
+
+        std::cout << Path << ":\n";
+        std::cout << "    Traversal: " << NumTraversalMeshes << " meshes, " << Instances.size() << " instances (point instancers not counted) in "
+            << TraversalMs << " ms\n";
+        std::cout << "    Hydra:     " << NumHydraMeshes << " meshes, " << NumHydraInstances << " instances from " << Scene.GetNumRprims() << " rprims in "
+            << HydraMs << " ms (" << PopulateMs << " ms populate)\n";
+
+        // Update throughput: a playback over the time range, or a handful of point edits on a static scene.
+        size_t NumSyncs = 0;
+        size_t NumChanged = 0;
+        double SyncMs = 0.0;
+        if (Stage->HasAuthoredTimeCodeRange())
+        {
+            const double Start = Stage->GetStartTimeCode();
+            const double End = Stage->GetEndTimeCode();
+            const size_t NumFrames = std::min(MaxPlaybackFrames, static_cast<size_t>(End - Start) + 1);
+            for (size_t Frame = 1; Frame < NumFrames; Frame++)
+            {
+                const HydraSyncResult Result = Scene.Sync(UsdTimeCode(Start + static_cast<double>(Frame)));
+                NumChanged += Result.Changed.size();
+                SyncMs += Result.SyncMs;
+                NumSyncs++;
+            }
+            std::cout << "    Playback:  ";
+        }
+        else
+        {
+            for (const UsdPrim& Prim : ToolScene::GatherMeshPrims(Stage))
+            {
+                if (NumSyncs == MaxEditedMeshes) { break; }
+                if (Prim.IsInPrototype()) { continue; }
+
+                const UsdAttribute Points = UsdGeomMesh(Prim).GetPointsAttr();
+                VtArray<GfVec3f> Values;
+                if (!Points.Get(&Values) || Values.empty()) { continue; }
+                for (GfVec3f& Point : Values) { Point *= 1.01f; }
+                Points.Set(Values);
+
+                const HydraSyncResult Result = Scene.Sync(UsdTimeCode::Default());
+                NumChanged += Result.Changed.size();
+                SyncMs += Result.SyncMs;
+                NumSyncs++;
+            }
+            std::cout << "    Edits:     ";
+        }
+        std::cout << NumSyncs << " syncs, " << (NumSyncs > 0 ? SyncMs / NumSyncs : 0.0) << " ms and "
+            << (NumSyncs > 0 ? static_cast<double>(NumChanged) / NumSyncs : 0.0) << " changed rprims each\n";
+        return true;
+    }
+}
+
+int RunHydraCommand(const std::vector<std::string>& Args)
+{
+    std::cout << "Synthetic Hydra sync:\n";
+    const bool bPassed = RunSyntheticCheck();
+
+    size_t NumFailed = 0;
+    for (const std::string& File : ToolScene::CollectUsdFiles(Args, "hydra"))
+    {
+        if (!MeasureScene(File))
+        {
+            std::cerr << "hydra: Failed '" << File << "'\n";
+            NumFailed++;
+        }
+    }
+
+    std::cout << "hydra: " << (bPassed ? "Hydra instances and changes match the stage.\n" : "Hydra sync check failed!\n");
+    return bPassed && NumFailed == 0 ? 0 : 1;
+}
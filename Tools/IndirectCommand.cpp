@@ -0,0 +1,183 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+#include "ToolTiming.h"
+
+#include "DrawSorting.h"
+#include "IndirectDraws.h"
+
+// Std
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr size_t DefaultMeshCounts[] = { 10000, 100000, 1000000 };
+    constexpr size_t NumTimedRuns = 7;
+    constexpr uint32_t NumPipelines = 3; // One per vertex format.
+    constexpr uint32_t NumMaterials = 4; // Deform ring or arena, 16 or 32 bit indices.
+
+    using ToolTiming::Clock;
+    using ToolTiming::ToMs;
+
+    // A frame's draws: every mesh's command, and packets for the visible ones. A few meshes draw nothing, like a LOD without
+    // triangles would, and must be compacted away.
+    struct SyntheticFrame
+    {
+        std::vector<IndirectDrawCommand> MeshCommands;
+        std::vector<DrawPacket> Packets;
+    };
+
+    SyntheticFrame MakeFrame(size_t NumMeshes, std::mt19937& Random)
+    {
+        std::uniform_int_distribution<uint32_t> Pipeline(0, NumPipelines - 1);
+        std::uniform_int_distribution<uint32_t> Material(0, NumMaterials - 1);
+        std::uniform_int_distribution<uint32_t> Indices(1, 30000);
+        std::uniform_int_distribution<uint32_t> Instances(1, 8);
+        std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+        std::lognormal_distribution<float> Depth(3.0f, 1.5f);
+
+        SyntheticFrame Frame;
+        Frame.MeshCommands.resize(NumMeshes);
+        uint32_t FirstIndex = 0;
+        int32_t BaseVertex = 0;
+        uint32_t FirstInstance = 0;
+        for (uint32_t Mesh = 0; Mesh < static_cast<uint32_t>(NumMeshes); Mesh++)
+        {
+            IndirectDrawCommand& Command = Frame.MeshCommands[Mesh];
+            Command.Dequantisation.Scale = DirectX::XMFLOAT4(Unit(Random), Unit(Random), Unit(Random), 0.0f);
+            Command.Dequantisation.Offset = DirectX::XMFLOAT4(Unit(Random), Unit(Random), Unit(Random), 0.0f);
+            Command.IndexCountPerInstance = Unit(Random) < 0.02f ? 0 : Indices(Random) * 3;
+            Command.InstanceCount = Unit(Random) < 0.02f ? 0 : Instances(Random);
+            Command.StartIndexLocation = FirstIndex;
+            Command.BaseVertexLocation = BaseVertex;
+            Command.StartInstanceLocation = FirstInstance;
+            FirstIndex += Command.IndexCountPerInstance;
+            BaseVertex += static_cast<int32_t>(Command.IndexCountPerInstance / 2);
+            FirstInstance += Command.InstanceCount;
+
+            // About half the scene in view.
+            if (Unit(Random) < 0.5f)
+            {
+                const uint64_t Key = DrawSorting::MakeKey(DrawPass::Opaque, Pipeline(Random), Material(Random), Depth(Random));
+                Frame.Packets.push_back(DrawPacket{ Key, Mesh });
+            }
+        }
+        return Frame;
+    }
+
+    // The commands must be the direct path's draws in packet order, each batch a run of packets with the same state.
+    bool CheckDrawList(const SyntheticFrame& Frame, const IndirectDrawList& Draws)
+    {
+        size_t NumCompacted = 0;
+        size_t Command = 0;
+        size_t Batch = 0;
+        for (const DrawPacket& Packet : Frame.Packets)
+        {
+            const IndirectDrawCommand& Expected = Frame.MeshCommands[Packet.Mesh];
+            if (Expected.IndexCountPerInstance == 0 || Expected.InstanceCount == 0)
+            {
+                NumCompacted++;
+                continue;
+            }
+            if (Command >= Draws.Commands.size() || std::memcmp(&Draws.Commands[Command], &Expected, sizeof(IndirectDrawCommand)) != 0)
+            {
+                std::cerr << "indirect: Command " << Command << " is not the draw of mesh " << Packet.Mesh << ".\n";
+                return false;
+            }
+
+            // Moves on to the next batch exactly where the previous one ends.
+            while (Batch < Draws.Batches.size() && Command >= Draws.Batches[Batch].FirstCommand + Draws.Batches[Batch].NumCommands) { Batch++; }
+            if (Batch >= Draws.Batches.size() || Draws.Batches[Batch].State != DrawSorting::GetState(Packet.Key)
+                || (Command == Draws.Batches[Batch].FirstCommand && Draws.Batches[Batch].Mesh != Packet.Mesh))
+            {
+                std::cerr << "indirect: Command " << Command << " is in the wrong batch.\n";
+                return false;
+            }
+            Command++;
+        }
+
+        uint32_t BatchEnd = 0;
+        for (size_t Idx = 0; Idx < Draws.Batches.size(); Idx++)
+        {
+            const IndirectDrawBatch& Current = Draws.Batches[Idx];
+            if (Current.FirstCommand != BatchEnd || Current.NumCommands == 0 || (Idx > 0 && Draws.Batches[Idx - 1].State == Current.State))
+            {
+                std::cerr << "indirect: Batch " << Idx << " does not follow the previous one or could have been merged with it.\n";
+                return false;
+            }
+            BatchEnd += Current.NumCommands;
+        }
+        if (Command != Draws.Commands.size() || BatchEnd != Draws.Commands.size() || NumCompacted != Draws.NumCompacted)
+        {
+            std::cerr << "indirect: " << Draws.Commands.size() << " commands and " << Draws.NumCompacted << " compacted, expected " << Command
+                << " and " << NumCompacted << ".\n";
+            return false;
+        }
+        return true;
+    }
+
+    // The argument buffer is read as root constants followed by D3D12_DRAW_INDEXED_ARGUMENTS.
+    bool CheckLayout()
+    {
+        const size_t Arguments = sizeof(PositionDequantisation);
+        const bool bMatches = offsetof(IndirectDrawCommand, Dequantisation) == 0
+            && offsetof(IndirectDrawCommand, IndexCountPerInstance) == Arguments
+            && offsetof(IndirectDrawCommand, InstanceCount) == Arguments + 4
+            && offsetof(IndirectDrawCommand, StartIndexLocation) == Arguments + 8
+            && offsetof(IndirectDrawCommand, BaseVertexLocation) == Arguments + 12
+            && offsetof(IndirectDrawCommand, StartInstanceLocation) == Arguments + 16
+            && sizeof(IndirectDrawCommand) % 4 == 0;
+        if (!bMatches) { std::cerr << "indirect: IndirectDrawCommand does not match the command signature.\n"; }
+        return bMatches;
+    }
+
+    bool RunFrame(size_t NumMeshes)
+    {
+        std::mt19937 Random(static_cast<uint32_t>(NumMeshes));
+        SyntheticFrame Frame = MakeFrame(NumMeshes, Random);
+        IndirectDrawList Draws;
+
+        // Mesh order first, as drawn with sorting off, then sorted like the renderer does.
+        IndirectDraws::Build(Frame.MeshCommands, Frame.Packets, Draws);
+        const size_t NumUnsortedBatches = Draws.Batches.size();
+        bool bPassed = CheckDrawList(Frame, Draws);
+
+        DrawPacketSorter Sorter;
+        Sorter.Sort(Frame.Packets);
+        std::vector<double> Times;
+        for (size_t Run = 0; Run < NumTimedRuns; Run++)
+        {
+            const auto Start = Clock::now();
+            IndirectDraws::Build(Frame.MeshCommands, Frame.Packets, Draws);
+            Times.push_back(ToMs(Clock::now() - Start));
+        }
+        std::sort(Times.begin(), Times.end());
+        const double BuildMs = Times[Times.size() / 2];
+        bPassed &= CheckDrawList(Frame, Draws);
+
+        std::cout << NumMeshes << " meshes, " << Frame.Packets.size() << " packets: " << Draws.Commands.size() << " commands ("
+            << Draws.NumCompacted << " compacted) in " << Draws.Batches.size() << " batches, " << NumUnsortedBatches << " unsorted, built in "
+            << BuildMs << " ms (" << Draws.Commands.size() * sizeof(IndirectDrawCommand) / (1024.0 * 1024.0) << " MB)\n";
+        return bPassed;
+    }
+}
+
+int RunIndirectCommand(const std::vector<std::string>& Args)
+{
+    std::vector<size_t> Counts;
+    if (!ToolScene::ParseCounts(Args, DefaultMeshCounts, "indirect", "mesh", Counts)) { return 1; }
+
+    bool bPassed = CheckLayout();
+    for (const size_t Count : Counts)
+    {
+        bPassed &= RunFrame(Count);
+    }
+
+    std::cout << "indirect: " << (bPassed ? "Argument buffers match the direct draws.\n" : "Indirect draw check failed!\n");
+    return bPassed ? 0 : 1;
+}
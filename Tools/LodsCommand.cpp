@@ -0,0 +1,150 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+
+#include "RenderMesh.h"
+
+// Std
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+// USD
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/metrics.h"
+#include "pxr/usd/usdGeom/tokens.h"
+
+using namespace pxr;
+
+namespace
+{
+    struct LodChain
+    {
+        std::string Path;
+        float Radius = 0.0f;
+        std::vector<MeshLod> Lods;
+    };
+
+    // Triangles per level summed over meshes. Meshes with fewer levels count their coarsest one for the rest.
+    struct LodTotals
+    {
+        size_t NumMeshes = 0;
+        size_t NumSimplifiedMeshes = 0;
+        size_t NumTriangles[MaxMeshLods] = {};
+        float MaxRelativeError[MaxMeshLods] = {};
+        double BuildMs = 0.0;
+
+        void Add(const LodChain& Chain)
+        {
+            NumMeshes++;
+            NumSimplifiedMeshes += Chain.Lods.size() > 1 ? 1 : 0;
+            for (size_t Level = 0; Level < MaxMeshLods; Level++)
+            {
+                const MeshLod& Lod = Chain.Lods[std::min(Level, Chain.Lods.size() - 1)];
+                NumTriangles[Level] += Lod.NumIndices / 3;
+                if (Chain.Radius > 0.0f) { MaxRelativeError[Level] = std::max(MaxRelativeError[Level], Lod.Error / Chain.Radius); }
+            }
+        }
+
+        void Print(const std::string& Label) const
+        {
+            if (NumTriangles[0] == 0) { return; }
+
+            std::cout << Label << ": " << NumMeshes << " meshes, " << NumSimplifiedMeshes << " with LODs, built in " << BuildMs << " ms\n";
+            for (size_t Level = 0; Level < MaxMeshLods; Level++)
+            {
+                std::cout << "    LOD" << Level << ": " << NumTriangles[Level] << " triangles (" << 100.0 * NumTriangles[Level] / NumTriangles[0]
+                    << "%), max error " << 100.0f * MaxRelativeError[Level] << "% of the mesh radius\n";
+            }
+        }
+    };
+
+    // Builds every mesh with LODs and without the cooked cache.
+    bool BuildScene(const std::string& Path, std::vector<LodChain>& OutChains, double& OutBuildMs)
+    {
+        UsdStageRefPtr Stage = UsdStage::Open(Path);
+        if (!Stage) { return false; }
+
+        MeshBuildSettings Settings;
+        Settings.bIsYUp = UsdGeomGetStageUpAxis(Stage) == UsdGeomTokens->y;
+        Settings.bBuildMeshlets = false;
+        Settings.bGenerateLods = true;
+
+        const std::vector<UsdPrim> MeshPrims = ToolScene::GatherMeshPrims(Stage);
+        std::vector<LodChain> Chains(MeshPrims.size());
+        const auto Start = std::chrono::steady_clock::now();
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, MeshPrims.size()),
+            [&](const tbb::blocked_range<size_t>& Range)
+            {
+                for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+                {
+                    RenderMesh Mesh(Settings);
+                    UsdPrim Prim = MeshPrims[Idx];
+                    Mesh.Load(Prim);
+
+                    const std::shared_ptr<MeshData> Data = Mesh.GetMeshData();
+                    if (!Data || Data->Lods.empty() || Data->Lods[0].NumIndices == 0) { continue; }
+
+                    Chains[Idx].Path = Prim.GetPath().GetString();
+                    Chains[Idx].Radius = Data->BoundsRadius;
+                    Chains[Idx].Lods = Data->Lods;
+                }
+            });
+        OutBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+        for (LodChain& Chain : Chains)
+        {
+            if (!Chain.Path.empty()) { OutChains.push_back(std::move(Chain)); }
+        }
+        return true;
+    }
+}
+
+int RunLodsCommand(const std::vector<std::string>& Args)
+{
+    if (Args.empty())
+    {
+        std::cerr << "lods: Expected at least one USD file or directory.\n";
+        return 1;
+    }
+
+    const std::vector<std::string> Files = ToolScene::CollectUsdFiles(Args, "lods");
+
+    size_t NumFailed = 0;
+    LodTotals AllTotals;
+    for (const std::string& File : Files)
+    {
+        std::vector<LodChain> Chains;
+        double BuildMs = 0.0;
+        if (!BuildScene(File, Chains, BuildMs))
+        {
+            std::cerr << "lods: Failed '" << File << "'\n";
+            NumFailed++;
+            continue;
+        }
+
+        // One line per simplified mesh after the build logging, so the table is not interleaved with it.
+        LodTotals FileTotals;
+        FileTotals.BuildMs = BuildMs;
+        std::cout << std::fixed << std::setprecision(3);
+        for (const LodChain& Chain : Chains)
+        {
+            if (Chain.Lods.size() > 1)
+            {
+                std::cout << Chain.Path << ":";
+                for (const MeshLod& Lod : Chain.Lods) { std::cout << " " << Lod.NumIndices / 3 << " (" << Lod.Error << ")"; }
+                std::cout << "\n";
+            }
+            FileTotals.Add(Chain);
+            AllTotals.Add(Chain);
+        }
+        FileTotals.Print(File);
+        AllTotals.BuildMs += BuildMs;
+    }
+    if (Files.size() > 1) { AllTotals.Print("lods: All scenes"); }
+
+    return NumFailed == 0 ? 0 : 1;
+}
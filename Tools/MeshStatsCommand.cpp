@@ -0,0 +1,138 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+
+#include "RenderMesh.h"
+
+// Std
+#include <iomanip>
+#include <iostream>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+// USD
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/metrics.h"
+#include "pxr/usd/usdGeom/tokens.h"
+
+using namespace pxr;
+
+namespace
+{
+    struct MeshStats
+    {
+        std::string Path;
+        size_t NumTriangles = 0;
+        size_t NumVertices = 0;
+        MeshOptimiser::VertexCacheStats Before;
+        MeshOptimiser::VertexCacheStats After;
+    };
+
+    // Running totals, ACMR is weighted by triangles and ATVR by vertices so the totals are those of one big mesh.
+    struct StatsTotals
+    {
+        size_t NumMeshes = 0;
+        size_t NumTriangles = 0;
+        size_t NumVertices = 0;
+        double MissesBefore = 0.0;
+        double MissesAfter = 0.0;
+
+        void Add(const MeshStats& Stats)
+        {
+            NumMeshes++;
+            NumTriangles += Stats.NumTriangles;
+            NumVertices += Stats.NumVertices;
+            MissesBefore += static_cast<double>(Stats.Before.ACMR) * Stats.NumTriangles;
+            MissesAfter += static_cast<double>(Stats.After.ACMR) * Stats.NumTriangles;
+        }
+
+        void Print(const std::string& Label) const
+        {
+            if (NumTriangles == 0 || NumVertices == 0) { return; }
+
+            std::cout << Label << ": " << NumMeshes << " meshes, " << NumTriangles << " triangles, " << NumVertices << " vertices\n"
+                << "    ACMR " << MissesBefore / NumTriangles << " -> " << MissesAfter / NumTriangles << "\n"
+                << "    ATVR " << MissesBefore / NumVertices << " -> " << MissesAfter / NumVertices << "\n";
+        }
+    };
+
+    // Builds every mesh without the cooked cache and measures its index order before and after optimisation.
+    bool MeasureScene(const std::string& Path, std::vector<MeshStats>& OutStats)
+    {
+        UsdStageRefPtr Stage = UsdStage::Open(Path);
+        if (!Stage) { return false; }
+
+        MeshBuildSettings Settings;
+        Settings.bIsYUp = UsdGeomGetStageUpAxis(Stage) == UsdGeomTokens->y;
+        Settings.bOptimiseIndexOrder = true;
+        Settings.bGenerateLods = false;
+
+        const std::vector<UsdPrim> MeshPrims = ToolScene::GatherMeshPrims(Stage);
+        std::vector<MeshStats> Stats(MeshPrims.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, MeshPrims.size()),
+            [&](const tbb::blocked_range<size_t>& Range)
+            {
+                for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+                {
+                    RenderMesh Mesh(Settings);
+                    UsdPrim Prim = MeshPrims[Idx];
+                    Mesh.Load(Prim);
+
+                    const std::shared_ptr<MeshData> Data = Mesh.GetMeshData();
+                    if (!Data || !Data->bIndexOrderOptimised) { continue; }
+
+                    Stats[Idx].Path = Prim.GetPath().GetString();
+                    Stats[Idx].NumTriangles = Data->GetNumIndices() / 3;
+                    Stats[Idx].NumVertices = Data->GetNumVertices();
+                    Stats[Idx].Before = Data->CacheStatsBefore;
+                    Stats[Idx].After = Data->CacheStatsAfter;
+                }
+            });
+
+        for (MeshStats& Mesh : Stats)
+        {
+            if (!Mesh.Path.empty()) { OutStats.push_back(std::move(Mesh)); }
+        }
+        return true;
+    }
+}
+
+int RunMeshStatsCommand(const std::vector<std::string>& Args)
+{
+    if (Args.empty())
+    {
+        std::cerr << "meshstats: Expected at least one USD file or directory.\n";
+        return 1;
+    }
+
+    const std::vector<std::string> Files = ToolScene::CollectUsdFiles(Args, "meshstats");
+
+    size_t NumFailed = 0;
+    StatsTotals AllTotals;
+    for (const std::string& File : Files)
+    {
+        std::vector<MeshStats> Stats;
+        if (!MeasureScene(File, Stats))
+        {
+            std::cerr << "meshstats: Failed '" << File << "'\n";
+            NumFailed++;
+            continue;
+        }
+
+        // One line per mesh after the build logging, so the table is not interleaved with it.
+        StatsTotals FileTotals;
+        std::cout << std::fixed << std::setprecision(3);
+        for (const MeshStats& Mesh : Stats)
+        {
+            std::cout << Mesh.Path << ": " << Mesh.NumTriangles << " tris, ACMR " << Mesh.Before.ACMR << " -> " << Mesh.After.ACMR
+                << ", ATVR " << Mesh.Before.ATVR << " -> " << Mesh.After.ATVR << "\n";
+            FileTotals.Add(Mesh);
+            AllTotals.Add(Mesh);
+        }
+        FileTotals.Print(File);
+    }
+    if (Files.size() > 1) { AllTotals.Print("meshstats: All scenes"); }
+
+    return NumFailed == 0 ? 0 : 1;
+}
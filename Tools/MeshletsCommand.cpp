@@ -0,0 +1,257 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+
+#include "Frustum.h"
+#include "Meshlets.h"
+#include "RenderMesh.h"
+
+// Std
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+// USD
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/metrics.h"
+#include "pxr/usd/usdGeom/tokens.h"
+
+using namespace DirectX;
+using namespace pxr;
+
+namespace
+{
+    // Views orbit the scene bounds at this many scene radii, close enough that part of the scene falls outside the frustum.
+    constexpr size_t NumViews = 8;
+    constexpr float ViewDistance = 1.5f;
+    constexpr float ViewElevation = 0.35f;
+    constexpr float ViewFieldOfView = 45.0f;
+    constexpr float ViewAspectRatio = 16.0f / 9.0f;
+
+    struct CullMesh
+    {
+        std::shared_ptr<MeshData> Data;
+        XMFLOAT3 Center = XMFLOAT3(0.0f, 0.0f, 0.0f); // Whole mesh bounding sphere, the object culling baseline.
+        float Radius = 0.0f;
+        size_t NumTriangles = 0;
+    };
+
+    struct CullScene
+    {
+        std::vector<CullMesh> Meshes;
+        std::vector<ToolMeshInstance> Instances;
+        XMFLOAT3 Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        float Radius = 0.0f;
+        bool bIsYUp = true;
+    };
+
+    // Triangles left after each culling stage, summed over the views.
+    struct CullTotals
+    {
+        size_t NumTriangles = 0;
+        size_t NumAfterObject = 0;
+        size_t NumAfterMeshletFrustum = 0;
+        size_t NumAfterMeshletCone = 0;
+        MeshletCullStats Meshlets;
+        double CullMs = 0.0;
+    };
+
+    void ComputeSphere(const std::vector<XMFLOAT3>& Positions, XMFLOAT3& OutCenter, float& OutRadius)
+    {
+        XMVECTOR Min = XMVectorReplicate(FLT_MAX);
+        XMVECTOR Max = XMVectorReplicate(-FLT_MAX);
+        for (const XMFLOAT3& Position : Positions)
+        {
+            Min = XMVectorMin(Min, XMLoadFloat3(&Position));
+            Max = XMVectorMax(Max, XMLoadFloat3(&Position));
+        }
+        const XMVECTOR Center = XMVectorScale(XMVectorAdd(Min, Max), 0.5f);
+        float RadiusSq = 0.0f;
+        for (const XMFLOAT3& Position : Positions)
+        {
+            RadiusSq = std::max(RadiusSq, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&Position), Center))));
+        }
+        XMStoreFloat3(&OutCenter, Center);
+        OutRadius = std::sqrt(RadiusSq);
+    }
+
+    float GetMaxScale(const XMMATRIX& Matrix)
+    {
+        return std::max({ XMVectorGetX(XMVector3Length(Matrix.r[0])), XMVectorGetX(XMVector3Length(Matrix.r[1])), XMVectorGetX(XMVector3Length(Matrix.r[2])) });
+    }
+
+    // Builds every unique mesh once in USD space and lists the world matrix of each place it is drawn, instance proxies included.
+    bool LoadScene(const std::string& Path, CullScene& OutScene)
+    {
+        UsdStageRefPtr Stage = UsdStage::Open(Path);
+        if (!Stage) { return false; }
+        OutScene.bIsYUp = UsdGeomGetStageUpAxis(Stage) == UsdGeomTokens->y;
+
+        std::vector<UsdPrim> MeshPrims;
+        ToolScene::GatherMeshInstances(Stage, MeshPrims, OutScene.Instances);
+
+        // USD space throughout, so the USD world matrices apply as they are.
+        MeshBuildSettings Settings;
+        Settings.bIsYUp = true;
+        Settings.bOptimiseIndexOrder = true;
+        Settings.bBuildMeshlets = true;
+        Settings.bGenerateLods = false;
+        Settings.Format = VertexFormat::Float;
+
+        OutScene.Meshes.resize(MeshPrims.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, MeshPrims.size()),
+            [&](const tbb::blocked_range<size_t>& Range)
+            {
+                for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+                {
+                    RenderMesh Mesh(Settings);
+                    UsdPrim Prim = MeshPrims[Idx];
+                    Mesh.Load(Prim);
+
+                    CullMesh& Cull = OutScene.Meshes[Idx];
+                    Cull.Data = Mesh.GetMeshData();
+                    if (!Cull.Data || Cull.Data->Positions.empty()) { continue; }
+
+                    Cull.NumTriangles = Cull.Data->GetNumIndices() / 3;
+                    ComputeSphere(Cull.Data->Positions, Cull.Center, Cull.Radius);
+                }
+            });
+
+        // Scene bounds from the instance spheres, the views orbit around them.
+        std::vector<XMFLOAT3> InstanceExtremes;
+        for (const ToolMeshInstance& Instance : OutScene.Instances)
+        {
+            const CullMesh& Mesh = OutScene.Meshes[Instance.MeshIdx];
+            if (Mesh.NumTriangles == 0) { continue; }
+
+            const XMMATRIX World = XMLoadFloat4x4(&Instance.World);
+            const XMVECTOR Center = XMVector3Transform(XMLoadFloat3(&Mesh.Center), World);
+            const XMVECTOR Extent = XMVectorReplicate(Mesh.Radius * GetMaxScale(World));
+            InstanceExtremes.emplace_back();
+            XMStoreFloat3(&InstanceExtremes.back(), XMVectorSubtract(Center, Extent));
+            InstanceExtremes.emplace_back();
+            XMStoreFloat3(&InstanceExtremes.back(), XMVectorAdd(Center, Extent));
+        }
+        ComputeSphere(InstanceExtremes, OutScene.Center, OutScene.Radius);
+        return true;
+    }
+
+    void CullView(const CullScene& Scene, size_t ViewIdx, CullTotals& Totals)
+    {
+        const float Angle = XM_2PI * static_cast<float>(ViewIdx) / NumViews;
+        const XMVECTOR Direction = Scene.bIsYUp
+            ? XMVectorSet(std::cos(Angle), ViewElevation, std::sin(Angle), 0.0f)
+            : XMVectorSet(std::cos(Angle), std::sin(Angle), ViewElevation, 0.0f);
+        const XMVECTOR UpAxis = Scene.bIsYUp ? XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+        const XMVECTOR Focus = XMLoadFloat3(&Scene.Center);
+        const XMVECTOR Eye = XMVectorAdd(Focus, XMVectorScale(XMVector3Normalize(Direction), Scene.Radius * ViewDistance));
+
+        const float Radius = std::max(Scene.Radius, 1e-3f);
+        const XMMATRIX View = XMMatrixLookAtRH(Eye, Focus, UpAxis);
+        const XMMATRIX Projection = XMMatrixPerspectiveFovRH(XMConvertToRadians(ViewFieldOfView), ViewAspectRatio, Radius * 1e-3f, Radius * ViewDistance * 4.0f);
+        const Frustum ViewFrustum = Frustum::FromViewProjection(XMMatrixMultiply(View, Projection));
+        XMFLOAT3 EyePosition;
+        XMStoreFloat3(&EyePosition, Eye);
+
+        const auto Start = std::chrono::steady_clock::now();
+        MeshletCullStats ViewStats;
+        size_t NumAfterObject = 0;
+        for (const ToolMeshInstance& Instance : Scene.Instances)
+        {
+            const CullMesh& Mesh = Scene.Meshes[Instance.MeshIdx];
+            if (Mesh.NumTriangles == 0) { continue; }
+            Totals.NumTriangles += Mesh.NumTriangles;
+
+            const XMMATRIX World = XMLoadFloat4x4(&Instance.World);
+            XMFLOAT3 Center;
+            XMStoreFloat3(&Center, XMVector3Transform(XMLoadFloat3(&Mesh.Center), World));
+            if (!ViewFrustum.IntersectsSphere(Center, Mesh.Radius * GetMaxScale(World))) { continue; }
+            NumAfterObject += Mesh.NumTriangles;
+
+            // Meshes without a meshlet table are a single cluster, already decided by the object test.
+            Meshlets::Cull(Mesh.Data->Clusters, Instance.World, ViewFrustum, EyePosition, ViewStats);
+        }
+        Totals.CullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+        const size_t NumUnclustered = NumAfterObject - ViewStats.NumTriangles;
+        Totals.NumAfterObject += NumAfterObject;
+        Totals.NumAfterMeshletFrustum += NumUnclustered + ViewStats.NumVisibleTriangles + ViewStats.NumConeCulledTriangles;
+        Totals.NumAfterMeshletCone += NumUnclustered + ViewStats.NumVisibleTriangles;
+        Totals.Meshlets.Merge(ViewStats);
+    }
+
+    void PrintTotals(const std::string& Label, const CullTotals& Totals, size_t NumViewsCulled)
+    {
+        if (Totals.NumTriangles == 0 || NumViewsCulled == 0) { return; }
+
+        const auto Percent = [&Totals](size_t Count) { return 100.0 * static_cast<double>(Count) / Totals.NumTriangles; };
+        std::cout << Label << ": " << Totals.NumTriangles / NumViewsCulled << " triangles per view, averaged over " << NumViewsCulled << " views\n"
+            << "    After object culling:          " << Totals.NumAfterObject / NumViewsCulled << " (" << Percent(Totals.NumAfterObject) << "%)\n"
+            << "    After meshlet frustum culling: " << Totals.NumAfterMeshletFrustum / NumViewsCulled << " (" << Percent(Totals.NumAfterMeshletFrustum) << "%)\n"
+            << "    After meshlet cone culling:    " << Totals.NumAfterMeshletCone / NumViewsCulled << " (" << Percent(Totals.NumAfterMeshletCone) << "%)\n"
+            << "    Meshlets tested " << Totals.Meshlets.NumMeshlets / NumViewsCulled << ", frustum culled " << Totals.Meshlets.NumFrustumCulled / NumViewsCulled
+            << ", cone culled " << Totals.Meshlets.NumConeCulled / NumViewsCulled << ", " << Totals.CullMs / NumViewsCulled << " ms per view\n";
+    }
+}
+
+int RunMeshletsCommand(const std::vector<std::string>& Args)
+{
+    if (Args.empty())
+    {
+        std::cerr << "meshlets: Expected at least one USD file or directory.\n";
+        return 1;
+    }
+
+    const std::vector<std::string> Files = ToolScene::CollectUsdFiles(Args, "meshlets");
+
+    size_t NumFailed = 0;
+    size_t NumViewsCulled = 0;
+    CullTotals AllTotals;
+    for (const std::string& File : Files)
+    {
+        CullScene Scene;
+        if (!LoadScene(File, Scene))
+        {
+            std::cerr << "meshlets: Failed '" << File << "'\n";
+            NumFailed++;
+            continue;
+        }
+
+        size_t NumMeshlets = 0;
+        size_t NumClusteredMeshes = 0;
+        for (const CullMesh& Mesh : Scene.Meshes)
+        {
+            if (!Mesh.Data || Mesh.Data->Clusters.IsEmpty()) { continue; }
+            NumMeshlets += Mesh.Data->Clusters.Meshlets.size();
+            NumClusteredMeshes++;
+        }
+
+        CullTotals FileTotals;
+        for (size_t ViewIdx = 0; ViewIdx < NumViews; ViewIdx++)
+        {
+            CullView(Scene, ViewIdx, FileTotals);
+        }
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << File << ": " << Scene.Meshes.size() << " meshes, " << NumClusteredMeshes << " with " << NumMeshlets << " meshlets, "
+            << Scene.Instances.size() << " instances\n";
+        PrintTotals(File, FileTotals, NumViews);
+
+        AllTotals.NumTriangles += FileTotals.NumTriangles;
+        AllTotals.NumAfterObject += FileTotals.NumAfterObject;
+        AllTotals.NumAfterMeshletFrustum += FileTotals.NumAfterMeshletFrustum;
+        AllTotals.NumAfterMeshletCone += FileTotals.NumAfterMeshletCone;
+        AllTotals.Meshlets.Merge(FileTotals.Meshlets);
+        AllTotals.CullMs += FileTotals.CullMs;
+        NumViewsCulled += NumViews;
+    }
+    if (Files.size() > 1) { PrintTotals("meshlets: All scenes", AllTotals, NumViewsCulled); }
+
+    return NumFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,318 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+
+#include "Frustum.h"
+#include "FrustumCulling.h"
+#include "OcclusionCulling.h"
+#include "RenderMesh.h"
+
+// Std
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+// USD
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/metrics.h"
+#include "pxr/usd/usdGeom/tokens.h"
+
+using namespace DirectX;
+using namespace pxr;
+
+namespace
+{
+    // Same orbit as the meshlets command, so the two reports describe the same views.
+    constexpr size_t NumViews = 8;
+    constexpr float ViewDistance = 1.5f;
+    constexpr float ViewElevation = 0.35f;
+    constexpr float ViewFieldOfView = 45.0f;
+    constexpr float ViewAspectRatio = 16.0f / 9.0f;
+
+    struct OcclusionScene
+    {
+        std::vector<std::shared_ptr<MeshData>> Meshes;
+        std::vector<ToolMeshInstance> Instances;
+        std::vector<BoundingBox> Boxes;
+        std::vector<XMFLOAT3> Centers;
+        std::vector<float> Radii;
+        CullBoundsSoA Bounds;
+        XMFLOAT3 Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        float Radius = 0.0f;
+        bool bIsYUp = true;
+    };
+
+    struct OcclusionTotals
+    {
+        size_t NumInFrustum = 0;
+        OcclusionStats Occlusion;
+    };
+
+    BoundingBox MakeBox(float MinX, float MinY, float MinZ, float MaxX, float MaxY, float MaxZ)
+    {
+        BoundingBox Box;
+        Box.Min = XMFLOAT3(MinX, MinY, MinZ);
+        Box.Max = XMFLOAT3(MaxX, MaxY, MaxZ);
+        return Box;
+    }
+
+    OccluderMesh MakeQuad(const XMFLOAT3& A, const XMFLOAT3& B, const XMFLOAT3& C, const XMFLOAT3& D)
+    {
+        OccluderMesh Quad;
+        Quad.Positions = { A, B, C, D };
+        Quad.Indices = { 0, 1, 2, 0, 2, 3 };
+        return Quad;
+    }
+
+    // Known answers from a camera at the origin looking down -Z: a wall 10 units away, the same wall wound the other way,
+    // and a floor that reaches behind the camera so it has to be clipped at the near plane.
+    bool RunSyntheticChecks()
+    {
+        const XMMATRIX View = XMMatrixLookAtRH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        const XMMATRIX ViewProjection = XMMatrixMultiply(View, XMMatrixPerspectiveFovRH(XMConvertToRadians(60.0f), ViewAspectRatio, 0.1f, 100.0f));
+
+        const OccluderMesh Wall = MakeQuad(XMFLOAT3(-4.0f, -3.0f, -10.0f), XMFLOAT3(4.0f, -3.0f, -10.0f), XMFLOAT3(4.0f, 3.0f, -10.0f), XMFLOAT3(-4.0f, 3.0f, -10.0f));
+        const OccluderMesh BackWall = MakeQuad(XMFLOAT3(-4.0f, 3.0f, -10.0f), XMFLOAT3(4.0f, 3.0f, -10.0f), XMFLOAT3(4.0f, -3.0f, -10.0f), XMFLOAT3(-4.0f, -3.0f, -10.0f));
+        const OccluderMesh Floor = MakeQuad(XMFLOAT3(-50.0f, -1.0f, 5.0f), XMFLOAT3(50.0f, -1.0f, 5.0f), XMFLOAT3(50.0f, -1.0f, -50.0f), XMFLOAT3(-50.0f, -1.0f, -50.0f));
+
+        struct Check
+        {
+            const char* Name;
+            const OccluderMesh* Occluder;
+            BoundingBox Box;
+            bool bExpectVisible;
+        };
+        const Check Checks[] =
+        {
+            { "Box behind the wall", &Wall, MakeBox(-1.0f, -1.0f, -20.0f, 1.0f, 1.0f, -18.0f), false },
+            { "Wide box behind the wall", &Wall, MakeBox(-3.0f, -2.0f, -20.0f, 3.0f, 2.0f, -19.0f), false },
+            { "Box behind the back facing wall", &BackWall, MakeBox(-1.0f, -1.0f, -20.0f, 1.0f, 1.0f, -18.0f), false },
+            { "Box in front of the wall", &Wall, MakeBox(-1.0f, -1.0f, -6.0f, 1.0f, 1.0f, -5.0f), true },
+            { "Box through the wall", &Wall, MakeBox(-1.0f, -1.0f, -11.0f, 1.0f, 1.0f, -9.0f), true },
+            { "Box behind and above the wall", &Wall, MakeBox(-1.0f, 2.0f, -20.0f, 1.0f, 6.0f, -18.0f), true },
+            { "Box behind and beside the wall", &Wall, MakeBox(10.0f, -1.0f, -20.0f, 12.0f, 1.0f, -18.0f), true },
+            { "Box around the camera", &Wall, MakeBox(-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f), true },
+            { "Box with no occluders", nullptr, MakeBox(-1.0f, -1.0f, -20.0f, 1.0f, 1.0f, -18.0f), true },
+            { "Box under the clipped floor", &Floor, MakeBox(-1.0f, -5.0f, -20.0f, 1.0f, -3.0f, -18.0f), false },
+            { "Box on the clipped floor", &Floor, MakeBox(-1.0f, -1.5f, -20.0f, 1.0f, 1.0f, -18.0f), true },
+        };
+
+        OcclusionBuffer Buffer;
+        Buffer.Resize(OcclusionCulling::BufferWidth, static_cast<uint32_t>(std::ceil(OcclusionCulling::BufferWidth / ViewAspectRatio)));
+
+        size_t NumFailed = 0;
+        for (const Check& Test : Checks)
+        {
+            std::vector<OccluderInstance> Occluders;
+            if (Test.Occluder)
+            {
+                OccluderInstance Instance;
+                Instance.Mesh = Test.Occluder;
+                XMStoreFloat4x4(&Instance.World, XMMatrixIdentity());
+                Occluders.push_back(Instance);
+            }
+
+            OcclusionStats Stats;
+            Buffer.Render(Occluders, ViewProjection, Stats);
+            const bool bVisible = Buffer.IsVisible(Test.Box);
+            if (bVisible != Test.bExpectVisible)
+            {
+                std::cerr << "occlusion: " << Test.Name << " should be " << (Test.bExpectVisible ? "visible" : "occluded") << "\n";
+                NumFailed++;
+            }
+        }
+
+        // Only the largest candidates over the minimum size are kept, largest first.
+        std::vector<OccluderCandidate> Candidates;
+        for (uint32_t Idx = 0; Idx < OcclusionCulling::MaxOccluders * 2; Idx++)
+        {
+            Candidates.push_back(OccluderCandidate{ Idx, OcclusionCulling::MinOccluderScreenSize * 0.5f * static_cast<float>(Idx) });
+        }
+        OcclusionCulling::SelectOccluders(Candidates);
+        const bool bSelectionOk = Candidates.size() == OcclusionCulling::MaxOccluders && Candidates.front().Object == OcclusionCulling::MaxOccluders * 2 - 1
+            && std::is_sorted(Candidates.begin(), Candidates.end(), [](const OccluderCandidate& A, const OccluderCandidate& B) { return A.ScreenSize > B.ScreenSize; });
+        if (!bSelectionOk)
+        {
+            std::cerr << "occlusion: Occluder selection did not keep the largest candidates in order\n";
+            NumFailed++;
+        }
+
+        std::cout << "occlusion: " << std::size(Checks) + 1 - NumFailed << " / " << std::size(Checks) + 1 << " synthetic checks passed\n";
+        return NumFailed == 0;
+    }
+
+    // Builds every unique mesh once in USD space with its LODs and occluder, and the world bounds of each instance.
+    bool LoadScene(const std::string& Path, OcclusionScene& OutScene)
+    {
+        UsdStageRefPtr Stage = UsdStage::Open(Path);
+        if (!Stage) { return false; }
+        OutScene.bIsYUp = UsdGeomGetStageUpAxis(Stage) == UsdGeomTokens->y;
+
+        std::vector<UsdPrim> MeshPrims;
+        ToolScene::GatherMeshInstances(Stage, MeshPrims, OutScene.Instances);
+
+        // USD space throughout, so the USD world matrices apply as they are.
+        MeshBuildSettings Settings;
+        Settings.bIsYUp = true;
+        Settings.bBuildMeshlets = false;
+        Settings.bGenerateLods = true;
+        Settings.Format = VertexFormat::Float;
+
+        OutScene.Meshes.resize(MeshPrims.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, MeshPrims.size()),
+            [&](const tbb::blocked_range<size_t>& Range)
+            {
+                for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+                {
+                    RenderMesh Mesh(Settings);
+                    UsdPrim Prim = MeshPrims[Idx];
+                    Mesh.Load(Prim);
+                    OutScene.Meshes[Idx] = Mesh.GetMeshData();
+                }
+            });
+
+        // Instances of meshes without triangles never pass culling and are never occluders.
+        const size_t NumInstances = OutScene.Instances.size();
+        OutScene.Boxes.assign(NumInstances, BoundingBox());
+        OutScene.Centers.assign(NumInstances, XMFLOAT3(0.0f, 0.0f, 0.0f));
+        OutScene.Radii.assign(NumInstances, 0.0f);
+        OutScene.Bounds.Resize(NumInstances);
+        BoundingBox SceneBox;
+        for (size_t Idx = 0; Idx < NumInstances; Idx++)
+        {
+            const MeshData* Mesh = OutScene.Meshes[OutScene.Instances[Idx].MeshIdx].get();
+            if (!Mesh || Mesh->GetNumIndices() == 0)
+            {
+                OutScene.Bounds.SetNeverVisible(Idx);
+                continue;
+            }
+
+            const XMMATRIX World = XMLoadFloat4x4(&OutScene.Instances[Idx].World);
+            const float Scale = std::max({ XMVectorGetX(XMVector3Length(World.r[0])), XMVectorGetX(XMVector3Length(World.r[1])), XMVectorGetX(XMVector3Length(World.r[2])) });
+            const BoundingBox& Box = OutScene.Boxes[Idx] = BoundingBox::FromTransformedBox(Mesh->BoundsCenter, Mesh->BoundsExtents, World);
+            XMStoreFloat3(&OutScene.Centers[Idx], XMVector3Transform(XMLoadFloat3(&Mesh->BoundsCenter), World));
+            OutScene.Radii[Idx] = Mesh->BoundsRadius * Scale;
+            OutScene.Bounds.Set(Idx, OutScene.Centers[Idx], OutScene.Radii[Idx],
+                XMFLOAT3((Box.Max.x - Box.Min.x) * 0.5f, (Box.Max.y - Box.Min.y) * 0.5f, (Box.Max.z - Box.Min.z) * 0.5f));
+            SceneBox.Grow(Box);
+        }
+
+        if (SceneBox.Min.x <= SceneBox.Max.x)
+        {
+            const XMVECTOR Min = XMLoadFloat3(&SceneBox.Min);
+            const XMVECTOR Max = XMLoadFloat3(&SceneBox.Max);
+            XMStoreFloat3(&OutScene.Center, XMVectorScale(XMVectorAdd(Min, Max), 0.5f));
+            OutScene.Radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(Max, Min))) * 0.5f;
+        }
+        return true;
+    }
+
+    // Frustum culls the instances of one orbit view, then draws the largest into the occlusion buffer and tests the rest against it.
+    void CullView(const OcclusionScene& Scene, size_t ViewIdx, OcclusionBuffer& Buffer, OcclusionTotals& Totals)
+    {
+        const float Angle = XM_2PI * static_cast<float>(ViewIdx) / NumViews;
+        const XMVECTOR Direction = Scene.bIsYUp
+            ? XMVectorSet(std::cos(Angle), ViewElevation, std::sin(Angle), 0.0f)
+            : XMVectorSet(std::cos(Angle), std::sin(Angle), ViewElevation, 0.0f);
+        const XMVECTOR UpAxis = Scene.bIsYUp ? XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+        const XMVECTOR Focus = XMLoadFloat3(&Scene.Center);
+        const XMVECTOR Eye = XMVectorAdd(Focus, XMVectorScale(XMVector3Normalize(Direction), Scene.Radius * ViewDistance));
+
+        const float Radius = std::max(Scene.Radius, 1e-3f);
+        const XMMATRIX View = XMMatrixLookAtRH(Eye, Focus, UpAxis);
+        const XMMATRIX Projection = XMMatrixPerspectiveFovRH(XMConvertToRadians(ViewFieldOfView), ViewAspectRatio, Radius * 1e-3f, Radius * ViewDistance * 4.0f);
+        const XMMATRIX ViewProjection = XMMatrixMultiply(View, Projection);
+
+        std::vector<uint32_t> Visible;
+        CullKernelStats KernelStats;
+        FrustumCulling::Cull(Scene.Bounds, Frustum::FromViewProjection(ViewProjection), Visible, KernelStats);
+        Totals.NumInFrustum += Visible.size();
+
+        std::vector<OccluderCandidate> Candidates;
+        for (const uint32_t Object : Visible)
+        {
+            if (Scene.Meshes[Scene.Instances[Object].MeshIdx]->Occluder.IsEmpty()) { continue; }
+
+            const float Distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&Scene.Centers[Object]), Eye)));
+            Candidates.push_back(OccluderCandidate{ Object, Scene.Radii[Object] / std::max(Distance, Radius * 1e-3f) });
+        }
+        OcclusionCulling::SelectOccluders(Candidates);
+
+        std::vector<OccluderInstance> Occluders;
+        for (const OccluderCandidate& Candidate : Candidates)
+        {
+            const ToolMeshInstance& Instance = Scene.Instances[Candidate.Object];
+            Occluders.push_back(OccluderInstance{ &Scene.Meshes[Instance.MeshIdx]->Occluder, Instance.World });
+        }
+
+        Buffer.Render(Occluders, ViewProjection, Totals.Occlusion);
+        OcclusionCulling::RemoveOccluded(Buffer, Scene.Boxes, Visible, Totals.Occlusion);
+    }
+
+    void PrintTotals(const std::string& Label, size_t NumInstances, const OcclusionTotals& Totals, size_t NumViewsCulled)
+    {
+        if (NumViewsCulled == 0) { return; }
+
+        const OcclusionStats& Stats = Totals.Occlusion;
+        const double Occluded = Totals.NumInFrustum > 0 ? 100.0 * static_cast<double>(Stats.NumOccluded) / Totals.NumInFrustum : 0.0;
+        std::cout << Label << ": " << NumInstances << " instances, averaged over " << NumViewsCulled << " views\n"
+            << "    In frustum: " << Totals.NumInFrustum / NumViewsCulled << ", occluded " << Stats.NumOccluded / NumViewsCulled << " (" << Occluded << "%)\n"
+            << "    Occluders " << Stats.NumOccluders / NumViewsCulled << " with " << Stats.NumOccluderTriangles / NumViewsCulled << " triangles, "
+            << Stats.NumRasterisedTriangles / NumViewsCulled << " rasterised\n"
+            << "    Raster " << Stats.RasterMs / NumViewsCulled << " ms, test " << Stats.TestMs / NumViewsCulled << " ms per view\n";
+    }
+}
+
+int RunOcclusionCommand(const std::vector<std::string>& Args)
+{
+    std::cout << std::fixed << std::setprecision(2);
+    bool bPassed = RunSyntheticChecks();
+
+    const std::vector<std::string> Files = ToolScene::CollectUsdFiles(Args, "occlusion");
+
+    OcclusionBuffer Buffer;
+    Buffer.Resize(OcclusionCulling::BufferWidth, static_cast<uint32_t>(std::ceil(OcclusionCulling::BufferWidth / ViewAspectRatio)));
+
+    size_t NumViewsCulled = 0;
+    size_t NumAllInstances = 0;
+    OcclusionTotals AllTotals;
+    for (const std::string& File : Files)
+    {
+        OcclusionScene Scene;
+        if (!LoadScene(File, Scene))
+        {
+            std::cerr << "occlusion: Failed '" << File << "'\n";
+            bPassed = false;
+            continue;
+        }
+
+        const size_t NumOccluderMeshes = std::count_if(Scene.Meshes.begin(), Scene.Meshes.end(),
+            [](const std::shared_ptr<MeshData>& Mesh) { return Mesh && !Mesh->Occluder.IsEmpty(); });
+        std::cout << File << ": " << Scene.Meshes.size() << " meshes, " << NumOccluderMeshes << " with occluders\n";
+
+        OcclusionTotals FileTotals;
+        for (size_t ViewIdx = 0; ViewIdx < NumViews; ViewIdx++)
+        {
+            CullView(Scene, ViewIdx, Buffer, FileTotals);
+        }
+        PrintTotals(File, Scene.Instances.size(), FileTotals, NumViews);
+
+        AllTotals.NumInFrustum += FileTotals.NumInFrustum;
+        AllTotals.Occlusion.NumOccluders += FileTotals.Occlusion.NumOccluders;
+        AllTotals.Occlusion.NumOccluderTriangles += FileTotals.Occlusion.NumOccluderTriangles;
+        AllTotals.Occlusion.NumRasterisedTriangles += FileTotals.Occlusion.NumRasterisedTriangles;
+        AllTotals.Occlusion.NumTested += FileTotals.Occlusion.NumTested;
+        AllTotals.Occlusion.NumOccluded += FileTotals.Occlusion.NumOccluded;
+        AllTotals.Occlusion.RasterMs += FileTotals.Occlusion.RasterMs;
+        AllTotals.Occlusion.TestMs += FileTotals.Occlusion.TestMs;
+        NumAllInstances += Scene.Instances.size();
+        NumViewsCulled += NumViews;
+    }
+    if (Files.size() > 1) { PrintTotals("occlusion: All scenes", NumAllInstances, AllTotals, NumViewsCulled); }
+
+    return bPassed ? 0 : 1;
+}
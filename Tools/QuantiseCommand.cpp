@@ -0,0 +1,216 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+
+#include "RenderMesh.h"
+#include "VertexQuantisation.h"
+
+// Std
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+// USD
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/metrics.h"
+#include "pxr/usd/usdGeom/tokens.h"
+
+using namespace DirectX;
+using namespace pxr;
+
+namespace
+{
+    // Error bounds every encoding has to hold, checked per component.
+    constexpr float HalfRelativeError = 1.0f / 2048.0f;      // Round to nearest with an 11 bit significand.
+    constexpr float HalfSmallestStep = 1.0f / 16777216.0f;   // Subnormal spacing, 2^-24.
+    constexpr float FloatRelativeError = 1.0f / 4194304.0f;  // Slack for float rounding in the encode and decode, 2^-22 of the bounds.
+    constexpr float MaxNormalDegrees = 0.05f;                 // 16 bit octahedral worst case is just under 0.04 degrees.
+    constexpr float Unorm8Error = 0.5f / 255.0f + 1e-6f;
+
+    struct ErrorReport
+    {
+        size_t NumVertices = 0;
+        size_t NumViolations = 0;
+        float MaxPosition = 0.0f;
+        float MaxPositionOfBound = 0.0f; // Largest error as a fraction of its bound, above 1 is a violation.
+        float MaxNormalDegrees = 0.0f;
+        float MaxColour = 0.0f;
+        float MaxUV = 0.0f;
+        size_t NumHalfFallbacks = 0;     // Meshes too large for half positions, encoded bounds relative instead.
+
+        void Merge(const ErrorReport& Other)
+        {
+            NumVertices += Other.NumVertices;
+            NumViolations += Other.NumViolations;
+            MaxPosition = std::max(MaxPosition, Other.MaxPosition);
+            MaxPositionOfBound = std::max(MaxPositionOfBound, Other.MaxPositionOfBound);
+            MaxNormalDegrees = std::max(MaxNormalDegrees, Other.MaxNormalDegrees);
+            MaxColour = std::max(MaxColour, Other.MaxColour);
+            MaxUV = std::max(MaxUV, Other.MaxUV);
+            NumHalfFallbacks += Other.NumHalfFallbacks;
+        }
+    };
+
+    float HalfErrorBound(float Value) { return std::max(std::abs(Value) * HalfRelativeError, HalfSmallestStep); }
+
+    // Round trips one mesh's render space vertices and UVs through Format and measures against the bounds.
+    ErrorReport RoundTrip(const std::vector<Vertex>& Vertices, const std::vector<XMFLOAT2>& UVs, VertexFormat Format)
+    {
+        ErrorReport Report;
+        Report.NumVertices = Vertices.size();
+
+        std::vector<QuantisedVertex> Quantised;
+        PositionDequantisation Dequantisation;
+        const VertexFormat UsedFormat = VertexQuantisation::Encode(Vertices, Format, Quantised, Dequantisation);
+        Report.NumHalfFallbacks = UsedFormat != Format ? 1 : 0;
+
+        for (size_t Idx = 0; Idx < Vertices.size(); Idx++)
+        {
+            const Vertex& Source = Vertices[Idx];
+            const Vertex Decoded = VertexQuantisation::Decode(Quantised[Idx], UsedFormat, Dequantisation);
+            bool bViolation = false;
+
+            for (size_t Axis = 0; Axis < 3; Axis++)
+            {
+                const float Value = (&Source.Position.x)[Axis];
+                const float Error = std::abs((&Decoded.Position.x)[Axis] - Value);
+                const float Bound = UsedFormat == VertexFormat::QuantisedBounds
+                    ? (&Dequantisation.Scale.x)[Axis] / 131070.0f + (std::abs((&Dequantisation.Offset.x)[Axis]) + (&Dequantisation.Scale.x)[Axis]) * FloatRelativeError
+                    : HalfErrorBound(Value);
+                Report.MaxPosition = std::max(Report.MaxPosition, Error);
+                Report.MaxPositionOfBound = std::max(Report.MaxPositionOfBound, Error / Bound);
+                bViolation |= Error > Bound;
+            }
+
+            // Only unit normals have a meaningful angle, zero normals encode to an arbitrary direction.
+            const XMVECTOR SourceNormal = XMLoadFloat3(&Source.Normals);
+            if (XMVectorGetX(XMVector3LengthSq(SourceNormal)) > 0.5f)
+            {
+                const float Cosine = std::clamp(XMVectorGetX(XMVector3Dot(XMVector3Normalize(SourceNormal), XMLoadFloat3(&Decoded.Normals))), -1.0f, 1.0f);
+                const float Degrees = XMConvertToDegrees(std::acos(Cosine));
+                Report.MaxNormalDegrees = std::max(Report.MaxNormalDegrees, Degrees);
+                bViolation |= Degrees > MaxNormalDegrees;
+            }
+
+            for (size_t Channel = 0; Channel < 4; Channel++)
+            {
+                const float Value = std::clamp((&Source.Colour.x)[Channel], 0.0f, 1.0f);
+                const float Error = std::abs((&Decoded.Colour.x)[Channel] - Value);
+                Report.MaxColour = std::max(Report.MaxColour, Error);
+                bViolation |= Error > Unorm8Error;
+            }
+
+            Report.NumViolations += bViolation ? 1 : 0;
+        }
+
+        for (const XMFLOAT2& UV : UVs)
+        {
+            const XMFLOAT2 Decoded = VertexQuantisation::DecodeHalf2(VertexQuantisation::EncodeHalf2(UV));
+            const float ErrorU = std::abs(Decoded.x - UV.x);
+            const float ErrorV = std::abs(Decoded.y - UV.y);
+            Report.MaxUV = std::max({ Report.MaxUV, ErrorU, ErrorV });
+            Report.NumViolations += (ErrorU > HalfErrorBound(UV.x) || ErrorV > HalfErrorBound(UV.y)) ? 1 : 0;
+        }
+        return Report;
+    }
+
+    // Random vertices at several scales, including one past the half float range, plus the axis directions the octahedral fold is worst at.
+    void BuildSyntheticMeshes(std::vector<std::vector<Vertex>>& OutMeshes, std::vector<std::vector<XMFLOAT2>>& OutUVs)
+    {
+        std::mt19937 Random(1234);
+        std::uniform_real_distribution<float> Signed(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+
+        for (const float Scale : { 0.01f, 1.0f, 100.0f, 10000.0f, 100000.0f })
+        {
+            std::vector<Vertex> Vertices(100000);
+            std::vector<XMFLOAT2> UVs(Vertices.size());
+            for (size_t Idx = 0; Idx < Vertices.size(); Idx++)
+            {
+                Vertex& Vtx = Vertices[Idx];
+                Vtx.Position = XMFLOAT3(Signed(Random) * Scale, Signed(Random) * Scale, Signed(Random) * Scale);
+                XMStoreFloat3(&Vtx.Normals, XMVector3Normalize(XMVectorSet(Signed(Random), Signed(Random), Signed(Random), 0.0f)));
+                Vtx.Colour = XMFLOAT4(Unit(Random), Unit(Random), Unit(Random), 1.0f);
+                UVs[Idx] = XMFLOAT2(Signed(Random) * 4.0f, Signed(Random) * 4.0f);
+            }
+
+            const XMFLOAT3 Axes[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+            for (size_t Axis = 0; Axis < 6; Axis++) { Vertices[Axis].Normals = Axes[Axis]; }
+
+            OutMeshes.push_back(std::move(Vertices));
+            OutUVs.push_back(std::move(UVs));
+        }
+    }
+
+    // Float vertices of every mesh in a scene, built without the mesh cache.
+    bool BuildSceneMeshes(const std::string& Path, std::vector<std::vector<Vertex>>& OutMeshes, std::vector<std::vector<XMFLOAT2>>& OutUVs)
+    {
+        UsdStageRefPtr Stage = UsdStage::Open(Path);
+        if (!Stage) { return false; }
+
+        MeshBuildSettings Settings;
+        Settings.bIsYUp = UsdGeomGetStageUpAxis(Stage) == UsdGeomTokens->y;
+        Settings.bOptimiseIndexOrder = false;
+        Settings.bGenerateLods = false;
+        Settings.Format = VertexFormat::Float;
+
+        for (UsdPrim Prim : ToolScene::GatherMeshPrims(Stage))
+        {
+            RenderMesh Mesh(Settings);
+            Mesh.Load(Prim);
+            const std::shared_ptr<MeshData> Data = Mesh.GetMeshData();
+            if (!Data || Data->Vertices.empty()) { continue; }
+
+            OutMeshes.push_back(Data->Vertices);
+            OutUVs.push_back(Data->UVs);
+        }
+        return true;
+    }
+
+    bool PrintReport(const std::string& Label, const std::vector<std::vector<Vertex>>& Meshes, const std::vector<std::vector<XMFLOAT2>>& UVs)
+    {
+        bool bPassed = true;
+        for (const VertexFormat Format : { VertexFormat::QuantisedHalf, VertexFormat::QuantisedBounds })
+        {
+            ErrorReport Total;
+            for (size_t Idx = 0; Idx < Meshes.size(); Idx++) { Total.Merge(RoundTrip(Meshes[Idx], UVs[Idx], Format)); }
+
+            std::cout << Label << (Format == VertexFormat::QuantisedHalf ? " [half positions]" : " [bounds positions]") << ": "
+                << Meshes.size() << " meshes, " << Total.NumVertices << " vertices, " << Total.NumViolations << " out of bounds\n"
+                << "    position " << Total.MaxPosition << " (" << Total.MaxPositionOfBound * 100.0f << "% of bound)"
+                << ", normal " << Total.MaxNormalDegrees << " deg, colour " << Total.MaxColour << ", uv " << Total.MaxUV;
+            if (Total.NumHalfFallbacks > 0) { std::cout << ", " << Total.NumHalfFallbacks << " fell back to bounds positions"; }
+            std::cout << "\n";
+            bPassed &= Total.NumViolations == 0;
+        }
+        return bPassed;
+    }
+}
+
+int RunQuantiseCommand(const std::vector<std::string>& Args)
+{
+    std::cout << "quantise: " << sizeof(Vertex) << " byte float vertices -> " << sizeof(QuantisedVertex) << " byte quantised vertices, "
+        << static_cast<float>(sizeof(Vertex)) / sizeof(QuantisedVertex) << "x smaller\n";
+
+    std::vector<std::vector<Vertex>> Meshes;
+    std::vector<std::vector<XMFLOAT2>> UVs;
+    BuildSyntheticMeshes(Meshes, UVs);
+    bool bPassed = PrintReport("Synthetic", Meshes, UVs);
+
+    size_t NumFailed = 0;
+    for (const std::string& File : ToolScene::CollectUsdFiles(Args, "quantise"))
+    {
+        Meshes.clear();
+        UVs.clear();
+        if (!BuildSceneMeshes(File, Meshes, UVs))
+        {
+            std::cerr << "quantise: Failed '" << File << "'\n";
+            NumFailed++;
+            continue;
+        }
+        bPassed &= PrintReport(File, Meshes, UVs);
+    }
+
+    std::cout << "quantise: " << (bPassed ? "All encodings within their error bounds.\n" : "Encodings exceeded their error bounds!\n");
+    return bPassed && NumFailed == 0 ? 0 : 1;
+}
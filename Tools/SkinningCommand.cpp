@@ -0,0 +1,463 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+#include "ToolTiming.h"
+
+#include "RenderMesh.h"
+#include "MeshDeformer.h"
+#include "Skinning.h"
+
+// Std
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+// USD
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/mesh.h"
+#include "pxr/usd/usdGeom/metrics.h"
+#include "pxr/usd/usdGeom/tokens.h"
+#include "pxr/usd/usdGeom/xformable.h"
+#include "pxr/usd/usdSkel/animation.h"
+#include "pxr/usd/usdSkel/animQuery.h"
+#include "pxr/usd/usdSkel/bindingAPI.h"
+#include "pxr/usd/usdSkel/blendShape.h"
+#include "pxr/usd/usdSkel/blendShapeQuery.h"
+#include "pxr/usd/usdSkel/cache.h"
+#include "pxr/usd/usdSkel/root.h"
+#include "pxr/usd/usdSkel/skeleton.h"
+#include "pxr/base/gf/rotation.h"
+
+using namespace DirectX;
+using namespace pxr;
+
+namespace
+{
+    constexpr size_t DefaultVertexCounts[] = { 10000, 100000 };
+    constexpr uint32_t BenchInfluences = 4;
+    constexpr uint32_t BenchJoints = 64;
+    constexpr size_t BenchBlendShapes = 8;
+
+    constexpr float PositionTolerance = 1e-4f;
+    constexpr float NormalTolerance = 1e-3f;
+
+    using ToolTiming::RepeatForMs;
+
+    // A strip standing on the origin, bent at its middle joint and bulged by a blend shape between time codes 0 and 10.
+    // The skeleton and the mesh both have their own transform, so skinning has to bring skeleton space back to the mesh.
+    constexpr int StripColumns = 4;
+    constexpr int StripRows = 40;
+    constexpr float StripHeight = 4.0f;
+    constexpr double RigEndTime = 10.0;
+
+    UsdPrim BuildRig(const UsdStageRefPtr& Stage)
+    {
+        UsdGeomSetStageUpAxis(Stage, UsdGeomTokens->y);
+        Stage->SetStartTimeCode(0.0);
+        Stage->SetEndTimeCode(RigEndTime);
+
+        UsdSkelRoot::Define(Stage, SdfPath("/Rig"));
+
+        const VtTokenArray Joints = { TfToken("Root"), TfToken("Root/Mid") };
+        const float MidHeight = StripHeight * 0.5f;
+        UsdSkelSkeleton Skeleton = UsdSkelSkeleton::Define(Stage, SdfPath("/Rig/Skeleton"));
+        Skeleton.CreateJointsAttr().Set(Joints);
+        Skeleton.CreateBindTransformsAttr().Set(VtMatrix4dArray{ GfMatrix4d(1.0), GfMatrix4d(1.0).SetTranslate(GfVec3d(0.0, MidHeight, 0.0)) });
+        Skeleton.CreateRestTransformsAttr().Set(VtMatrix4dArray{ GfMatrix4d(1.0), GfMatrix4d(1.0).SetTranslate(GfVec3d(0.0, MidHeight, 0.0)) });
+        Skeleton.AddTranslateOp().Set(GfVec3d(1.0, 0.0, 0.0));
+
+        UsdSkelAnimation Animation = UsdSkelAnimation::Define(Stage, SdfPath("/Rig/Animation"));
+        Animation.CreateJointsAttr().Set(Joints);
+        Animation.CreateTranslationsAttr().Set(VtVec3fArray{ GfVec3f(0.0f), GfVec3f(0.0f, MidHeight, 0.0f) });
+        Animation.CreateScalesAttr().Set(VtVec3hArray{ GfVec3h(1.0f), GfVec3h(1.0f) });
+        const GfQuatf Identity(1.0f);
+        const GfQuatf Twist(GfRotation(GfVec3d(0.0, 1.0, 0.0), 30.0).GetQuat());
+        const GfQuatf Bend(GfRotation(GfVec3d(0.0, 0.0, 1.0), 90.0).GetQuat());
+        Animation.CreateRotationsAttr().Set(VtQuatfArray{ Identity, Identity }, UsdTimeCode(0.0));
+        Animation.GetRotationsAttr().Set(VtQuatfArray{ Twist, Bend }, UsdTimeCode(RigEndTime));
+        Animation.CreateBlendShapesAttr().Set(VtTokenArray{ TfToken("Bulge") });
+        Animation.CreateBlendShapeWeightsAttr().Set(VtFloatArray{ 0.0f }, UsdTimeCode(0.0));
+        Animation.GetBlendShapeWeightsAttr().Set(VtFloatArray{ 1.0f }, UsdTimeCode(RigEndTime));
+        UsdSkelBindingAPI::Apply(Skeleton.GetPrim()).CreateAnimationSourceRel().SetTargets({ Animation.GetPath() });
+
+        // Points below the lower quarter follow the root, above the upper quarter the middle joint, blended in between.
+        VtVec3fArray Points;
+        VtIntArray JointIndices;
+        VtFloatArray JointWeights;
+        VtIntArray BulgeIndices;
+        VtVec3fArray BulgeOffsets;
+        for (int Row = 0; Row <= StripRows; Row++)
+        {
+            for (int Column = 0; Column <= StripColumns; Column++)
+            {
+                const float Y = Row * StripHeight / StripRows;
+                const float MidWeight = std::clamp((Y - StripHeight * 0.25f) / (StripHeight * 0.5f), 0.0f, 1.0f);
+                if (std::abs(Y - MidHeight) < StripHeight * 0.2f)
+                {
+                    BulgeIndices.push_back(static_cast<int>(Points.size()));
+                    BulgeOffsets.push_back(GfVec3f(0.0f, 0.0f, 0.5f));
+                }
+                Points.push_back(GfVec3f(Column * 0.25f - 0.5f, Y, 0.0f));
+                JointIndices.push_back(0);
+                JointIndices.push_back(1);
+                JointWeights.push_back(1.0f - MidWeight);
+                JointWeights.push_back(MidWeight);
+            }
+        }
+
+        VtIntArray Counts, Indices;
+        VtVec3fArray Normals;
+        for (int Row = 0; Row < StripRows; Row++)
+        {
+            for (int Column = 0; Column < StripColumns; Column++)
+            {
+                const int First = Row * (StripColumns + 1) + Column;
+                Counts.push_back(4);
+                for (const int Corner : { First, First + 1, First + StripColumns + 2, First + StripColumns + 1 })
+                {
+                    Indices.push_back(Corner);
+                    Normals.push_back(GfVec3f(0.0f, 0.0f, 1.0f));
+                }
+            }
+        }
+
+        UsdGeomMesh Mesh = UsdGeomMesh::Define(Stage, SdfPath("/Rig/Strip"));
+        Mesh.CreateFaceVertexCountsAttr().Set(Counts);
+        Mesh.CreateFaceVertexIndicesAttr().Set(Indices);
+        Mesh.CreatePointsAttr().Set(Points);
+        Mesh.CreateNormalsAttr().Set(Normals);
+        Mesh.SetNormalsInterpolation(UsdGeomTokens->faceVarying);
+        Mesh.AddTranslateOp().Set(GfVec3d(0.0, 0.0, 2.0));
+
+        UsdSkelBlendShape Bulge = UsdSkelBlendShape::Define(Stage, SdfPath("/Rig/Strip/Bulge"));
+        Bulge.CreateOffsetsAttr().Set(BulgeOffsets);
+        Bulge.CreatePointIndicesAttr().Set(BulgeIndices);
+
+        UsdSkelBindingAPI Binding = UsdSkelBindingAPI::Apply(Mesh.GetPrim());
+        Binding.CreateSkeletonRel().SetTargets({ Skeleton.GetPath() });
+        Binding.CreateJointIndicesPrimvar(false, 2).Set(JointIndices);
+        Binding.CreateJointWeightsPrimvar(false, 2).Set(JointWeights);
+        Binding.CreateGeomBindTransformAttr().Set(GfMatrix4d(1.0));
+        Binding.CreateBlendShapesAttr().Set(VtTokenArray{ TfToken("Bulge") });
+        Binding.CreateBlendShapeTargetsRel().SetTargets({ Bulge.GetPath() });
+        return Mesh.GetPrim();
+    }
+
+    // UsdSkel's own blend shape and skinning evaluation of the rest points at Time, in skeleton space.
+    bool ComputeReferencePoints(const UsdSkelSkeletonQuery& SkelQuery, const UsdSkelSkinningQuery& SkinQuery, const UsdSkelBlendShapeQuery& BlendShapeQuery,
+        const VtVec3fArray& RestPoints, UsdTimeCode Time, VtVec3fArray& OutPoints)
+    {
+        OutPoints = RestPoints;
+
+        VtFloatArray AnimWeights, MeshWeights, SubShapeWeights;
+        VtUIntArray BlendShapeIndices, SubShapeIndices;
+        if (!SkelQuery.GetAnimQuery().ComputeBlendShapeWeights(&AnimWeights, Time)) { return false; }
+        if (const UsdSkelAnimMapperRefPtr& Mapper = SkinQuery.GetBlendShapeMapper()) { Mapper->Remap(AnimWeights, &MeshWeights); }
+        else { MeshWeights = AnimWeights; }
+        if (!BlendShapeQuery.ComputeSubShapeWeights(MeshWeights, &SubShapeWeights, &BlendShapeIndices, &SubShapeIndices)) { return false; }
+        if (!BlendShapeQuery.ComputeDeformedPoints(SubShapeWeights, BlendShapeIndices, SubShapeIndices, BlendShapeQuery.ComputeBlendShapePointIndices(),
+            BlendShapeQuery.ComputeSubShapePointOffsets(), TfSpan<GfVec3f>(OutPoints.data(), OutPoints.size())))
+        {
+            return false;
+        }
+
+        VtMatrix4dArray SkinningTransforms;
+        return SkelQuery.ComputeSkinningTransforms(&SkinningTransforms, Time) && SkinQuery.ComputeSkinnedPoints(SkinningTransforms, &OutPoints, Time);
+    }
+
+    // Plays the rig back and checks every written vertex against UsdSkel, in world space.
+    bool RunRigCheck()
+    {
+        UsdStageRefPtr Stage = UsdStage::CreateInMemory();
+        UsdPrim Prim = BuildRig(Stage);
+
+        MeshBuildSettings Settings;
+        RenderMesh Mesh(Settings);
+        Mesh.Load(Prim);
+        const std::shared_ptr<MeshData> Data = Mesh.GetMeshData();
+        if (!Data || !Data->Deformer || !Data->Deformer->HasJointInfluences())
+        {
+            std::cerr << "skinning: The strip was not built as a skinnable mesh.\n";
+            return false;
+        }
+        MeshDeformer& Deformer = *Data->Deformer;
+
+        UsdSkelCache SkelCache;
+        const UsdSkelRoot SkelRoot(Stage->GetPrimAtPath(SdfPath("/Rig")));
+        SkelCache.Populate(SkelRoot, UsdPrimDefaultPredicate);
+        std::vector<UsdSkelBinding> Bindings;
+        SkelCache.ComputeSkelBindings(SkelRoot, &Bindings, UsdPrimDefaultPredicate);
+
+        UsdSkelSkeletonQuery SkelQuery;
+        UsdSkelSkinningQuery SkinQuery;
+        for (const UsdSkelBinding& Binding : Bindings)
+        {
+            for (const UsdSkelSkinningQuery& Target : Binding.GetSkinningTargets())
+            {
+                if (Target.GetPrim() != Prim) { continue; }
+                SkelQuery = SkelCache.GetSkelQuery(Binding.GetSkeleton());
+                SkinQuery = Target;
+            }
+        }
+        if (!SkelQuery || !SkinQuery || !Deformer.BindSkeleton(SkelQuery, SkinQuery))
+        {
+            std::cerr << "skinning: The strip could not be bound to its skeleton.\n";
+            return false;
+        }
+
+        VtVec3fArray RestPoints;
+        UsdGeomMesh(Prim).GetPointsAttr().Get(&RestPoints);
+        const UsdSkelBlendShapeQuery BlendShapeQuery{ UsdSkelBindingAPI(Prim) };
+        const std::vector<uint32_t>& VertexPoints = Deformer.GetVertexPoints();
+
+        std::vector<Vertex> Vertices(Deformer.GetNumVertices());
+        VtVec3fArray Reference;
+        float MaxPositionError = 0.0f;
+        float MaxNormalError = 0.0f;
+        size_t NumFrames = 0;
+        size_t NumUnchangedFrames = 0;
+        size_t NumOutside = 0;
+        for (double Time = 0.0; Time <= RigEndTime; Time += 0.5)
+        {
+            const bool bChanged = Deformer.Sample(UsdTimeCode(Time));
+            NumUnchangedFrames += bChanged || NumFrames == 0 ? 0 : 1;
+            NumFrames++;
+
+            DeformedBounds Bounds;
+            Deformer.WriteVertices(Vertices.data(), Bounds);
+            if (!ComputeReferencePoints(SkelQuery, SkinQuery, BlendShapeQuery, RestPoints, UsdTimeCode(Time), Reference))
+            {
+                std::cerr << "skinning: UsdSkel could not evaluate the rig at " << Time << ".\n";
+                return false;
+            }
+
+            const GfMatrix4d SkelToWorld = UsdGeomXformable(SkelQuery.GetPrim()).ComputeLocalToWorldTransform(UsdTimeCode(Time));
+            const GfMatrix4d MeshToWorld = UsdGeomXformable(Prim).ComputeLocalToWorldTransform(UsdTimeCode(Time));
+            for (size_t Idx = 0; Idx < Vertices.size(); Idx++)
+            {
+                const Vertex& Vtx = Vertices[Idx];
+                const GfVec3d World = MeshToWorld.Transform(GfVec3d(Vtx.Position.x, Vtx.Position.y, Vtx.Position.z));
+                const GfVec3d Expected = SkelToWorld.Transform(GfVec3d(Reference[VertexPoints[Idx]]));
+                MaxPositionError = std::max(MaxPositionError, static_cast<float>((World - Expected).GetLength()));
+
+                const float NormalLength = std::sqrt(Vtx.Normals.x * Vtx.Normals.x + Vtx.Normals.y * Vtx.Normals.y + Vtx.Normals.z * Vtx.Normals.z);
+                MaxNormalError = std::max(MaxNormalError, std::abs(NormalLength - 1.0f));
+
+                const bool bOutside = std::abs(Vtx.Position.x - Bounds.Center.x) > Bounds.Extents.x + PositionTolerance ||
+                    std::abs(Vtx.Position.y - Bounds.Center.y) > Bounds.Extents.y + PositionTolerance ||
+                    std::abs(Vtx.Position.z - Bounds.Center.z) > Bounds.Extents.z + PositionTolerance;
+                NumOutside += bOutside ? 1 : 0;
+            }
+        }
+
+        // The pose at an unchanged time is not evaluated again.
+        const bool bRepeatSkipped = !Deformer.Sample(UsdTimeCode(RigEndTime));
+
+        std::cout << "Synthetic rig: " << Vertices.size() << " vertices, " << NumFrames << " frames, max position error " << MaxPositionError
+            << ", max normal length error " << MaxNormalError << ", " << NumOutside << " vertices outside the bounds\n";
+
+        bool bPassed = true;
+        if (MaxPositionError > PositionTolerance || MaxNormalError > NormalTolerance || NumOutside > 0 || NumUnchangedFrames > 0)
+        {
+            std::cerr << "skinning: Skinned vertices do not follow UsdSkel.\n";
+            bPassed = false;
+        }
+        if (!bRepeatSkipped)
+        {
+            std::cerr << "skinning: An unchanged pose was evaluated again.\n";
+            bPassed = false;
+        }
+        return bPassed;
+    }
+
+    // Random rest pose in a unit cube with four weighted influences of 64 joints per vertex, and sparse blend shapes
+    // moving a twentieth of the vertices each.
+    SkinnedMeshSoA MakeBenchMesh(size_t NumVertices, std::mt19937& Random)
+    {
+        std::uniform_real_distribution<float> Unit(-1.0f, 1.0f);
+        std::uniform_int_distribution<int> Joint(0, BenchJoints - 1);
+        std::uniform_real_distribution<float> Weight(0.0f, 1.0f);
+
+        SkinnedMeshSoA Mesh;
+        Mesh.Resize(NumVertices, BenchInfluences, BenchJoints);
+        for (size_t Idx = 0; Idx < NumVertices; Idx++)
+        {
+            const XMVECTOR Normal = XMVector3Normalize(XMVectorSet(Unit(Random), Unit(Random), Unit(Random) + 2.0f, 0.0f));
+            XMFLOAT3 StoredNormal;
+            XMStoreFloat3(&StoredNormal, Normal);
+            Mesh.SetVertex(Idx, XMFLOAT3(Unit(Random), Unit(Random), Unit(Random)), StoredNormal, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
+
+            float Weights[BenchInfluences];
+            float Total = 0.0f;
+            for (float& W : Weights) { W = Weight(Random); Total += W; }
+            for (uint32_t Influence = 0; Influence < BenchInfluences; Influence++)
+            {
+                Mesh.SetInfluence(Idx, Influence, static_cast<uint16_t>(Joint(Random)), Weights[Influence] / Total);
+            }
+        }
+        Mesh.PadGroups();
+
+        std::uniform_int_distribution<uint32_t> PickVertex(0, static_cast<uint32_t>(NumVertices - 1));
+        for (size_t Shape = 0; Shape < BenchBlendShapes; Shape++)
+        {
+            SkinBlendShape BlendShape;
+            for (size_t Idx = 0; Idx < NumVertices / 20; Idx++)
+            {
+                BlendShape.Vertices.push_back(PickVertex(Random));
+                BlendShape.PositionOffsets.push_back(XMFLOAT3(Unit(Random) * 0.1f, Unit(Random) * 0.1f, Unit(Random) * 0.1f));
+            }
+            Mesh.BlendShapes.emplace_back(std::move(BlendShape));
+        }
+        return Mesh;
+    }
+
+    // Rotations about random axes with translations, as a posed skeleton would have.
+    std::vector<XMFLOAT4X4> MakeJointMatrices(std::mt19937& Random)
+    {
+        std::uniform_real_distribution<double> Unit(-1.0, 1.0);
+        std::vector<XMFLOAT4X4> Matrices(BenchJoints);
+        for (XMFLOAT4X4& Matrix : Matrices)
+        {
+            const GfVec3d Axis = GfVec3d(Unit(Random), Unit(Random), Unit(Random) + 2.0).GetNormalized();
+            GfMatrix4d Joint(1.0);
+            Joint.SetRotate(GfRotation(Axis, Unit(Random) * 180.0));
+            Joint.SetTranslateOnly(GfVec3d(Unit(Random), Unit(Random), Unit(Random)));
+            for (int Row = 0; Row < 4; Row++)
+            {
+                for (int Col = 0; Col < 4; Col++) { Matrix.m[Row][Col] = static_cast<float>(Joint[Row][Col]); }
+            }
+        }
+        return Matrices;
+    }
+
+    // One vertex at a time in double precision, for checking the kernel.
+    void SkinReference(const SkinnedMeshSoA& Mesh, const std::vector<XMFLOAT4X4>& Joints, const std::vector<float>& BlendShapeWeights, std::vector<Vertex>& Out)
+    {
+        std::vector<GfVec3d> Positions(Mesh.NumVertices);
+        for (size_t Idx = 0; Idx < Mesh.NumVertices; Idx++) { Positions[Idx] = GfVec3d(Mesh.PositionX[Idx], Mesh.PositionY[Idx], Mesh.PositionZ[Idx]); }
+        for (size_t Shape = 0; Shape < Mesh.BlendShapes.size(); Shape++)
+        {
+            const SkinBlendShape& BlendShape = Mesh.BlendShapes[Shape];
+            for (size_t Idx = 0; Idx < BlendShape.Vertices.size(); Idx++)
+            {
+                const XMFLOAT3& Offset = BlendShape.PositionOffsets[Idx];
+                Positions[BlendShape.Vertices[Idx]] += GfVec3d(Offset.x, Offset.y, Offset.z) * BlendShapeWeights[Shape];
+            }
+        }
+
+        Out.resize(Mesh.NumVertices);
+        for (size_t Idx = 0; Idx < Mesh.NumVertices; Idx++)
+        {
+            const GfVec3d& P = Positions[Idx];
+            const GfVec3d N(Mesh.NormalX[Idx], Mesh.NormalY[Idx], Mesh.NormalZ[Idx]);
+            GfVec3d SkinnedP(0.0), SkinnedN(0.0);
+            for (uint32_t Influence = 0; Influence < Mesh.NumInfluences; Influence++)
+            {
+                const size_t Slot = ((Idx / 4) * Mesh.NumInfluences + Influence) * 4 + Idx % 4;
+                const XMFLOAT4X4& M = Joints[Mesh.Joints[Slot]];
+                const double W = Mesh.Weights[Slot];
+                for (int Col = 0; Col < 3; Col++)
+                {
+                    SkinnedP[Col] += W * (P[0] * M.m[0][Col] + P[1] * M.m[1][Col] + P[2] * M.m[2][Col] + M.m[3][Col]);
+                    SkinnedN[Col] += W * (N[0] * M.m[0][Col] + N[1] * M.m[1][Col] + N[2] * M.m[2][Col]);
+                }
+            }
+            SkinnedN.Normalize();
+            Out[Idx].Position = XMFLOAT3(static_cast<float>(SkinnedP[0]), static_cast<float>(SkinnedP[1]), static_cast<float>(SkinnedP[2]));
+            Out[Idx].Normals = XMFLOAT3(static_cast<float>(SkinnedN[0]), static_cast<float>(SkinnedN[1]), static_cast<float>(SkinnedN[2]));
+        }
+    }
+
+    bool RunBenchmark(size_t NumVertices)
+    {
+        std::mt19937 Random(1234);
+        const SkinnedMeshSoA Mesh = MakeBenchMesh(NumVertices, Random);
+        const std::vector<XMFLOAT4X4> Joints = MakeJointMatrices(Random);
+        std::vector<float> BlendShapeWeights(BenchBlendShapes, 0.0f);
+        BlendShapeWeights[0] = 0.5f;
+        BlendShapeWeights[3] = 0.25f;
+
+        // Kernel against the reference, then without any active blend shape, the common case between facial animation.
+        std::vector<Vertex> Vertices(NumVertices);
+        std::vector<Vertex> Expected;
+        SkinningScratch Scratch;
+        XMFLOAT3 Min, Max;
+        Skinning::Skin(Mesh, Joints.data(), BlendShapeWeights.data(), Scratch, Vertices.data(), Min, Max);
+        SkinReference(Mesh, Joints, BlendShapeWeights, Expected);
+
+        float MaxPositionError = 0.0f;
+        float MaxNormalError = 0.0f;
+        for (size_t Idx = 0; Idx < NumVertices; Idx++)
+        {
+            const XMFLOAT3& P = Vertices[Idx].Position;
+            const XMFLOAT3& N = Vertices[Idx].Normals;
+            const XMFLOAT3& EP = Expected[Idx].Position;
+            const XMFLOAT3& EN = Expected[Idx].Normals;
+            MaxPositionError = std::max({ MaxPositionError, std::abs(P.x - EP.x), std::abs(P.y - EP.y), std::abs(P.z - EP.z) });
+            MaxNormalError = std::max({ MaxNormalError, std::abs(N.x - EN.x), std::abs(N.y - EN.y), std::abs(N.z - EN.z) });
+        }
+
+        // One core, the same mesh skinned again and again.
+        size_t NumRuns = 0;
+        const std::vector<float> NoBlendShapes(BenchBlendShapes, 0.0f);
+        const double BlendMs = RepeatForMs([&]() { Skinning::Skin(Mesh, Joints.data(), BlendShapeWeights.data(), Scratch, Vertices.data(), Min, Max); }, NumRuns);
+        const double BlendRate = NumVertices * NumRuns / (BlendMs / 1000.0);
+        const double SkinMs = RepeatForMs([&]() { Skinning::Skin(Mesh, Joints.data(), NoBlendShapes.data(), Scratch, Vertices.data(), Min, Max); }, NumRuns);
+        const double SkinRate = NumVertices * NumRuns / (SkinMs / 1000.0);
+
+        // Every core, a crowd of meshes written on whichever thread picks them up, like the deform ring update.
+        const int NumThreads = tbb::this_task_arena::max_concurrency();
+        const size_t NumMeshes = static_cast<size_t>(NumThreads) * 4;
+        tbb::enumerable_thread_specific<std::vector<Vertex>> ThreadVertices([NumVertices]() { return std::vector<Vertex>(NumVertices); });
+        tbb::enumerable_thread_specific<SkinningScratch> ThreadScratch;
+        const double CrowdMs = RepeatForMs([&]()
+            {
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, NumMeshes, 1), [&](const tbb::blocked_range<size_t>& Range)
+                    {
+                        std::vector<Vertex>& Dest = ThreadVertices.local();
+                        SkinningScratch& LocalScratch = ThreadScratch.local();
+                        XMFLOAT3 LocalMin, LocalMax;
+                        for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+                        {
+                            Skinning::Skin(Mesh, Joints.data(), BlendShapeWeights.data(), LocalScratch, Dest.data(), LocalMin, LocalMax);
+                        }
+                    });
+            }, NumRuns);
+        const double CrowdRate = NumVertices * NumMeshes * NumRuns / (CrowdMs / 1000.0);
+
+        std::cout << NumVertices << " vertices, " << BenchInfluences << " influences of " << BenchJoints << " joints, " << BenchBlendShapes << " blend shapes:\n"
+            << "    1 core:    " << SkinRate / 1e6 << " M vertices/s skinned, " << BlendRate / 1e6 << " M vertices/s with 2 blend shapes\n"
+            << "    " << NumThreads << " threads: " << CrowdRate / 1e6 << " M vertices/s over " << NumMeshes << " meshes, "
+            << CrowdRate / NumThreads / 1e6 << " M vertices/s per core\n"
+            << "    max error " << MaxPositionError << " position, " << MaxNormalError << " normal against the reference\n";
+
+        if (MaxPositionError > PositionTolerance || MaxNormalError > NormalTolerance)
+        {
+            std::cerr << "skinning: Kernel output differs from the reference.\n";
+            return false;
+        }
+        return true;
+    }
+}
+
+int RunSkinningCommand(const std::vector<std::string>& Args)
+{
+    std::vector<size_t> Counts;
+    if (!ToolScene::ParseCounts(Args, DefaultVertexCounts, "skinning", "vertex", Counts)) { return 1; }
+
+    bool bPassed = RunRigCheck();
+    for (const size_t Count : Counts)
+    {
+        bPassed &= RunBenchmark(Count);
+    }
+
+    std::cout << "skinning: " << (bPassed ? "Skinned vertices match the reference.\n" : "Skinning check failed!\n");
+    return bPassed ? 0 : 1;
+}
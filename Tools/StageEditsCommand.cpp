@@ -0,0 +1,324 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+#include "ToolTiming.h"
+
+#include "RenderMesh.h"
+#include "StageEdits.h"
+
+// Std
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <string>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+// USD
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/tf/notice.h"
+#include "pxr/base/tf/weakBase.h"
+#include "pxr/usd/sdf/schema.h"
+#include "pxr/usd/sdf/types.h"
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/mesh.h"
+#include "pxr/usd/usdGeom/metrics.h"
+#include "pxr/usd/usdGeom/pointInstancer.h"
+#include "pxr/usd/usdGeom/primvarsAPI.h"
+#include "pxr/usd/usdGeom/tokens.h"
+#include "pxr/usd/usdGeom/xform.h"
+#include "pxr/usd/usdGeom/xformCache.h"
+#include "pxr/usd/usdGeom/xformCommonAPI.h"
+
+using namespace pxr;
+
+namespace
+{
+    using ToolTiming::Clock;
+    using ToolTiming::ToMs;
+
+    // Meshes of each scene whose points are nudged one at a time.
+    constexpr size_t MaxEditedMeshes = 8;
+
+    // Classifies every ObjectsChanged of one stage the way USDScene does.
+    class EditRecorder : public TfWeakBase
+    {
+    public:
+        explicit EditRecorder(const UsdStageRefPtr& Stage)
+        {
+            Key = TfNotice::Register(TfCreateWeakPtr(this), &EditRecorder::OnObjectsChanged, UsdStageWeakPtr(Stage));
+        }
+        ~EditRecorder() { TfNotice::Revoke(Key); }
+
+        // Coalesced edits since the last call.
+        std::vector<StageEdit> Take()
+        {
+            std::vector<StageEdit> Result;
+            Result.swap(Edits);
+            StageEdits::Coalesce(Result);
+            return Result;
+        }
+
+    private:
+        void OnObjectsChanged(const UsdNotice::ObjectsChanged& Notice, const UsdStageWeakPtr& Sender) { StageEdits::Classify(Notice, Edits); }
+
+        TfNotice::Key Key;
+        std::vector<StageEdit> Edits;
+    };
+
+    const char* GetKindName(StageEditKind Kind)
+    {
+        switch (Kind)
+        {
+        case StageEditKind::None: return "None";
+        case StageEditKind::Transform: return "Transform";
+        case StageEditKind::Primvar: return "Primvar";
+        case StageEditKind::Topology: return "Topology";
+        case StageEditKind::Resync: return "Resync";
+        }
+        return "?";
+    }
+
+    std::string ToString(const std::vector<StageEdit>& Edits)
+    {
+        if (Edits.empty()) { return "nothing"; }
+
+        std::string Result;
+        for (const StageEdit& Edit : Edits)
+        {
+            Result += (Result.empty() ? "" : ", ") + std::string(GetKindName(Edit.Kind)) + " " + Edit.Path.GetString();
+        }
+        return Result;
+    }
+
+    // A mesh below a transformed group, another at the root and a point instancer drawing a third one three times.
+    UsdStageRefPtr BuildEditStage()
+    {
+        UsdStageRefPtr Stage = UsdStage::CreateInMemory();
+        UsdGeomSetStageUpAxis(Stage, UsdGeomTokens->y);
+
+        UsdGeomXform::Define(Stage, SdfPath("/World"));
+        UsdGeomXformCommonAPI(ToolScene::DefineQuad(Stage, SdfPath("/World/Quad"), false)).SetTranslate(GfVec3d(0.0, 0.0, 0.0));
+        UsdGeomXformCommonAPI(UsdGeomXform::Define(Stage, SdfPath("/World/Group"))).SetTranslate(GfVec3d(0.0, 0.0, 0.0));
+        ToolScene::DefineQuad(Stage, SdfPath("/World/Group/Tri"), false);
+
+        UsdGeomPointInstancer Instancer = UsdGeomPointInstancer::Define(Stage, SdfPath("/World/Instancer"));
+        ToolScene::DefineQuad(Stage, SdfPath("/World/Instancer/Protos/Box"), false);
+        Instancer.CreatePrototypesRel().AddTarget(SdfPath("/World/Instancer/Protos/Box"));
+        Instancer.CreateProtoIndicesAttr().Set(VtIntArray{ 0, 0, 0 });
+        Instancer.CreatePositionsAttr().Set(VtArray<GfVec3f>{ GfVec3f(0, 0, 0), GfVec3f(2, 0, 0), GfVec3f(4, 0, 0) });
+        return Stage;
+    }
+
+    struct EditCase
+    {
+        const char* Name;
+        std::function<void(const UsdStageRefPtr&)> Edit;
+        std::vector<StageEdit> Expected;
+    };
+
+    // Applies each edit to one stage in turn and checks what it was classified and coalesced into.
+    bool RunSyntheticCheck()
+    {
+        const UsdStageRefPtr Stage = BuildEditStage();
+        EditRecorder Recorder(Stage);
+
+        const SdfPath Quad("/World/Quad");
+        const SdfPath Group("/World/Group");
+        const SdfPath Instancer("/World/Instancer");
+        const TfToken Translate("xformOp:translate");
+        const std::vector<EditCase> Cases =
+        {
+            { "translate a mesh", [&](const UsdStageRefPtr& S) { S->GetPrimAtPath(Quad).GetAttribute(Translate).Set(GfVec3d(1.0, 2.0, 3.0)); },
+                { { Quad, StageEditKind::Transform } } },
+            { "translate a group", [&](const UsdStageRefPtr& S) { S->GetPrimAtPath(Group).GetAttribute(Translate).Set(GfVec3d(0.0, 1.0, 0.0)); },
+                { { Group, StageEditKind::Transform } } },
+            { "move points", [&](const UsdStageRefPtr& S)
+                {
+                    UsdGeomMesh(S->GetPrimAtPath(Quad)).GetPointsAttr().Set(VtArray<GfVec3f>{ GfVec3f(0, 0, 0), GfVec3f(2, 0, 0), GfVec3f(2, 2, 0), GfVec3f(0, 2, 0) });
+                },
+                { { Quad, StageEditKind::Primvar } } },
+            { "add a display colour", [&](const UsdStageRefPtr& S)
+                {
+                    UsdGeomPrimvarsAPI(S->GetPrimAtPath(Quad)).CreatePrimvar(UsdGeomTokens->primvarsDisplayColor, SdfValueTypeNames->Color3fArray)
+                        .Set(VtArray<GfVec3f>{ GfVec3f(1, 0, 0) });
+                },
+                { { Quad, StageEditKind::Primvar } } },
+            { "change faces", [&](const UsdStageRefPtr& S) { UsdGeomMesh(S->GetPrimAtPath(Quad)).GetFaceVertexIndicesAttr().Set(VtIntArray{ 3, 2, 1, 0 }); },
+                { { Quad, StageEditKind::Topology } } },
+            { "points and faces together", [&](const UsdStageRefPtr& S)
+                {
+                    const UsdGeomMesh Mesh(S->GetPrimAtPath(Quad));
+                    Mesh.GetPointsAttr().Set(VtArray<GfVec3f>{ GfVec3f(0, 0, 0), GfVec3f(1, 0, 0), GfVec3f(1, 1, 0), GfVec3f(0, 1, 0) });
+                    Mesh.GetFaceVertexIndicesAttr().Set(VtIntArray{ 0, 1, 2, 3 });
+                    S->GetPrimAtPath(Quad).GetAttribute(Translate).Set(GfVec3d(0.0, 0.0, 0.0));
+                },
+                { { Quad, StageEditKind::Transform }, { Quad, StageEditKind::Topology } } },
+            { "define a mesh", [&](const UsdStageRefPtr& S) { ToolScene::DefineQuad(S, Group.AppendChild(TfToken("Added")), false); },
+                { { Group.AppendChild(TfToken("Added")), StageEditKind::Resync } } },
+            { "edit inside a new prim", [&](const UsdStageRefPtr& S)
+                {
+                    const SdfPath Inner = Group.AppendChild(TfToken("Inner"));
+                    UsdGeomXformCommonAPI(UsdGeomXform::Define(S, Inner)).SetTranslate(GfVec3d(1.0, 0.0, 0.0));
+                    ToolScene::DefineQuad(S, Inner.AppendChild(TfToken("Mesh")), false);
+                },
+                { { Group.AppendChild(TfToken("Inner")), StageEditKind::Resync } } },
+            { "move instances", [&](const UsdStageRefPtr& S)
+                {
+                    UsdGeomPointInstancer(S->GetPrimAtPath(Instancer)).GetPositionsAttr().Set(VtArray<GfVec3f>{ GfVec3f(0, 1, 0), GfVec3f(2, 1, 0), GfVec3f(4, 1, 0) });
+                },
+                { { Instancer, StageEditKind::Transform } } },
+            { "change prototype indices", [&](const UsdStageRefPtr& S)
+                {
+                    UsdGeomPointInstancer(S->GetPrimAtPath(Instancer)).GetProtoIndicesAttr().Set(VtIntArray{ 0, 0 });
+                },
+                { { Instancer, StageEditKind::Resync } } },
+            { "remove a mesh", [&](const UsdStageRefPtr& S) { S->RemovePrim(Group.AppendChild(TfToken("Tri"))); },
+                { { Group.AppendChild(TfToken("Tri")), StageEditKind::Resync } } },
+            { "attributes the renderer does not read", [&](const UsdStageRefPtr& S)
+                {
+                    const UsdGeomMesh Mesh(S->GetPrimAtPath(Quad));
+                    Mesh.CreateDoubleSidedAttr().Set(true);
+                    Mesh.CreateVisibilityAttr().Set(UsdGeomTokens->invisible);
+                    S->GetPrimAtPath(Quad).SetMetadata(SdfFieldKeys->Comment, std::string("Edited"));
+                },
+                {} },
+        };
+
+        bool bPassed = true;
+        for (const EditCase& Case : Cases)
+        {
+            Recorder.Take();
+            Case.Edit(Stage);
+            const std::vector<StageEdit> Edits = Recorder.Take();
+
+            const bool bMatches = Edits.size() == Case.Expected.size() && std::equal(Edits.begin(), Edits.end(), Case.Expected.begin(),
+                [](const StageEdit& A, const StageEdit& B) { return A.Path == B.Path && A.Kind == B.Kind; });
+            std::cout << "    " << Case.Name << ": " << ToString(Edits) << (bMatches ? "\n" : "  <- expected " + ToString(Case.Expected) + "\n");
+            bPassed = bPassed && bMatches;
+        }
+        return bPassed;
+    }
+
+    // Adds an animated op to an animated prim between frames. A xform cache kept across frames and cleared the way USDScene clears
+    // its AnimationXformCache has to evaluate the new ops at the next time like a fresh cache does, not its cached op list.
+    bool RunAnimatedOpCheck()
+    {
+        const UsdStageRefPtr Stage = UsdStage::CreateInMemory();
+        const SdfPath SpinnerPath("/Spinner");
+        const UsdGeomXform Spinner = UsdGeomXform::Define(Stage, SpinnerPath);
+        const UsdPrim Quad = ToolScene::DefineQuad(Stage, SpinnerPath.AppendChild(TfToken("Quad")), false).GetPrim();
+        const UsdGeomXformOp Translate = Spinner.AddTranslateOp();
+        Translate.Set(GfVec3d(0.0, 0.0, 0.0), UsdTimeCode(1.0));
+        Translate.Set(GfVec3d(10.0, 0.0, 0.0), UsdTimeCode(10.0));
+
+        // Both caches have resolved the prims' queries by the first frame.
+        UsdGeomXformCache Cleared(UsdTimeCode(1.0));
+        UsdGeomXformCache Kept(UsdTimeCode(1.0));
+        Cleared.GetLocalToWorldTransform(Quad);
+        Kept.GetLocalToWorldTransform(Quad);
+
+        EditRecorder Recorder(Stage);
+        const UsdGeomXformOp Rotate = Spinner.AddRotateYOp();
+        Rotate.Set(0.0f, UsdTimeCode(1.0));
+        Rotate.Set(90.0f, UsdTimeCode(10.0));
+        const std::vector<StageEdit> Edits = Recorder.Take();
+        if (StageEdits::InvalidatesXformQueries(Edits)) { Cleared.Clear(); }
+
+        const UsdTimeCode Next(5.5);
+        Cleared.SetTime(Next);
+        Kept.SetTime(Next);
+        UsdGeomXformCache Fresh(Next);
+        const GfMatrix4d Expected = Fresh.GetLocalToWorldTransform(Quad);
+        const bool bEdits = Edits.size() == 1 && Edits[0].Path == SpinnerPath && Edits[0].Kind == StageEditKind::Transform;
+        const bool bMatches = GfIsClose(Cleared.GetLocalToWorldTransform(Quad), Expected, 1e-9);
+        const bool bKeptStale = !GfIsClose(Kept.GetLocalToWorldTransform(Quad), Expected, 1e-9);
+
+        std::cout << "    add an animated op and advance time: " << ToString(Edits) << (bEdits ? "" : "  <- expected Transform /Spinner")
+            << (bMatches ? ", cleared cache matches a fresh one" : ", cleared cache evaluates stale ops")
+            << (bKeptStale ? " (an uncleared cache would not)\n" : "\n");
+        return bEdits && bMatches;
+    }
+
+    // Nudges the points of a few meshes one at a time and compares rebuilding only the edited mesh with building every mesh,
+    // which is what reloading the whole scene costs before any upload.
+    bool MeasureScene(const std::string& Path)
+    {
+        UsdStageRefPtr Stage = UsdStage::Open(Path);
+        if (!Stage) { return false; }
+
+        MeshBuildSettings Settings;
+        Settings.bIsYUp = UsdGeomGetStageUpAxis(Stage) == UsdGeomTokens->y;
+
+        std::vector<UsdPrim> Prims = ToolScene::GatherMeshPrims(Stage);
+        std::vector<std::shared_ptr<MeshData>> Built(Prims.size());
+        const Clock::time_point StartTime = Clock::now();
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, Prims.size()), [&](const tbb::blocked_range<size_t>& Range)
+            {
+                for (size_t Idx = Range.begin(); Idx != Range.end(); ++Idx)
+                {
+                    RenderMesh Mesh(Settings);
+                    Mesh.Load(Prims[Idx]);
+                    Built[Idx] = Mesh.GetMeshData();
+                }
+            });
+        const double FullMs = ToMs(Clock::now() - StartTime);
+
+        // Meshes inside instancing prototypes can't be edited, their source prims are.
+        EditRecorder Recorder(Stage);
+        size_t NumEdited = 0;
+        size_t NumMisclassified = 0;
+        size_t NumSameIndices = 0;
+        double RebuildMs = 0.0;
+        for (size_t Idx = 0; Idx < Prims.size() && NumEdited < MaxEditedMeshes; Idx++)
+        {
+            if (!Built[Idx] || Prims[Idx].IsInPrototype()) { continue; }
+
+            const UsdAttribute Points = UsdGeomMesh(Prims[Idx]).GetPointsAttr();
+            VtArray<GfVec3f> Values;
+            if (Points.ValueMightBeTimeVarying() || !Points.Get(&Values) || Values.empty()) { continue; }
+            for (GfVec3f& Point : Values) { Point *= 1.01f; }
+            Points.Set(Values);
+
+            const std::vector<StageEdit> Edits = Recorder.Take();
+            const bool bPrimvar = Edits.size() == 1 && Edits[0].Path == Prims[Idx].GetPath() && Edits[0].Kind == StageEditKind::Primvar;
+            NumMisclassified += bPrimvar ? 0 : 1;
+
+            const Clock::time_point RebuildStart = Clock::now();
+            RenderMesh Mesh(Settings);
+            Mesh.Load(Prims[Idx]);
+            RebuildMs += ToMs(Clock::now() - RebuildStart);
+
+            // Scaling every point keeps the triangles, so the index buffer can stay unless welding or simplification changed.
+            const std::shared_ptr<MeshData> Data = Mesh.GetMeshData();
+            NumSameIndices += Data && Built[Idx]->HasSameIndices(*Data) ? 1 : 0;
+            NumEdited++;
+        }
+
+        std::cout << Path << ": " << Prims.size() << " meshes built in " << FullMs << " ms, " << NumEdited << " edited meshes rebuilt in "
+            << (NumEdited > 0 ? RebuildMs / NumEdited : 0.0) << " ms each, " << NumSameIndices << " kept their indices, "
+            << NumMisclassified << " misclassified\n";
+        return NumMisclassified == 0;
+    }
+}
+
+int RunStageEditsCommand(const std::vector<std::string>& Args)
+{
+    std::cout << "Synthetic stage edits:\n";
+    bool bPassed = RunSyntheticCheck();
+    bPassed = RunAnimatedOpCheck() && bPassed;
+
+    size_t NumFailed = 0;
+    for (const std::string& File : ToolScene::CollectUsdFiles(Args, "stageedits"))
+    {
+        if (!MeasureScene(File))
+        {
+            std::cerr << "stageedits: Failed '" << File << "'\n";
+            NumFailed++;
+        }
+    }
+
+    std::cout << "stageedits: " << (bPassed ? "Stage edits are classified as expected.\n" : "Stage edit classification failed!\n");
+    return bPassed && NumFailed == 0 ? 0 : 1;
+}
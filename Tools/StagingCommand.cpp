@@ -0,0 +1,231 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+#include "ToolTiming.h"
+
+#include "StagingRing.h"
+
+// Std
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr size_t DefaultOperationCounts[] = { 1000000 };
+    constexpr uint64_t RingBytes = 1 << 20;       // Small, so the ring wraps and fills often.
+    constexpr uint64_t MaxChunk = RingBytes / 4;  // Larger uploads are staged in pieces, like StaticMeshPipeline does.
+    constexpr uint64_t Alignment = 16;
+    constexpr size_t UploadsPerFrame = 64;
+
+    using ToolTiming::Clock;
+    using ToolTiming::ToMs;
+
+    // Stands in for the GPU: the fence completes submitted values a few frames late, or straight away when waited on.
+    class FakeFence final : public StagingFence
+    {
+    public:
+        uint64_t Signalled = 0;
+        uint64_t Completed = 0;
+        size_t NumWaits = 0;
+
+        uint64_t GetCompletedValue() const override { return Completed; }
+        void Wait(uint64_t Value) override
+        {
+            if (Completed >= Value) { return; }
+            Completed = std::min(Value, Signalled);
+            NumWaits++;
+        }
+    };
+
+    // Ring ranges that must not be handed out again, by offset, with the fence value of their batch. 0 while the batch is open.
+    struct LiveRange
+    {
+        uint64_t Size = 0;
+        uint64_t FenceValue = 0;
+    };
+
+    struct StagingCheck
+    {
+        StagingRing Ring;
+        FakeFence Fence;
+        std::map<uint64_t, LiveRange> Live;
+        size_t NumSubmits = 0;
+        size_t MaxInFlight = 0;
+        uint64_t PeakUsed = 0;
+        bool bPassed = true;
+
+        void Fail(const char* What)
+        {
+            if (bPassed) { std::cerr << "staging: " << What << "\n"; }
+            bPassed = false;
+        }
+
+        void Submit()
+        {
+            Fence.Signalled++;
+            Ring.Submit(Fence.Signalled);
+            for (auto& Range : Live)
+            {
+                if (Range.second.FenceValue == 0) { Range.second.FenceValue = Fence.Signalled; }
+            }
+            NumSubmits++;
+            MaxInFlight = std::max(MaxInFlight, Ring.GetNumInFlight());
+        }
+
+        // What the ring must have freed after retiring up to the fence's completed value.
+        void MirrorRetire()
+        {
+            const uint64_t Completed = Fence.GetCompletedValue();
+            for (auto It = Live.begin(); It != Live.end();)
+            {
+                It = (It->second.FenceValue != 0 && It->second.FenceValue <= Completed) ? Live.erase(It) : std::next(It);
+            }
+        }
+
+        // The new range may not overlap any range still open or in flight.
+        void CheckNew(uint64_t Offset, uint64_t Size)
+        {
+            if (Offset % Alignment != 0 || Offset + Size > RingBytes) { Fail("Allocation misaligned or past the end."); }
+            const auto Next = Live.lower_bound(Offset);
+            if (Next != Live.end() && Next->first < Offset + Size) { Fail("Allocation overlaps a range in flight."); }
+            if (Next != Live.begin() && std::prev(Next)->first + std::prev(Next)->second.Size > Offset) { Fail("Allocation overlaps a range in flight."); }
+            Live.emplace(Offset, LiveRange{ Size, 0 });
+        }
+
+        // Same loop as StaticMeshPipeline::StageArenaRange: submit what is open, then wait for the oldest batch until it fits.
+        void Stage(uint64_t Size)
+        {
+            uint64_t Offset = 0;
+            while (!Ring.Allocate(Size, Alignment, Offset))
+            {
+                if (Ring.GetOpenBytes() > 0)
+                {
+                    Submit();
+                    continue;
+                }
+                if (!Ring.WaitForOldest(Fence))
+                {
+                    Fail("Allocation failed with nothing in flight.");
+                    return;
+                }
+                MirrorRetire();
+            }
+            CheckNew(Offset, Size);
+            PeakUsed = std::max(PeakUsed, Ring.GetUsed());
+
+            uint64_t LiveBytes = 0;
+            for (const auto& Range : Live) { LiveBytes += Range.second.Size; }
+            if (Ring.GetUsed() < LiveBytes) { Fail("Ring counts fewer used bytes than are in flight."); }
+        }
+    };
+
+    bool RunRing(size_t NumOperations)
+    {
+        std::mt19937 Random(4321);
+        std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+        std::uniform_int_distribution<uint64_t> SmallSize(1, 16 * 1024);
+        std::uniform_int_distribution<uint64_t> LargeSize(16 * 1024, 3 * RingBytes);
+        std::uniform_int_distribution<uint64_t> GpuProgress(0, 2);
+
+        StagingCheck Check;
+        Check.Ring.Reset(RingBytes);
+        size_t NumUploads = 0;
+        uint64_t NumBytes = 0;
+        const auto Start = Clock::now();
+        for (size_t Operation = 1; Operation <= NumOperations && Check.bPassed; Operation++)
+        {
+            // Mostly small meshes, now and then one larger than the ring that goes up in pieces.
+            const uint64_t Size = Unit(Random) < 0.01f ? LargeSize(Random) : SmallSize(Random);
+            for (uint64_t Done = 0; Done < Size; Done += MaxChunk)
+            {
+                Check.Stage(std::min(Size - Done, MaxChunk));
+            }
+            NumUploads++;
+            NumBytes += Size;
+
+            // End of a frame: the copies are submitted and the GPU has finished some of the earlier ones.
+            if (Operation % UploadsPerFrame == 0)
+            {
+                Check.Submit();
+                Check.Fence.Completed = std::min(Check.Fence.Completed + GpuProgress(Random), Check.Fence.Signalled);
+                Check.Ring.Retire(Check.Fence.GetCompletedValue());
+                Check.MirrorRetire();
+            }
+        }
+        const double Ms = ToMs(Clock::now() - Start);
+
+        // Once everything has completed the whole ring is free again.
+        Check.Submit();
+        Check.Fence.Completed = Check.Fence.Signalled;
+        Check.Ring.Retire(Check.Fence.GetCompletedValue());
+        Check.MirrorRetire();
+        if (Check.Ring.GetUsed() != 0 || Check.Ring.GetNumInFlight() != 0 || !Check.Live.empty()) { Check.Fail("Ring not empty after every batch retired."); }
+
+        std::cout << NumUploads << " uploads, " << NumBytes / (1024.0 * 1024.0) << " MB through a " << RingBytes / 1024 << " KB ring: "
+            << Check.Ring.GetNumWraps() << " wraps, " << Check.NumSubmits << " submits, " << Check.Fence.NumWaits << " fence waits, at most "
+            << Check.MaxInFlight << " batches in flight, peak " << Check.PeakUsed / 1024 << " KB used (" << Ms << " ms)\n";
+        return Check.bPassed;
+    }
+
+    // Merged copies must write exactly what the copies they merged would have.
+    bool RunCopyMerging()
+    {
+        std::mt19937 Random(99);
+        std::uniform_int_distribution<uint32_t> Destination(0, 2);
+        std::uniform_int_distribution<uint64_t> Size(1, 256);
+        std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+        constexpr uint64_t BufferBytes = 1 << 20;
+
+        std::vector<uint8_t> Source(BufferBytes);
+        for (size_t Idx = 0; Idx < Source.size(); Idx++) { Source[Idx] = static_cast<uint8_t>(Random()); }
+
+        // Meshes staged one after another into mostly consecutive ranges, now and then into another buffer or a hole.
+        std::vector<StagedCopy> Copies;
+        std::vector<StagedCopy> Merged;
+        StagedCopy Next;
+        while (Next.SourceOffset + 256 < BufferBytes)
+        {
+            Next.Size = Size(Random);
+            if (Next.DestinationOffset + Next.Size >= BufferBytes) { break; }
+            Copies.push_back(Next);
+            StagingCopies::Append(Merged, Next);
+
+            Next.SourceOffset += Next.Size + (Unit(Random) < 0.1f ? 16 : 0);
+            Next.DestinationOffset += Next.Size + (Unit(Random) < 0.1f ? Size(Random) : 0);
+            if (Unit(Random) < 0.05f) { Next.Destination = Destination(Random); }
+        }
+
+        const auto Apply = [&Source, BufferBytes](const std::vector<StagedCopy>& List)
+        {
+            std::vector<std::vector<uint8_t>> Buffers(3, std::vector<uint8_t>(BufferBytes, 0));
+            for (const StagedCopy& Copy : List)
+            {
+                std::copy_n(Source.begin() + Copy.SourceOffset, Copy.Size, Buffers[Copy.Destination].begin() + Copy.DestinationOffset);
+            }
+            return Buffers;
+        };
+        const bool bSame = Apply(Copies) == Apply(Merged);
+        std::cout << Copies.size() << " staged copies merged into " << Merged.size() << " CopyBufferRegion calls\n";
+        if (!bSame) { std::cerr << "staging: Merged copies write different bytes.\n"; }
+        return bSame;
+    }
+}
+
+int RunStagingCommand(const std::vector<std::string>& Args)
+{
+    std::vector<size_t> Counts;
+    if (!ToolScene::ParseCounts(Args, DefaultOperationCounts, "staging", "upload", Counts)) { return 1; }
+
+    bool bPassed = RunCopyMerging();
+    for (const size_t Count : Counts)
+    {
+        bPassed &= RunRing(Count);
+    }
+
+    std::cout << "staging: " << (bPassed ? "No range in flight was handed out again and every batch retired.\n" : "Staging ring check failed!\n");
+    return bPassed ? 0 : 1;
+}
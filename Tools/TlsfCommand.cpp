@@ -0,0 +1,260 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+#include "ToolTiming.h"
+
+#include "ArenaAllocator.h"
+#include "TlsfAllocator.h"
+
+// Std
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr size_t DefaultOperationCounts[] = { 1000000 };
+    constexpr uint64_t Granularity = 64 * 1024;           // D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT.
+    constexpr uint64_t BlockSize = 64 * 1024 * 1024;       // Like the renderer's heaps.
+    constexpr size_t MaxLiveAllocations = 2048;            // Frees win once this many buffers are allocated, so the heaps settle.
+    constexpr size_t CheckEvery = 997;                     // Operations between full checks against the live allocations.
+
+    using ToolTiming::Clock;
+    using ToolTiming::ToMs;
+
+    // Buffer sizes in bytes, mostly a few granules with a long tail and now and then one larger than a block.
+    uint64_t RandomSize(std::mt19937& Random)
+    {
+        std::uniform_real_distribution<double> Unit(0.0, 1.0);
+        if (Unit(Random) < 0.002) { return BlockSize + static_cast<uint64_t>(Unit(Random) * BlockSize); }
+        return ToolTiming::LongTailSize(Random, 6.0, BlockSize / 4);
+    }
+
+    // Only remembers the blocks' sizes, and counts what was created and destroyed.
+    class FakeBlockSource final : public MemoryBlockSource
+    {
+    public:
+        std::vector<uint64_t> Sizes;
+        size_t NumCreated = 0;
+        size_t NumDestroyed = 0;
+        bool bMisused = false;
+
+        bool CreateBlock(uint32_t Block, uint64_t Size) override
+        {
+            if (Block >= Sizes.size()) { Sizes.resize(Block + 1, 0); }
+            bMisused |= Sizes[Block] != 0 || Size == 0;
+            Sizes[Block] = Size;
+            NumCreated++;
+            return true;
+        }
+
+        void DestroyBlock(uint32_t Block) override
+        {
+            bMisused |= Block >= Sizes.size() || Sizes[Block] == 0;
+            if (Block < Sizes.size()) { Sizes[Block] = 0; }
+            NumDestroyed++;
+        }
+    };
+
+    // The live allocations must lie in created blocks without overlapping, and the stats must match the gaps between them.
+    bool CheckAllocations(const TlsfAllocator& Allocator, const FakeBlockSource& Source, const std::vector<TlsfAllocation>& Live)
+    {
+        std::map<std::pair<uint32_t, uint64_t>, uint64_t> ByOffset; // Block and offset to granule rounded size.
+        uint64_t RequestedBytes = 0;
+        for (const TlsfAllocation& Allocation : Live)
+        {
+            if (Allocation.Offset % Granularity != 0 || Allocation.Block >= Source.Sizes.size()) { return false; }
+            ByOffset.emplace(std::make_pair(Allocation.Block, Allocation.Offset), (Allocation.Size + Granularity - 1) / Granularity * Granularity);
+            RequestedBytes += Allocation.Size;
+        }
+
+        TlsfStats Expected;
+        std::vector<uint64_t> Cursors(Source.Sizes.size(), 0);
+        for (const auto& Range : ByOffset)
+        {
+            const uint32_t Block = Range.first.first;
+            const uint64_t Offset = Range.first.second;
+            if (Offset < Cursors[Block] || Offset + Range.second > Source.Sizes[Block]) { return false; }
+            if (Offset > Cursors[Block])
+            {
+                Expected.NumFreeRanges++;
+                Expected.LargestFreeRange = std::max(Expected.LargestFreeRange, Offset - Cursors[Block]);
+            }
+            Cursors[Block] = Offset + Range.second;
+            Expected.AllocatedBytes += Range.second;
+        }
+        for (size_t Block = 0; Block < Source.Sizes.size(); Block++)
+        {
+            if (Source.Sizes[Block] == 0) { continue; }
+            Expected.NumBlocks++;
+            Expected.BlockBytes += Source.Sizes[Block];
+            if (Cursors[Block] < Source.Sizes[Block])
+            {
+                Expected.NumFreeRanges++;
+                Expected.LargestFreeRange = std::max(Expected.LargestFreeRange, Source.Sizes[Block] - Cursors[Block]);
+            }
+        }
+
+        const TlsfStats Stats = Allocator.GetStats();
+        return Stats.NumBlocks == Expected.NumBlocks && Stats.NumAllocations == Live.size() && Stats.NumFreeRanges == Expected.NumFreeRanges
+            && Stats.BlockBytes == Expected.BlockBytes && Stats.RequestedBytes == RequestedBytes && Stats.AllocatedBytes == Expected.AllocatedBytes
+            && Stats.LargestFreeRange == Expected.LargestFreeRange;
+    }
+
+    bool RunFuzz(size_t NumOperations)
+    {
+        std::mt19937 Random(2024);
+        std::uniform_real_distribution<double> Unit(0.0, 1.0);
+
+        FakeBlockSource Source;
+        bool bPassed = true;
+        TlsfStats Settled;
+        {
+            TlsfAllocator Allocator(Source, BlockSize, Granularity);
+            std::vector<TlsfAllocation> Live;
+            size_t PeakBlocks = 0;
+            for (size_t Operation = 1; Operation <= NumOperations && bPassed; Operation++)
+            {
+                const double FreeChance = Live.size() < MaxLiveAllocations ? 0.45 : 0.55;
+                if (!Live.empty() && Unit(Random) < FreeChance)
+                {
+                    const size_t Idx = std::uniform_int_distribution<size_t>(0, Live.size() - 1)(Random);
+                    Allocator.Free(Live[Idx]);
+                    bPassed &= !Live[Idx].IsValid();
+                    Live[Idx] = Live.back();
+                    Live.pop_back();
+                }
+                else
+                {
+                    TlsfAllocation Allocation;
+                    bPassed &= Allocator.Allocate(RandomSize(Random), Allocation);
+                    Live.push_back(Allocation);
+                }
+                PeakBlocks = std::max(PeakBlocks, Source.NumCreated - Source.NumDestroyed);
+                if (Operation % CheckEvery == 0 && !CheckAllocations(Allocator, Source, Live))
+                {
+                    std::cerr << "tlsf: Allocations overlap or the stats are wrong after " << Operation << " operations.\n";
+                    bPassed = false;
+                }
+            }
+            bPassed &= CheckAllocations(Allocator, Source, Live);
+            Settled = Allocator.GetStats();
+
+            // Freeing everything merges every block back into one range, and all but one spare block are destroyed.
+            for (TlsfAllocation& Allocation : Live) { Allocator.Free(Allocation); }
+            const TlsfStats Empty = Allocator.GetStats();
+            if (Empty.NumBlocks > 1 || Empty.NumFreeRanges != Empty.NumBlocks || Empty.AllocatedBytes != 0 || Empty.RequestedBytes != 0)
+            {
+                std::cerr << "tlsf: " << Empty.NumBlocks << " blocks and " << Empty.NumFreeRanges << " free ranges left once everything was freed.\n";
+                bPassed = false;
+            }
+
+            std::cout << NumOperations << " operations: at most " << PeakBlocks << " blocks of " << BlockSize / (1024 * 1024) << " MB, "
+                << Source.NumCreated << " created. Settled at " << Settled.NumAllocations << " allocations in " << Settled.NumBlocks << " blocks, "
+                << Settled.BlockBytes / (1024 * 1024) << " MB, " << Settled.NumFreeRanges << " free ranges, "
+                << 100.0 * Settled.GetFragmentation() << "% fragmentation, " << Settled.GetWastedBytes() / (1024 * 1024) << " MB wasted to the "
+                << Granularity / 1024 << " KB granularity\n";
+        }
+
+        // The allocator destroys what is left when it goes away.
+        if (Source.bMisused || Source.NumCreated != Source.NumDestroyed)
+        {
+            std::cerr << "tlsf: Blocks created twice, destroyed twice or leaked.\n";
+            bPassed = false;
+        }
+        return bPassed;
+    }
+
+    // The same allocations and frees through the TLSF allocator and through ArenaAllocator's first fit over one large buffer.
+    void RunBenchmark(size_t NumOperations)
+    {
+        std::mt19937 Random(7);
+        std::uniform_real_distribution<double> Unit(0.0, 1.0);
+        struct Operation
+        {
+            uint64_t Size = 0;   // 0 frees Slot.
+            size_t Slot = 0;
+        };
+        std::vector<Operation> Operations;
+        Operations.reserve(NumOperations);
+        size_t NumLive = 0;
+        for (size_t Idx = 0; Idx < NumOperations; Idx++)
+        {
+            const double FreeChance = NumLive < MaxLiveAllocations ? 0.45 : 0.55;
+            if (NumLive > 0 && Unit(Random) < FreeChance)
+            {
+                Operations.push_back(Operation{ 0, std::uniform_int_distribution<size_t>(0, NumLive - 1)(Random) });
+                NumLive--;
+            }
+            else
+            {
+                // Kept within a block, the first fit arena has no dedicated blocks.
+                Operations.push_back(Operation{ std::min(RandomSize(Random), BlockSize), NumLive });
+                NumLive++;
+            }
+        }
+
+        FakeBlockSource Source;
+        double TlsfMs = 0.0;
+        {
+            TlsfAllocator Allocator(Source, BlockSize, Granularity);
+            std::vector<TlsfAllocation> Live;
+            const auto Start = Clock::now();
+            for (const Operation& Op : Operations)
+            {
+                if (Op.Size == 0)
+                {
+                    Allocator.Free(Live[Op.Slot]);
+                    Live[Op.Slot] = Live.back();
+                    Live.pop_back();
+                    continue;
+                }
+                Live.emplace_back();
+                Allocator.Allocate(Op.Size, Live.back());
+            }
+            TlsfMs = ToMs(Clock::now() - Start);
+        }
+
+        ArenaAllocator Arena;
+        Arena.Reset(1ull << 40); // In granules, never full.
+        std::vector<std::pair<uint64_t, uint64_t>> Live;
+        const auto Start = Clock::now();
+        for (const Operation& Op : Operations)
+        {
+            if (Op.Size == 0)
+            {
+                Arena.Free(Live[Op.Slot].first, Live[Op.Slot].second);
+                Live[Op.Slot] = Live.back();
+                Live.pop_back();
+                continue;
+            }
+            const uint64_t Granules = (Op.Size + Granularity - 1) / Granularity;
+            uint64_t Offset = 0;
+            Arena.Allocate(Granules, Offset);
+            Live.emplace_back(Offset, Granules);
+        }
+        const double FirstFitMs = ToMs(Clock::now() - Start);
+
+        std::cout << "TLSF " << TlsfMs * 1e6 / NumOperations << " ns, first fit " << FirstFitMs * 1e6 / NumOperations
+            << " ns per operation over " << NumOperations << " operations\n";
+    }
+}
+
+int RunTlsfCommand(const std::vector<std::string>& Args)
+{
+    std::vector<size_t> Counts;
+    if (!ToolScene::ParseCounts(Args, DefaultOperationCounts, "tlsf", "operation", Counts)) { return 1; }
+
+    bool bPassed = true;
+    for (const size_t Count : Counts)
+    {
+        bPassed &= RunFuzz(Count);
+        RunBenchmark(Count);
+    }
+
+    std::cout << "tlsf: " << (bPassed ? "No allocations overlapped, the stats matched and freeing everything merged every block.\n" : "TLSF allocator check failed!\n");
+    return bPassed ? 0 : 1;
+}
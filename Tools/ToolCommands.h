@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Subcommands of DXRendererTools, each takes the arguments after its name and returns the process exit code.
+
+// cook <file or directory>... : Writes '<scene>.meshcache' next to every USD file, directories are searched recursively.
+int RunCookCommand(const std::vector<std::string>& Args);
+
+// meshstats <file or directory>... : Prints the vertex cache ACMR and ATVR of every mesh before and after index order optimisation.
+int RunMeshStatsCommand(const std::vector<std::string>& Args);
+
+// meshlets <file or directory>... : Builds meshlets for every mesh and reports the triangles left after object, meshlet frustum
+// and meshlet normal cone culling from a ring of views around each scene.
+int RunMeshletsCommand(const std::vector<std::string>& Args);
+
+// lods <file or directory>... : Generates the simplified LOD chain of every mesh and prints its triangle counts and errors.
+int RunLodsCommand(const std::vector<std::string>& Args);
+
+// bvh [object count]... : Times the scene BVH build, refit, frustum and ray queries and the flat culling kernel on synthetic scenes,
+// 1k, 10k and 100k objects by default. Fails when a query disagrees with brute force.
+int RunBVHCommand(const std::vector<std::string>& Args);
+
+// occlusion [file or directory]... : Checks the occlusion buffer against known answers on synthetic occluders, then reports how many
+// frustum culled instances of the given scenes their largest occluders hide from a ring of views. Fails when a check does not hold.
+int RunOcclusionCommand(const std::vector<std::string>& Args);
+
+// deform [file or directory]... : Plays a synthetic 100k vertex deforming grid and checks every written vertex against its time samples,
+// then times the deforming meshes of the given scenes over their time range. Fails when the grid does not follow its samples.
+int RunDeformCommand(const std::vector<std::string>& Args);
+
+// skinning [vertex count]... : Checks skinned and blend shaped vertices of a synthetic UsdSkel rig against UsdSkel's own skinning, then
+// benchmarks the skinning kernel on synthetic meshes, 10k and 100k vertices by default, on one core and across meshes on every core.
+// Fails when a vertex is off the reference.
+int RunSkinningCommand(const std::vector<std::string>& Args);
+
+// stageedits [file or directory]... : Checks how edits to a synthetic stage are classified into transform, primvar, topology and resync
+// edits, then nudges the points of a few meshes of the given scenes and times rebuilding only those against building every mesh.
+// Also adds an animated op to an animated prim and advances time. Fails when an edit is classified differently, or a xform cache
+// cleared after the edit evaluates other transforms than a fresh one.
+int RunStageEditsCommand(const std::vector<std::string>& Args);
+
+// hydra [file or directory]... : Syncs a synthetic stage with native and point instancing through the Hydra front-end and checks every
+// instance's transform and what edits change, then loads the given scenes through the USD traversal and through Hydra and times Hydra
+// syncing their playback, or a few point edits on static scenes. Fails when an instance or change differs from the stage.
+int RunHydraCommand(const std::vector<std::string>& Args);
+
+// triangulate [face count]... : Triangulates synthetic triangle, quad, mixed, convex and concave polygon meshes, 1M faces by default,
+// with the mesh triangulator and with HdMeshUtil and times both. Fails when the corners differ from HdMeshUtil's, or for concave faces
+// when the triangles do not cover the faces exactly.
+int RunTriangulateCommand(const std::vector<std::string>& Args);
+
+// arena [operation count]... : Fuzzes the geometry arena allocator with mesh sized allocations, frees and reloads, 1M operations by
+// default, growing and compacting it like the mesh pipeline. Fails when ranges overlap, freed neighbours are not merged or the used
+// and fragmented counts disagree with the live ranges.
+int RunArenaCommand(const std::vector<std::string>& Args);
+
+// drawsort [packet count]... : Sorts draw packets with the radix sort and with std::sort, 100k, 300k and 1M packets by default, with
+// keys like the renderer's and with many passes, PSOs and materials, and times both. Fails when the key fields do not order like
+// draws should be recorded, or the radix sort's order differs from std::sort or is not stable.
+int RunDrawSortCommand(const std::vector<std::string>& Args);
+
+// indirect [mesh count]... : Builds indirect argument buffers for synthetic frames, 10k, 100k and 1M meshes by default, in mesh
+// order and sorted, and times building them. Fails when the command layout does not match the command signature, or the commands
+// and batches differ from the direct draws of the packets with empty draws left out.
+int RunIndirectCommand(const std::vector<std::string>& Args);
+
+// staging [upload count]... : Stages mesh sized uploads, 1M by default, through a small staging ring whose batches a fake fence
+// completes a few frames late, and checks merging consecutive copies. Fails when a range still in flight is handed out again, the
+// ring is not empty once every batch has retired, or merged copies write other bytes.
+int RunStagingCommand(const std::vector<std::string>& Args);
+
+// tlsf [operation count]... : Allocates and frees buffer sized ranges, 1M operations by default, through the TLSF allocator over
+// fake 64 MB blocks, and times the same operations against ArenaAllocator's first fit. Fails when allocations overlap, the stats
+// do not match the gaps between them, or freeing everything leaves more than one empty block.
+int RunTlsfCommand(const std::vector<std::string>& Args);
+
+// quantise [file or directory]... : Round trips vertices through the quantised vertex formats and checks the error bounds,
+// always on synthetic data and additionally on every mesh of the given scenes. Fails when any bound is exceeded.
+int RunQuantiseCommand(const std::vector<std::string>& Args);
@@ -0,0 +1,127 @@
+#include "ToolScene.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <unordered_map>
+
+#include "pxr/usd/sdf/types.h"
+#include "pxr/usd/usd/primRange.h"
+#include "pxr/usd/usdGeom/primvarsAPI.h"
+#include "pxr/usd/usdGeom/tokens.h"
+#include "pxr/usd/usdGeom/xformCache.h"
+
+using namespace pxr;
+
+namespace
+{
+    bool IsUsdFile(const std::filesystem::path& Path)
+    {
+        const std::string Extension = Path.extension().string();
+        return Extension == ".usd" || Extension == ".usda" || Extension == ".usdc" || Extension == ".usdz";
+    }
+}
+
+std::vector<std::string> ToolScene::CollectUsdFiles(const std::vector<std::string>& Args, const char* CommandName)
+{
+    std::vector<std::string> Files;
+    for (const std::string& Arg : Args)
+    {
+        const std::filesystem::path Path(Arg);
+        if (std::filesystem::is_directory(Path))
+        {
+            for (const std::filesystem::directory_entry& Entry : std::filesystem::recursive_directory_iterator(Path))
+            {
+                if (Entry.is_regular_file() && IsUsdFile(Entry.path())) { Files.push_back(Entry.path().string()); }
+            }
+        }
+        else if (IsUsdFile(Path))
+        {
+            Files.push_back(Arg);
+        }
+        else
+        {
+            std::cerr << CommandName << ": Skipping '" << Arg << "', not a USD file or directory.\n";
+        }
+    }
+    return Files;
+}
+
+bool ToolScene::ParseCounts(const std::vector<std::string>& Args, std::span<const size_t> Defaults, const char* CommandName, const char* Noun,
+    std::vector<size_t>& OutCounts)
+{
+    OutCounts.assign(Defaults.begin(), Defaults.end());
+    if (Args.empty()) { return true; }
+
+    OutCounts.clear();
+    for (const std::string& Arg : Args)
+    {
+        const size_t Count = std::strtoull(Arg.c_str(), nullptr, 10);
+        if (Count == 0)
+        {
+            std::cerr << CommandName << ": Expected " << Noun << " counts, got '" << Arg << "'\n";
+            return false;
+        }
+        OutCounts.push_back(Count);
+    }
+    return true;
+}
+
+std::vector<UsdPrim> ToolScene::GatherMeshPrims(const UsdStageRefPtr& Stage)
+{
+    const TfToken MeshType("Mesh");
+    std::vector<UsdPrim> MeshPrims;
+    const auto GatherMeshes = [&](const UsdPrimRange& Range)
+    {
+        for (const UsdPrim& Prim : Range)
+        {
+            if (Prim.GetTypeName() == MeshType) { MeshPrims.push_back(Prim); }
+        }
+    };
+    GatherMeshes(Stage->TraverseAll());
+    for (const UsdPrim& Prototype : Stage->GetPrototypes())
+    {
+        GatherMeshes(UsdPrimRange(Prototype, UsdPrimAllPrimsPredicate));
+    }
+    return MeshPrims;
+}
+
+UsdGeomMesh ToolScene::DefineQuad(const UsdStageRefPtr& Stage, const SdfPath& Path, bool bWithPrimvars)
+{
+    UsdGeomMesh Mesh = UsdGeomMesh::Define(Stage, Path);
+    Mesh.CreatePointsAttr().Set(VtArray<GfVec3f>{ GfVec3f(0, 0, 0), GfVec3f(1, 0, 0), GfVec3f(1, 1, 0), GfVec3f(0, 1, 0) });
+    Mesh.CreateFaceVertexCountsAttr().Set(VtIntArray{ 4 });
+    Mesh.CreateFaceVertexIndicesAttr().Set(VtIntArray{ 0, 1, 2, 3 });
+    if (bWithPrimvars)
+    {
+        Mesh.CreateNormalsAttr().Set(VtArray<GfVec3f>(4, GfVec3f(0, 0, 1)));
+        Mesh.SetNormalsInterpolation(UsdGeomTokens->faceVarying);
+        UsdGeomPrimvarsAPI(Mesh).CreatePrimvar(TfToken("st"), SdfValueTypeNames->TexCoord2fArray, UsdGeomTokens->faceVarying)
+            .Set(VtArray<GfVec2f>{ GfVec2f(0, 0), GfVec2f(1, 0), GfVec2f(1, 1), GfVec2f(0, 1) });
+    }
+    return Mesh;
+}
+
+void ToolScene::GatherMeshInstances(const UsdStageRefPtr& Stage, std::vector<UsdPrim>& OutMeshPrims, std::vector<ToolMeshInstance>& OutInstances)
+{
+    const TfToken MeshType("Mesh");
+    std::unordered_map<SdfPath, size_t, SdfPath::Hash> MeshIndices;
+    UsdGeomXformCache XformCache;
+    for (const UsdPrim& Prim : UsdPrimRange::Stage(Stage, UsdTraverseInstanceProxies()))
+    {
+        if (Prim.GetTypeName() != MeshType) { continue; }
+
+        const UsdPrim Source = Prim.IsInstanceProxy() ? Prim.GetPrimInPrototype() : Prim;
+        const auto Found = MeshIndices.emplace(Source.GetPath(), OutMeshPrims.size());
+        if (Found.second) { OutMeshPrims.push_back(Source); }
+
+        const GfMatrix4d World = XformCache.GetLocalToWorldTransform(Prim);
+        ToolMeshInstance Instance;
+        Instance.MeshIdx = Found.first->second;
+        for (int Row = 0; Row < 4; Row++)
+        {
+            for (int Col = 0; Col < 4; Col++) { Instance.World.m[Row][Col] = static_cast<float>(World[Row][Col]); }
+        }
+        OutInstances.push_back(Instance);
+    }
+}
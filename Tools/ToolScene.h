@@ -0,0 +1,38 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "pxr/usd/usd/prim.h"
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/mesh.h"
+
+// One place a mesh is drawn, with its USD Local to World matrix as a row vector matrix.
+struct ToolMeshInstance
+{
+    size_t MeshIdx = 0;
+    DirectX::XMFLOAT4X4 World;
+};
+
+// Scene helpers shared by the tool subcommands.
+namespace ToolScene
+{
+    // USD files named in the arguments, directories are searched recursively. Anything else is reported and skipped.
+    std::vector<std::string> CollectUsdFiles(const std::vector<std::string>& Args, const char* CommandName);
+
+    // Positive counts named in the arguments, or Defaults without any. False after reporting the first argument that is not one.
+    bool ParseCounts(const std::vector<std::string>& Args, std::span<const size_t> Defaults, const char* CommandName, const char* Noun,
+        std::vector<size_t>& OutCounts);
+
+    // Every mesh the renderer can reach, including point instancer prototypes and meshes inside instancing prototypes.
+    std::vector<pxr::UsdPrim> GatherMeshPrims(const pxr::UsdStageRefPtr& Stage);
+
+    // A unit quad in the XY plane as one face. With primvars it also has the face varying normals and UVs RenderMesh requires.
+    pxr::UsdGeomMesh DefineQuad(const pxr::UsdStageRefPtr& Stage, const pxr::SdfPath& Path, bool bWithPrimvars);
+
+    // Every mesh drawn in the composed scene once, and each place it is drawn. Instance proxies share their prototype's mesh.
+    void GatherMeshInstances(const pxr::UsdStageRefPtr& Stage, std::vector<pxr::UsdPrim>& OutMeshPrims, std::vector<ToolMeshInstance>& OutInstances);
+}
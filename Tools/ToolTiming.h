@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+// Timing and workload helpers shared by the tool subcommands' benchmarks.
+namespace ToolTiming
+{
+    using Clock = std::chrono::steady_clock;
+
+    inline double ToMs(Clock::duration Duration) { return std::chrono::duration<double, std::milli>(Duration).count(); }
+
+    constexpr double MinTimedMs = 250.0; // Each measurement repeats its kernel for at least this long.
+
+    // Runs the kernel at least three times and for at least MinTimedMs, returns the total time and how often it ran.
+    template <typename Func>
+    double RepeatForMs(const Func& Run, size_t& OutRuns)
+    {
+        OutRuns = 0;
+        const auto Start = Clock::now();
+        double Elapsed = 0.0;
+        while (OutRuns < 3 || Elapsed < MinTimedMs)
+        {
+            Run();
+            OutRuns++;
+            Elapsed = ToMs(Clock::now() - Start);
+        }
+        return Elapsed;
+    }
+
+    // Sizes from 1 to MaxSize, mostly small with a long tail. Higher exponents push more of them towards 1.
+    inline uint64_t LongTailSize(std::mt19937& Random, double Exponent, uint64_t MaxSize)
+    {
+        std::uniform_real_distribution<double> Unit(0.0, 1.0);
+        return 1 + static_cast<uint64_t>(std::pow(Unit(Random), Exponent) * static_cast<double>(MaxSize - 1));
+    }
+}
@@ -0,0 +1,66 @@
+#include "ToolCommands.h"
+
+#include <functional>
+#include <iostream>
+#include <map>
+
+namespace
+{
+    int PrintUsage()
+    {
+        std::cout << "Usage: DXRendererTools <command> [args]\n"
+            << "  cook <file or directory>...        Cook the meshes of USD scenes into '<scene>.meshcache' files.\n"
+            << "  meshstats <file or directory>...   Measure the vertex cache efficiency of every mesh before and after optimisation.\n"
+            << "  meshlets <file or directory>...    Measure how many triangles meshlet frustum and cone culling rejects.\n"
+            << "  lods <file or directory>...        Print the LOD chain triangle counts and errors of every mesh.\n"
+            << "  bvh [object count]...              Benchmark the scene BVH and flat frustum culling on synthetic scenes.\n"
+            << "  occlusion [file or directory]...   Check the software occlusion buffer and measure what it culls in USD scenes.\n"
+            << "  deform [file or directory]...      Check deforming mesh playback and time it on USD scenes.\n"
+            << "  skinning [vertex count]...         Check the skinning kernel and benchmark its vertices per second per core.\n"
+            << "  stageedits [file or directory]...  Check how stage edits are classified and time rebuilding only the edited meshes.\n"
+            << "  hydra [file or directory]...       Check the Hydra front-end and compare its load and sync times with the traversal.\n"
+            << "  triangulate [face count]...        Check the mesh triangulator against HdMeshUtil and benchmark both.\n"
+            << "  arena [operation count]...         Fuzz the geometry arena allocator and time its allocations.\n"
+            << "  drawsort [packet count]...         Check the draw packet radix sort and benchmark it against std::sort.\n"
+            << "  indirect [mesh count]...           Check the indirect argument buffer builder against direct draws.\n"
+            << "  staging [upload count]...          Check the staging ring's wrap around and fence retirement with a fake fence.\n"
+            << "  tlsf [operation count]...          Fuzz the TLSF heap allocator and time it against first fit.\n"
+            << "  quantise [file or directory]...    Check the error bounds of the quantised vertex formats.\n";
+        return 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::map<std::string, std::function<int(const std::vector<std::string>&)>> Commands =
+    {
+        { "cook", RunCookCommand },
+        { "meshstats", RunMeshStatsCommand },
+        { "meshlets", RunMeshletsCommand },
+        { "lods", RunLodsCommand },
+        { "bvh", RunBVHCommand },
+        { "occlusion", RunOcclusionCommand },
+        { "deform", RunDeformCommand },
+        { "skinning", RunSkinningCommand },
+        { "stageedits", RunStageEditsCommand },
+        { "hydra", RunHydraCommand },
+        { "triangulate", RunTriangulateCommand },
+        { "arena", RunArenaCommand },
+        { "drawsort", RunDrawSortCommand },
+        { "indirect", RunIndirectCommand },
+        { "staging", RunStagingCommand },
+        { "tlsf", RunTlsfCommand },
+        { "quantise", RunQuantiseCommand },
+    };
+
+    if (argc < 2) { return PrintUsage(); }
+
+    const auto Command = Commands.find(argv[1]);
+    if (Command == Commands.end())
+    {
+        std::cerr << "Unknown command '" << argv[1] << "'\n";
+        return PrintUsage();
+    }
+
+    return Command->second(std::vector<std::string>(argv + 2, argv + argc));
+}
@@ -0,0 +1,348 @@
+#include "ToolCommands.h"
+#include "ToolScene.h"
+#include "ToolTiming.h"
+
+#include "MeshTriangulator.h"
+
+// Std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Usd
+#include "pxr/imaging/hd/meshUtil.h"
+#include "pxr/imaging/hd/vtBufferSource.h"
+#include "pxr/imaging/pxOsd/tokens.h"
+#include "pxr/usd/usdGeom/tokens.h"
+
+using namespace DirectX;
+using namespace pxr;
+
+namespace
+{
+    constexpr size_t DefaultFaceCounts[] = { 1000000 };
+    constexpr size_t MixedTriangleEvery = 5; // Every fifth cell of the mixed mesh is two triangles, breaking up the quad runs.
+    constexpr size_t MixedHoleEvery = 97;
+    constexpr double AreaTolerance = 1e-6; // Relative.
+
+    using ToolTiming::RepeatForMs;
+
+    struct TestMesh
+    {
+        std::string Name;
+        MeshSourceArrays Source;
+        bool bConcave = false; // Ear clipped, so its triangles are checked by area instead of against HdMeshUtil.
+    };
+
+    // What RenderMesh hands to welding, one position, normal and UV per triangle corner.
+    struct Corners
+    {
+        std::vector<XMFLOAT3> Positions;
+        std::vector<XMFLOAT3> Normals;
+        std::vector<XMFLOAT2> UVs;
+    };
+
+    // Distinct face varying normals and UVs so a corner read from the wrong face vertex shows.
+    void AddFaceVaryingPrimvars(MeshSourceArrays& Source)
+    {
+        const size_t NumFaceVertices = Source.FaceVertexIndices.size();
+        Source.Normals.resize(NumFaceVertices);
+        Source.UVs.resize(NumFaceVertices);
+        Source.NormalsInterpolation = UsdGeomTokens->faceVarying;
+        Source.UVsInterpolation = UsdGeomTokens->faceVarying;
+        for (size_t Idx = 0; Idx < NumFaceVertices; Idx++)
+        {
+            Source.Normals[Idx] = GfVec3f(static_cast<float>(Idx % 7), static_cast<float>(Idx % 11), static_cast<float>(Idx % 13));
+            Source.UVs[Idx] = GfVec2f(static_cast<float>(Idx % 17), static_cast<float>(Idx % 19));
+        }
+    }
+
+    // Grid of unit cells in the XY plane, counter clockwise seen from +Z.
+    void AddGridPoints(size_t Columns, size_t Rows, MeshSourceArrays& Source)
+    {
+        Source.Points.reserve((Columns + 1) * (Rows + 1));
+        for (size_t Y = 0; Y <= Rows; Y++)
+        {
+            for (size_t X = 0; X <= Columns; X++) { Source.Points.push_back(GfVec3f(static_cast<float>(X), static_cast<float>(Y), 0.0f)); }
+        }
+    }
+
+    // Cells of a grid with at least NumCells cells, as the four corners of each.
+    template <typename Func>
+    void ForEachCell(size_t NumCells, MeshSourceArrays& Source, const Func& AddCell)
+    {
+        const size_t Columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(NumCells))));
+        const size_t Rows = (NumCells + Columns - 1) / Columns;
+        AddGridPoints(Columns, Rows, Source);
+        for (size_t Cell = 0; Cell < NumCells; Cell++)
+        {
+            const int A = static_cast<int>((Cell / Columns) * (Columns + 1) + Cell % Columns);
+            const int D = A + static_cast<int>(Columns + 1);
+            AddCell(Cell, A, A + 1, D + 1, D);
+        }
+    }
+
+    void AddFace(MeshSourceArrays& Source, std::initializer_list<int> Indices)
+    {
+        Source.FaceVertexCounts.push_back(static_cast<int>(Indices.size()));
+        for (const int Index : Indices) { Source.FaceVertexIndices.push_back(Index); }
+    }
+
+    TestMesh MakeTriangleMesh(size_t NumFaces)
+    {
+        TestMesh Mesh{ "triangles" };
+        Mesh.Source.Orientation = UsdGeomTokens->rightHanded;
+        ForEachCell(std::max<size_t>(NumFaces / 2, 1), Mesh.Source, [&](size_t Cell, int A, int B, int C, int D)
+            {
+                AddFace(Mesh.Source, { A, B, C });
+                AddFace(Mesh.Source, { A, C, D });
+            });
+        AddFaceVaryingPrimvars(Mesh.Source);
+        return Mesh;
+    }
+
+    TestMesh MakeQuadMesh(size_t NumFaces)
+    {
+        TestMesh Mesh{ "quads" };
+        Mesh.Source.Orientation = UsdGeomTokens->rightHanded;
+        ForEachCell(NumFaces, Mesh.Source, [&](size_t Cell, int A, int B, int C, int D) { AddFace(Mesh.Source, { A, B, C, D }); });
+        AddFaceVaryingPrimvars(Mesh.Source);
+        return Mesh;
+    }
+
+    // Short runs of both sizes, holes and left handed winding.
+    TestMesh MakeMixedMesh(size_t NumFaces)
+    {
+        TestMesh Mesh{ "mixed, holes, left handed" };
+        Mesh.Source.Orientation = UsdGeomTokens->leftHanded;
+        ForEachCell(NumFaces, Mesh.Source, [&](size_t Cell, int A, int B, int C, int D)
+            {
+                if (Cell % MixedTriangleEvery == 0)
+                {
+                    AddFace(Mesh.Source, { A, B, C });
+                    AddFace(Mesh.Source, { A, C, D });
+                }
+                else
+                {
+                    AddFace(Mesh.Source, { A, B, C, D });
+                }
+            });
+        for (size_t Face = 0; Face < Mesh.Source.FaceVertexCounts.size(); Face += MixedHoleEvery) { Mesh.Source.HoleIndices.push_back(static_cast<int>(Face)); }
+        AddFaceVaryingPrimvars(Mesh.Source);
+        return Mesh;
+    }
+
+    // Faces with their own points, each from a corner list placed at its cell.
+    TestMesh MakePolygonMesh(const std::string& Name, size_t NumFaces, const std::vector<GfVec2f>& Shape, bool bConcave)
+    {
+        TestMesh Mesh{ Name };
+        Mesh.bConcave = bConcave;
+        Mesh.Source.Orientation = UsdGeomTokens->rightHanded;
+        const size_t Columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(NumFaces))));
+        Mesh.Source.Points.reserve(NumFaces * Shape.size());
+        for (size_t Face = 0; Face < NumFaces; Face++)
+        {
+            const GfVec2f Offset(static_cast<float>(Face % Columns) * 3.0f, static_cast<float>(Face / Columns) * 3.0f);
+            Mesh.Source.FaceVertexCounts.push_back(static_cast<int>(Shape.size()));
+            for (const GfVec2f& Corner : Shape)
+            {
+                Mesh.Source.FaceVertexIndices.push_back(static_cast<int>(Mesh.Source.Points.size()));
+                Mesh.Source.Points.push_back(GfVec3f(Offset[0] + Corner[0], Offset[1] + Corner[1], 0.0f));
+            }
+        }
+        AddFaceVaryingPrimvars(Mesh.Source);
+        return Mesh;
+    }
+
+    std::vector<GfVec2f> MakeOctagon()
+    {
+        std::vector<GfVec2f> Shape;
+        for (int Corner = 0; Corner < 8; Corner++)
+        {
+            const double Angle = Corner * 3.14159265358979323846 / 4.0;
+            Shape.push_back(GfVec2f(static_cast<float>(1.0 + std::cos(Angle)), static_cast<float>(1.0 + std::sin(Angle))));
+        }
+        return Shape;
+    }
+
+    // A comb, where fanning from the first corner crosses outside the face.
+    std::vector<GfVec2f> MakeComb()
+    {
+        return { GfVec2f(0.0f, 0.0f), GfVec2f(2.0f, 0.0f), GfVec2f(2.0f, 2.0f), GfVec2f(1.5f, 2.0f), GfVec2f(1.5f, 0.5f),
+            GfVec2f(1.0f, 0.5f), GfVec2f(1.0f, 2.0f), GfVec2f(0.5f, 2.0f), GfVec2f(0.5f, 0.5f), GfVec2f(0.0f, 0.5f) };
+    }
+
+    // The old RenderMesh path, HdMeshUtil with the primvars boxed through VtValue.
+    void TriangulateWithMeshUtil(const MeshSourceArrays& Source, Corners& Out)
+    {
+        const HdMeshTopology Topology(PxOsdOpenSubdivTokens->none, Source.Orientation, Source.FaceVertexCounts, Source.FaceVertexIndices, Source.HoleIndices);
+        HdMeshUtil MeshUtil(&Topology, SdfPath("/Bench"));
+        VtVec3iArray Triangles;
+        VtIntArray Params;
+        MeshUtil.ComputeTriangleIndices(&Triangles, &Params);
+
+        Out.Positions.clear();
+        Out.Positions.reserve(Triangles.size() * 3);
+        for (const GfVec3i& Triangle : Triangles)
+        {
+            for (int Corner = 0; Corner < 3; Corner++)
+            {
+                const GfVec3f& P = Source.Points[Triangle[Corner]];
+                Out.Positions.push_back(XMFLOAT3(P[0], P[1], P[2]));
+            }
+        }
+
+        VtValue Normals;
+        HdVtBufferSource NormalsBuffer(TfToken("TempN"), VtValue(Source.Normals));
+        MeshUtil.ComputeTriangulatedFaceVaryingPrimvar(NormalsBuffer.GetData(), static_cast<int>(NormalsBuffer.GetNumElements()), NormalsBuffer.GetTupleType().type, &Normals);
+        const VtArray<GfVec3f> TriangulatedNormals = Normals.Get<VtArray<GfVec3f>>();
+        Out.Normals.resize(TriangulatedNormals.size());
+        for (size_t Idx = 0; Idx < TriangulatedNormals.size(); Idx++)
+        {
+            Out.Normals[Idx] = XMFLOAT3(TriangulatedNormals[Idx][0], TriangulatedNormals[Idx][1], TriangulatedNormals[Idx][2]);
+        }
+
+        VtValue UVs;
+        HdVtBufferSource UVsBuffer(TfToken("TempUvs"), VtValue(Source.UVs));
+        MeshUtil.ComputeTriangulatedFaceVaryingPrimvar(UVsBuffer.GetData(), static_cast<int>(UVsBuffer.GetNumElements()), UVsBuffer.GetTupleType().type, &UVs);
+        const VtArray<GfVec2f> TriangulatedUVs = UVs.Get<VtArray<GfVec2f>>();
+        Out.UVs.resize(TriangulatedUVs.size());
+        for (size_t Idx = 0; Idx < TriangulatedUVs.size(); Idx++) { Out.UVs[Idx] = XMFLOAT2(TriangulatedUVs[Idx][0], TriangulatedUVs[Idx][1]); }
+    }
+
+    // The new RenderMesh path, every primvar gathered from the corners in one pass.
+    bool TriangulateWithTriangulator(const MeshSourceArrays& Source, std::vector<uint32_t>& Scratch, Corners& Out, MeshTriangulator::TriangulationStats* Stats = nullptr)
+    {
+        if (!MeshTriangulator::Triangulate(Source, Scratch, Stats)) { return false; }
+
+        Out.Positions.resize(Scratch.size());
+        Out.Normals.resize(Scratch.size());
+        Out.UVs.resize(Scratch.size());
+        for (size_t Idx = 0; Idx < Scratch.size(); Idx++)
+        {
+            const uint32_t Corner = Scratch[Idx];
+            const GfVec3f& P = Source.Points[Source.FaceVertexIndices[Corner]];
+            const GfVec3f& N = Source.Normals[Corner];
+            const GfVec2f& UV = Source.UVs[Corner];
+            Out.Positions[Idx] = XMFLOAT3(P[0], P[1], P[2]);
+            Out.Normals[Idx] = XMFLOAT3(N[0], N[1], N[2]);
+            Out.UVs[Idx] = XMFLOAT2(UV[0], UV[1]);
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool SameCorners(const std::vector<T>& A, const std::vector<T>& B)
+    {
+        return A.size() == B.size() && (A.empty() || memcmp(A.data(), B.data(), A.size() * sizeof(T)) == 0);
+    }
+
+    // Triangle area in the XY plane, positive when counter clockwise.
+    double SignedArea(const XMFLOAT3& A, const XMFLOAT3& B, const XMFLOAT3& C)
+    {
+        return 0.5 * ((static_cast<double>(B.x) - A.x) * (static_cast<double>(C.y) - A.y) - (static_cast<double>(B.y) - A.y) * (static_cast<double>(C.x) - A.x));
+    }
+
+    double PolygonArea(const std::vector<GfVec2f>& Shape)
+    {
+        double Area = 0.0;
+        for (size_t Idx = 0; Idx < Shape.size(); Idx++)
+        {
+            const GfVec2f& P = Shape[Idx];
+            const GfVec2f& Q = Shape[(Idx + 1) % Shape.size()];
+            Area += 0.5 * (static_cast<double>(P[0]) * Q[1] - static_cast<double>(Q[0]) * P[1]);
+        }
+        return Area;
+    }
+
+    // Counter clockwise faces cover exactly their area when no triangle is flipped and the areas add up.
+    bool CheckCoverage(const Corners& Triangles, double ExpectedArea, size_t& OutFlipped)
+    {
+        double Area = 0.0;
+        OutFlipped = 0;
+        for (size_t Idx = 0; Idx + 2 < Triangles.Positions.size(); Idx += 3)
+        {
+            const double TriangleArea = SignedArea(Triangles.Positions[Idx], Triangles.Positions[Idx + 1], Triangles.Positions[Idx + 2]);
+            if (TriangleArea < 0.0) { OutFlipped++; }
+            Area += std::abs(TriangleArea);
+        }
+        return OutFlipped == 0 && std::abs(Area - ExpectedArea) <= AreaTolerance * ExpectedArea;
+    }
+
+    bool RunMesh(const TestMesh& Mesh, double ExpectedArea)
+    {
+        Corners Reference;
+        Corners Result;
+        std::vector<uint32_t> Scratch;
+        MeshTriangulator::TriangulationStats Stats;
+        TriangulateWithMeshUtil(Mesh.Source, Reference);
+        if (!TriangulateWithTriangulator(Mesh.Source, Scratch, Result, &Stats))
+        {
+            std::cerr << "triangulate: '" << Mesh.Name << "' was rejected.\n";
+            return false;
+        }
+
+        bool bPassed = true;
+        size_t NumFlipped = 0;
+        size_t NumMeshUtilFlipped = 0;
+        if (Mesh.bConcave)
+        {
+            bPassed = CheckCoverage(Result, ExpectedArea, NumFlipped);
+            CheckCoverage(Reference, ExpectedArea, NumMeshUtilFlipped);
+        }
+        else
+        {
+            bPassed = SameCorners(Result.Positions, Reference.Positions) && SameCorners(Result.Normals, Reference.Normals) && SameCorners(Result.UVs, Reference.UVs);
+        }
+
+        size_t MeshUtilRuns = 0;
+        size_t TriangulatorRuns = 0;
+        const double MeshUtilMs = RepeatForMs([&]() { TriangulateWithMeshUtil(Mesh.Source, Reference); }, MeshUtilRuns) / MeshUtilRuns;
+        const double TriangulatorMs = RepeatForMs([&]() { TriangulateWithTriangulator(Mesh.Source, Scratch, Result); }, TriangulatorRuns) / TriangulatorRuns;
+
+        std::cout << Mesh.Name << ", " << Mesh.Source.FaceVertexCounts.size() << " faces -> " << Result.Positions.size() / 3 << " triangles:\n"
+            << "    HdMeshUtil   " << MeshUtilMs << " ms\n"
+            << "    triangulator " << TriangulatorMs << " ms, " << MeshUtilMs / TriangulatorMs << "x, " << Stats.NumRuns << " triangle and quad runs, "
+            << Stats.NumConvexPolygons << " convex and " << Stats.NumConcavePolygons << " concave polygons, " << Stats.NumSkippedFaces << " skipped\n";
+        if (Mesh.bConcave)
+        {
+            std::cout << "    " << NumFlipped << " flipped triangles, " << NumMeshUtilFlipped << " from HdMeshUtil's fan\n";
+        }
+
+        if (!bPassed)
+        {
+            std::cerr << "triangulate: '" << Mesh.Name << (Mesh.bConcave ? "' does not cover its faces.\n" : "' differs from HdMeshUtil.\n");
+        }
+        return bPassed;
+    }
+
+    bool RunBenchmark(size_t NumFaces)
+    {
+        const std::vector<GfVec2f> Octagon = MakeOctagon();
+        const std::vector<GfVec2f> Comb = MakeComb();
+
+        bool bPassed = RunMesh(MakeTriangleMesh(NumFaces), 0.0);
+        bPassed &= RunMesh(MakeQuadMesh(NumFaces), 0.0);
+        bPassed &= RunMesh(MakeMixedMesh(NumFaces), 0.0);
+        bPassed &= RunMesh(MakePolygonMesh("convex octagons", NumFaces, Octagon, false), 0.0);
+        bPassed &= RunMesh(MakePolygonMesh("concave combs", NumFaces, Comb, true), PolygonArea(Comb) * NumFaces);
+        return bPassed;
+    }
+}
+
+int RunTriangulateCommand(const std::vector<std::string>& Args)
+{
+    std::vector<size_t> Counts;
+    if (!ToolScene::ParseCounts(Args, DefaultFaceCounts, "triangulate", "face", Counts)) { return 1; }
+
+    bool bPassed = true;
+    for (const size_t Count : Counts)
+    {
+        bPassed &= RunBenchmark(Count);
+    }
+
+    std::cout << "triangulate: " << (bPassed ? "Triangles match HdMeshUtil and cover every concave face.\n" : "Triangulation check failed!\n");
+    return bPassed ? 0 : 1;
+}